@@ -0,0 +1,94 @@
+#include "arena.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+struct ArenaSlab {
+    ArenaSlab *next;
+    size_t size;                // usable bytes, after the header
+};
+
+#define SLAB_HEADER ARENA_ROUND(sizeof(ArenaSlab))
+
+static __thread ArenaSlab *slabCache;
+static __thread int cachedSlabs;
+
+static char *slab_data(ArenaSlab *slab) {
+    return (char *)slab + SLAB_HEADER;
+}
+
+static ArenaSlab *slab_take(size_t size) {
+    ArenaSlab *slab;
+    if (size <= ARENA_SLAB_SIZE && slabCache) {
+        slab = slabCache;
+        slabCache = slab->next;
+        cachedSlabs--;
+        return slab;
+    }
+    if (size < ARENA_SLAB_SIZE) size = ARENA_SLAB_SIZE;
+    slab = malloc(SLAB_HEADER + size);
+    if (slab) slab->size = size;
+    return slab;
+}
+
+static void slab_give(ArenaSlab *slab) {
+    if (slab->size != ARENA_SLAB_SIZE || cachedSlabs >= ARENA_CACHE_SLABS) {
+        free(slab);
+        return;
+    }
+    slab->next = slabCache;
+    slabCache = slab;
+    cachedSlabs++;
+}
+
+void *arena_alloc(Arena *arena, size_t size) {
+    size = ARENA_ROUND(size);
+    if (!arena->slabs || arena->used + size > arena->slabs->size) {
+        ArenaSlab *slab = slab_take(size);
+        if (!slab) return NULL;
+        slab->next = arena->slabs;
+        arena->slabs = slab;
+        arena->used = 0;
+        arena->footprint += slab->size;
+    }
+    void *p = slab_data(arena->slabs) + arena->used;
+    arena->used += size;
+    return p;
+}
+
+void *arena_calloc(Arena *arena, size_t size) {
+    void *p = arena_alloc(arena, size);
+    if (p) memset(p, 0, size);
+    return p;
+}
+
+ArenaMark arena_mark(const Arena *arena) {
+    return (ArenaMark){arena->slabs, arena->used};
+}
+
+void arena_rewind(Arena *arena, ArenaMark mark) {
+    while (arena->slabs != mark.slab) {
+        ArenaSlab *slab = arena->slabs;
+        arena->slabs = slab->next;
+        arena->footprint -= slab->size;
+        slab_give(slab);
+    }
+    arena->used = mark.used;
+}
+
+void arena_release(Arena *arena) {
+    arena_rewind(arena, (ArenaMark){NULL, 0});
+}
+
+void arena_trim(void) {
+    while (slabCache) {
+        ArenaSlab *slab = slabCache;
+        slabCache = slab->next;
+        free(slab);
+    }
+    cachedSlabs = 0;
+}
+
+int arena_cached_slabs(void) {
+    return cachedSlabs;
+}
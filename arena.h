@@ -0,0 +1,49 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+// A bump allocator for memory that lives as long as one game session.
+// Allocations are carved in order from fixed-size slabs and never freed
+// one by one; arena_release gives all of the slabs back at once. Released
+// slabs go to a cache kept per thread, so once it is warm sessions start,
+// play and end without calling malloc, and nothing fragments however long
+// the server runs. An allocation larger than a slab gets a slab of its
+// own, which is freed rather than cached.
+#define ARENA_SLAB_SIZE 4096            // usable bytes per slab
+#define ARENA_CACHE_SLABS 8192          // cached per thread; more are freed on release
+#define ARENA_ALIGN 16
+#define ARENA_ROUND(n) (((n) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+typedef struct ArenaSlab ArenaSlab;
+
+// Zeroed means empty: no slab is taken until the first allocation.
+typedef struct {
+    ArenaSlab *slabs;           // newest first; allocations come from the first
+    size_t used;                // bytes taken from the first slab
+    size_t footprint;           // usable bytes of all the slabs held
+} Arena;
+
+// A point to go back to after scratch allocations.
+typedef struct {
+    ArenaSlab *slab;
+    size_t used;
+} ArenaMark;
+
+// ARENA_ALIGN aligned and uninitialized, or NULL if no slab could be had.
+void *arena_alloc(Arena *arena, size_t size);
+// The same, zero-filled.
+void *arena_calloc(Arena *arena, size_t size);
+
+ArenaMark arena_mark(const Arena *arena);
+// Drops everything allocated since the mark; slabs taken since go back to the cache.
+void arena_rewind(Arena *arena, ArenaMark mark);
+
+// Gives every slab to the calling thread's cache, leaving the arena empty.
+void arena_release(Arena *arena);
+// Frees the calling thread's cached slabs.
+void arena_trim(void);
+// Slabs in the calling thread's cache.
+int arena_cached_slabs(void);
+
+#endif
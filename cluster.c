@@ -0,0 +1,108 @@
+#include "cluster.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+static int cluster_address(const char *path, struct sockaddr_un *addr) {
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr->sun_path)) return -1;
+    strcpy(addr->sun_path, path);
+    return 0;
+}
+
+int cluster_connect(const char *path) {
+    struct sockaddr_un addr;
+    if (cluster_address(path, &addr) != 0) return -1;
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    int flags;
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || (flags = fcntl(fd, F_GETFL)) < 0 ||
+        fcntl(fd, F_SETFL, flags | O_NONBLOCK) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int cluster_listen(const char *path) {
+    struct sockaddr_un addr;
+    if (cluster_address(path, &addr) != 0) return -1;
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (fd < 0) return -1;
+    unlink(path);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 16) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int cluster_send(int fd, const ClusterMsg *msg, const char *data, size_t len, const int *fds, int numFds) {
+    struct iovec iov[2] = {{(void *)msg, sizeof(*msg)}, {(void *)data, len}};
+    union {
+        char buf[CMSG_SPACE(2 * sizeof(int))];
+        struct cmsghdr align;
+    } control;
+    struct msghdr mh = {0};
+    mh.msg_iov = iov;
+    mh.msg_iovlen = len ? 2 : 1;
+    if (numFds > 0) {
+        if (numFds > 2) return -1;
+        memset(&control, 0, sizeof(control));
+        mh.msg_control = control.buf;
+        mh.msg_controllen = CMSG_SPACE(numFds * sizeof(int));
+        struct cmsghdr *cm = CMSG_FIRSTHDR(&mh);
+        cm->cmsg_level = SOL_SOCKET;
+        cm->cmsg_type = SCM_RIGHTS;
+        cm->cmsg_len = CMSG_LEN(numFds * sizeof(int));
+        memcpy(CMSG_DATA(cm), fds, numFds * sizeof(int));
+    }
+    ssize_t n;
+    do n = sendmsg(fd, &mh, MSG_NOSIGNAL);
+    while (n < 0 && errno == EINTR);
+    return n == (ssize_t)(sizeof(*msg) + len) ? 0 : -1;
+}
+
+int cluster_recv(int fd, ClusterMsg *msg, char *buf, size_t size, int *fds, int maxFds, int *numFds) {
+    struct iovec iov[2] = {{msg, sizeof(*msg)}, {buf, size}};
+    union {
+        char buf[CMSG_SPACE(2 * sizeof(int))];
+        struct cmsghdr align;
+    } control;
+    struct msghdr mh = {0};
+    mh.msg_iov = iov;
+    mh.msg_iovlen = 2;
+    mh.msg_control = control.buf;
+    mh.msg_controllen = sizeof(control.buf);
+    *numFds = 0;
+    ssize_t n;
+    do n = recvmsg(fd, &mh, MSG_CMSG_CLOEXEC);
+    while (n < 0 && errno == EINTR);
+    // Descriptors that arrived are ours to close, even with a bad message.
+    if (n < 0) mh.msg_controllen = 0;
+    for (struct cmsghdr *cm = CMSG_FIRSTHDR(&mh); cm; cm = CMSG_NXTHDR(&mh, cm)) {
+        if (cm->cmsg_level != SOL_SOCKET || cm->cmsg_type != SCM_RIGHTS) continue;
+        int count = (cm->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        int received[2];
+        if (count > 2) count = 2;
+        memcpy(received, CMSG_DATA(cm), count * sizeof(int));
+        for (int i = 0; i < count; i++) {
+            if (*numFds < maxFds) fds[(*numFds)++] = received[i];
+            else close(received[i]);
+        }
+    }
+    if (n < (ssize_t)sizeof(*msg) || (mh.msg_flags & MSG_TRUNC)) {
+        int error = n < 0 ? errno : ECONNRESET;
+        for (int i = 0; i < *numFds; i++) close(fds[i]);
+        *numFds = 0;
+        errno = error;
+        return -1;
+    }
+    return (int)(n - sizeof(*msg));
+}
@@ -0,0 +1,56 @@
+#ifndef CLUSTER_H
+#define CLUSTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Cluster mode: game_coordinator accepts the players, pairs those asking
+// for the same game and hands each pair to the least loaded of several
+// game_server nodes on the same host. Nodes register over a Unix
+// SOCK_SEQPACKET socket and report their load; a handoff carries the
+// player sockets themselves (SCM_RIGHTS), so a node serves them exactly
+// as if it had accepted them.
+
+#define CLUSTER_MAX_GAMES 16
+#define CLUSTER_MAX_INPUT 4096          // unread input passed with one connection
+#define CLUSTER_GAME_NAMES_SIZE 256
+
+typedef enum {
+    CLUSTER_HELLO,              // node -> coordinator: pid and game names
+    CLUSTER_LOAD,               // node -> coordinator: load report
+    CLUSTER_HANDOFF,            // coordinator -> node: one or two connections
+} ClusterMsgType;
+
+typedef struct {
+    uint32_t type;
+    int32_t pid;
+    // CLUSTER_LOAD
+    uint32_t sessions;
+    uint32_t clients;
+    uint32_t cpuPermille;       // CPU time over wall time since the last report
+    uint32_t queueDepth[CLUSTER_MAX_GAMES];
+    // CLUSTER_HANDOFF: the game the connections asked for (-1 = none yet:
+    // the node reads their input as usual), how many came, and how many
+    // bytes of input each had sent that the coordinator did not use
+    int32_t gameType;
+    uint32_t count;
+    uint32_t inputLen[2];
+    // Followed by the game names, comma separated (hello), or the input
+    // of each connection in turn (handoff)
+} ClusterMsg;
+
+// Nodes: connects to the coordinator. Returns the socket, non-blocking, or -1.
+int cluster_connect(const char *path);
+// Coordinator: listens for nodes, replacing a stale socket file.
+int cluster_listen(const char *path);
+
+// One message with data after it and fds attached. Returns 0 or -1.
+int cluster_send(int fd, const ClusterMsg *msg, const char *data, size_t len, const int *fds, int numFds);
+// Reads one message into msg and buf (data after the header, up to size
+// bytes) and up to maxFds passed descriptors into fds. Returns the data
+// length, or -1 with errno set when the peer closed (ECONNRESET) or the
+// read failed (EAGAIN on a non-blocking socket with nothing queued);
+// *numFds gets the number of descriptors received.
+int cluster_recv(int fd, ClusterMsg *msg, char *buf, size_t size, int *fds, int maxFds, int *numFds);
+
+#endif
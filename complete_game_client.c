@@ -2,26 +2,138 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <strings.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include "game_rules.h"
+#include "wordle_dict.h"
 
 #define PORT 8081
 #define MAX 256
 #define BUFFER_SIZE 2048
 #define SA struct sockaddr
 
-int read_line(int sockfd, char *buf, int size) {
-    int n = 0;
-    while (n < size - 1) {
-        char c;
-        int bytes = read(sockfd, &c, 1);
-        if (bytes <= 0) return bytes;
-        if (c == '\n') break;
-        buf[n++] = c;
-    }
-    buf[n] = '\0';
-    return n;
+// Buffered line framing: each read() takes whatever the kernel has, and
+// complete lines are handed out of the buffer one at a time.
+typedef struct {
+    int fd;
+    char buf[BUFFER_SIZE * 2];
+    int start, len;
+    int closed;
+} LineReader;
+
+LineReader server = {-1};
+LineReader input = {STDIN_FILENO};
+
+// What the client knows of the game, from the server's own messages, to
+// catch input the server would refuse without a round trip.
+int myTurn;
+int myPlayer = 1;
+ChessBoard chessBoard;
+Piece chessPieces[8][8];
+int chessBoardKnown;
+int tttRows, tttCols, tttBoardRow;
+TttMask tttOccupied, tttPending;
+
+// Reads once; returns 0 once the other end has closed.
+int reader_fill(LineReader *r) {
+    if (r->start > 0) {
+        memmove(r->buf, r->buf + r->start, r->len);
+        r->start = 0;
+    }
+    if (r->len == (int)sizeof(r->buf) - 1) return 1;
+    int n = read(r->fd, r->buf + r->len, sizeof(r->buf) - 1 - r->len);
+    if (n < 0 && errno == EINTR) return 1;
+    if (n <= 0) {
+        r->closed = 1;
+        return 0;
+    }
+    r->len += n;
+    return 1;
+}
+
+// The next buffered line without its newline, or NULL until one is complete.
+// A line that fills the whole buffer, or the tail left at end of input,
+// is returned as it is.
+char *reader_next(LineReader *r) {
+    char *line = r->buf + r->start;
+    char *nl = memchr(line, '\n', r->len);
+    int len;
+    if (nl) {
+        len = nl - line;
+        r->start += len + 1;
+        r->len -= len + 1;
+    } else if (r->len > 0 && (r->closed || r->len == (int)sizeof(r->buf) - 1)) {
+        len = r->len;
+        r->start += len;
+        r->len = 0;
+    } else {
+        return NULL;
+    }
+    line[len] = '\0';
+    if (len > 0 && line[len - 1] == '\r') line[len - 1] = '\0';
+    return line;
+}
+
+// Returns the line length, or -1 once the other end has closed.
+int read_line(LineReader *r, char *buf, int size) {
+    char *line;
+    while (!(line = reader_next(r)))
+        if (r->closed || !reader_fill(r)) {
+            if (!(line = reader_next(r))) return -1;
+            break;
+        }
+    snprintf(buf, size, "%s", line);
+    return strlen(buf);
+}
+
+// Sends one newline-terminated command, exactly as long as it is.
+void send_command(const char *fmt, const char *arg) {
+    char cmd[MAX];
+    int len = snprintf(cmd, sizeof(cmd) - 1, fmt, arg);
+    if (len < 0) return;
+    if (len > (int)sizeof(cmd) - 2) len = sizeof(cmd) - 2;
+    cmd[len++] = '\n';
+    for (int sent = 0; sent < len;) {
+        int n = write(server.fd, cmd + sent, len - sent);
+        if (n <= 0) return;
+        sent += n;
+    }
+}
+
+// A game's screen: one handler for each line from the server and one for
+// each line the player types. Either returns 1 when the game is over.
+typedef struct {
+    int (*serverLine)(char *line);
+    int (*userLine)(char *line);
+} GameUi;
+
+// Waits on the server and the keyboard together, so updates are shown as
+// soon as they arrive even while the player is typing.
+void run_game(const GameUi *ui) {
+    struct pollfd fds[2] = {{server.fd, POLLIN, 0}, {input.fd, POLLIN, 0}};
+    while (1) {
+        char *line;
+        while ((line = reader_next(&server)))
+            if (ui->serverLine(line)) return;
+        if (server.closed) {
+            printf("\033[1;31mServer disconnected\033[0m\n");
+            return;
+        }
+        if (poll(fds, input.closed ? 1 : 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        if (fds[0].revents) reader_fill(&server);
+        if (!input.closed && fds[1].revents) {
+            reader_fill(&input);
+            while ((line = reader_next(&input)))
+                if (ui->userLine(line)) return;
+        }
+    }
 }
 
 void display_sl_board(char *board_msg) {
@@ -49,207 +161,365 @@ void display_sl_board(char *board_msg) {
     fflush(stdout);
 }
 
-void playWordle(int sockfd) {
-    char buff[MAX];
-    int n;
-    while (1) {
-        bzero(buff, MAX);
-        read(sockfd, buff, sizeof(buff));
-        printf("%s", buff);
-        fflush(stdout);
-        if (strstr(buff, "Game over") || strstr(buff, "wins!") || strstr(buff, "disconnected")) {
-            break;
-        }
-        if (strstr(buff, "Enter a 5-letter guess")) {
-            bzero(buff, MAX);
-            n = 0;
-            printf("Your guess: ");
-            fflush(stdout);
-            while ((buff[n++] = getchar()) != '\n');
-            buff[n-1] = '\0';
-            write(sockfd, buff, sizeof(buff));
-            if (strncmp(buff, "exit", 4) == 0) {
-                printf("Client exiting...\n");
-                fflush(stdout);
-                break;
-            }
+int wordleServerLine(char *line) {
+    printf("%s\n", line);
+    if (strstr(line, "Game over") || strstr(line, "wins!") || strstr(line, "disconnected")) return 1;
+    if (strstr(line, "Enter a 5-letter guess")) {
+        myTurn = 1;
+        printf("Your guess: ");
+    }
+    return 0;
+}
+
+int wordleUserLine(char *line) {
+    if (strncmp(line, "exit", 4) == 0) {
+        send_command("%s", line);
+        printf("Client exiting...\n");
+        return 1;
+    }
+    if (!myTurn) {
+        printf("Not your turn.\n");
+        return 0;
+    }
+    if (strncasecmp(line, "HINT", 4) != 0) {
+        char guess[6];
+        snprintf(guess, sizeof(guess), "%s", line);
+        const char *problem = wordle_check_guess(guess);
+        if (problem) {
+            printf("%s\nYour guess: ", problem);
+            return 0;
         }
     }
+    myTurn = 0;
+    send_command("%s", line);
+    return 0;
+}
+
+// The server sends the board as several lines; only the control lines
+// need more than printing.
+int chessServerLine(char *line) {
+    if (strncmp(line, "BOARD_UPDATE", 12) == 0) return 0;
+    sscanf(line, "Connected as Player %d", &myPlayer);
+    if (chess_parse_board_row(line, &chessBoard, chessPieces)) chessBoardKnown = 1;
+    if (strncmp(line, "TURN", 4) == 0) {
+        myTurn = 1;
+        printf("\n\033[1;36m♟ Your Turn! ♟\033[0m Enter move (e.g., 'P1 e5', 'K1B c6'): ");
+    } else if (strstr(line, "WINNER:")) {
+        printf("\n\033[1;32m🏆 %s 🏆\033[0m\n", strstr(line, "WINNER:") + 7);
+        return 1;
+    } else {
+        printf("%s\n", line);
+        if (strstr(line, "Game ended")) return 1;
+    }
+    return 0;
 }
 
-void playChess(int sockfd) {
-    char buffer[BUFFER_SIZE];
-    int expecting_board = 0;
-    while (1) {
-        bzero(buffer, BUFFER_SIZE);
-        int n = read(sockfd, buffer, BUFFER_SIZE);
-        if (n <= 0) {
-            printf("\033[1;31mServer disconnected\033[0m\n");
-            fflush(stdout);
-            break;
+int chessUserLine(char *line) {
+    if (!myTurn) {
+        printf("Not your turn.\n");
+        return 0;
+    }
+    char pieceId[4] = "", to[3] = "", feedback[100];
+    int fromX, fromY, toX, toY;
+    sscanf(line, "%3s %2s", pieceId, to);
+    if (chessBoardKnown && !check_chess_move(&chessBoard, pieceId, to, myPlayer == 1 ? WHITE : BLACK,
+                                             &fromX, &fromY, &toX, &toY, feedback)) {
+        printf("%s\n\033[1;36m♟ Your Turn! ♟\033[0m Enter move (e.g., 'P1 e5', 'K1B c6'): ", feedback);
+        return 0;
+    }
+    myTurn = 0;
+    send_command("MOVE:%s", line);
+    return 0;
+}
+
+int snakeLadderServerLine(char *line) {
+    if (strncmp(line, "WELCOME:", 8) == 0) {
+        int player_id = -1;
+        sscanf(line + 8, "Player %d", &player_id);
+        printf("You are Player %d\n", player_id);
+    } else if (strncmp(line, "BOARD:", 6) == 0) {
+        display_sl_board(line);
+    } else if (strncmp(line, "GAME_START", 10) == 0) {
+        printf("\n\033[1;33mGame Started!\033[0m\n");
+    } else if (strncmp(line, "NEW_PLAYER:", 11) == 0) {
+        printf("%s", line + 11);
+    } else if (strncmp(line, "TURN", 4) == 0) {
+        printf("\n\033[1;36mYour Turn!\033[0m Enter 'roll' to roll the dice: ");
+    } else if (strncmp(line, "ROLLED:", 7) == 0) {
+        int p_id, roll;
+        sscanf(line + 7, "P%d=%d", &p_id, &roll);
+        printf("Player %d rolled a %d\n", p_id, roll);
+    } else if (strncmp(line, "SNAKE:", 6) == 0) {
+        int p_id, from, to;
+        sscanf(line + 6, "P%d=%d-%d", &p_id, &from, &to);
+        printf("\033[31mPlayer %d slid down a snake from %d to %d\033[0m\n", p_id, from, to);
+    } else if (strncmp(line, "LADDER:", 7) == 0) {
+        int p_id, from, to;
+        sscanf(line + 7, "P%d=%d-%d", &p_id, &from, &to);
+        printf("\033[32mPlayer %d climbed a ladder from %d to %d\033[0m\n", p_id, from, to);
+    } else if (strncmp(line, "POSITIONS:", 10) == 0) {
+        printf("\n\033[1mPlayer Positions:\033[0m\n");
+        char *token = strtok(line + 10, ",");
+        while (token != NULL) {
+            int p_id, pos;
+            sscanf(token, "P%d=%d", &p_id, &pos);
+            printf("Player \033[1m%d\033[0m: %d\n", p_id, pos);
+            token = strtok(NULL, ",");
         }
-        buffer[n] = '\0';
-        printf("[DEBUG] Received message: %s\n", buffer);
-        fflush(stdout);
+    } else if (strncmp(line, "WINNER:", 7) == 0) {
+        printf("\n\033[1;32m%s wins!\033[0m\n", line + 7);
+        return 1;
+    } else if (line[0]) {
+        printf("%s\n", line);
+    }
+    return 0;
+}
 
-        if (strncmp(buffer, "WELCOME:", 8) == 0) {
-            printf("%s\n", buffer);
-            fflush(stdout);
-        } else if (strncmp(buffer, "MOVE:", 5) == 0) {
-            printf("%s\n", buffer);
-            fflush(stdout);
-        } else if (strncmp(buffer, "BOARD_UPDATE", 12) == 0) {
-            printf("[DEBUG] Received BOARD_UPDATE, expecting board next\n");
-            fflush(stdout);
-            expecting_board = 1;
-            continue;
-        } else if (strncmp(buffer, "TURN", 4) == 0) {
-            printf("[DEBUG] Received TURN\n");
-            fflush(stdout);
-            printf("\n\033[1;36m♟ Your Turn! ♟\033[0m Enter move (e.g., 'P1 e5', 'K1B c6'): ");
-            fflush(stdout);
-            char move[10];
-            fgets(move, sizeof(move), stdin);
-            move[strcspn(move, "\n")] = '\0';
-            char cmd[20];
-            snprintf(cmd, sizeof(cmd), "MOVE:%s\n", move);
-            write(sockfd, cmd, strlen(cmd));
-        } else if (strncmp(buffer, "WINNER:", 7) == 0) {
-            printf("\n\033[1;32m🏆 %s 🏆\033[0m\n", buffer + 7);
-            fflush(stdout);
-            break;
-        } else if (strncmp(buffer, "Invalid", 7) == 0) {
-            printf("%s\n", buffer);
-            fflush(stdout);
-        } else if (expecting_board) {
-            printf("[DEBUG] Displaying chess board:\n");
-            fflush(stdout);
-            printf("%s", buffer);
-            fflush(stdout);
-            expecting_board = 0;
-        } else {
-            printf("[DEBUG] Unexpected message, treating as board:\n");
-            fflush(stdout);
-            printf("%s", buffer);
-            fflush(stdout);
+int snakeLadderUserLine(char *line) {
+    if (strncasecmp(line, "roll", 4) == 0) send_command("%s", "ROLL");
+    else printf("Enter 'roll' to roll the dice: ");
+    return 0;
+}
+
+// A board row reads " X | O |   ": the mark of column c is at 4c + 1.
+int ttt_board_row(const char *line) {
+    int len = strlen(line), cols = (len + 1) / 4;
+    if (len == 0 || len != cols * 4 - 1 || cols * (tttBoardRow + 1) > TTT_MAX_CELLS) return 0;
+    for (int c = 0; c < cols; c++) {
+        char mark = line[4 * c + 1];
+        if (line[4 * c] != ' ' || (mark != 'X' && mark != 'O' && mark != ' ') || (c < cols - 1 && line[4 * c + 3] != '|'))
+            return 0;
+        if (mark != ' ') tttPending |= (TttMask)1 << (tttBoardRow * cols + c);
+    }
+    tttBoardRow++;
+    return 1;
+}
+
+int ticTacToeServerLine(char *line) {
+    printf("%s\n", line);
+    if (line[0] == '\0') {
+        tttBoardRow = 0;
+        tttPending = 0;
+    } else if (ttt_board_row(line)) {
+        tttOccupied = tttPending;
+    }
+    if (strstr(line, "Your turn")) {
+        int maxRow, maxCol;
+        if (sscanf(line, "Your turn Player %*c. Enter row and col (0-%d 0-%d)", &maxRow, &maxCol) == 2) {
+            tttRows = maxRow + 1;
+            tttCols = maxCol + 1;
         }
+        myTurn = 1;
+        printf("Enter row and col (or HINT): ");
     }
+    return strstr(line, "wins!") || strstr(line, "It's a draw!") || strstr(line, "Player disconnected");
 }
 
-void playSnakeLadder(int sockfd) {
-    char buff[BUFFER_SIZE];
-    int player_id = -1;
-    while (1) {
-        int n = read_line(sockfd, buff, BUFFER_SIZE);
-        if (n <= 0) {
-            printf("Server disconnected\n");
-            fflush(stdout);
-            break;
+int ticTacToeUserLine(char *line) {
+    if (!myTurn) {
+        printf("Not your turn.\n");
+        return 0;
+    }
+    if (strncasecmp(line, "HINT", 4) != 0 && tttRows > 0 && ttt_parse_move(line, tttRows, tttCols, tttOccupied) < 0) {
+        printf("Invalid move. Try again (format: row col): ");
+        return 0;
+    }
+    myTurn = 0;
+    send_command("%s", line);
+    return 0;
+}
+
+int rockPaperScissorServerLine(char *line) {
+    printf("%s\n", line);
+    if (strstr(line, "Game over")) return 1;
+    if (strstr(line, "Enter STONE") || strstr(line, "Enter PAPER") || strstr(line, "Enter SCISSORS")) printf("Your move: ");
+    return 0;
+}
+
+int rockPaperScissorUserLine(char *line) {
+    send_command("%s", line);
+    if (strncmp(line, "exit", 4) == 0) {
+        printf("Client exiting...\n");
+        return 1;
+    }
+    return 0;
+}
+
+const GameUi wordleUi = {wordleServerLine, wordleUserLine};
+const GameUi chessUi = {chessServerLine, chessUserLine};
+const GameUi snakeLadderUi = {snakeLadderServerLine, snakeLadderUserLine};
+const GameUi ticTacToeUi = {ticTacToeServerLine, ticTacToeUserLine};
+const GameUi rockPaperScissorUi = {rockPaperScissorServerLine, rockPaperScissorUserLine};
+
+// A spectator sees what the players are sent until the game ends.
+int spectatorServerLine(char *line) {
+    if (strcmp(line, "SPECTATE_END") == 0) {
+        printf("\n\033[1;33mThe game is over.\033[0m\n");
+        return 1;
+    }
+    printf("%s\n", line);
+    return 0;
+}
+
+int spectatorUserLine(char *line) {
+    if (strncmp(line, "exit", 4) != 0) return 0;
+    send_command("%s", "LEAVE");
+    return 1;
+}
+
+const GameUi spectatorUi = {spectatorServerLine, spectatorUserLine};
+
+// A replay is shown like a spectated game and ends with REPLAY_END.
+int replayServerLine(char *line) {
+    if (strcmp(line, "REPLAY_END") == 0) {
+        printf("\n\033[1;33mEnd of the replay.\033[0m\n");
+        return 1;
+    }
+    printf("%s\n", line);
+    return 0;
+}
+
+const GameUi replayUi = {replayServerLine, spectatorUserLine};
+
+// Lists the games in progress and watches the one the player picks.
+void watchGame(void) {
+    char buffer[BUFFER_SIZE], choice[16];
+    send_command("%s", "LIST");
+    do {
+        if (read_line(&server, buffer, BUFFER_SIZE) < 0) {
+            printf("\033[1;31mServer disconnected\033[0m\n");
+            return;
         }
-        if (strncmp(buff, "WELCOME:", 8) == 0) {
-            sscanf(buff + 8, "Player %d", &player_id);
-            printf("You are Player %d\n", player_id);
-            fflush(stdout);
-        } else if (strncmp(buff, "BOARD:", 6) == 0) {
-            display_sl_board(buff);
-        } else if (strncmp(buff, "GAME_START", 10) == 0) {
-            printf("\n\033[1;33mGame Started!\033[0m\n");
-            fflush(stdout);
-        } else if (strncmp(buff, "NEW_PLAYER:", 11) == 0) {
-            printf("%s", buff + 11);
-            fflush(stdout);
-        } else if (strncmp(buff, "TURN", 4) == 0) {
-            printf("\n\033[1;36mYour Turn!\033[0m Enter 'roll' to roll the dice: ");
-            fflush(stdout);
-            char input[10];
-            fgets(input, 10, stdin);
-            if (strncmp(input, "roll", 4) == 0) write(sockfd, "ROLL\n", 5);
-        } else if (strncmp(buff, "ROLLED:", 7) == 0) {
-            int p_id, roll;
-            sscanf(buff + 7, "P%d=%d", &p_id, &roll);
-            printf("Player %d rolled a %d\n", p_id, roll);
-            fflush(stdout);
-        } else if (strncmp(buff, "SNAKE:", 6) == 0) {
-            int p_id, from, to;
-            sscanf(buff + 6, "P%d=%d-%d", &p_id, &from, &to);
-            printf("\033[31mPlayer %d slid down a snake from %d to %d\033[0m\n", p_id, from, to);
-            fflush(stdout);
-        } else if (strncmp(buff, "LADDER:", 7) == 0) {
-            int p_id, from, to;
-            sscanf(buff + 7, "P%d=%d-%d", &p_id, &from, &to);
-            printf("\033[32mPlayer %d climbed a ladder from %d to %d\033[0m\n", p_id, from, to);
-            fflush(stdout);
-        } else if (strncmp(buff, "POSITIONS:", 10) == 0) {
-            printf("\n\033[1mPlayer Positions:\033[0m\n");
-            char *token = strtok(buff + 10, ",");
-            while (token != NULL) {
-                int p_id, pos;
-                sscanf(token, "P%d=%d", &p_id, &pos);
-                printf("Player \033[1m%d\033[0m: %d\n", p_id, pos);
-                token = strtok(NULL, ",");
-            }
-            fflush(stdout);
-        } else if (strncmp(buff, "WINNER:", 7) == 0) {
-            printf("\n\033[1;32m%s wins!\033[0m\n", buff + 7);
-            fflush(stdout);
-            break;
+    } while (strncmp(buffer, "SESSIONS:", 9) != 0);
+    if (buffer[9] == '\0') {
+        printf("\n\033[1;33mNo games in progress.\033[0m\n");
+        return;
+    }
+    printf("\n\033[1mGames in progress:\033[0m\n");
+    for (char *game = strtok(buffer + 9, ","); game; game = strtok(NULL, ",")) {
+        char *name = strchr(game, ':');
+        if (name) *name++ = '\0';
+        printf("  \033[1;34m%s.\033[0m %s\n", game, name ? name : "");
+    }
+    printf("\n\033[1mGame to watch:\033[0m ");
+    if (read_line(&input, choice, sizeof(choice)) < 0) return;
+    send_command("SPECTATE:%s", choice);
+    do {
+        if (read_line(&server, buffer, BUFFER_SIZE) < 0) {
+            printf("\033[1;31mServer disconnected\033[0m\n");
+            return;
         }
+    } while (strncmp(buffer, "SPECTATING:", 11) != 0 && strncmp(buffer, "ERROR:", 6) != 0);
+    if (buffer[0] == 'E') {
+        printf("\n\033[1;31m%s\033[0m\n", buffer + 6);
+        return;
     }
+    printf("\n\033[1;33mWatching game %s (type exit to stop)\033[0m\n", buffer + 11);
+    run_game(&spectatorUi);
 }
 
-void playTicTacToe(int sockfd) {
-    char buffer[1024];
-    while (1) {
-        memset(buffer, 0, sizeof(buffer));
-        int n = read(sockfd, buffer, sizeof(buffer));
-        if (n <= 0) {
-            printf("Server disconnected\n");
-            fflush(stdout);
-            break;
+// Replays a game of this server run, from its start or from a move.
+void replayGame(void) {
+    char buffer[BUFFER_SIZE], game[16], move[16], request[40];
+    printf("\n\033[1mGame to replay:\033[0m ");
+    if (read_line(&input, game, sizeof(game)) < 0) return;
+    printf("\033[1mFrom move (empty for the start):\033[0m ");
+    if (read_line(&input, move, sizeof(move)) < 0) return;
+    snprintf(request, sizeof(request), "REPLAY:%d:%d", atoi(game), atoi(move));
+    send_command("%s", request);
+    do {
+        if (read_line(&server, buffer, BUFFER_SIZE) < 0) {
+            printf("\033[1;31mServer disconnected\033[0m\n");
+            return;
         }
-        printf("%s", buffer);
-        fflush(stdout);
-        if (strstr(buffer, "Your turn")) {
-            memset(buffer, 0, sizeof(buffer));
-            printf("Enter row and col (0-2 0-2): ");
-            fflush(stdout);
-            fgets(buffer, sizeof(buffer), stdin);
-            buffer[strcspn(buffer, "\n")] = 0;
-            write(sockfd, buffer, strlen(buffer));
+    } while (strncmp(buffer, "REPLAY:", 7) != 0 && strncmp(buffer, "ERROR:", 6) != 0);
+    if (buffer[0] == 'E') {
+        printf("\n\033[1;31m%s\033[0m\n", buffer + 6);
+        return;
+    }
+    printf("\n\033[1;33mReplaying game %s (type exit to stop)\033[0m\n", buffer + 7);
+    run_game(&replayUi);
+}
+
+// Counts this connection's games towards a player's stats; empty plays unranked.
+void chooseName(void) {
+    char buffer[BUFFER_SIZE], name[32];
+    printf("\n\033[1mYour name (empty to play unranked):\033[0m ");
+    if (read_line(&input, name, sizeof(name)) < 0 || name[0] == '\0') return;
+    send_command("NAME:%s", name);
+    do {
+        if (read_line(&server, buffer, BUFFER_SIZE) < 0) return;
+    } while (strncmp(buffer, "NAME:", 5) != 0 && strncmp(buffer, "ERROR:", 6) != 0);
+    if (buffer[0] == 'E') printf("\033[1;31m%s (playing unranked)\033[0m\n", buffer + 6);
+}
+
+// Shows the top players of a game, best rating first.
+void showLeaderboard(void) {
+    static const char *const gameNames[] = {"WORDLE", "CHESS", "SNAKE_LADDER", "TIC_TAC_TOE", "ROCK_PAPER_SCISSOR"};
+    char buffer[BUFFER_SIZE], choice[16];
+    printf("\n\033[1mLeaderboard of which game (1-5):\033[0m ");
+    if (read_line(&input, choice, sizeof(choice)) < 0) return;
+    int game = atoi(choice) - 1;
+    if (game < 0 || game >= 5) {
+        printf("\033[1;31mInvalid choice!\033[0m\n");
+        return;
+    }
+    send_command("TOP:%s", gameNames[game]);
+    do {
+        if (read_line(&server, buffer, BUFFER_SIZE) < 0) {
+            printf("\033[1;31mServer disconnected\033[0m\n");
+            return;
         }
+    } while (strncmp(buffer, "TOP:", 4) != 0 && strncmp(buffer, "ERROR:", 6) != 0);
+    if (buffer[0] == 'E') {
+        printf("\n\033[1;31m%s\033[0m\n", buffer + 6);
+        return;
+    }
+    char *places = strchr(buffer, ' ');
+    if (!places || places[1] == '\0') {
+        printf("\n\033[1;33mNo %s games recorded yet.\033[0m\n", gameNames[game]);
+        return;
+    }
+    printf("\n\033[1m%-4s %-24s %6s  %s\033[0m\n", "", "Player", "Rating", "W-L-D");
+    for (char *place = strtok(places + 1, ","); place; place = strtok(NULL, ",")) {
+        char name[32], record[48];
+        int rank, rating;
+        if (sscanf(place, "%d:%31[^:]:%d:%47s", &rank, name, &rating, record) == 4)
+            printf("  \033[1;34m%2d.\033[0m %-24s %6d  %s\n", rank, name, rating, record);
     }
 }
 
-void playRockPaperScissor(int sockfd) {
-    char buff[MAX];
-    int n;
+// Plays every round of a tournament: each match starts with START:, and
+// standings arrive between rounds until TOURNAMENT_OVER.
+void playTournament(const char *game_name) {
+    char buffer[BUFFER_SIZE];
     while (1) {
-        bzero(buff, MAX);
-        read(sockfd, buff, sizeof(buff));
-        printf("%s", buff);
-        fflush(stdout);
-        if (strstr(buff, "Game over") || strstr(buff, "wins the game")) {
+        if (read_line(&server, buffer, BUFFER_SIZE) < 0) {
+            printf("\033[1;31mServer disconnected\033[0m\n");
+            fflush(stdout);
             break;
         }
-        if (strstr(buff, "Enter STONE") || strstr(buff, "Enter PAPER") || strstr(buff, "Enter SCISSORS")) {
-            bzero(buff, MAX);
-            n = 0;
-            printf("Your move: ");
+        if (strncmp(buffer, "START:", 6) == 0) {
+            printf("\n\033[1;33mMatch starting!\033[0m\n");
+            if (strcmp(game_name, "ROCK_PAPER_SCISSOR") == 0) run_game(&rockPaperScissorUi);
+        } else if (strncmp(buffer, "TOURNAMENT_OVER:", 16) == 0) {
+            printf("\n\033[1;32m🏆 %s\033[0m\n", buffer + 16);
             fflush(stdout);
-            while ((buff[n++] = getchar()) != '\n');
-            buff[n - 1] = '\0';
-            write(sockfd, buff, sizeof(buff));
-            if (strncmp(buff, "exit", 4) == 0) {
-                printf("Client exiting...\n");
-                fflush(stdout);
-                break;
-            }
+            break;
+        } else if (strncmp(buffer, "TOURNAMENT:", 11) == 0 || strncmp(buffer, "STANDINGS:", 10) == 0) {
+            printf("\033[1;36m%s\033[0m\n", strchr(buffer, ':') + 1);
+        } else if (strncmp(buffer, "ERROR:", 6) == 0) {
+            printf("\n\033[1;31m%s\033[0m\n", buffer + 6);
+            break;
         }
+        fflush(stdout);
     }
 }
 
 int main() {
     setvbuf(stdout, NULL, _IONBF, 0); // Disable stdout buffering
+    // Without the word lists only the server checks guesses against the dictionary.
+    wordle_dict_load(WORDLE_ANSWERS_PATH, WORDLE_ALLOWED_PATH);
     int sockfd;
     struct sockaddr_in servaddr;
     char buffer[BUFFER_SIZE];
@@ -287,12 +557,15 @@ int main() {
     printf("  \033[1;34m3.\033[0m Snake and Ladder\n");
     printf("  \033[1;34m4.\033[0m Tic Tac Toe\n");
     printf("  \033[1;34m5.\033[0m Rock Paper Scissors\n");
-    printf("\n\033[1mEnter your choice (1-5):\033[0m ");
+    printf("  \033[1;34m6.\033[0m Rock Paper Scissors Tournament\n");
+    printf("  \033[1;34m7.\033[0m Watch a game\n");
+    printf("  \033[1;34m8.\033[0m Replay a game\n");
+    printf("  \033[1;34m9.\033[0m Leaderboards\n");
+    printf("\n\033[1mEnter your choice (1-9):\033[0m ");
     fflush(stdout);
 
     char choice[10];
-    fgets(choice, sizeof(choice), stdin);
-    choice[strcspn(choice, "\n")] = '\0';
+    if (read_line(&input, choice, sizeof(choice)) < 0) choice[0] = '\0';
     int game_choice = atoi(choice);
 
     switch (game_choice) {
@@ -301,6 +574,10 @@ int main() {
         case 3: game_name = "SNAKE_LADDER"; break;
         case 4: game_name = "TIC_TAC_TOE"; break;
         case 5: game_name = "ROCK_PAPER_SCISSOR"; break;
+        case 6: game_name = "ROCK_PAPER_SCISSOR"; break;
+        case 7: break;
+        case 8: break;
+        case 9: break;
         default:
             printf("\033[1;31mInvalid choice! Exiting.\033[0m\n");
             fflush(stdout);
@@ -308,14 +585,32 @@ int main() {
             return 0;
     }
 
-    char cmd[30];
-    snprintf(cmd, sizeof(cmd), "GAME:%s\n", game_name);
-    write(sockfd, cmd, strlen(cmd));
+    server.fd = sockfd;
+    if (game_choice >= 7) {
+        if (game_choice == 7) watchGame();
+        else if (game_choice == 8) replayGame();
+        else showLeaderboard();
+        close(sockfd);
+        printf("\033[1;34mDisconnected from server.\033[0m\n");
+        return 0;
+    }
+    chooseName();
+    if (game_choice == 6) {
+        send_command("TOURNAMENT:%s", game_name);
+        printf("\n\033[1;33mWaiting for the tournament to fill up...\033[0m\n");
+        fflush(stdout);
+        playTournament(game_name);
+        close(sockfd);
+        printf("\033[1;34mDisconnected from server.\033[0m\n");
+        return 0;
+    }
+    send_command("GAME:%s", game_name);
+    send_command("%s", "LOBBY");
     printf("\n\033[1;33mWaiting for another player to join %s...\033[0m\n", game_name);
     fflush(stdout);
 
     while (!game_selected) {
-        int n = read_line(sockfd, buffer, BUFFER_SIZE);
+        int n = read_line(&server, buffer, BUFFER_SIZE);
         if (n <= 0) {
             printf("\033[1;31mServer disconnected\033[0m\n");
             fflush(stdout);
@@ -324,7 +619,6 @@ int main() {
         if (strncmp(buffer, "WAITING", 7) == 0) {
             printf(".");
             fflush(stdout);
-            sleep(1);
             continue;
         } else if (strncmp(buffer, "START:", 6) == 0) {
             char selected_game[20];
@@ -332,6 +626,15 @@ int main() {
             if (strcmp(selected_game, game_name) == 0) {
                 game_selected = 1;
             }
+        } else if (strncmp(buffer, "LOBBY:", 6) == 0) {
+            // After the first update only the games that changed are listed.
+            char key[32];
+            int waiting, playing;
+            snprintf(key, sizeof(key), " %s=", game_name);
+            char *counts = strstr(buffer, key);
+            if (counts && sscanf(counts + strlen(key), "%d/%d", &waiting, &playing) == 2)
+                printf("\n\033[1;36m%d waiting, %d games of %s in progress\033[0m", waiting, playing, game_name);
+            fflush(stdout);
         } else if (strncmp(buffer, "Connected as Player", 19) == 0) {
             printf("\n%s", buffer);
             fflush(stdout);
@@ -343,11 +646,11 @@ int main() {
     }
 
     if (game_selected) {
-        if (strcmp(game_name, "WORDLE") == 0) playWordle(sockfd);
-        else if (strcmp(game_name, "CHESS") == 0) playChess(sockfd);
-        else if (strcmp(game_name, "SNAKE_LADDER") == 0) playSnakeLadder(sockfd);
-        else if (strcmp(game_name, "TIC_TAC_TOE") == 0) playTicTacToe(sockfd);
-        else if (strcmp(game_name, "ROCK_PAPER_SCISSOR") == 0) playRockPaperScissor(sockfd);
+        if (strcmp(game_name, "WORDLE") == 0) run_game(&wordleUi);
+        else if (strcmp(game_name, "CHESS") == 0) run_game(&chessUi);
+        else if (strcmp(game_name, "SNAKE_LADDER") == 0) run_game(&snakeLadderUi);
+        else if (strcmp(game_name, "TIC_TAC_TOE") == 0) run_game(&ticTacToeUi);
+        else if (strcmp(game_name, "ROCK_PAPER_SCISSOR") == 0) run_game(&rockPaperScissorUi);
     }
 
     close(sockfd);
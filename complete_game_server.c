@@ -5,362 +5,579 @@
 #include <string.h>
 #include <sys/socket.h>
 #include <sys/types.h>
-#include <sys/select.h>
+#include <sys/resource.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <errno.h>
 #include <unistd.h>
 #include <time.h>
 #include <arpa/inet.h>
 #include <ctype.h>
+#include <signal.h>
+#include <strings.h>
+#include "pgn_archive.h"
+#include "wordle_dict.h"
+#include "wordle_solver.h"
+#include "game_rules.h"
+#include "ttt_engine.h"
+#include "server_config.h"
+#include "snake_ladder.h"
+#include "game_rng.h"
+#include "tournament.h"
+#include "worker_pool.h"
+#include "metrics.h"
+#include "logger.h"
+#include "trace.h"
+#include "io_loop.h"
+#include "replay_archive.h"
+#include "cluster.h"
+#include "player_stats.h"
+#include "arena.h"
+#include "sock_opts.h"
 
 #define PORT 8081
 #define MAX 256
 #define BUFFER_SIZE 2048
-#define MAX_CLIENTS 10
+#define CLIENT_INPUT_SIZE 4096
+#define CLIENT_MAX_OUTPUT (1024 * 1024)
+#define INITIAL_CLIENTS 64
+#define CLIENT_MAX_CHANNELS 16       // per connection; channel 0 is the connection itself
+#define SESSION_MAX_SPECTATORS 16
 #define SA struct sockaddr
-
-// Wordle
+#define ARCHIVE_DIR "archive"
+#define ARCHIVE_ROTATE_BYTES (64 * 1024 * 1024)
+#define REPLAY_DIR "replays"
+#define REPLAY_ROTATE_BYTES (64 * 1024 * 1024)
+#define WORDLE_PRECOMPUTE_PATTERNS 1
+#define WORDLE_MAX_GUESSES 16
+#define WORDLE_HINTS_PER_PLAYER 1
+#define TTT_HINTS_PER_PLAYER 1
+#define TTT_BOT_TT_BITS 20
+#define SOAK_REPORT_MS 10000
+#define SNAPSHOT_SIZE (BUFFER_SIZE * 2)
+#define REPLAY_KEYFRAME_MOVES 8
+#define REPLAY_WINDOW (64 * 1024)       // replay output queued per client before waiting for the socket
+#define LEADERBOARD_DEFAULT 10
+#define LEADERBOARD_MAX 20
+#define LOBBY_FEATURED 3
+#define LOBBY_WINDOW (64 * 1024)        // output queued for a lobby watcher before it skips updates
+
+// Wordle (built-in fallback when the dictionary files cannot be loaded)
 const char *wordList[] = {"APPLE", "GRAPE", "MANGO", "BERRY", "LEMON", "WATER", "ORBIT"};
 const int wordListSize = 7;
 
-// Chess
-typedef enum { PAWN, KNIGHT, BISHOP, ROOK, QUEEN, KING } PieceType;
-typedef enum { WHITE, BLACK } Color;
-
-typedef struct {
-    PieceType type;
-    Color color;
-    char id[4];
-} Piece;
-
-typedef struct {
-    Piece* board[8][8];
-} ChessBoard;
-
-// Snake and Ladder
-typedef struct {
-    int start;
-    int end;
-} SnakeLadder;
-
-SnakeLadder snakes[] = {{16,6}, {47,26}, {49,11}, {56,53}, {62,19}, {64,60}, {87,24}, {93,73}, {95,75}, {98,78}};
-int num_snakes = 10;
-
-SnakeLadder ladders[] = {{1,38}, {4,14}, {9,31}, {21,42}, {28,84}, {36,44}, {51,67}, {71,91}, {80,100}};
-int num_ladders = 9;
-
 // Game Session
-typedef enum { WORDLE, CHESS, SNAKE_LADDER, TIC_TAC_TOE, ROCK_PAPER_SCISSOR } GameType;
-
-typedef struct {
-    int connfd;
-    char gameChoice[20];
-} WaitingPlayer;
-
-typedef struct {
-    int player1_fd;
-    int player2_fd;
+typedef enum { WORDLE, CHESS, SNAKE_LADDER, TIC_TAC_TOE, ROCK_PAPER_SCISSOR, GAME_TYPE_COUNT } GameType;
+
+typedef struct TournamentEntry TournamentEntry;
+typedef struct Bot Bot;
+typedef enum { BOT_RANDOM, BOT_GREEDY, BOT_ENGINE } BotPolicy;
+
+typedef struct GameSession {
+    // The session itself and all of its game state come from its arena,
+    // released in one go when it ends. Messages built during a turn take
+    // scratch space from it too (arena_mark/arena_rewind).
+    Arena arena;
+    size_t memoryCounted;       // arena footprint last added to the session memory gauge
+    int id;
+    int player1_id;             // client ids, see clients[]
+    int player2_id;
     GameType gameType;
     int gameOver;
+    int winner;                 // 0 or 1 for player 1 or 2, -1 for none
+    TournamentEntry *tournament;
+    int tournamentMatch;
+    int soak;                   // bot-against-bot soak test session
+    int traced;                 // spans are recorded, see trace.h
+    uint64_t rngSeed;
+    GameRng rng;
     // Wordle
     char secretWord[6];
     int turn;
     int p1Attempts;
     int p2Attempts;
     int maxAttempts;
+    char wordleGuesses[WORDLE_MAX_GUESSES][6];
+    uint8_t wordlePatterns[WORDLE_MAX_GUESSES];
+    int wordleGuessCount;
+    int wordleHints[2];
     // Chess
     ChessBoard chessBoard;
     int chessTurn;
     enum { WAITING, PLAYING, FINISHED } chessState;
+    PgnMove *chessMoves;        // PGN_MAX_PLIES of them
+    int chessMoveCount;
+    time_t chessStarted;
     // Snake and Ladder
     int slPositions[2];
     int slTurn;
     enum { SL_WAITING, SL_PLAYING, SL_FINISHED } slState;
     // Tic Tac Toe
-    char tttBoard[3][3];
+    TttMask tttMasks[2];
     char tttCurrentPlayer;
     int tttTurn;
+    int tttLastCell;
+    int tttHints[2];
     // Rock Paper Scissors
     int rpsScore[2];
     int rpsRounds;
+    char rpsMoves[2][16];
+    int rpsCommitted[2];
+    // Spectators (client ids) get everything broadcast to the players
+    int spectators[SESSION_MAX_SPECTATORS];
+    int numSpectators;
+    struct GameSession *prev, *next;    // activeSessions
+    ReplayGame replay;
+    // Player stats: who played (player_stats ids, -1 without a name), and
+    // each side's turns, the time they took and when the current one began
+    int playerIds[2];
+    uint32_t turns[2];
+    uint64_t turnNs[2];
+    long long turnStartNs[2];
 } GameSession;
 
-WaitingPlayer waitingPlayers[MAX_CLIENTS];
-int numWaiting = 0;
-GameSession sessions[MAX_CLIENTS];
+// Connections
+typedef enum { CLIENT_FREE, CLIENT_SELECTING, CLIENT_WAITING, CLIENT_PLAYING, CLIENT_TOURNAMENT, CLIENT_SPECTATING, CLIENT_REPLAYING } ClientState;
+
+typedef struct {
+    int fd;
+    ClientState state;
+    GameType gameType;
+    GameSession *session;
+    int player;                 // 0 or 1 within the session
+    TournamentEntry *tournament;
+    int tournamentSlot;
+    int closing;                // close once the output queue has drained
+    int broken;                 // write failed or the peer stopped reading
+    int tickWrites;             // direct writes this loop tick, counted under the cork policy
+    char address[32];           // "ip:port" of the peer
+    Bot *bot;                   // set for built-in bots, which have no socket
+    // A connection can carry extra channels, each a client of its own with
+    // no socket: "@<n> <line>" frames in both directions.
+    int conn;                   // for a channel, the client id of its connection; -1 otherwise
+    int channel;
+    int channels[CLIENT_MAX_CHANNELS];  // for a connection, channel client id + 1, 0 when closed
+    int multiplexed;            // has opened a channel, so stays open between games
+    ReplayCursor replay;        // while replaying
+    int playerId;               // player_stats id once named, -1 before
+    int lobbyWatcher;           // index in lobbyWatchers + 1 while subscribed to the lobby feed
+    int lobbyStale;             // skipped an update, so is sent the whole lobby next
+    long long waitingSince;     // ms, while waiting for an opponent
+    long long joinedNs;         // when the player asked for a game, for the match wait metric
+    char in[CLIENT_INPUT_SIZE];
+    int inLen;
+    char *out;
+    size_t outStart, outLen, outCap;
+} Client;
+
+// A tournament collects players until it is full, then the tournament
+// module pairs them and the server plays each match as a normal session.
+struct TournamentEntry {
+    Tournament *tournament;
+    GameType gameType;
+    int *players;               // participant -> client id, -1 once gone
+    int count;
+    int size;
+};
+
+Client *clients;
+int clientCapacity = 0;
+int clientHigh = 0;             // ids below this have been used
+int *freeClientIds;
+int numFreeClients = 0;
+int waitingPlayer[GAME_TYPE_COUNT];
+TournamentEntry *tournamentLobby[GAME_TYPE_COUNT];
 int numSessions = 0;
+GameSession *activeSessions;
+int nextSessionId = 0;
+WordleSolver wordleSolver;
+int wordleSolverReady = 0;
+TttGeometry tttGeometry;
+TttBot *tttBot;
+SlLayout slLayout;
+char slBoardMsg[BUFFER_SIZE];
+WorkerPool *botPool;
+BotPolicy botPolicy;
+const char *botPolicyNames[] = {"random", "greedy", "engine"};
+int botSerial = 0;
+long long botMoves = 0, botDegraded = 0;
+int soakRunning = 0;
+long long soakFinished = 0;
+int soakNextGame = 0;
+const char *gameNames[GAME_TYPE_COUNT];
+long long loopWakeNs;           // when the event loop last woke; turn latency counts from here
+IoLoop *ioLoop;
+int ioSendAsync = 0;            // io_uring sends: the loop owns the output queue, outLen counts what it holds
+int *brokenIds;                 // clients marked broken, dropped by the main loop
+int numBroken = 0, brokenCapacity = 0;
+int clusterFd = -1;             // cluster mode: the link to the coordinator
+int stopPipe[2] = {-1, -1};     // written by SIGINT/SIGTERM to wake the loop
+volatile sig_atomic_t stopRequested;
+int lobbyDirty = 1;             // matchmaking or sessions changed since the last lobby update
+SockOptions sockOptions;
+int *writtenIds;                // cork policy: clients written this tick, uncorked before the next wait
+int numWritten = 0, writtenCapacity = 0;
 
 // Utility Functions
-void send_full(int connfd, const char *msg) {
-    size_t len = strlen(msg);
-    size_t total = 0;
-    while (total < len) {
-        int sent = write(connfd, msg + total, len - total);
-        if (sent <= 0) break;
-        total += sent;
+void send_channel(Client *c, const char *msg, size_t len);
+
+// A write failed or the peer stopped reading. The client is dropped by the
+// main loop, not here in the middle of its session's turn.
+void client_break(int id) {
+    if (clients[id].broken) return;
+    clients[id].broken = 1;
+    if (numBroken == brokenCapacity) {
+        int capacity = brokenCapacity ? brokenCapacity * 2 : 64;
+        int *grown = realloc(brokenIds, capacity * sizeof(int));
+        if (!grown) return;
+        brokenIds = grown;
+        brokenCapacity = capacity;
+    }
+    brokenIds[numBroken++] = id;
+}
+
+// Under the cork policy a client's first write of a tick goes out at
+// once and a second corks the socket, so a turn's later writes share
+// segments until uncork_clients ends the tick.
+void cork_client(int id) {
+    Client *c = &clients[id];
+    if (c->tickWrites++ == 0) {
+        if (numWritten == writtenCapacity) {
+            int capacity = writtenCapacity ? writtenCapacity * 2 : 64;
+            int *grown = realloc(writtenIds, capacity * sizeof(int));
+            if (!grown) {
+                c->tickWrites = 0;
+                return;
+            }
+            writtenIds = grown;
+            writtenCapacity = capacity;
+        }
+        writtenIds[numWritten++] = id;
+    } else if (c->tickWrites == 2) {
+        sock_cork(c->fd, 1);
+    }
+}
+
+void uncork_clients(void) {
+    for (int i = 0; i < numWritten; i++) {
+        Client *c = &clients[writtenIds[i]];
+        if (c->tickWrites >= 2 && c->fd >= 0) sock_cork(c->fd, 0);
+        c->tickWrites = 0;
+    }
+    numWritten = 0;
+}
+
+// Writes straight to the socket while nothing is queued; whatever the
+// kernel does not take is queued and flushed when the socket is writable.
+void send_bytes(int id, const char *msg, size_t len) {
+    Client *c = &clients[id];
+    if (c->conn >= 0) {
+        send_channel(c, msg, len);
+        return;
+    }
+    if (c->fd < 0 || c->broken || len == 0) return;
+    if (ioSendAsync) {
+        if (c->outLen + len > CLIENT_MAX_OUTPUT) {
+            metrics_add(METRIC_OUTPUT_OVERFLOWS, 0, 1);
+            client_break(id);
+            return;
+        }
+        uint64_t span = trace_begin();
+        if (io_loop_send(ioLoop, id, msg, len) != 0) client_break(id);
+        else c->outLen += len;
+        trace_end(TRACE_SEND, span);
+        return;
     }
+    if (c->outLen == 0) {
+        if (sockOptions.flush == SOCK_FLUSH_CORK) cork_client(id);
+        uint64_t span = trace_begin();
+        ssize_t sent = send(c->fd, msg, len, MSG_NOSIGNAL);
+        trace_end(TRACE_SEND, span);
+        if (sent < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                client_break(id);
+                return;
+            }
+            sent = 0;
+        }
+        metrics_add(METRIC_BYTES_OUT, 0, sent);
+        msg += sent;
+        len -= sent;
+        if (len == 0) return;
+        metrics_add(METRIC_WRITE_STALLS, 0, 1);
+    }
+    if (c->outLen + len > CLIENT_MAX_OUTPUT) {
+        metrics_add(METRIC_OUTPUT_OVERFLOWS, 0, 1);
+        client_break(id);
+        return;
+    }
+    if (c->outLen == 0 && ioLoop) io_loop_want_write(ioLoop, id, 1);
+    if (c->outStart + c->outLen + len > c->outCap) {
+        memmove(c->out, c->out + c->outStart, c->outLen);
+        c->outStart = 0;
+        if (c->outLen + len > c->outCap) {
+            size_t cap = c->outCap ? c->outCap : BUFFER_SIZE;
+            while (cap < c->outLen + len) cap *= 2;
+            char *grown = realloc(c->out, cap);
+            if (!grown) {
+                client_break(id);
+                return;
+            }
+            c->out = grown;
+            c->outCap = cap;
+        }
+    }
+    memcpy(c->out + c->outStart + c->outLen, msg, len);
+    c->outLen += len;
+}
+
+// Prefixes every line of msg with the channel and sends it on the
+// connection in one write. A last line without a newline is ended, so
+// frames from different channels never interleave mid-line.
+void send_channel(Client *c, const char *msg, size_t len) {
+    char prefix[8], stack[BUFFER_SIZE + 256];
+    int prefixLen = snprintf(prefix, sizeof(prefix), "@%d ", c->channel);
+    size_t lines = 1;
+    for (size_t i = 0; i < len; i++) lines += msg[i] == '\n';
+    size_t size = len + lines * (prefixLen + 1);
+    char *framed = size <= sizeof(stack) ? stack : malloc(size);
+    if (!framed) return;
+    size_t n = 0;
+    for (size_t start = 0; start < len;) {
+        const char *nl = memchr(msg + start, '\n', len - start);
+        size_t end = nl ? (size_t)(nl - msg) : len;
+        memcpy(framed + n, prefix, prefixLen);
+        memcpy(framed + n + prefixLen, msg + start, end - start);
+        n += prefixLen + end - start;
+        framed[n++] = '\n';
+        start = end + 1;
+    }
+    send_bytes(c->conn, framed, n);
+    if (framed != stack) free(framed);
 }
 
-void send_to_player(int connfd, const char *msg) {
-    send_full(connfd, msg);
+void send_to_player(int id, const char *msg) {
+    send_bytes(id, msg, strlen(msg));
 }
 
 void broadcast(GameSession *session, const char *msg) {
-    send_to_player(session->player1_fd, msg);
-    send_to_player(session->player2_fd, msg);
+    replay_output(&session->replay, msg, strlen(msg));
+    send_to_player(session->player1_id, msg);
+    send_to_player(session->player2_id, msg);
+    for (int i = 0; i < session->numSpectators; i++) send_to_player(session->spectators[i], msg);
+}
+
+int session_player(GameSession *session, int player) {
+    return player == 0 ? session->player1_id : session->player2_id;
 }
 
 // Wordle Functions
+// Feedback: uppercase letter = right spot, lowercase = in the word elsewhere,
+// '*' = not in the word. Rendered from the same pattern the hint solver uses.
 void checkGuess(const char *guess, const char *secret, char *feedback) {
+    uint8_t pattern = wordle_pattern(guess, secret);
     for (int i = 0; i < 5; i++) {
-        if (guess[i] == secret[i]) feedback[i] = guess[i];
+        int digit = pattern % 3;
+        pattern /= 3;
+        if (digit == 2) feedback[i] = guess[i];
+        else if (digit == 1) feedback[i] = tolower(guess[i]);
         else feedback[i] = '*';
     }
     feedback[5] = '\0';
 }
 
-int receiveGuess(int sockfd, char *guess) {
-    char buff[MAX];
-    bzero(buff, MAX);
-    read(sockfd, buff, sizeof(buff));
-    if (strncmp(buff, "exit", 4) == 0) return 0;
-    strncpy(guess, buff, 6);
-    guess[5] = '\0';
-    return 1;
+void send_wordle_hint(GameSession *session, int current_id) {
+    int *hints = &session->wordleHints[session->turn - 1];
+    char msg[MAX];
+    if (!wordleSolverReady) {
+        send_to_player(current_id, "Hints are not available on this server.\n");
+        return;
+    }
+    if (*hints >= WORDLE_HINTS_PER_PLAYER) {
+        send_to_player(current_id, "No hints left!\n");
+        return;
+    }
+    char best[6];
+    int left = wordle_solver_hint(&wordleSolver, session->wordleGuesses, session->wordlePatterns,
+                                  session->wordleGuessCount, best);
+    (*hints)++;
+    if (left == 0) snprintf(msg, MAX, "Hint: no word in the dictionary matches the feedback so far.\n");
+    else snprintf(msg, MAX, "Hint: try %s (%d possible answers left)\n", best, left);
+    send_to_player(current_id, msg);
 }
 
-void runWordleGame(GameSession *session) {
-    char guess[6], feedback[6];
-    int current_fd;
-    char msg[MAX];
+void pick_wordle_answer(GameSession *session) {
+    int count = wordle_dict_answer_count();
+    if (count > 0) {
+        memcpy(session->secretWord, wordle_dict_answer(game_rng_range(&session->rng, count)), 5);
+        session->secretWord[5] = '\0';
+    } else {
+        strcpy(session->secretWord, wordList[game_rng_range(&session->rng, wordListSize)]);
+    }
+}
 
-    while (!session->gameOver) {
-        current_fd = (session->turn == 1) ? session->player1_fd : session->player2_fd;
-        int *currentAttempts = (session->turn == 1) ? &session->p1Attempts : &session->p2Attempts;
-        char playerName[10];
-        snprintf(playerName, sizeof(playerName), "Player %d", session->turn);
+void prompt_wordle_turn(GameSession *session) {
+    char msg[MAX];
+    snprintf(msg, MAX, "Your turn, Player %d. Enter a 5-letter guess:\n", session->turn);
+    send_to_player(session_player(session, session->turn - 1), msg);
+    snprintf(msg, MAX, "Waiting for Player %d to guess...\n", session->turn);
+    send_to_player(session_player(session, 2 - session->turn), msg);
+}
 
-        snprintf(msg, MAX, "Your turn, %s. Enter a 5-letter guess:\n", playerName);
-        send_to_player(current_fd, msg);
+void startWordleGame(GameSession *session) {
+    session->turn = 1;
+    session->p1Attempts = 0;
+    session->p2Attempts = 0;
+    session->maxAttempts = 5;
+    session->wordleGuessCount = 0;
+    session->wordleHints[0] = session->wordleHints[1] = 0;
+    pick_wordle_answer(session);
+    LOG_INFO("Session %d: Wordle game started", session->id);
+    broadcast(session, "Feedback: UPPERCASE = right spot, lowercase = wrong spot, * = not in word. Type HINT for a suggestion.\n");
+    prompt_wordle_turn(session);
+}
 
-        int other_fd = (session->turn == 1) ? session->player2_fd : session->player1_fd;
-        snprintf(msg, MAX, "Waiting for %s to guess...\n", playerName);
-        send_to_player(other_fd, msg);
+void abandonWordleGame(GameSession *session, int player) {
+    char msg[MAX];
+    snprintf(msg, MAX, "Player %d disconnected. Game over.\n", player + 1);
+    broadcast(session, msg);
+}
 
-        if (!receiveGuess(current_fd, guess)) {
-            snprintf(msg, MAX, "%s disconnected. Game over.\n", playerName);
-            broadcast(session, msg);
-            session->gameOver = 1;
-            break;
-        }
+void handleWordleInput(GameSession *session, int player, char *line) {
+    char guess[6], feedback[6];
+    char msg[MAX];
+    int current_id = session_player(session, player);
+    if (player != session->turn - 1) {
+        send_to_player(current_id, "Not your turn.\n");
+        return;
+    }
+    int *currentAttempts = (session->turn == 1) ? &session->p1Attempts : &session->p2Attempts;
+    char playerName[20];
+    snprintf(playerName, sizeof(playerName), "Player %d", session->turn);
 
-        if (strlen(guess) != 5) {
-            send_to_player(current_fd, "Invalid guess! Must be 5 letters.\n");
-            continue;
-        }
+    if (strncmp(line, "exit", 4) == 0) {
+        abandonWordleGame(session, player);
+        session->winner = 1 - player;
+        session->gameOver = 1;
+        return;
+    }
+    strncpy(guess, line, 6);
+    guess[5] = '\0';
 
-        for (int i = 0; i < 5; i++) {
-            if (guess[i] >= 'a' && guess[i] <= 'z') guess[i] -= 32;
-        }
+    if (strcasecmp(guess, "HINT") == 0) {
+        send_wordle_hint(session, current_id);
+        prompt_wordle_turn(session);
+        return;
+    }
 
-        checkGuess(guess, session->secretWord, feedback);
-        (*currentAttempts)++;
+    uint64_t span = trace_begin();
+    const char *problem = wordle_check_guess(guess);
+    trace_end(TRACE_VALIDATE, span);
+    if (problem) {
+        snprintf(msg, MAX, "%s\n", problem);
+        send_to_player(current_id, msg);
+        prompt_wordle_turn(session);
+        return;
+    }
 
-        snprintf(msg, MAX, "%s guessed: %s, Feedback: %s\n", playerName, guess, feedback);
-        broadcast(session, msg);
+    span = trace_begin();
+    checkGuess(guess, session->secretWord, feedback);
+    (*currentAttempts)++;
+    if (session->wordleGuessCount < WORDLE_MAX_GUESSES) {
+        strcpy(session->wordleGuesses[session->wordleGuessCount], guess);
+        session->wordlePatterns[session->wordleGuessCount++] = wordle_pattern(guess, session->secretWord);
+    }
+    trace_end(TRACE_UPDATE, span);
 
-        if (strcmp(guess, session->secretWord) == 0) {
-            snprintf(msg, MAX, "%s wins! The word was: %s\n", playerName, session->secretWord);
-            broadcast(session, msg);
-            session->gameOver = 1;
-            break;
-        }
+    snprintf(msg, MAX, "%s guessed: %s, Feedback: %s\n", playerName, guess, feedback);
+    broadcast(session, msg);
 
-        if (session->p1Attempts >= session->maxAttempts && session->p2Attempts >= session->maxAttempts) {
-            snprintf(msg, MAX, "Game over! No one guessed the word: %s\n", session->secretWord);
-            broadcast(session, msg);
-            session->gameOver = 1;
-            break;
-        }
+    if (strcmp(guess, session->secretWord) == 0) {
+        snprintf(msg, MAX, "%s wins! The word was: %s\n", playerName, session->secretWord);
+        broadcast(session, msg);
+        session->winner = player;
+        session->gameOver = 1;
+        return;
+    }
 
-        session->turn = (session->turn == 1) ? 2 : 1;
+    if (session->p1Attempts >= session->maxAttempts && session->p2Attempts >= session->maxAttempts) {
+        snprintf(msg, MAX, "Game over! No one guessed the word: %s\n", session->secretWord);
+        broadcast(session, msg);
+        session->gameOver = 1;
+        return;
     }
+
+    session->turn = (session->turn == 1) ? 2 : 1;
+    prompt_wordle_turn(session);
 }
 
 // Chess Functions
-void init_chess_board(ChessBoard* board) {
+#define CHESS_PIECES 32
+
+// The pieces come from the arena in one block and stay there, captured
+// or not, until the arena is released. Returns 0, or -1 if out of memory.
+int init_chess_board(ChessBoard* board, Arena *arena) {
+    static const Piece backRank[2][8] = {
+        {{ROOK, WHITE, "R1W"}, {KNIGHT, WHITE, "K1W"}, {BISHOP, WHITE, "B1W"}, {QUEEN, WHITE, "QW"},
+         {KING, WHITE, "KW"}, {BISHOP, WHITE, "B2W"}, {KNIGHT, WHITE, "K2W"}, {ROOK, WHITE, "R2W"}},
+        {{ROOK, BLACK, "R1B"}, {KNIGHT, BLACK, "K1B"}, {BISHOP, BLACK, "B1B"}, {QUEEN, BLACK, "QB"},
+         {KING, BLACK, "KB"}, {BISHOP, BLACK, "B2B"}, {KNIGHT, BLACK, "K2B"}, {ROOK, BLACK, "R2B"}},
+    };
     for (int i = 0; i < 8; i++) for (int j = 0; j < 8; j++) board->board[i][j] = NULL;
-    board->board[7][0] = (Piece*)malloc(sizeof(Piece)); *board->board[7][0] = (Piece){ROOK, WHITE, "R1W"};
-    board->board[7][1] = (Piece*)malloc(sizeof(Piece)); *board->board[7][1] = (Piece){KNIGHT, WHITE, "K1W"};
-    board->board[7][2] = (Piece*)malloc(sizeof(Piece)); *board->board[7][2] = (Piece){BISHOP, WHITE, "B1W"};
-    board->board[7][3] = (Piece*)malloc(sizeof(Piece)); *board->board[7][3] = (Piece){QUEEN, WHITE, "QW"};
-    board->board[7][4] = (Piece*)malloc(sizeof(Piece)); *board->board[7][4] = (Piece){KING, WHITE, "KW"};
-    board->board[7][5] = (Piece*)malloc(sizeof(Piece)); *board->board[7][5] = (Piece){BISHOP, WHITE, "B2W"};
-    board->board[7][6] = (Piece*)malloc(sizeof(Piece)); *board->board[7][6] = (Piece){KNIGHT, WHITE, "K2W"};
-    board->board[7][7] = (Piece*)malloc(sizeof(Piece)); *board->board[7][7] = (Piece){ROOK, WHITE, "R2W"};
-    for (int i = 0; i < 8; i++) {
-        board->board[6][i] = (Piece*)malloc(sizeof(Piece));
-        sprintf(board->board[6][i]->id, "P%dW", i + 1);
-        board->board[6][i]->type = PAWN;
-        board->board[6][i]->color = WHITE;
-    }
-    board->board[0][0] = (Piece*)malloc(sizeof(Piece)); *board->board[0][0] = (Piece){ROOK, BLACK, "R1B"};
-    board->board[0][1] = (Piece*)malloc(sizeof(Piece)); *board->board[0][1] = (Piece){KNIGHT, BLACK, "K1B"};
-    board->board[0][2] = (Piece*)malloc(sizeof(Piece)); *board->board[0][2] = (Piece){BISHOP, BLACK, "B1B"};
-    board->board[0][3] = (Piece*)malloc(sizeof(Piece)); *board->board[0][3] = (Piece){QUEEN, BLACK, "QB"};
-    board->board[0][4] = (Piece*)malloc(sizeof(Piece)); *board->board[0][4] = (Piece){KING, BLACK, "KB"};
-    board->board[0][5] = (Piece*)malloc(sizeof(Piece)); *board->board[0][5] = (Piece){BISHOP, BLACK, "B2B"};
-    board->board[0][6] = (Piece*)malloc(sizeof(Piece)); *board->board[0][6] = (Piece){KNIGHT, BLACK, "K2B"};
-    board->board[0][7] = (Piece*)malloc(sizeof(Piece)); *board->board[0][7] = (Piece){ROOK, BLACK, "R2B"};
+    Piece *pieces = arena_alloc(arena, CHESS_PIECES * sizeof(Piece));
+    if (!pieces) return -1;
     for (int i = 0; i < 8; i++) {
-        board->board[1][i] = (Piece*)malloc(sizeof(Piece));
-        sprintf(board->board[1][i]->id, "P%dB", i + 1);
-        board->board[1][i]->type = PAWN;
-        board->board[1][i]->color = BLACK;
+        pieces[i] = backRank[0][i];
+        pieces[8 + i] = (Piece){PAWN, WHITE, ""};
+        sprintf(pieces[8 + i].id, "P%dW", i + 1);
+        pieces[16 + i] = backRank[1][i];
+        pieces[24 + i] = (Piece){PAWN, BLACK, ""};
+        sprintf(pieces[24 + i].id, "P%dB", i + 1);
+        board->board[7][i] = &pieces[i];
+        board->board[6][i] = &pieces[8 + i];
+        board->board[0][i] = &pieces[16 + i];
+        board->board[1][i] = &pieces[24 + i];
     }
+    return 0;
 }
 
+// The pieces themselves go with the session's arena.
 void free_chess_board(ChessBoard* board) {
-    for (int i = 0; i < 8; i++) for (int j = 0; j < 8; j++) {
-        free(board->board[i][j]);
-        board->board[i][j] = NULL;
-    }
+    for (int i = 0; i < 8; i++) for (int j = 0; j < 8; j++) board->board[i][j] = NULL;
 }
 
-void get_chess_board_string(ChessBoard* board, char* board_str) {
-    char* p = board_str;
-    p += sprintf(p, "\n\033[1;34m✨ CHESS BOARD ✨\033[0m\n");
-    p += sprintf(p, "    a   b   c   d   e   f   g   h\n");
-    p += sprintf(p, "  ┌───┬───┬───┬───┬───┬───┬───┬───┐\n");
-    for (int i = 0; i < 8; i++) {
-        p += sprintf(p, "\033[1;34m%d\033[0m │", 8 - i);
-        for (int j = 0; j < 8; j++) {
-            if (board->board[i][j]) {
-                char* color = board->board[i][j]->color == WHITE ? "\033[1;37m" : "\033[1;30m";
-                p += sprintf(p, "%s%-3s\033[0m│", color, board->board[i][j]->id);
-            } else {
-                p += sprintf(p, " . │");
-            }
-        }
-        p += sprintf(p, "\n");
-        if (i < 7) p += sprintf(p, "  ├───┼───┼───┼───┼───┼───┼───┼───┤\n");
-    }
-    p += sprintf(p, "  └───┴───┴───┴───┴───┴───┴───┴───┘\n");
-    p += sprintf(p, "    a   b   c   d   e   f   g   h\n\n");
+size_t snapshotChessGame(GameSession *session, char *buf, size_t size) {
+    get_chess_board_string(&session->chessBoard, buf);
+    return strlen(buf);
 }
 
 void send_chess_board(GameSession *session) {
-    char board_str[BUFFER_SIZE];
-    bzero(board_str, BUFFER_SIZE);
+    ArenaMark mark = arena_mark(&session->arena);
+    char *board_str = arena_alloc(&session->arena, BUFFER_SIZE);
+    if (!board_str) return;
+    uint64_t span = trace_begin();
     get_chess_board_string(&session->chessBoard, board_str);
-    printf("[DEBUG] Sending chess board to players %d and %d\n", session->player1_fd, session->player2_fd);
+    trace_end(TRACE_SERIALIZE, span);
+    LOG_DEBUG("Sending chess board to players %d and %d", session->player1_id, session->player2_id);
     broadcast(session, board_str);
-    usleep(10000); // 10ms delay to ensure client processes board
-}
-
-int is_path_clear(ChessBoard* board, int fromX, int fromY, int toX, int toY) {
-    int dx = toX - fromX;
-    int dy = toY - fromY;
-    int steps = abs(dx) > abs(dy) ? abs(dx) : abs(dy);
-    int stepX = dx ? dx / abs(dx) : 0;
-    int stepY = dy ? dy / abs(dy) : 0;
-    for (int i = 1; i < steps; i++) {
-        int x = fromX + i * stepX;
-        int y = fromY + i * stepY;
-        if (board->board[x][y]) return 0;
-    }
-    return 1;
-}
-
-int is_legal_move(ChessBoard* board, int fromX, int fromY, int toX, int toY, char* feedback) {
-    Piece* piece = board->board[fromX][fromY];
-    int dx = toX - fromX;
-    int dy = toY - fromY;
-    if (fromX == toX && fromY == toY) {
-        strcpy(feedback, "\033[1;31mInvalid move! Cannot move to the same square.\033[0m");
-        return 0;
-    }
-    if (board->board[toX][toY] && board->board[toX][toY]->color == piece->color) {
-        strcpy(feedback, "\033[1;31mInvalid move! Cannot capture your own piece.\033[0m");
-        return 0;
-    }
-    switch (piece->type) {
-        case PAWN:
-            if (piece->color == WHITE) {
-                if (dx == -1 && dy == 0 && !board->board[toX][toY]) return 1;
-                if (fromX == 6 && dx == -2 && dy == 0 && !board->board[toX][toY] && !board->board[fromX - 1][fromY]) return 1;
-                if (dx == -1 && (dy == 1 || dy == -1) && board->board[toX][toY] && board->board[toX][toY]->color == BLACK) return 1;
-                strcpy(feedback, "\033[1;31mInvalid pawn move! White pawns move up one (or two from row 2) or capture diagonally.\033[0m");
-            } else {
-                if (dx == 1 && dy == 0 && !board->board[toX][toY]) return 1;
-                if (fromX == 1 && dx == 2 && dy == 0 && !board->board[toX][toY] && !board->board[fromX + 1][fromY]) return 1;
-                if (dx == 1 && (dy == 1 || dy == -1) && board->board[toX][toY] && board->board[toX][toY]->color == WHITE) return 1;
-                strcpy(feedback, "\033[1;31mInvalid pawn move! Black pawns move down one (or two from row 7) or capture diagonally.\033[0m");
-            }
-            return 0;
-        case KNIGHT:
-            if ((abs(dx) == 2 && abs(dy) == 1) || (abs(dx) == 1 && abs(dy) == 2)) return 1;
-            strcpy(feedback, "\033[1;31mInvalid knight move! Knights move in an L-shape (2x1 or 1x2).\033[0m");
-            return 0;
-        case BISHOP:
-            if (abs(dx) == abs(dy) && is_path_clear(board, fromX, fromY, toX, toY)) return 1;
-            strcpy(feedback, "\033[1;31mInvalid bishop move! Bishops move diagonally any distance.\033[0m");
-            return 0;
-        case ROOK:
-            if ((dx == 0 || dy == 0) && is_path_clear(board, fromX, fromY, toX, toY)) return 1;
-            strcpy(feedback, "\033[1;31mInvalid rook move! Rooks move horizontally or vertically any distance.\033[0m");
-            return 0;
-        case QUEEN:
-            if ((abs(dx) == abs(dy) || dx == 0 || dy == 0) && is_path_clear(board, fromX, fromY, toX, toY)) return 1;
-            strcpy(feedback, "\033[1;31mInvalid queen move! Queens move diagonally, horizontally, or vertically any distance.\033[0m");
-            return 0;
-        case KING:
-            if (abs(dx) <= 1 && abs(dy) <= 1) return 1;
-            strcpy(feedback, "\033[1;31mInvalid king move! Kings move one square in any direction.\033[0m");
-            return 0;
-    }
-    return 0;
+    arena_rewind(&session->arena, mark);
 }
 
 int move_piece(ChessBoard* board, const char* pieceId, const char* to, Color playerColor, char* feedback) {
-    int fromX = -1, fromY = -1;
-    for (int i = 0; i < 8; i++) {
-        for (int j = 0; j < 8; j++) {
-            if (board->board[i][j] && strcmp(board->board[i][j]->id, pieceId) == 0 && board->board[i][j]->color == playerColor) {
-                fromX = i;
-                fromY = j;
-                break;
-            }
-        }
-        if (fromX != -1) break;
-    }
-    if (fromX == -1) {
-        strcpy(feedback, "\033[1;31mPiece not found or not yours!\033[0m");
-        return 0;
-    }
-    if (strlen(to) != 2) {
-        strcpy(feedback, "\033[1;31mInvalid destination format! Use e.g., 'e5'\033[0m");
-        return 0;
-    }
-    int toY = to[0] - 'a';
-    int toX = 8 - (to[1] - '0');
-    if (toX < 0 || toX > 7 || toY < 0 || toY > 7) {
-        strcpy(feedback, "\033[1;31mDestination out of bounds!\033[0m");
-        return 0;
-    }
-    if (!is_legal_move(board, fromX, fromY, toX, toY, feedback)) return 0;
+    int fromX = -1, fromY = -1, toX, toY;
+    uint64_t span = trace_begin();
+    int legal = check_chess_move(board, pieceId, to, playerColor, &fromX, &fromY, &toX, &toY, feedback);
+    trace_end(TRACE_VALIDATE, span);
+    if (!legal) return 0;
+    span = trace_begin();
     Piece* movingPiece = board->board[fromX][fromY];
     Piece* targetPiece = board->board[toX][toY];
-    if (movingPiece->type == PAWN && targetPiece && targetPiece->type == KING) {
-        free(board->board[toX][toY]);
-        board->board[toX][toY] = board->board[fromX][fromY];
-        board->board[fromX][fromY] = NULL;
-        strcpy(feedback, "\033[1;32mMove successful: Pawn captured King!\033[0m");
-        return 2;
-    }
-    free(board->board[toX][toY]);
+    int kingTaken = movingPiece->type == PAWN && targetPiece && targetPiece->type == KING;
     board->board[toX][toY] = board->board[fromX][fromY];
     board->board[fromX][fromY] = NULL;
-    strcpy(feedback, "\033[1;32mMove successful\033[0m");
-    return 1;
+    strcpy(feedback, kingTaken ? "\033[1;32mMove successful: Pawn captured King!\033[0m" : "\033[1;32mMove successful\033[0m");
+    trace_end(TRACE_UPDATE, span);
+    return kingTaken ? 2 : 1;
 }
 
 int check_chess_winner(ChessBoard* board) {
@@ -376,105 +593,174 @@ int check_chess_winner(ChessBoard* board) {
     return -1;
 }
 
-void runChessGame(GameSession *session) {
-    init_chess_board(&session->chessBoard);
+static const char pgn_piece_letters[] = {'P', 'N', 'B', 'R', 'Q', 'K'};
+
+// Describes a move before it is applied so the finished game can be archived.
+int describe_chess_move(ChessBoard* board, const char* pieceId, const char* to, Color playerColor, PgnMove *m) {
+    int fromX, fromY;
+    if (strlen(to) != 2 || !find_piece(board, pieceId, playerColor, &fromX, &fromY)) return 0;
+    int toY = to[0] - 'a';
+    int toX = 8 - (to[1] - '0');
+    if (toX < 0 || toX > 7 || toY < 0 || toY > 7) return 0;
+    m->from = fromX * 8 + fromY;
+    m->to = toX * 8 + toY;
+    m->piece = pgn_piece_letters[board->board[fromX][fromY]->type];
+    m->capture = board->board[toX][toY] != NULL;
+    return 1;
+}
+
+void describe_player(int id, int playerNum, char *out, size_t size) {
+    if (clients[id].address[0])
+        snprintf(out, size, "Player %d (%s)", playerNum, clients[id].address);
+    else
+        snprintf(out, size, "Player %d", playerNum);
+}
+
+// Hands the finished game to the archive writer; must run before free_chess_board.
+void archive_chess_game(GameSession *session, PgnResult result, const char *termination) {
+    static PgnGameRecord record;
+    describe_player(session->player1_id, 1, record.white, sizeof(record.white));
+    describe_player(session->player2_id, 2, record.black, sizeof(record.black));
+    snprintf(record.termination, sizeof(record.termination), "%s", termination);
+    record.result = result;
+    record.started = session->chessStarted;
+    record.finished = time(NULL);
+    record.plyCount = session->chessMoveCount;
+    int kept = record.plyCount < PGN_MAX_PLIES ? record.plyCount : PGN_MAX_PLIES;
+    memcpy(record.moves, session->chessMoves, kept * sizeof(PgnMove));
+    if (!pgn_archive_submit(&record))
+        LOG_WARN("Archive queue full, chess game dropped");
+}
+
+void startChessGame(GameSession *session) {
+    // Both fit in the slab the session came from (see start_session).
+    session->chessMoves = arena_alloc(&session->arena, PGN_MAX_PLIES * sizeof(PgnMove));
+    init_chess_board(&session->chessBoard, &session->arena);
     session->chessState = PLAYING;
     session->chessTurn = 0;
+    session->chessMoveCount = 0;
+    session->chessStarted = time(NULL);
     char msg[50];
     snprintf(msg, 50, "\033[1;33m🎉 CHESS GAME STARTED! 🎉\033[0m\n");
     broadcast(session, msg);
-    printf("[DEBUG] Chess game started for players %d and %d\n", session->player1_fd, session->player2_fd);
-    usleep(10000); // 10ms delay
+    LOG_DEBUG("Chess game started for players %d and %d", session->player1_id, session->player2_id);
     send_chess_board(session);
-    send_to_player(session->player1_fd, "TURN\n");
-
-    while (!session->gameOver) {
-        int current_fd = session->chessTurn == 0 ? session->player1_fd : session->player2_fd;
-        char buff[BUFFER_SIZE];
-        int n = read(current_fd, buff, sizeof(buff));
-        if (n <= 0) {
-            broadcast(session, "\033[1;31mGame ended: Player disconnected\033[0m\n");
-            session->gameOver = 1;
-            free_chess_board(&session->chessBoard);
-            break;
-        }
-        buff[n] = '\0';
-        if (strncmp(buff, "MOVE:", 5) == 0 && session->chessState == PLAYING) {
-            char pieceId[4], to[3];
-            sscanf(buff + 5, "%s %s", pieceId, to);
-            char feedback[100];
-            Color playerColor = session->chessTurn == 0 ? WHITE : BLACK;
-            int moveResult = move_piece(&session->chessBoard, pieceId, to, playerColor, feedback);
-            if (moveResult > 0) {
-                char move_msg[50];
-                snprintf(move_msg, 50, "\033[1;36mMOVE:Player %d (%c) moved %s to %s\033[0m\n", 
-                        session->chessTurn + 1, session->chessTurn == 0 ? 'W' : 'B', pieceId, to);
-                broadcast(session, move_msg);
-                usleep(10000); // 10ms delay
-                broadcast(session, "BOARD_UPDATE\n");
-                printf("[DEBUG] Sending board update after move %s to %s\n", pieceId, to);
-                usleep(10000); // 10ms delay
-                send_chess_board(session);
-                if (moveResult == 2) {
-                    char win_msg[50];
-                    snprintf(win_msg, 50, "\033[1;32mWINNER:Player %d (%c) by pawn capturing king!\033[0m\n", 
-                            session->chessTurn + 1, session->chessTurn == 0 ? 'W' : 'B');
-                    broadcast(session, win_msg);
-                    session->gameOver = 1;
-                    free_chess_board(&session->chessBoard);
-                    break;
-                }
-                int winner = check_chess_winner(&session->chessBoard);
-                if (winner >= 0) {
-                    char win_msg[50];
-                    snprintf(win_msg, 50, "\033[1;32mWINNER:Player %d (%c) by capturing king!\033[0m\n", 
-                            winner + 1, winner == 0 ? 'W' : 'B');
-                    broadcast(session, win_msg);
-                    session->gameOver = 1;
-                    free_chess_board(&session->chessBoard);
-                    break;
-                }
-                session->chessTurn = (session->chessTurn + 1) % 2;
-                int next_fd = session->chessTurn == 0 ? session->player1_fd : session->player2_fd;
-                printf("[DEBUG] Sending TURN to player %d\n", session->chessTurn + 1);
-                usleep(10000); // 10ms delay
-                send_to_player(next_fd, "TURN\n");
-            } else {
-                send_to_player(current_fd, feedback);
-                usleep(10000); // 10ms delay
-                send_to_player(current_fd, "\nTURN\n");
-            }
-        }
+    send_to_player(session->player1_id, "TURN\n");
+}
+
+void abandonChessGame(GameSession *session, int player) {
+    broadcast(session, "\033[1;31mGame ended: Player disconnected\033[0m\n");
+    archive_chess_game(session, PGN_UNFINISHED, "abandoned");
+    free_chess_board(&session->chessBoard);
+}
+
+void handleChessInput(GameSession *session, int player, char *line) {
+    int current_id = session_player(session, player);
+    if (player != session->chessTurn) {
+        send_to_player(current_id, "Not your turn.\n");
+        return;
+    }
+    if (strcmp(line, "RESIGN") == 0 && session->chessState == PLAYING) {
+        char win_msg[96];
+        snprintf(win_msg, sizeof(win_msg), "\033[1;32mWINNER:Player %d (%c) by resignation\033[0m\n",
+                 2 - player, player == 0 ? 'B' : 'W');
+        broadcast(session, win_msg);
+        session->winner = 1 - player;
+        session->gameOver = 1;
+        archive_chess_game(session, player == 0 ? PGN_BLACK_WINS : PGN_WHITE_WINS, "resignation");
+        free_chess_board(&session->chessBoard);
+        return;
+    }
+    if (strncmp(line, "MOVE:", 5) != 0 || session->chessState != PLAYING) return;
+    char pieceId[4] = "", to[3] = "";
+    sscanf(line + 5, "%3s %2s", pieceId, to);
+    char feedback[100];
+    Color playerColor = session->chessTurn == 0 ? WHITE : BLACK;
+    PgnMove pending;
+    int described = describe_chess_move(&session->chessBoard, pieceId, to, playerColor, &pending);
+    int moveResult = move_piece(&session->chessBoard, pieceId, to, playerColor, feedback);
+    if (moveResult <= 0) {
+        send_to_player(current_id, feedback);
+        send_to_player(current_id, "\nTURN\n");
+        return;
+    }
+    if (described && session->chessMoveCount < PGN_MAX_PLIES) session->chessMoves[session->chessMoveCount] = pending;
+    session->chessMoveCount++;
+    char move_msg[64];
+    snprintf(move_msg, sizeof(move_msg), "\033[1;36mMOVE:Player %d (%c) moved %s to %s\033[0m\n", 
+            session->chessTurn + 1, session->chessTurn == 0 ? 'W' : 'B', pieceId, to);
+    broadcast(session, move_msg);
+    broadcast(session, "BOARD_UPDATE\n");
+    LOG_DEBUG("Sending board update after move %s to %s", pieceId, to);
+    send_chess_board(session);
+    if (moveResult == 2) {
+        char win_msg[96];
+        snprintf(win_msg, sizeof(win_msg), "\033[1;32mWINNER:Player %d (%c) by pawn capturing king!\033[0m\n", 
+                session->chessTurn + 1, session->chessTurn == 0 ? 'W' : 'B');
+        broadcast(session, win_msg);
+        session->winner = session->chessTurn;
+        session->gameOver = 1;
+        archive_chess_game(session, session->chessTurn == 0 ? PGN_WHITE_WINS : PGN_BLACK_WINS, "normal");
+        free_chess_board(&session->chessBoard);
+        return;
+    }
+    int winner = check_chess_winner(&session->chessBoard);
+    if (winner >= 0) {
+        char win_msg[96];
+        snprintf(win_msg, sizeof(win_msg), "\033[1;32mWINNER:Player %d (%c) by capturing king!\033[0m\n", 
+                winner + 1, winner == 0 ? 'W' : 'B');
+        broadcast(session, win_msg);
+        session->winner = winner;
+        session->gameOver = 1;
+        archive_chess_game(session, winner == 0 ? PGN_WHITE_WINS : PGN_BLACK_WINS, "normal");
+        free_chess_board(&session->chessBoard);
+        return;
     }
+    session->chessTurn = (session->chessTurn + 1) % 2;
+    LOG_DEBUG("Sending TURN to player %d", session->chessTurn + 1);
+    send_to_player(session_player(session, session->chessTurn), "TURN\n");
 }
 
 // Snake and Ladder Functions
-void send_sl_board(GameSession *session) {
-    char board_msg[BUFFER_SIZE] = "BOARD:";
-    for (int i = 1; i <= 100; i++) {
+// The board never changes while the server runs, so its message is built once.
+void build_sl_board_message(void) {
+    char *p = slBoardMsg + sprintf(slBoardMsg, "BOARD:");
+    for (int i = 1; i <= slLayout.size; i++) {
         char marker = ' ';
-        for (int j = 0; j < num_snakes; j++) if (snakes[j].start == i) marker = 'S';
-        for (int j = 0; j < num_ladders; j++) if (ladders[j].start == i) marker = 'L';
-        char temp[5];
-        snprintf(temp, 5, "%d%c,", i, marker);
-        strcat(board_msg, temp);
+        if (slLayout.jump[i] < i) marker = 'S';
+        else if (slLayout.jump[i] > i) marker = 'L';
+        p += sprintf(p, "%d%c,", i, marker);
     }
-    board_msg[strlen(board_msg) - 1] = '\n';
-    broadcast(session, board_msg);
+    p[-1] = '\n';
 }
 
-void send_sl_positions(GameSession *session) {
-    char pos_msg[BUFFER_SIZE] = "POSITIONS:";
+void send_sl_board(GameSession *session) {
+    broadcast(session, slBoardMsg);
+}
+
+void get_sl_positions(GameSession *session, char *pos_msg) {
+    strcpy(pos_msg, "POSITIONS:");
     for (int i = 0; i < 2; i++) {
         char temp[20];
         snprintf(temp, 20, "P%d=%d,", i + 1, session->slPositions[i]);
         strcat(pos_msg, temp);
     }
     pos_msg[strlen(pos_msg) - 1] = '\n';
+}
+
+void send_sl_positions(GameSession *session) {
+    char pos_msg[BUFFER_SIZE];
+    get_sl_positions(session, pos_msg);
     broadcast(session, pos_msg);
 }
 
-void runSnakeLadderGame(GameSession *session) {
+size_t snapshotSnakeLadderGame(GameSession *session, char *buf, size_t size) {
+    char pos_msg[BUFFER_SIZE];
+    get_sl_positions(session, pos_msg);
+    return snprintf(buf, size, "%s%s", slBoardMsg, pos_msg);
+}
+
+void startSnakeLadderGame(GameSession *session) {
     session->slPositions[0] = 0;
     session->slPositions[1] = 0;
     session->slState = SL_PLAYING;
@@ -482,169 +768,181 @@ void runSnakeLadderGame(GameSession *session) {
     broadcast(session, "\033[1;33m🎉 SNAKE AND LADDER GAME STARTED! 🎉\033[0m\n");
     send_sl_board(session);
     send_sl_positions(session);
-    send_to_player(session->player1_fd, "TURN\n");
-
-    while (!session->gameOver) {
-        int current_fd = session->slTurn == 0 ? session->player1_fd : session->player2_fd;
-        char buff[BUFFER_SIZE];
-        int n = read(current_fd, buff, sizeof(buff));
-        if (n <= 0) {
-            broadcast(session, "Game ended due to disconnection\n");
-            session->gameOver = 1;
-            break;
+    send_to_player(session->player1_id, "TURN\n");
+}
+
+void abandonSnakeLadderGame(GameSession *session, int player) {
+    broadcast(session, "Game ended due to disconnection\n");
+}
+
+void handleSnakeLadderInput(GameSession *session, int player, char *line) {
+    if (player != session->slTurn) {
+        send_to_player(session_player(session, player), "Not your turn.\n");
+        return;
+    }
+    if (strncmp(line, "ROLL", 4) != 0 || session->slState != SL_PLAYING) return;
+    int roll = game_rng_range(&session->rng, SL_DIE_SIDES) + 1;
+    char roll_msg[50];
+    snprintf(roll_msg, 50, "ROLLED:P%d=%d\n", session->slTurn + 1, roll);
+    broadcast(session, roll_msg);
+    int new_pos = session->slPositions[session->slTurn] + roll;
+    if (new_pos <= slLayout.size) {
+        int dest = slLayout.jump[new_pos];
+        session->slPositions[session->slTurn] = dest;
+        if (dest != new_pos) {
+            char jump_msg[50];
+            snprintf(jump_msg, 50, "%s:P%d=%d-%d\n", dest < new_pos ? "SNAKE" : "LADDER", session->slTurn + 1, new_pos, dest);
+            broadcast(session, jump_msg);
         }
-        buff[n] = '\0';
-        if (strncmp(buff, "ROLL", 4) == 0 && session->slState == SL_PLAYING) {
-            int roll = rand() % 6 + 1;
-            char roll_msg[50];
-            snprintf(roll_msg, 50, "ROLLED:P%d=%d\n", session->slTurn + 1, roll);
-            broadcast(session, roll_msg);
-            int new_pos = session->slPositions[session->slTurn] + roll;
-            if (new_pos <= 100) {
-                session->slPositions[session->slTurn] = new_pos;
-                for (int j = 0; j < num_snakes; j++) {
-                    if (new_pos == snakes[j].start) {
-                        session->slPositions[session->slTurn] = snakes[j].end;
-                        char snake_msg[50];
-                        snprintf(snake_msg, 50, "SNAKE:P%d=%d-%d\n", session->slTurn + 1, new_pos, snakes[j].end);
-                        broadcast(session, snake_msg);
-                        break;
-                    }
-                }
-                for (int j = 0; j < num_ladders; j++) {
-                    if (new_pos == ladders[j].start) {
-                        session->slPositions[session->slTurn] = ladders[j].end;
-                        char ladder_msg[50];
-                        snprintf(ladder_msg, 50, "LADDER:P%d=%d-%d\n", session->slTurn + 1, new_pos, ladders[j].end);
-                        broadcast(session, ladder_msg);
-                        break;
-                    }
-                }
-                if (session->slPositions[session->slTurn] >= 100) {
-                    char win_msg[50];
-                    snprintf(win_msg, 50, "WINNER:Player %d\n", session->slTurn + 1);
-                    broadcast(session, win_msg);
-                    session->gameOver = 1;
-                    break;
-                }
-            }
-            send_sl_positions(session);
-            session->slTurn = (session->slTurn + 1) % 2;
-            int next_fd = session->slTurn == 0 ? session->player1_fd : session->player2_fd;
-            send_to_player(next_fd, "TURN\n");
+        if (session->slPositions[session->slTurn] >= slLayout.size) {
+            char win_msg[50];
+            snprintf(win_msg, 50, "WINNER:Player %d\n", session->slTurn + 1);
+            broadcast(session, win_msg);
+            session->winner = session->slTurn;
+            session->gameOver = 1;
+            return;
         }
     }
+    send_sl_positions(session);
+    session->slTurn = (session->slTurn + 1) % 2;
+    send_to_player(session_player(session, session->slTurn), "TURN\n");
 }
 
 // Tic Tac Toe Functions
 void init_ttt_board(GameSession *session) {
-    for (int i = 0; i < 3; i++)
-        for (int j = 0; j < 3; j++)
-            session->tttBoard[i][j] = ' ';
+    session->tttMasks[0] = 0;
+    session->tttMasks[1] = 0;
+    session->tttLastCell = -1;
+}
+
+char ttt_cell(GameSession *session, int cell) {
+    if ((session->tttMasks[0] >> cell) & 1) return 'X';
+    if ((session->tttMasks[1] >> cell) & 1) return 'O';
+    return ' ';
 }
 
 void get_ttt_board_display(GameSession *session, char *buffer) {
-    sprintf(buffer,
-        "\n %c | %c | %c \n---|---|---\n %c | %c | %c \n---|---|---\n %c | %c | %c \n",
-        session->tttBoard[0][0], session->tttBoard[0][1], session->tttBoard[0][2],
-        session->tttBoard[1][0], session->tttBoard[1][1], session->tttBoard[1][2],
-        session->tttBoard[2][0], session->tttBoard[2][1], session->tttBoard[2][2]);
+    char *p = buffer;
+    p += sprintf(p, "\n");
+    for (int r = 0; r < tttGeometry.rows; r++) {
+        for (int c = 0; c < tttGeometry.cols; c++)
+            p += sprintf(p, " %c %s", ttt_cell(session, r * tttGeometry.cols + c), c < tttGeometry.cols - 1 ? "|" : "\n");
+        if (r < tttGeometry.rows - 1)
+            for (int c = 0; c < tttGeometry.cols; c++)
+                p += sprintf(p, "---%s", c < tttGeometry.cols - 1 ? "|" : "\n");
+    }
 }
 
 int check_ttt_winner(GameSession *session) {
-    for (int i = 0; i < 3; i++) {
-        if (session->tttBoard[i][0] == session->tttCurrentPlayer && session->tttBoard[i][1] == session->tttCurrentPlayer && session->tttBoard[i][2] == session->tttCurrentPlayer)
-            return 1;
-        if (session->tttBoard[0][i] == session->tttCurrentPlayer && session->tttBoard[1][i] == session->tttCurrentPlayer && session->tttBoard[2][i] == session->tttCurrentPlayer)
-            return 1;
-    }
-    if (session->tttBoard[0][0] == session->tttCurrentPlayer && session->tttBoard[1][1] == session->tttCurrentPlayer && session->tttBoard[2][2] == session->tttCurrentPlayer)
-        return 1;
-    if (session->tttBoard[0][2] == session->tttCurrentPlayer && session->tttBoard[1][1] == session->tttCurrentPlayer && session->tttBoard[2][0] == session->tttCurrentPlayer)
-        return 1;
-    return 0;
+    int player = session->tttCurrentPlayer == 'X' ? 0 : 1;
+    if (session->tttLastCell < 0) return 0;
+    return ttt_is_win(&tttGeometry, session->tttMasks[player], session->tttLastCell);
 }
 
 int is_ttt_draw(GameSession *session) {
-    for (int i = 0; i < 3; i++)
-        for (int j = 0; j < 3; j++)
-            if (session->tttBoard[i][j] == ' ') return 0;
-    return 1;
+    return ttt_is_full(&tttGeometry, session->tttMasks[0], session->tttMasks[1]);
+}
+
+size_t snapshotTicTacToeGame(GameSession *session, char *buf, size_t size) {
+    get_ttt_board_display(session, buf);
+    return strlen(buf);
 }
 
 void broadcast_ttt_board(GameSession *session) {
-    char buffer[1024];
+    ArenaMark mark = arena_mark(&session->arena);
+    char *buffer = arena_alloc(&session->arena, SNAPSHOT_SIZE);
+    if (!buffer) return;
+    uint64_t span = trace_begin();
     get_ttt_board_display(session, buffer);
+    trace_end(TRACE_SERIALIZE, span);
     broadcast(session, buffer);
+    arena_rewind(&session->arena, mark);
+}
+
+void send_ttt_hint(GameSession *session, int player, int current_id) {
+    char msg[MAX];
+    if (session->tttHints[player] >= TTT_HINTS_PER_PLAYER) {
+        send_to_player(current_id, "No hints left!\n");
+        return;
+    }
+    session->tttHints[player]++;
+    int cell = ttt_best_move(tttBot, session->tttMasks[player], session->tttMasks[1 - player], serverConfig.tttBotDepth);
+    snprintf(msg, MAX, "Hint: play %d %d\n", cell / tttGeometry.cols, cell % tttGeometry.cols);
+    send_to_player(current_id, msg);
 }
 
-void runTicTacToeGame(GameSession *session) {
+void prompt_ttt_turn(GameSession *session) {
+    int player = session->tttTurn % 2;
+    char move_prompt[96];
+    sprintf(move_prompt, "Your turn Player %c. Enter row and col (0-%d 0-%d) or HINT:\n", (player == 0 ? 'X' : 'O'),
+            tttGeometry.rows - 1, tttGeometry.cols - 1);
+    send_to_player(session_player(session, player), move_prompt);
+}
+
+void startTicTacToeGame(GameSession *session) {
     init_ttt_board(session);
     session->tttCurrentPlayer = 'X';
     session->tttTurn = 0;
+    session->tttHints[0] = session->tttHints[1] = 0;
     broadcast(session, "\033[1;33m🎉 TIC TAC TOE GAME STARTED! 🎉\033[0m\n");
+    if (tttGeometry.rows != 3 || tttGeometry.cols != 3 || tttGeometry.k != 3) {
+        char rules[MAX];
+        snprintf(rules, MAX, "Board is %dx%d, get %d in a row to win.\n", tttGeometry.rows, tttGeometry.cols, tttGeometry.k);
+        broadcast(session, rules);
+    }
     broadcast_ttt_board(session);
+    prompt_ttt_turn(session);
+}
 
-    while (!session->gameOver) {
-        int player = session->tttTurn % 2;
-        int current_fd = player == 0 ? session->player1_fd : session->player2_fd;
-        char move_prompt[64];
-        sprintf(move_prompt, "Your turn Player %c. Enter row and col (0-2 0-2):\n", (player == 0 ? 'X' : 'O'));
-        send_to_player(current_fd, move_prompt);
-
-        int valid_move = 0;
-        while (!valid_move) {
-            char buffer[1024];
-            int n = read(current_fd, buffer, sizeof(buffer));
-            if (n <= 0) {
-                broadcast(session, "Player disconnected.\n");
-                session->gameOver = 1;
-                break;
-            }
-            buffer[n] = '\0';
-            int row, col;
-            if (sscanf(buffer, "%d %d", &row, &col) != 2 ||
-                row < 0 || row > 2 || col < 0 || col > 2 || session->tttBoard[row][col] != ' ') {
-                send_to_player(current_fd, "Invalid move. Try again (format: row col):\n");
-                continue;
-            }
-            valid_move = 1;
-            session->tttCurrentPlayer = (player == 0 ? 'X' : 'O');
-            session->tttBoard[row][col] = session->tttCurrentPlayer;
-        }
-        if (session->gameOver) break;
+void abandonTicTacToeGame(GameSession *session, int player) {
+    broadcast(session, "Player disconnected.\n");
+}
 
-        broadcast_ttt_board(session);
-        if (check_ttt_winner(session)) {
-            char buffer[64];
-            sprintf(buffer, "Player %c wins!\n", session->tttCurrentPlayer);
-            broadcast(session, buffer);
-            session->gameOver = 1;
-            break;
-        }
-        if (is_ttt_draw(session)) {
-            broadcast(session, "It's a draw!\n");
-            session->gameOver = 1;
-            break;
-        }
-        session->tttTurn++;
+void handleTicTacToeInput(GameSession *session, int player, char *line) {
+    int current_id = session_player(session, player);
+    if (player != session->tttTurn % 2) {
+        send_to_player(current_id, "Not your turn.\n");
+        return;
     }
-}
+    if (strncasecmp(line, "HINT", 4) == 0) {
+        send_ttt_hint(session, player, current_id);
+        prompt_ttt_turn(session);
+        return;
+    }
+    uint64_t span = trace_begin();
+    int cell = ttt_parse_move(line, tttGeometry.rows, tttGeometry.cols, session->tttMasks[0] | session->tttMasks[1]);
+    trace_end(TRACE_VALIDATE, span);
+    if (cell < 0) {
+        send_to_player(current_id, "Invalid move. Try again (format: row col):\n");
+        return;
+    }
+    span = trace_begin();
+    session->tttCurrentPlayer = (player == 0 ? 'X' : 'O');
+    session->tttLastCell = cell;
+    session->tttMasks[player] |= (TttMask)1 << session->tttLastCell;
+    trace_end(TRACE_UPDATE, span);
 
-// Rock Paper Scissors Functions
-int receive_rps_move(int sockfd, char *move, const char *playerName) {
-    char buff[MAX];
-    bzero(buff, MAX);
-    read(sockfd, buff, sizeof(buff));
-    if (strncmp(buff, "exit", 4) == 0) {
-        snprintf(move, 16, "exit");
-        return 0;
+    broadcast_ttt_board(session);
+    if (check_ttt_winner(session)) {
+        char buffer[64];
+        sprintf(buffer, "Player %c wins!\n", session->tttCurrentPlayer);
+        broadcast(session, buffer);
+        session->winner = player;
+        session->gameOver = 1;
+        return;
     }
-    strncpy(move, buff, 15);
-    move[15] = '\0';
-    return 1;
+    if (is_ttt_draw(session)) {
+        broadcast(session, "It's a draw!\n");
+        session->gameOver = 1;
+        return;
+    }
+    session->tttTurn++;
+    prompt_ttt_turn(session);
 }
 
+// Rock Paper Scissors Functions
+#define RPS_BEST_OF 3
+
 const char* get_rps_winner(const char *p1, const char *p2) {
     if (strcmp(p1, p2) == 0) return "It's a tie!";
     if ((strcmp(p1, "STONE") == 0 && strcmp(p2, "SCISSORS") == 0) ||
@@ -656,202 +954,2007 @@ const char* get_rps_winner(const char *p1, const char *p2) {
     }
 }
 
-void runRockPaperScissorGame(GameSession *session) {
-    int bestOf = 3;
-    int roundsNeededToWin = (bestOf / 2) + 1;
+void start_rps_round(GameSession *session) {
+    char msg[MAX];
+    session->rpsRounds++;
+    session->rpsCommitted[0] = session->rpsCommitted[1] = 0;
+    snprintf(msg, MAX, "\n--- Round %d ---\nEnter STONE, PAPER, or SCISSORS:\n", session->rpsRounds);
+    broadcast(session, msg);
+}
+
+void startRockPaperScissorGame(GameSession *session) {
     session->rpsScore[0] = 0;
     session->rpsScore[1] = 0;
     session->rpsRounds = 0;
-    char p1Move[16], p2Move[16];
-    char msg[MAX];
-
     broadcast(session, "\033[1;33m🎉 ROCK PAPER SCISSORS GAME STARTED! 🎉\033[0m\n");
+    start_rps_round(session);
+}
 
-    while (session->rpsScore[0] < roundsNeededToWin && session->rpsScore[1] < roundsNeededToWin) {
-        session->rpsRounds++;
-        snprintf(msg, MAX, "\n--- Round %d ---\nEnter STONE, PAPER, or SCISSORS:\n", session->rpsRounds);
-        broadcast(session, msg);
+void abandonRockPaperScissorGame(GameSession *session, int player) {
+    broadcast(session, "A player disconnected. Game over.\n");
+}
 
-        if (!receive_rps_move(session->player1_fd, p1Move, "Player 1") || 
-            !receive_rps_move(session->player2_fd, p2Move, "Player 2")) {
-            broadcast(session, "A player disconnected. Game over.\n");
-            session->gameOver = 1;
-            break;
-        }
+// Both players commit a move at their own pace, in either order; the
+// round is resolved as soon as the second move arrives.
+void handleRockPaperScissorInput(GameSession *session, int player, char *line) {
+    int roundsNeededToWin = (RPS_BEST_OF / 2) + 1;
+    int current_id = session_player(session, player);
+    char msg[MAX];
 
-        for (int i = 0; p1Move[i]; i++) p1Move[i] = toupper(p1Move[i]);
-        for (int i = 0; p2Move[i]; i++) p2Move[i] = toupper(p2Move[i]);
+    if (strncmp(line, "exit", 4) == 0) {
+        abandonRockPaperScissorGame(session, player);
+        session->winner = 1 - player;
+        session->gameOver = 1;
+        return;
+    }
+    if (session->rpsCommitted[player]) {
+        send_to_player(current_id, "Move already locked in. Waiting for opponent...\n");
+        return;
+    }
+    char *move = session->rpsMoves[player];
+    strncpy(move, line, 15);
+    move[15] = '\0';
+    for (int i = 0; move[i]; i++) move[i] = toupper(move[i]);
+    if (strcmp(move, "STONE") != 0 && strcmp(move, "PAPER") != 0 && strcmp(move, "SCISSORS") != 0) {
+        send_to_player(current_id, "Invalid move! Enter STONE, PAPER, or SCISSORS:\n");
+        return;
+    }
+    session->rpsCommitted[player] = 1;
+    if (!session->rpsCommitted[1 - player]) {
+        send_to_player(session_player(session, 1 - player), "Opponent has locked in a move.\n");
+        return;
+    }
 
-        snprintf(msg, MAX, "Player 1 chose: %s\n", p1Move);
-        broadcast(session, msg);
-        snprintf(msg, MAX, "Player 2 chose: %s\n", p2Move);
-        broadcast(session, msg);
+    snprintf(msg, MAX, "Player 1 chose: %s\n", session->rpsMoves[0]);
+    broadcast(session, msg);
+    snprintf(msg, MAX, "Player 2 chose: %s\n", session->rpsMoves[1]);
+    broadcast(session, msg);
 
-        const char *result = get_rps_winner(p1Move, p2Move);
-        snprintf(msg, MAX, "Result: %s\n", result);
-        broadcast(session, msg);
+    const char *result = get_rps_winner(session->rpsMoves[0], session->rpsMoves[1]);
+    snprintf(msg, MAX, "Result: %s\n", result);
+    broadcast(session, msg);
 
-        if (strstr(result, "Player 1 wins")) session->rpsScore[0]++;
-        else if (strstr(result, "Player 2 wins")) session->rpsScore[1]++;
+    if (strstr(result, "Player 1 wins")) session->rpsScore[0]++;
+    else if (strstr(result, "Player 2 wins")) session->rpsScore[1]++;
 
-        snprintf(msg, MAX, "Score: Player 1 [%d] - Player 2 [%d]\n", session->rpsScore[0], session->rpsScore[1]);
-        broadcast(session, msg);
-    }
+    snprintf(msg, MAX, "Score: Player 1 [%d] - Player 2 [%d]\n", session->rpsScore[0], session->rpsScore[1]);
+    broadcast(session, msg);
 
-    if (!session->gameOver) {
-        if (session->rpsScore[0] > session->rpsScore[1]) 
-            broadcast(session, "\n🏆 Player 1 wins the game!\n");
-        else 
-            broadcast(session, "\n🏆 Player 2 wins the game!\n");
-        broadcast(session, "Game over. Thanks for playing!\n");
-        session->gameOver = 1;
+    if (session->rpsScore[0] < roundsNeededToWin && session->rpsScore[1] < roundsNeededToWin) {
+        start_rps_round(session);
+        return;
     }
+    session->winner = session->rpsScore[0] > session->rpsScore[1] ? 0 : 1;
+    if (session->winner == 0)
+        broadcast(session, "\n🏆 Player 1 wins the game!\n");
+    else
+        broadcast(session, "\n🏆 Player 2 wins the game!\n");
+    broadcast(session, "Game over. Thanks for playing!\n");
+    session->gameOver = 1;
 }
 
-// Main Server Logic
-int main() {
-    int sockfd;
-    struct sockaddr_in servaddr;
-    fd_set readfds;
-    srand(time(NULL));
+typedef struct {
+    const char *name;
+    void (*start)(GameSession *session);
+    void (*input)(GameSession *session, int player, char *line);
+    void (*abandon)(GameSession *session, int player);     // player left mid-game
+    // The current state as a spectator would be shown it, into at least
+    // SNAPSHOT_SIZE bytes; may be NULL
+    size_t (*snapshot)(GameSession *session, char *buf, size_t size);
+} GameHandlers;
+
+const GameHandlers games[GAME_TYPE_COUNT] = {
+    [WORDLE] = {"WORDLE", startWordleGame, handleWordleInput, abandonWordleGame, NULL},
+    [CHESS] = {"CHESS", startChessGame, handleChessInput, abandonChessGame, snapshotChessGame},
+    [SNAKE_LADDER] = {"SNAKE_LADDER", startSnakeLadderGame, handleSnakeLadderInput, abandonSnakeLadderGame, snapshotSnakeLadderGame},
+    [TIC_TAC_TOE] = {"TIC_TAC_TOE", startTicTacToeGame, handleTicTacToeInput, abandonTicTacToeGame, snapshotTicTacToeGame},
+    [ROCK_PAPER_SCISSOR] = {"ROCK_PAPER_SCISSOR", startRockPaperScissorGame, handleRockPaperScissorInput, abandonRockPaperScissorGame, NULL},
+};
+
+int find_game(const char *name) {
+    for (int g = 0; g < GAME_TYPE_COUNT; g++)
+        if (strcmp(name, games[g].name) == 0) return g;
+    return -1;
+}
 
-    sockfd = socket(AF_INET, SOCK_STREAM, 0);
-    if (sockfd == -1) {
-        printf("Socket creation failed...\n");
-        exit(0);
+// Each session gets its own generator; the seed is logged so a game's dice
+// and word choice can be reproduced by setting rng_seed.
+void seed_session_rng(GameSession *session) {
+    if (serverConfig.rngSeed) {
+        uint64_t x = (uint64_t)serverConfig.rngSeed + session->id;
+        session->rngSeed = game_rng_splitmix(&x);
+    } else {
+        session->rngSeed = game_rng_fresh_seed();
     }
-    printf("Socket successfully created..\n");
+    game_rng_seed(&session->rng, session->rngSeed);
+    LOG_INFO("Session %d seed: %016llx", session->id, (unsigned long long)session->rngSeed);
+}
 
-    int opt = 1;
-    setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+// Sessions
+void end_session(GameSession *session);
+void bot_poke_session(GameSession *session);
+int bot_wants_move(GameSession *session, int player);
+long long now_ms(void);
+long long now_ns(void);
+void check_tournament_over(TournamentEntry *entry);
+
+// Keyframe for replays: playback can start here without the moves before.
+void replay_snapshot(GameSession *session) {
+    if (!games[session->gameType].snapshot) return;
+    ArenaMark mark = arena_mark(&session->arena);
+    char *snapshot = arena_alloc(&session->arena, SNAPSHOT_SIZE);
+    if (!snapshot) return;
+    replay_keyframe(&session->replay, snapshot, games[session->gameType].snapshot(session, snapshot, SNAPSHOT_SIZE));
+    arena_rewind(&session->arena, mark);
+}
 
-    bzero(&servaddr, sizeof(servaddr));
-    servaddr.sin_family = AF_INET;
-    servaddr.sin_addr.s_addr = htonl(INADDR_ANY);
-    servaddr.sin_port = htons(PORT);
+// Adds what the session's arena has grown or shrunk by to the memory gauge.
+void count_session_memory(GameSession *session) {
+    if (session->arena.footprint == session->memoryCounted) return;
+    metrics_add(METRIC_SESSION_MEMORY, session->gameType, (int64_t)session->arena.footprint - (int64_t)session->memoryCounted);
+    session->memoryCounted = session->arena.footprint;
+}
 
-    if (bind(sockfd, (SA*)&servaddr, sizeof(servaddr)) != 0) {
-        printf("Socket bind failed...\n");
-        exit(0);
+// The session and the game state allocated when it starts share one slab,
+// so once the session exists its game cannot run out of memory.
+_Static_assert(ARENA_ROUND(sizeof(GameSession)) + PGN_MAX_PLIES * sizeof(PgnMove) +
+               ARENA_ROUND(CHESS_PIECES * sizeof(Piece)) <= ARENA_SLAB_SIZE, "a chess session must fit in one arena slab");
+
+GameSession *start_session(GameType gameType, int p1, int p2, TournamentEntry *tournament, int matchId) {
+    Arena arena = {0};
+    GameSession *session = arena_calloc(&arena, sizeof(GameSession));
+    if (!session) {
+        LOG_ERROR("Out of memory starting a session");
+        return NULL;
     }
-    printf("Socket successfully bound..\n");
+    session->arena = arena;
+    session->id = nextSessionId++;
+    session->player1_id = p1;
+    session->player2_id = p2;
+    session->gameType = gameType;
+    session->winner = -1;
+    session->tournament = tournament;
+    session->tournamentMatch = matchId;
+    seed_session_rng(session);
+    session->traced = trace_wants_session(session->id);
+    lobbyDirty = 1;
+    long long now = now_ns();
+    for (int player = 0; player < 2; player++) {
+        Client *c = &clients[session_player(session, player)];
+        if (!tournament && !c->bot) metrics_observe(METRIC_MATCH_WAIT, gameType, now - c->joinedNs);
+        c->state = CLIENT_PLAYING;
+        c->session = session;
+        c->player = player;
+        session->playerIds[player] = c->playerId;
+        session->turnStartNs[player] = now;
+    }
+    char start_msg[50];
+    snprintf(start_msg, sizeof(start_msg), "START:%s\n", games[gameType].name);
+    send_to_player(p1, start_msg);
+    send_to_player(p1, "Connected as Player 1. Game starting...\n");
+    send_to_player(p2, start_msg);
+    send_to_player(p2, "Connected as Player 2. Game starting...\n");
+    numSessions++;
+    session->next = activeSessions;
+    if (activeSessions) activeSessions->prev = session;
+    activeSessions = session;
+    metrics_add(METRIC_SESSIONS_STARTED, gameType, 1);
+    metrics_add(METRIC_SESSIONS_ACTIVE, gameType, 1);
+    games[gameType].start(session);
+    // Bot soak games would only fill the replay files.
+    if (!session->soak) {
+        replay_begin(&session->replay, session->id, gameType, time(NULL));
+        replay_snapshot(session);
+    }
+    count_session_memory(session);
+    bot_poke_session(session);
+    return session;
+}
 
-    if (listen(sockfd, 5) != 0) {
-        printf("Listen failed...\n");
-        exit(0);
+// Clients
+int client_alloc(int fd) {
+    if (numFreeClients == 0) {
+        int capacity = clientCapacity ? clientCapacity * 2 : INITIAL_CLIENTS;
+        Client *grown = realloc(clients, capacity * sizeof(Client));
+        int *grownFree = realloc(freeClientIds, capacity * sizeof(int));
+        if (grown) clients = grown;
+        if (grownFree) freeClientIds = grownFree;
+        if (!grown || !grownFree) return -1;
+        for (int id = capacity - 1; id >= clientCapacity; id--) {
+            clients[id].fd = -1;
+            clients[id].state = CLIENT_FREE;
+            freeClientIds[numFreeClients++] = id;
+        }
+        clientCapacity = capacity;
     }
-    printf("Server listening..\n");
+    int id = freeClientIds[--numFreeClients];
+    Client *c = &clients[id];
+    memset(c, 0, sizeof(Client));
+    c->fd = fd;
+    c->state = CLIENT_SELECTING;
+    c->tournamentSlot = -1;
+    c->conn = -1;
+    c->playerId = -1;
+    if (id >= clientHigh) clientHigh = id + 1;
+    return id;
+}
 
-    while (1) {
-        FD_ZERO(&readfds);
-        FD_SET(sockfd, &readfds);
-        int max_fd = sockfd;
-
-        for (int i = 0; i < numWaiting; i++) {
-            FD_SET(waitingPlayers[i].connfd, &readfds);
-            if (waitingPlayers[i].connfd > max_fd) max_fd = waitingPlayers[i].connfd;
-        }
-        for (int i = 0; i < numSessions; i++) {
-            if (!sessions[i].gameOver) {
-                FD_SET(sessions[i].player1_fd, &readfds);
-                FD_SET(sessions[i].player2_fd, &readfds);
-                if (sessions[i].player1_fd > max_fd) max_fd = sessions[i].player1_fd;
-                if (sessions[i].player2_fd > max_fd) max_fd = sessions[i].player2_fd;
+void client_lost(int id);
+void stop_spectating(int id);
+void lobby_unsubscribe(int id);
+
+// Channels go with their connection. They are detached first, so the
+// games they leave do not write to a connection that is going away.
+void close_channels(int id) {
+    for (int ch = 1; ch < CLIENT_MAX_CHANNELS; ch++) {
+        int channelId = clients[id].channels[ch] - 1;
+        if (channelId < 0) continue;
+        clients[id].channels[ch] = 0;
+        clients[channelId].conn = -1;
+        client_lost(channelId);
+    }
+}
+
+void client_close(int id) {
+    Client *c = &clients[id];
+    if (c->state == CLIENT_FREE) return;
+    if (c->state == CLIENT_SPECTATING) stop_spectating(id);
+    if (c->multiplexed) close_channels(id);
+    if (clients[id].lobbyWatcher) lobby_unsubscribe(id);
+    c = &clients[id];
+    if (c->conn >= 0) {
+        Client *conn = &clients[c->conn];
+        conn->channels[c->channel] = 0;
+        char msg[32];
+        snprintf(msg, sizeof(msg), "@%d CLOSED\n", c->channel);
+        send_bytes(c->conn, msg, strlen(msg));
+        c->conn = -1;
+    }
+    if (c->fd >= 0) {
+        if (ioLoop) io_loop_remove(ioLoop, id);
+        close(c->fd);
+        metrics_add(METRIC_CONNECTIONS_CLOSED, 0, 1);
+        metrics_add(METRIC_CONNECTIONS_OPEN, 0, -1);
+    }
+    free(c->out);
+    free(c->bot);
+    c->fd = -1;
+    c->out = NULL;
+    c->bot = NULL;
+    c->state = CLIENT_FREE;
+    c->session = NULL;
+    freeClientIds[numFreeClients++] = id;
+}
+
+// Ends the connection once everything queued for it has been sent.
+void client_finish(int id) {
+    if (clients[id].outLen == 0) client_close(id);
+    else clients[id].closing = 1;
+}
+
+// After a game or tournament: a plain connection plays one and is closed,
+// a multiplexed connection and its channels go back to selecting.
+void client_done(int id) {
+    Client *c = &clients[id];
+    if (c->conn >= 0 || c->multiplexed) return;
+    client_finish(id);
+}
+
+// Players waiting for an opponent plus registrations for the next tournament.
+void update_queue_depth(GameType gameType) {
+    TournamentEntry *lobby = tournamentLobby[gameType];
+    metrics_set(METRIC_QUEUE_DEPTH, gameType, (waitingPlayer[gameType] >= 0) + (lobby ? lobby->count : 0));
+    lobbyDirty = 1;
+}
+
+// Takes a client out of matchmaking and any tournament it entered.
+void leave_queues(int id) {
+    Client *c = &clients[id];
+    if (c->state == CLIENT_WAITING && waitingPlayer[c->gameType] == id) {
+        waitingPlayer[c->gameType] = -1;
+        update_queue_depth(c->gameType);
+    }
+    TournamentEntry *entry = c->tournament;
+    if (!entry) return;
+    c->tournament = NULL;
+    if (entry->tournament) {
+        tournament_withdraw(entry->tournament, c->tournamentSlot);
+        entry->players[c->tournamentSlot] = -1;
+        return;
+    }
+    // Not started yet: close the gap in the registration list.
+    for (int i = c->tournamentSlot; i < entry->count - 1; i++) {
+        entry->players[i] = entry->players[i + 1];
+        clients[entry->players[i]].tournamentSlot = i;
+    }
+    entry->count--;
+    update_queue_depth(entry->gameType);
+}
+
+// The peer went away (or typed exit in a game without its own handling).
+void client_lost(int id) {
+    // A channel's game may be against its own connection: settle the
+    // channels first, so the connection's session is looked up afterwards.
+    if (clients[id].multiplexed) close_channels(id);
+    Client *c = &clients[id];
+    GameSession *session = c->state == CLIENT_PLAYING ? c->session : NULL;
+    int player = c->player;
+    LOG_INFO("Client %d disconnected", id);
+    leave_queues(id);
+    if (session) {
+        session->winner = 1 - player;
+        games[session->gameType].abandon(session, player);
+        session->gameOver = 1;
+    }
+    client_close(id);
+    if (session) end_session(session);
+}
+
+// Both players go back to their tournament, or are disconnected once the
+// final messages are out; a tournament match then reports its result.
+void end_session(GameSession *session) {
+    for (int player = 0; player < 2; player++) {
+        int id = session_player(session, player);
+        Client *c = &clients[id];
+        if (c->state != CLIENT_PLAYING || c->session != session) continue;
+        c->session = NULL;
+        if (c->tournament) {
+            c->state = CLIENT_TOURNAMENT;
+        } else {
+            c->state = CLIENT_SELECTING;
+            client_done(id);
+        }
+    }
+    for (int i = 0; i < session->numSpectators; i++) {
+        Client *c = &clients[session->spectators[i]];
+        send_to_player(session->spectators[i], "SPECTATE_END\n");
+        c->state = CLIENT_SELECTING;
+        c->session = NULL;
+    }
+    replay_end(&session->replay, session->winner, time(NULL));
+    player_stats_record(session->gameType, session->playerIds, session->winner, session->turns, session->turnNs);
+    if (session->prev) session->prev->next = session->next;
+    else activeSessions = session->next;
+    if (session->next) session->next->prev = session->prev;
+    numSessions--;
+    lobbyDirty = 1;
+    metrics_add(METRIC_SESSIONS_FINISHED, session->gameType, 1);
+    metrics_add(METRIC_SESSIONS_ACTIVE, session->gameType, -1);
+    metrics_add(METRIC_SESSION_MEMORY, session->gameType, -(int64_t)session->memoryCounted);
+    if (session->soak) {
+        soakRunning--;
+        soakFinished++;
+    }
+    TournamentEntry *entry = session->tournament;
+    int matchId = session->tournamentMatch, winner = session->winner;
+    Arena arena = session->arena;
+    arena_release(&arena);
+    if (entry) {
+        tournament_report(entry->tournament, matchId, winner);
+        check_tournament_over(entry);
+    }
+}
+
+// Tournaments
+void tournament_start_match(void *ctx, int matchId, int a, int b) {
+    TournamentEntry *entry = ctx;
+    if (start_session(entry->gameType, entry->players[a], entry->players[b], entry, matchId)) return;
+    // The match cannot be played, so settle it or the round never ends. A
+    // knockout needs a winner; the caller checks whether the tournament is over.
+    send_to_player(entry->players[a], "TOURNAMENT:Out of memory, the match is settled without playing\n");
+    send_to_player(entry->players[b], "TOURNAMENT:Out of memory, the match is settled without playing\n");
+    tournament_report(entry->tournament, matchId, tournament_format(entry->tournament) == TOURNAMENT_BRACKET ? 0 : -1);
+}
+
+void tournament_message(void *ctx, int participant, const char *msg) {
+    TournamentEntry *entry = ctx;
+    if (entry->players[participant] >= 0) send_to_player(entry->players[participant], msg);
+}
+
+void tournament_finished(void *ctx) {
+    TournamentEntry *entry = ctx;
+    LOG_INFO("%s tournament finished", games[entry->gameType].name);
+}
+
+const TournamentCallbacks tournamentCallbacks = {tournament_start_match, tournament_message, tournament_finished};
+
+void check_tournament_over(TournamentEntry *entry) {
+    if (!tournament_is_over(entry->tournament)) return;
+    for (int i = 0; i < entry->count; i++) {
+        int id = entry->players[i];
+        if (id < 0) continue;
+        clients[id].tournament = NULL;
+        if (clients[id].state == CLIENT_TOURNAMENT) clients[id].state = CLIENT_SELECTING;
+        client_done(id);
+    }
+    tournament_free(entry->tournament);
+    free(entry->players);
+    free(entry);
+}
+
+void join_tournament(int id, GameType gameType) {
+    TournamentEntry *entry = tournamentLobby[gameType];
+    if (!entry) {
+        entry = calloc(1, sizeof(TournamentEntry));
+        if (entry) entry->players = malloc(serverConfig.tournamentPlayers * sizeof(int));
+        if (!entry || !entry->players) {
+            free(entry);
+            send_to_player(id, "ERROR:Server is out of memory\n");
+            return;
+        }
+        entry->gameType = gameType;
+        entry->size = serverConfig.tournamentPlayers;
+        tournamentLobby[gameType] = entry;
+    }
+    Client *c = &clients[id];
+    c->state = CLIENT_TOURNAMENT;
+    c->tournament = entry;
+    c->tournamentSlot = entry->count;
+    entry->players[entry->count++] = id;
+    char msg[MAX];
+    snprintf(msg, MAX, "TOURNAMENT:Registered as Player %d, %d of %d players joined\n", entry->count, entry->count, entry->size);
+    send_to_player(id, "WAITING\n");
+    send_to_player(id, msg);
+    if (entry->count < entry->size) {
+        update_queue_depth(gameType);
+        return;
+    }
+
+    tournamentLobby[gameType] = NULL;
+    update_queue_depth(gameType);
+    TournamentFormat format = strcasecmp(serverConfig.tournamentFormat, "bracket") == 0 ? TOURNAMENT_BRACKET : TOURNAMENT_SWISS;
+    entry->tournament = tournament_create(format, entry->count, serverConfig.tournamentRounds, &tournamentCallbacks, entry);
+    if (!entry->tournament) {
+        for (int i = 0; i < entry->count; i++) {
+            send_to_player(entry->players[i], "ERROR:Could not start the tournament\n");
+            clients[entry->players[i]].tournament = NULL;
+            client_finish(entry->players[i]);
+        }
+        free(entry->players);
+        free(entry);
+        return;
+    }
+    LOG_INFO("Starting %s %s tournament with %d players", format == TOURNAMENT_BRACKET ? "bracket" : "Swiss",
+           games[gameType].name, entry->count);
+    tournament_start(entry->tournament);
+    check_tournament_over(entry);
+}
+
+// Matchmaking
+// Pairs the player with the one waiting for the game, or makes it wait;
+// waitingSince is when it started waiting, for the bot fill.
+void queue_player(int id, int gameType, long long waitingSince) {
+    int other = waitingPlayer[gameType];
+    if (other < 0) {
+        waitingPlayer[gameType] = id;
+        clients[id].state = CLIENT_WAITING;
+        clients[id].waitingSince = waitingSince;
+        update_queue_depth(gameType);
+        return;
+    }
+    waitingPlayer[gameType] = -1;
+    update_queue_depth(gameType);
+    if (start_session(gameType, other, id, NULL, -1)) return;
+    // The other player keeps its place; this one is told and can choose again.
+    waitingPlayer[gameType] = other;
+    update_queue_depth(gameType);
+    send_to_player(id, "ERROR:Server is out of memory\n");
+}
+
+void join_game(int id, const char *choice, int tournament) {
+    int gameType = find_game(choice);
+    char msg[MAX];
+    if (gameType < 0) {
+        snprintf(msg, MAX, "ERROR:Unknown game %.40s\n", choice);
+        send_to_player(id, msg);
+        return;
+    }
+    LOG_INFO("Player %d selected %s: %s", id, tournament ? "tournament" : "game", choice);
+    clients[id].gameType = gameType;
+    clients[id].joinedNs = now_ns();
+    if (tournament) {
+        join_tournament(id, gameType);
+        return;
+    }
+    send_to_player(id, "WAITING\n");
+    queue_player(id, gameType, now_ms());
+}
+
+// Spectating
+void list_sessions(int id) {
+    char msg[BUFFER_SIZE] = "SESSIONS:";
+    size_t len = strlen(msg);
+    for (GameSession *session = activeSessions; session; session = session->next) {
+        int n = snprintf(msg + len, sizeof(msg) - len, "%s%d:%s", len > 9 ? "," : "", session->id,
+                         games[session->gameType].name);
+        if (n < 0 || len + n >= sizeof(msg) - 1) break;
+        len += n;
+    }
+    msg[len] = '\0';
+    strcat(msg, "\n");
+    send_to_player(id, msg);
+}
+
+void spectate_session(int id, const char *arg) {
+    int sessionId = atoi(arg);
+    GameSession *session = activeSessions;
+    while (session && session->id != sessionId) session = session->next;
+    if (!session) {
+        send_to_player(id, "ERROR:No such session\n");
+        return;
+    }
+    if (session->numSpectators == SESSION_MAX_SPECTATORS) {
+        send_to_player(id, "ERROR:Too many spectators\n");
+        return;
+    }
+    session->spectators[session->numSpectators++] = id;
+    clients[id].state = CLIENT_SPECTATING;
+    clients[id].session = session;
+    char msg[MAX];
+    snprintf(msg, MAX, "SPECTATING:%d %s\n", session->id, games[session->gameType].name);
+    send_to_player(id, msg);
+    if (games[session->gameType].snapshot) {
+        ArenaMark mark = arena_mark(&session->arena);
+        char *snapshot = arena_alloc(&session->arena, SNAPSHOT_SIZE);
+        if (snapshot) send_bytes(id, snapshot, games[session->gameType].snapshot(session, snapshot, SNAPSHOT_SIZE));
+        arena_rewind(&session->arena, mark);
+    }
+}
+
+void stop_spectating(int id) {
+    GameSession *session = clients[id].session;
+    for (int i = 0; i < session->numSpectators; i++) {
+        if (session->spectators[i] != id) continue;
+        session->spectators[i] = session->spectators[--session->numSpectators];
+        break;
+    }
+    clients[id].state = CLIENT_SELECTING;
+    clients[id].session = NULL;
+}
+
+// Replays
+// Output waiting to go out on the client's connection.
+size_t pending_output(int id) {
+    int conn = clients[id].conn >= 0 ? clients[id].conn : id;
+    return clients[conn].outLen;
+}
+
+// Sends the replay on from the mapping while the connection keeps up, and
+// stops once REPLAY_WINDOW is queued; the client is pumped again as its
+// output drains.
+void replay_pump(int id) {
+    Client *c = &clients[id];
+    const char *data;
+    while (c->state == CLIENT_REPLAYING && !c->broken && pending_output(id) < REPLAY_WINDOW) {
+        size_t len = replay_next(&c->replay, &data);
+        if (len == 0) {
+            c->state = CLIENT_SELECTING;
+            send_to_player(id, "REPLAY_END\n");
+            break;
+        }
+        send_bytes(id, data, len);
+        c = &clients[id];
+    }
+}
+
+// The connection's output drained: carry on with its replays.
+void replay_resume(int id) {
+    if (clients[id].state == CLIENT_REPLAYING) replay_pump(id);
+    if (!clients[id].multiplexed) return;
+    for (int ch = 1; ch < CLIENT_MAX_CHANNELS; ch++) {
+        int channelId = clients[id].channels[ch] - 1;
+        if (channelId >= 0 && clients[channelId].state == CLIENT_REPLAYING) replay_pump(channelId);
+    }
+}
+
+// "<id>[:<from>[:<to>]]": the game from after move from (0 = its start)
+// up to move to (the end by default).
+void start_replay(int id, const char *arg) {
+    int gameId = atoi(arg), fromMove = 0, toMove = -1;
+    const char *sep = strchr(arg, ':');
+    if (sep) {
+        fromMove = atoi(sep + 1);
+        sep = strchr(sep + 1, ':');
+        if (sep) toMove = atoi(sep + 1);
+    }
+    ReplayInfo info;
+    if (fromMove < 0 || replay_open(gameId, fromMove, toMove, &clients[id].replay, &info) != 0) {
+        send_to_player(id, "ERROR:No such replay\n");
+        return;
+    }
+    char msg[MAX];
+    snprintf(msg, MAX, "REPLAY:%d %s %d%s\n", gameId, games[info.gameType].name, info.moves, info.live ? " LIVE" : "");
+    send_to_player(id, msg);
+    clients[id].state = CLIENT_REPLAYING;
+    replay_pump(id);
+}
+
+// Lobby feed
+// What a lobby watcher is shown: per game the players waiting (for an
+// opponent or a tournament) and the games in progress, and the live
+// matches between the best rated players.
+typedef struct {
+    int waiting[GAME_TYPE_COUNT];
+    int playing[GAME_TYPE_COUNT];
+    int numFeatured;
+    int featured[LOBBY_FEATURED];       // session ids, best first
+    GameType featuredGame[LOBBY_FEATURED];
+    char featuredNames[LOBBY_FEATURED][2][PLAYER_NAME_SIZE];
+} LobbyState;
+
+LobbyState lobbyPublished;      // as of the last update sent
+unsigned lobbySeq = 0;
+char lobbyFull[BUFFER_SIZE];    // lobbyPublished encoded whole, once needed
+size_t lobbyFullLen = 0;
+int *lobbyWatchers;
+int numLobbyWatchers = 0, lobbyWatcherCapacity = 0;
+int numLobbyStale = 0;
+long long nextLobbyUpdate;      // ms
+
+// Players without a name, and bots, count as new players.
+int lobby_rating(GameSession *session, int player) {
+    const PlayerGameStats *st = player_stats_get(session->gameType, session->playerIds[player]);
+    return st ? st->rating : PLAYER_RATING_START;
+}
+
+void lobby_collect(LobbyState *state) {
+    GameSession *top[LOBBY_FEATURED];
+    int score[LOBBY_FEATURED];
+    memset(state, 0, sizeof(*state));
+    for (int g = 0; g < GAME_TYPE_COUNT; g++)
+        state->waiting[g] = (waitingPlayer[g] >= 0) + (tournamentLobby[g] ? tournamentLobby[g]->count : 0);
+    for (GameSession *s = activeSessions; s; s = s->next) {
+        state->playing[s->gameType]++;
+        if (s->soak) continue;
+        // Kept sorted by combined rating, the older game first on a tie.
+        int rating = lobby_rating(s, 0) + lobby_rating(s, 1);
+        int n = state->numFeatured, i = n;
+        while (i > 0 && (score[i - 1] < rating || (score[i - 1] == rating && top[i - 1]->id > s->id))) i--;
+        if (i == LOBBY_FEATURED) continue;
+        if (n < LOBBY_FEATURED) state->numFeatured = ++n;
+        for (int j = n - 1; j > i; j--) {
+            top[j] = top[j - 1];
+            score[j] = score[j - 1];
+        }
+        top[i] = s;
+        score[i] = rating;
+    }
+    for (int i = 0; i < state->numFeatured; i++) {
+        state->featured[i] = top[i]->id;
+        state->featuredGame[i] = top[i]->gameType;
+        for (int player = 0; player < 2; player++) {
+            const char *name = player_stats_name(top[i]->playerIds[player]);
+            if (!name) name = clients[session_player(top[i], player)].bot ? "bot" : "guest";
+            strcpy(state->featuredNames[i][player], name);
+        }
+    }
+}
+
+int lobby_same_featured(const LobbyState *a, const LobbyState *b) {
+    if (a->numFeatured != b->numFeatured) return 0;
+    for (int i = 0; i < a->numFeatured; i++)
+        if (a->featured[i] != b->featured[i]) return 0;
+    return 1;
+}
+
+// "LOBBY:FULL <seq> <GAME>=<waiting>/<playing> ... featured=<id>:<GAME>:<name>:<name>,..."
+// with every game, or with from given "LOBBY:DELTA <seq> ..." with only
+// what changed since from. Returns 0 if nothing did.
+size_t lobby_encode(char *buf, size_t size, const LobbyState *from, const LobbyState *to, unsigned seq) {
+    int changed = 0;
+    size_t len = snprintf(buf, size, "LOBBY:%s %u", from ? "DELTA" : "FULL", seq);
+    for (int g = 0; g < GAME_TYPE_COUNT; g++) {
+        if (from && from->waiting[g] == to->waiting[g] && from->playing[g] == to->playing[g]) continue;
+        len += snprintf(buf + len, size - len, " %s=%d/%d", games[g].name, to->waiting[g], to->playing[g]);
+        changed = 1;
+    }
+    if (!from || !lobby_same_featured(from, to)) {
+        len += snprintf(buf + len, size - len, " featured=");
+        for (int i = 0; i < to->numFeatured; i++)
+            len += snprintf(buf + len, size - len, "%s%d:%s:%s:%s", i ? "," : "", to->featured[i],
+                            games[to->featuredGame[i]].name, to->featuredNames[i][0], to->featuredNames[i][1]);
+        changed = 1;
+    }
+    if (!changed) return 0;
+    buf[len++] = '\n';
+    return len;
+}
+
+void lobby_send_full(int id) {
+    if (lobbyFullLen == 0) lobbyFullLen = lobby_encode(lobbyFull, sizeof(lobbyFull) - 1, NULL, &lobbyPublished, lobbySeq);
+    send_bytes(id, lobbyFull, lobbyFullLen);
+}
+
+void lobby_unsubscribe(int id) {
+    Client *c = &clients[id];
+    int last = lobbyWatchers[--numLobbyWatchers];
+    lobbyWatchers[c->lobbyWatcher - 1] = last;
+    clients[last].lobbyWatcher = c->lobbyWatcher;
+    if (c->lobbyStale) numLobbyStale--;
+    c->lobbyWatcher = 0;
+    c->lobbyStale = 0;
+}
+
+// Sends what changed in the lobby since the last update: one delta,
+// encoded once and queued as is for every watcher still in the lobby.
+// A watcher with more than LOBBY_WINDOW queued skips it and is sent the
+// whole lobby once it has caught up. Watchers that have left the lobby
+// (to play, watch or replay) are unsubscribed.
+void lobby_update(void) {
+    char delta[BUFFER_SIZE];
+    size_t deltaLen = 0;
+    if (lobbyDirty) {
+        LobbyState state;
+        lobby_collect(&state);
+        lobbyDirty = 0;
+        deltaLen = lobby_encode(delta, sizeof(delta) - 1, &lobbyPublished, &state, lobbySeq + 1);
+        if (deltaLen) {
+            lobbySeq++;
+            lobbyPublished = state;
+            lobbyFullLen = 0;
+        }
+    }
+    if (!deltaLen && !numLobbyStale) return;
+    for (int i = 0; i < numLobbyWatchers;) {
+        int id = lobbyWatchers[i];
+        Client *c = &clients[id];
+        if (c->state != CLIENT_SELECTING && c->state != CLIENT_WAITING) {
+            lobby_unsubscribe(id);
+            continue;
+        }
+        i++;
+        if (pending_output(id) > LOBBY_WINDOW) {
+            if (deltaLen && !c->lobbyStale) {
+                c->lobbyStale = 1;
+                numLobbyStale++;
+            }
+        } else if (c->lobbyStale) {
+            c->lobbyStale = 0;
+            numLobbyStale--;
+            lobby_send_full(id);
+        } else if (deltaLen) {
+            send_bytes(id, delta, deltaLen);
+        }
+    }
+}
+
+// Updates go out as soon as something changes, then at most once per
+// lobby_interval_ms; changes in between are folded into the next one.
+int lobby_update_due(long long now) {
+    return numLobbyWatchers > 0 && (lobbyDirty || numLobbyStale) && now >= nextLobbyUpdate;
+}
+
+void lobby_poll(long long now) {
+    if (!lobby_update_due(now)) return;
+    lobby_update();
+    nextLobbyUpdate = now + serverConfig.lobbyIntervalMs;
+}
+
+// "LOBBY" subscribes to the lobby feed, starting with the whole lobby;
+// "LOBBY:OFF" unsubscribes.
+void lobby_command(int id, const char *line) {
+    Client *c = &clients[id];
+    if (strcmp(line, "LOBBY:OFF") == 0) {
+        if (c->lobbyWatcher) lobby_unsubscribe(id);
+        send_to_player(id, "LOBBY:OFF\n");
+        return;
+    }
+    if (strcmp(line, "LOBBY") != 0) return;
+    if (!c->lobbyWatcher) {
+        if (numLobbyWatchers == lobbyWatcherCapacity) {
+            int capacity = lobbyWatcherCapacity ? lobbyWatcherCapacity * 2 : 64;
+            int *grown = realloc(lobbyWatchers, capacity * sizeof(int));
+            if (!grown) {
+                send_to_player(id, "ERROR:Server is out of memory\n");
+                return;
             }
+            lobbyWatchers = grown;
+            lobbyWatcherCapacity = capacity;
+        }
+        // Publishes pending changes first if the rate allows, so the
+        // newcomer starts from the current lobby.
+        long long now = now_ms();
+        if (lobbyDirty && now >= nextLobbyUpdate) {
+            lobby_update();
+            nextLobbyUpdate = now + serverConfig.lobbyIntervalMs;
         }
+        lobbyWatchers[numLobbyWatchers++] = id;
+        c->lobbyWatcher = numLobbyWatchers;
+    }
+    if (c->lobbyStale) {
+        c->lobbyStale = 0;
+        numLobbyStale--;
+    }
+    lobby_send_full(id);
+}
+
+// Player stats
+long long nextStatsSnapshot;    // ms
+
+// "NAME:<name>": later games of this client count for that player.
+void set_player_name(int id, const char *name) {
+    int playerId = player_stats_player(name);
+    if (playerId < 0) {
+        send_to_player(id, player_stats_valid_name(name) ? "ERROR:Server is out of memory\n"
+                                                         : "ERROR:Names are 1-23 letters, digits, _ or -\n");
+        return;
+    }
+    clients[id].playerId = playerId;
+    char msg[MAX];
+    snprintf(msg, MAX, "NAME:%s\n", name);
+    send_to_player(id, msg);
+}
+
+// "<GAME>[:<name>]", the client's own by default.
+void send_player_stats(int id, char *arg) {
+    char *name = strchr(arg, ':');
+    if (name) *name++ = '\0';
+    int gameType = find_game(arg);
+    int playerId = name ? player_stats_find(name) : clients[id].playerId;
+    char msg[MAX];
+    if (gameType < 0) {
+        snprintf(msg, MAX, "ERROR:Unknown game %.40s\n", arg);
+        send_to_player(id, msg);
+        return;
+    }
+    if (!name && playerId < 0) {
+        send_to_player(id, "ERROR:Set a name with NAME:<name> first\n");
+        return;
+    }
+    int total, rank = player_stats_rank(gameType, playerId, &total);
+    const PlayerGameStats *st = player_stats_get(gameType, playerId);
+    if (!st) {
+        snprintf(msg, MAX, "ERROR:No %s games recorded for %.24s\n", games[gameType].name, name ? name : player_stats_name(playerId));
+        send_to_player(id, msg);
+        return;
+    }
+    snprintf(msg, MAX, "STATS:%s %s %d/%d rating=%d wins=%u losses=%u draws=%u avg_turn_ms=%llu\n",
+             games[gameType].name, player_stats_name(playerId), rank + 1, total, st->rating, st->wins, st->losses,
+             st->draws, st->turns ? (unsigned long long)(st->turnNs / st->turns / 1000000) : 0ULL);
+    send_to_player(id, msg);
+}
+
+// "<GAME>[:<count>]": the top of the leaderboard, 10 places by default.
+void send_leaderboard(int id, const char *arg) {
+    char game[32];
+    snprintf(game, sizeof(game), "%.*s", (int)strcspn(arg, ":"), arg);
+    int gameType = find_game(game);
+    const char *sep = strchr(arg, ':');
+    int count = sep ? atoi(sep + 1) : LEADERBOARD_DEFAULT;
+    char msg[BUFFER_SIZE];
+    if (gameType < 0) {
+        snprintf(msg, MAX, "ERROR:Unknown game %.40s\n", game);
+        send_to_player(id, msg);
+        return;
+    }
+    if (count < 1 || count > LEADERBOARD_MAX) count = LEADERBOARD_MAX;
+    size_t len = snprintf(msg, sizeof(msg), "TOP:%s ", games[gameType].name);
+    for (int rank = 0; rank < count; rank++) {
+        int playerId = player_stats_at(gameType, rank);
+        if (playerId < 0) break;
+        const PlayerGameStats *st = player_stats_get(gameType, playerId);
+        len += snprintf(msg + len, sizeof(msg) - len, "%s%d:%s:%d:%u-%u-%u", rank ? "," : "", rank + 1,
+                        player_stats_name(playerId), st->rating, st->wins, st->losses, st->draws);
+    }
+    strcpy(msg + len, "\n");
+    send_to_player(id, msg);
+}
+
+// Turn time: from when it became the player's move to the move that ended
+// it, or to a move that started a new round for both (Rock Paper Scissors).
+// wanted is whose move it was before the line.
+void count_turn(GameSession *session, int player, const int wanted[2]) {
+    long long now = now_ns();
+    int wants[2] = {0, 0};
+    if (!session->gameOver)
+        for (int p = 0; p < 2; p++) wants[p] = bot_wants_move(session, p);
+    int newRound = wants[0] && wants[1] && !(wanted[0] && wanted[1]);
+    if (wanted[player] && (!wants[player] || newRound)) {
+        session->turns[player]++;
+        session->turnNs[player] += now - session->turnStartNs[player];
+    }
+    for (int p = 0; p < 2; p++)
+        if (wants[p] && (!wanted[p] || newRound)) session->turnStartNs[p] = now;
+}
 
-        select(max_fd + 1, &readfds, NULL, NULL, NULL);
+// Attributes the spans that follow to the client's session, when it is traced.
+void trace_client(int id) {
+    GameSession *session = clients[id].state == CLIENT_PLAYING ? clients[id].session : NULL;
+    trace_enter(session && session->traced ? session->id : -1, id);
+}
 
-        if (FD_ISSET(sockfd, &readfds)) {
-            struct sockaddr_in cliaddr;
-            socklen_t len = sizeof(cliaddr);
-            int connfd = accept(sockfd, (SA*)&cliaddr, &len);
-            if (connfd < 0) {
-                printf("Accept failed...\n");
-                continue;
+void handle_client_line(int id, char *line) {
+    Client *c = &clients[id];
+    switch (c->state) {
+        case CLIENT_SELECTING:
+            if (c->closing) break;
+            if (strncmp(line, "GAME:", 5) == 0) join_game(id, line + 5, 0);
+            else if (strncmp(line, "TOURNAMENT:", 11) == 0) join_game(id, line + 11, 1);
+            else if (strcmp(line, "LIST") == 0) list_sessions(id);
+            else if (strncmp(line, "SPECTATE:", 9) == 0) spectate_session(id, line + 9);
+            else if (strncmp(line, "REPLAY:", 7) == 0) start_replay(id, line + 7);
+            else if (strncmp(line, "NAME:", 5) == 0) set_player_name(id, line + 5);
+            else if (strncmp(line, "STATS:", 6) == 0) send_player_stats(id, line + 6);
+            else if (strncmp(line, "TOP:", 4) == 0) send_leaderboard(id, line + 4);
+            else if (strncmp(line, "LOBBY", 5) == 0) lobby_command(id, line);
+            break;
+        case CLIENT_WAITING:
+            if (strncmp(line, "LOBBY", 5) == 0) lobby_command(id, line);
+            break;
+        case CLIENT_REPLAYING:
+            if (strcmp(line, "LEAVE") == 0) {
+                c->state = CLIENT_SELECTING;
+                send_to_player(id, "SELECT_GAME\n");
             }
-            printf("New client connected (fd: %d)\n", connfd);
-            send_to_player(connfd, "SELECT_GAME\n");
-            waitingPlayers[numWaiting].connfd = connfd;
-            waitingPlayers[numWaiting].gameChoice[0] = '\0';
-            numWaiting++;
-        }
-
-        for (int i = 0; i < numWaiting; i++) {
-            if (FD_ISSET(waitingPlayers[i].connfd, &readfds)) {
-                char buff[BUFFER_SIZE];
-                int n = read(waitingPlayers[i].connfd, buff, sizeof(buff));
-                if (n <= 0) {
-                    close(waitingPlayers[i].connfd);
-                    for (int j = i; j < numWaiting - 1; j++) waitingPlayers[j] = waitingPlayers[j + 1];
-                    numWaiting--;
-                    continue;
+            break;
+        case CLIENT_SPECTATING:
+            if (strcmp(line, "LEAVE") == 0) {
+                stop_spectating(id);
+                send_to_player(id, "SELECT_GAME\n");
+            }
+            break;
+        case CLIENT_PLAYING: {
+            GameSession *session = c->session;
+            GameType gameType = session->gameType;
+            trace_client(id);
+            uint64_t span = trace_begin();
+            int wanted[2] = {bot_wants_move(session, 0), bot_wants_move(session, 1)};
+            games[gameType].input(session, c->player, line);
+            count_turn(session, c->player, wanted);
+            if (replay_move(&session->replay, c->player, line) &&
+                replay_moves(&session->replay) % REPLAY_KEYFRAME_MOVES == 0)
+                replay_snapshot(session);
+            trace_end(TRACE_TURN, span);
+            metrics_add(METRIC_TURNS, gameType, 1);
+            metrics_observe(METRIC_TURN_LATENCY, gameType, now_ns() - loopWakeNs);
+            if (session->gameOver) {
+                end_session(session);
+            } else {
+                count_session_memory(session);
+                bot_poke_session(session);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+// "@<n> <line>" hands line to channel n of the connection, opening it if
+// need be; "@<n> CLOSE" closes it.
+void channel_line(int id, int offset) {
+    char *line = clients[id].in + offset, *rest;
+    long ch = strtol(line + 1, &rest, 10);
+    if (rest == line + 1 || *rest != ' ' || ch < 1 || ch >= CLIENT_MAX_CHANNELS) {
+        send_to_player(id, "ERROR:Bad channel\n");
+        return;
+    }
+    offset += rest + 1 - line;
+    int channelId = clients[id].channels[ch] - 1;
+    if (strcmp(clients[id].in + offset, "CLOSE") == 0) {
+        if (channelId >= 0) client_lost(channelId);
+        return;
+    }
+    if (channelId < 0) {
+        channelId = client_alloc(-1);       // may move clients, and the input with it
+        if (channelId < 0) {
+            send_to_player(id, "ERROR:Server is out of memory\n");
+            return;
+        }
+        char address[sizeof(clients[id].address)];
+        snprintf(address, sizeof(address), "%.24s#%ld", clients[id].address, ch);
+        Client *c = &clients[channelId];
+        c->conn = id;
+        c->channel = ch;
+        memcpy(c->address, address, sizeof(address));
+        clients[id].channels[ch] = channelId + 1;
+        clients[id].multiplexed = 1;
+        LOG_INFO("Client %d opened channel %ld (id: %d)", id, ch, channelId);
+    }
+    handle_client_line(channelId, clients[id].in + offset);
+}
+
+// Splits the input buffer into messages, each ending in a newline; a
+// partial message waits for the rest. A client whose message does not fit
+// in the buffer is dropped.
+void process_client_input(int id) {
+    int fd = clients[id].fd;
+    int start = 0;
+    uint64_t span = trace_begin();
+    char *nl;
+    while ((nl = memchr(clients[id].in + start, '\n', clients[id].inLen - start))) {
+        char *line = clients[id].in + start;
+        int len = nl - line;
+        start += len + 1;
+        *nl = '\0';
+        if (len > 0 && line[len - 1] == '\r') line[--len] = '\0';
+        if (len == 0) continue;
+        trace_end(TRACE_PARSE, span);
+        if (line[0] == '@') channel_line(id, line - clients[id].in);
+        else handle_client_line(id, line);
+        if (clients[id].fd != fd) return;
+        trace_client(id);
+        span = trace_begin();
+    }
+    trace_end(TRACE_PARSE, span);
+    int left = clients[id].inLen - start;
+    if (left == CLIENT_INPUT_SIZE - 1) {
+        LOG_WARN("Client %d sent a message over %d bytes, disconnecting", id, CLIENT_INPUT_SIZE - 1);
+        client_lost(id);
+        return;
+    }
+    memmove(clients[id].in, clients[id].in + start, left);
+    clients[id].inLen = left;
+}
+
+void client_read(int id) {
+    int fd = clients[id].fd;
+    for (;;) {
+        Client *c = &clients[id];
+        uint64_t span = trace_begin();
+        ssize_t n = read(fd, c->in + c->inLen, CLIENT_INPUT_SIZE - 1 - c->inLen);
+        trace_end(TRACE_READ, span);
+        if (n > 0) {
+            metrics_add(METRIC_BYTES_IN, 0, n);
+            c->inLen += n;
+            process_client_input(id);
+            if (clients[id].fd != fd) return;
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+        if (n < 0 && errno == EINTR) continue;
+        client_lost(id);
+        return;
+    }
+}
+
+void client_flush(int id) {
+    Client *c = &clients[id];
+    while (c->outLen > 0) {
+        uint64_t span = trace_begin();
+        ssize_t sent = send(c->fd, c->out + c->outStart, c->outLen, MSG_NOSIGNAL);
+        trace_end(TRACE_FLUSH, span);
+        if (sent < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return;
+            if (errno == EINTR) continue;
+            client_break(id);
+            return;
+        }
+        metrics_add(METRIC_BYTES_OUT, 0, sent);
+        c->outStart += sent;
+        c->outLen -= sent;
+    }
+    c->outStart = 0;
+    if (ioLoop) io_loop_want_write(ioLoop, id, 0);
+    if (c->closing) client_close(id);
+    else replay_resume(id);
+}
+
+int set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags < 0 ? -1 : fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+// A new connection, accepted here or handed over by the coordinator.
+// Returns its id, or -1 after closing it.
+int client_adopt(int connfd) {
+    // io_uring waits for the socket itself, so its sockets stay blocking.
+    int id = ioSendAsync || set_nonblocking(connfd) == 0 ? client_alloc(connfd) : -1;
+    if (id >= 0 && io_loop_add(ioLoop, id, connfd) != 0) {
+        clients[id].fd = -1;
+        client_close(id);
+        id = -1;
+    }
+    if (id < 0) {
+        close(connfd);
+        return -1;
+    }
+    metrics_add(METRIC_CONNECTIONS_ACCEPTED, 0, 1);
+    metrics_add(METRIC_CONNECTIONS_OPEN, 0, 1);
+    if (sock_tune(connfd, &sockOptions) != 0) LOG_DEBUG("Socket options refused for fd %d", connfd);
+    struct sockaddr_in cliaddr;
+    socklen_t len = sizeof(cliaddr);
+    if (getpeername(connfd, (SA*)&cliaddr, &len) == 0)
+        snprintf(clients[id].address, sizeof(clients[id].address), "%s:%d", inet_ntoa(cliaddr.sin_addr), ntohs(cliaddr.sin_port));
+    LOG_INFO("New client connected (id: %d, fd: %d, %s)", id, connfd, clients[id].address);
+    return id;
+}
+
+void client_accepted(void *ctx, int connfd) {
+    int id = client_adopt(connfd);
+    if (id >= 0) send_to_player(id, "SELECT_GAME\n");
+}
+
+// poll and epoll: the server does its own reads and writes.
+void client_ready(void *ctx, int id, int events) {
+    int fd = clients[id].fd;
+    trace_client(id);
+    if (events & IO_WRITE) client_flush(id);
+    if (clients[id].fd == fd && (events & IO_READ)) client_read(id);
+}
+
+// io_uring: what the kernel read for the client. Taken in pieces when it
+// does not fit the input buffer at once.
+void client_received(void *ctx, int id, const char *data, size_t len) {
+    if (len == 0) {
+        client_lost(id);
+        return;
+    }
+    int fd = clients[id].fd;
+    trace_client(id);
+    metrics_add(METRIC_BYTES_IN, 0, len);
+    while (len > 0) {
+        Client *c = &clients[id];
+        size_t n = CLIENT_INPUT_SIZE - 1 - c->inLen;
+        if (n > len) n = len;
+        memcpy(c->in + c->inLen, data, n);
+        c->inLen += n;
+        data += n;
+        len -= n;
+        process_client_input(id);
+        if (clients[id].fd != fd) return;
+    }
+}
+
+void client_sent(void *ctx, int id, ssize_t len) {
+    Client *c = &clients[id];
+    if (len < 0) {
+        client_break(id);
+        return;
+    }
+    metrics_add(METRIC_BYTES_OUT, 0, len);
+    c->outLen -= len;
+    if (c->outLen == 0 && c->closing) client_close(id);
+    else if (!c->closing && c->outLen < REPLAY_WINDOW / 2) replay_resume(id);
+}
+
+void bot_collect(void);
+void cluster_receive(void);
+
+void bot_wake(void *ctx, int fd) {
+    char drain[16];
+    if (fd == clusterFd) cluster_receive();
+    else if (fd == stopPipe[0]) while (read(fd, drain, sizeof(drain)) > 0) {}
+    else bot_collect();
+}
+
+const IoCallbacks ioCallbacks = {client_accepted, bot_wake, client_ready, client_received, client_sent};
+
+// Drops the clients whose connection failed during the last round of events.
+void drop_broken_clients(void) {
+    for (int i = 0; i < numBroken; i++) {
+        int id = brokenIds[i];
+        if (clients[id].state != CLIENT_FREE && clients[id].broken) client_lost(id);
+    }
+    numBroken = 0;
+}
+
+// Thousands of concurrent players need as many descriptors.
+void raise_fd_limit(void) {
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+}
+
+// SIGINT and SIGTERM stop the loop at its next wake, so the archives,
+// replays and player stats are flushed on the way out. Any thread may take
+// the signal, hence the pipe. A second signal kills at once.
+void request_stop(int sig) {
+    int saved = errno;
+    stopRequested = 1;
+    (void)!write(stopPipe[1], "", 1);
+    errno = saved;
+}
+
+int catch_stop_signals(void) {
+    if (pipe(stopPipe) != 0) return -1;
+    for (int i = 0; i < 2; i++) {
+        fcntl(stopPipe[i], F_SETFL, O_NONBLOCK);
+        fcntl(stopPipe[i], F_SETFD, FD_CLOEXEC);
+    }
+    if (io_loop_add_wake(ioLoop, stopPipe[0]) != 0) return -1;
+    struct sigaction sa = {0};
+    sa.sa_handler = request_stop;
+    sa.sa_flags = SA_RESETHAND;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    return 0;
+}
+
+// Bot Players
+// Bots are clients without a socket. When it is a bot's move the main loop
+// copies what the bot may see into a BotTask and a worker thread decides;
+// the decision comes back as an ordinary input line.
+const char *rpsMoveNames[] = {"STONE", "PAPER", "SCISSORS"};
+
+struct Bot {
+    BotPolicy policy;
+    GameRng rng;
+    int serial;                 // tells a bot apart from a later one in the same client slot
+    int pending;                // a decision is being computed
+    int rpsRound;
+    int rpsSeen[3];             // opponent's past moves: STONE, PAPER, SCISSORS
+    int rpsLast;
+};
+
+typedef struct {
+    WorkerJob job;
+    int clientId;
+    int serial;
+    int sessionId;
+    GameType gameType;
+    BotPolicy policy;
+    int player;
+    GameRng rng;
+    long long queuedNs;
+    long long deadlineNs;
+    int degraded;               // waited past its budget, fell back to random
+    // Wordle
+    char guesses[WORDLE_MAX_GUESSES][6];
+    uint8_t patterns[WORDLE_MAX_GUESSES];
+    int history;
+    // Chess
+    Piece pieces[64];
+    ChessBoard board;
+    // Tic Tac Toe
+    TttMask mine, other;
+    // Rock Paper Scissors
+    int rpsSeen[3];
+    int rpsLast;
+    char line[32];              // the decision
+} BotTask;
+
+// game_sim.c defines GAME_SERVER_VIRTUAL_CLOCK and supplies its own now_ns.
+#ifndef GAME_SERVER_VIRTUAL_CLOCK
+long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+#endif
+
+long long now_ms(void) {
+    return now_ns() / 1000000;
+}
+
+int bot_answer_count(void) {
+    int count = wordle_dict_answer_count();
+    return count > 0 ? count : wordListSize;
+}
+
+void bot_answer(int i, char *word) {
+    memcpy(word, wordle_dict_answer_count() > 0 ? wordle_dict_answer(i) : wordList[i], 5);
+    word[5] = '\0';
+}
+
+void bot_wordle(BotTask *task) {
+    char word[6];
+    int count = bot_answer_count();
+    if (task->policy == BOT_ENGINE && wordleSolverReady &&
+        wordle_solver_hint(&wordleSolver, task->guesses, task->patterns, task->history, word) > 0) {
+        strcpy(task->line, word);
+        return;
+    }
+    if (task->policy != BOT_RANDOM) {
+        // Any answer that would have produced the same feedback so far,
+        // chosen by reservoir sampling.
+        int seen = 0;
+        for (int i = 0; i < count; i++) {
+            bot_answer(i, word);
+            int consistent = 1;
+            for (int h = 0; h < task->history && consistent; h++)
+                consistent = wordle_pattern(task->guesses[h], word) == task->patterns[h];
+            if (consistent && game_rng_range(&task->rng, ++seen) == 0) strcpy(task->line, word);
+        }
+        if (seen > 0) return;
+    }
+    bot_answer(game_rng_range(&task->rng, count), task->line);
+}
+
+typedef struct {
+    signed char fromX, fromY, toX, toY;
+} BotChessMove;
+
+#define BOT_CHESS_MAX_MOVES 256
+#define BOT_CHESS_WIN 1000000
+static const int chessValues[] = {1, 3, 3, 5, 9, 1000};     // indexed by PieceType
+
+int bot_chess_moves(ChessBoard *board, Color color, BotChessMove *out) {
+    char feedback[160];
+    int n = 0;
+    for (int fx = 0; fx < 8; fx++) for (int fy = 0; fy < 8; fy++) {
+        Piece *p = board->board[fx][fy];
+        if (!p || p->color != color) continue;
+        for (int tx = 0; tx < 8; tx++) for (int ty = 0; ty < 8; ty++) {
+            Piece *t = board->board[tx][ty];
+            if ((tx == fx && ty == fy) || (t && t->color == color)) continue;
+            if (is_legal_move(board, fx, fy, tx, ty, feedback)) out[n++] = (BotChessMove){fx, fy, tx, ty};
+        }
+    }
+    return n;
+}
+
+int bot_chess_material(ChessBoard *board, Color color) {
+    int score = 0;
+    for (int x = 0; x < 8; x++) for (int y = 0; y < 8; y++) {
+        Piece *p = board->board[x][y];
+        if (p) score += p->color == color ? chessValues[p->type] : -chessValues[p->type];
+    }
+    return score;
+}
+
+// Plain material negamax; a king capture ends the game, as on the server.
+int bot_chess_search(BotTask *task, Color color, int depth, int alpha, int beta, int *timedOut) {
+    if (depth == 0) return bot_chess_material(&task->board, color);
+    if (now_ns() > task->deadlineNs) {
+        *timedOut = 1;
+        return 0;
+    }
+    BotChessMove moves[BOT_CHESS_MAX_MOVES];
+    int n = bot_chess_moves(&task->board, color, moves);
+    if (n == 0) return bot_chess_material(&task->board, color);
+    ChessBoard *b = &task->board;
+    for (int i = 0; i < n; i++) {
+        BotChessMove m = moves[i];
+        Piece *captured = b->board[m.toX][m.toY];
+        if (captured && captured->type == KING) return BOT_CHESS_WIN + depth;
+        b->board[m.toX][m.toY] = b->board[m.fromX][m.fromY];
+        b->board[m.fromX][m.fromY] = NULL;
+        int score = -bot_chess_search(task, color == WHITE ? BLACK : WHITE, depth - 1, -beta, -alpha, timedOut);
+        b->board[m.fromX][m.fromY] = b->board[m.toX][m.toY];
+        b->board[m.toX][m.toY] = captured;
+        if (*timedOut) return 0;
+        if (score > alpha) alpha = score;
+        if (alpha >= beta) break;
+    }
+    return alpha;
+}
+
+void bot_chess(BotTask *task) {
+    BotChessMove moves[BOT_CHESS_MAX_MOVES];
+    Color color = task->player == 0 ? WHITE : BLACK;
+    int n = bot_chess_moves(&task->board, color, moves);
+    // Every piece is blocked: any move would be refused and asked for again.
+    if (n == 0) {
+        strcpy(task->line, "RESIGN");
+        return;
+    }
+    // Shuffle so equal moves are picked at random.
+    for (int i = n - 1; i > 0; i--) {
+        int j = game_rng_range(&task->rng, i + 1);
+        BotChessMove t = moves[i];
+        moves[i] = moves[j];
+        moves[j] = t;
+    }
+    int best = 0;
+    if (task->policy == BOT_GREEDY) {
+        int bestValue = -1;
+        for (int i = 0; i < n; i++) {
+            Piece *t = task->board.board[moves[i].toX][moves[i].toY];
+            int value = t ? chessValues[t->type] : 0;
+            if (value > bestValue) {
+                bestValue = value;
+                best = i;
+            }
+        }
+    } else if (task->policy == BOT_ENGINE) {
+        // Iterative deepening until the budget runs out; keep the result of
+        // the deepest search that finished.
+        ChessBoard *b = &task->board;
+        for (int depth = 1; depth <= 4; depth++) {
+            int timedOut = 0, alpha = -2 * BOT_CHESS_WIN, bestHere = 0;
+            for (int i = 0; i < n && !timedOut; i++) {
+                BotChessMove m = moves[i];
+                Piece *captured = b->board[m.toX][m.toY];
+                int score;
+                if (captured && captured->type == KING) {
+                    score = BOT_CHESS_WIN + depth;
+                } else {
+                    b->board[m.toX][m.toY] = b->board[m.fromX][m.fromY];
+                    b->board[m.fromX][m.fromY] = NULL;
+                    score = -bot_chess_search(task, color == WHITE ? BLACK : WHITE, depth - 1, -2 * BOT_CHESS_WIN, -alpha, &timedOut);
+                    b->board[m.fromX][m.fromY] = b->board[m.toX][m.toY];
+                    b->board[m.toX][m.toY] = captured;
                 }
-                buff[n] = '\0';
-                if (strncmp(buff, "GAME:", 5) == 0) {
-                    strncpy(waitingPlayers[i].gameChoice, buff + 5, 20);
-                    waitingPlayers[i].gameChoice[strcspn(waitingPlayers[i].gameChoice, "\n")] = '\0';
-                    printf("Player (fd: %d) selected game: %s\n", waitingPlayers[i].connfd, waitingPlayers[i].gameChoice);
-                    send_to_player(waitingPlayers[i].connfd, "WAITING\n");
-
-                    int matchIndex = -1;
-                    for (int j = 0; j < numWaiting; j++) {
-                        if (j != i && strcmp(waitingPlayers[i].gameChoice, waitingPlayers[j].gameChoice) == 0) {
-                            matchIndex = j;
-                            break;
-                        }
-                    }
+                if (!timedOut && score > alpha) {
+                    alpha = score;
+                    bestHere = i;
+                }
+            }
+            if (timedOut) break;
+            best = bestHere;
+            if (alpha >= BOT_CHESS_WIN) break;
+        }
+    } else {
+        best = game_rng_range(&task->rng, n);
+    }
+    BotChessMove m = moves[best];
+    snprintf(task->line, sizeof(task->line), "MOVE:%s %c%d", task->board.board[m.fromX][m.fromY]->id,
+             'a' + m.toY, 8 - m.toX);
+}
+
+void bot_ttt(BotTask *task, TttBot *engine) {
+    TttMask empty = tttGeometry.full & ~(task->mine | task->other);
+    int cell = -1;
+    if (task->policy == BOT_ENGINE && engine) {
+        cell = ttt_best_move(engine, task->mine, task->other, serverConfig.tttBotDepth);
+    } else if (task->policy == BOT_GREEDY) {
+        // Win if possible, otherwise block the opponent's win.
+        for (int pass = 0; pass < 2 && cell < 0; pass++) {
+            TttMask side = pass == 0 ? task->mine : task->other;
+            for (int c = 0; c < tttGeometry.cells && cell < 0; c++)
+                if (((empty >> c) & 1) && ttt_is_win(&tttGeometry, side | (TttMask)1 << c, c)) cell = c;
+        }
+    }
+    if (cell < 0) {
+        int open = __builtin_popcountll(empty), pick = game_rng_range(&task->rng, open);
+        for (cell = 0; cell < tttGeometry.cells; cell++)
+            if (((empty >> cell) & 1) && pick-- == 0) break;
+    }
+    snprintf(task->line, sizeof(task->line), "%d %d", cell / tttGeometry.cols, cell % tttGeometry.cols);
+}
+
+void bot_rps(BotTask *task) {
+    int predicted = -1;
+    if (task->policy == BOT_GREEDY) {
+        predicted = task->rpsLast;
+    } else if (task->policy == BOT_ENGINE) {
+        for (int m = 0; m < 3; m++)
+            if (task->rpsSeen[m] > 0 && (predicted < 0 || task->rpsSeen[m] > task->rpsSeen[predicted])) predicted = m;
+    }
+    // PAPER beats STONE, SCISSORS beats PAPER, STONE beats SCISSORS. One
+    // move in three stays random, or two such bots could tie forever.
+    int move = predicted >= 0 && game_rng_range(&task->rng, 3) != 0 ? (predicted + 1) % 3 : (int)game_rng_range(&task->rng, 3);
+    strcpy(task->line, rpsMoveNames[move]);
+}
+
+void bot_decide(WorkerJob *job, void *state) {
+    BotTask *task = (BotTask *)job;
+    if (now_ns() > task->deadlineNs) {
+        task->policy = BOT_RANDOM;
+        task->degraded = 1;
+    }
+    switch (task->gameType) {
+        case WORDLE: bot_wordle(task); break;
+        case CHESS: bot_chess(task); break;
+        case SNAKE_LADDER: strcpy(task->line, "ROLL"); break;
+        case TIC_TAC_TOE: bot_ttt(task, state); break;
+        case ROCK_PAPER_SCISSOR: bot_rps(task); break;
+        default: break;
+    }
+    metrics_observe(METRIC_BOT_DECISION, task->gameType, now_ns() - task->queuedNs);
+}
+
+// Each worker has its own Tic Tac Toe search state.
+void *bot_worker_init(void *ctx) {
+    return ttt_bot_create(&tttGeometry, TTT_BOT_TT_BITS - 4);
+}
 
-                    if (matchIndex != -1) {
-                        GameSession *session = &sessions[numSessions];
-                        session->player1_fd = waitingPlayers[matchIndex].connfd;
-                        session->player2_fd = waitingPlayers[i].connfd;
-                        session->gameOver = 0;
-                        char start_msg[50];
-                        if (strcmp(waitingPlayers[i].gameChoice, "WORDLE") == 0) {
-                            session->gameType = WORDLE;
-                            session->turn = 1;
-                            session->p1Attempts = 0;
-                            session->p2Attempts = 0;
-                            session->maxAttempts = 5;
-                            strcpy(session->secretWord, wordList[rand() % wordListSize]);
-                            printf("Starting Wordle game with secret word: %s\n", session->secretWord);
-                            snprintf(start_msg, sizeof(start_msg), "START:WORDLE\n");
-                        } else if (strcmp(waitingPlayers[i].gameChoice, "CHESS") == 0) {
-                            session->gameType = CHESS;
-                            snprintf(start_msg, sizeof(start_msg), "START:CHESS\n");
-                        } else if (strcmp(waitingPlayers[i].gameChoice, "SNAKE_LADDER") == 0) {
-                            session->gameType = SNAKE_LADDER;
-                            snprintf(start_msg, sizeof(start_msg), "START:SNAKE_LADDER\n");
-                        } else if (strcmp(waitingPlayers[i].gameChoice, "TIC_TAC_TOE") == 0) {
-                            session->gameType = TIC_TAC_TOE;
-                            snprintf(start_msg, sizeof(start_msg), "START:TIC_TAC_TOE\n");
-                        } else if (strcmp(waitingPlayers[i].gameChoice, "ROCK_PAPER_SCISSOR") == 0) {
-                            session->gameType = ROCK_PAPER_SCISSOR;
-                            snprintf(start_msg, sizeof(start_msg), "START:ROCK_PAPER_SCISSOR\n");
-                        }
-                        send_to_player(session->player1_fd, start_msg);
-                        send_to_player(session->player1_fd, "Connected as Player 1. Game starting...\n");
-                        send_to_player(session->player2_fd, start_msg);
-                        send_to_player(session->player2_fd, "Connected as Player 2. Game starting...\n");
-                        numSessions++;
-
-                        for (int j = matchIndex; j < numWaiting - 1; j++) waitingPlayers[j] = waitingPlayers[j + 1];
-                        numWaiting--;
-                        for (int j = i - 1; j < numWaiting - 1; j++) waitingPlayers[j] = waitingPlayers[j + 1];
-                        numWaiting--;
-                        i--;
-
-                        if (session->gameType == WORDLE) runWordleGame(session);
-                        else if (session->gameType == CHESS) runChessGame(session);
-                        else if (session->gameType == SNAKE_LADDER) runSnakeLadderGame(session);
-                        else if (session->gameType == TIC_TAC_TOE) runTicTacToeGame(session);
-                        else if (session->gameType == ROCK_PAPER_SCISSOR) runRockPaperScissorGame(session);
+void bot_worker_free(void *state) {
+    ttt_bot_free(state);
+}
+
+int bot_wants_move(GameSession *session, int player) {
+    switch (session->gameType) {
+        case WORDLE: return session->turn - 1 == player;
+        case CHESS: return session->chessState == PLAYING && session->chessTurn == player;
+        case SNAKE_LADDER: return session->slTurn == player;
+        case TIC_TAC_TOE: return session->tttTurn % 2 == player;
+        case ROCK_PAPER_SCISSOR: return !session->rpsCommitted[player];
+        default: return 0;
+    }
+}
+
+void bot_snapshot(GameSession *session, Bot *bot, int player, BotTask *task) {
+    switch (session->gameType) {
+        case WORDLE:
+            task->history = session->wordleGuessCount;
+            memcpy(task->guesses, session->wordleGuesses, sizeof(task->guesses));
+            memcpy(task->patterns, session->wordlePatterns, sizeof(task->patterns));
+            break;
+        case CHESS:
+            for (int x = 0; x < 8; x++) for (int y = 0; y < 8; y++) {
+                Piece *p = session->chessBoard.board[x][y];
+                task->board.board[x][y] = p ? &task->pieces[x * 8 + y] : NULL;
+                if (p) task->pieces[x * 8 + y] = *p;
+            }
+            break;
+        case TIC_TAC_TOE:
+            task->mine = session->tttMasks[player];
+            task->other = session->tttMasks[1 - player];
+            break;
+        case ROCK_PAPER_SCISSOR:
+            // At the start of a round the opponent's slot still holds last
+            // round's move; once they commit it must not be looked at.
+            if (session->rpsRounds > 1 && bot->rpsRound != session->rpsRounds && !session->rpsCommitted[1 - player]) {
+                for (int m = 0; m < 3; m++) {
+                    if (strcmp(session->rpsMoves[1 - player], rpsMoveNames[m]) == 0) {
+                        bot->rpsSeen[m]++;
+                        bot->rpsLast = m;
                     }
                 }
             }
+            bot->rpsRound = session->rpsRounds;
+            memcpy(task->rpsSeen, bot->rpsSeen, sizeof(task->rpsSeen));
+            task->rpsLast = bot->rpsLast;
+            break;
+        default:
+            break;
+    }
+}
+
+// Queues a decision for every bot in the session whose move it is.
+void bot_poke_session(GameSession *session) {
+    if (!botPool || session->gameOver) return;
+    for (int player = 0; player < 2; player++) {
+        int id = session_player(session, player);
+        Bot *bot = clients[id].bot;
+        if (!bot || bot->pending || clients[id].session != session || !bot_wants_move(session, player)) continue;
+        BotTask *task = calloc(1, sizeof(BotTask));
+        if (!task) continue;
+        task->job.run = bot_decide;
+        task->clientId = id;
+        task->serial = bot->serial;
+        task->sessionId = session->id;
+        task->gameType = session->gameType;
+        task->policy = bot->policy;
+        task->player = player;
+        game_rng_seed(&task->rng, game_rng_next(&bot->rng));
+        task->queuedNs = now_ns();
+        task->deadlineNs = task->queuedNs + (long long)serverConfig.botBudgetMs * 1000000;
+        task->rpsLast = -1;
+        bot_snapshot(session, bot, player, task);
+        bot->pending = 1;
+        worker_pool_submit(botPool, &task->job);
+    }
+}
+
+// Applies finished decisions; stale ones (the game moved on or ended) are dropped.
+void bot_collect(void) {
+    WorkerJob *job = worker_pool_completed(botPool);
+    while (job) {
+        BotTask *task = (BotTask *)job;
+        job = job->next;
+        int id = task->clientId;
+        Bot *bot = clients[id].bot;
+        if (bot && bot->serial == task->serial) {
+            bot->pending = 0;
+            GameSession *session = clients[id].session;
+            if (clients[id].state == CLIENT_PLAYING && session->id == task->sessionId) {
+                botMoves++;
+                botDegraded += task->degraded;
+                metrics_add(METRIC_BOT_MOVES, task->gameType, 1);
+                metrics_add(METRIC_BOT_OVER_BUDGET, task->gameType, task->degraded);
+                handle_client_line(id, task->line);
+                if (clients[id].state == CLIENT_PLAYING) bot_poke_session(clients[id].session);
+            }
+        }
+        free(task);
+    }
+}
+
+int spawn_bot(void) {
+    int id = client_alloc(-1);
+    if (id < 0) return -1;
+    Bot *bot = calloc(1, sizeof(Bot));
+    if (!bot) {
+        client_close(id);
+        return -1;
+    }
+    bot->policy = botPolicy;
+    bot->serial = ++botSerial;
+    bot->rpsLast = -1;
+    uint64_t x = serverConfig.rngSeed ? (uint64_t)serverConfig.rngSeed * 0x9E3779B97F4A7C15ULL + bot->serial : game_rng_fresh_seed();
+    game_rng_seed(&bot->rng, game_rng_splitmix(&x));
+    clients[id].bot = bot;
+    snprintf(clients[id].address, sizeof(clients[id].address), "bot %s", botPolicyNames[bot->policy]);
+    return id;
+}
+
+// A player who has waited bot_fill_ms for an opponent gets a bot instead.
+void fill_waiting_players(long long now) {
+    if (!botPool || serverConfig.botFillMs == 0) return;
+    for (int g = 0; g < GAME_TYPE_COUNT; g++) {
+        int id = waitingPlayer[g];
+        if (id < 0 || now - clients[id].waitingSince < serverConfig.botFillMs) continue;
+        int botId = spawn_bot();
+        if (botId < 0) continue;
+        waitingPlayer[g] = -1;
+        update_queue_depth(g);
+        LOG_INFO("No opponent for player %d in %s, starting a %s bot", id, games[g].name, botPolicyNames[botPolicy]);
+        send_to_player(id, "No opponent found, you are playing a bot.\n");
+        if (start_session(g, id, botId, NULL, -1)) continue;
+        // Keep the player waiting and try again after another bot_fill_ms.
+        client_close(botId);
+        waitingPlayer[g] = id;
+        clients[id].waitingSince = now;
+        update_queue_depth(g);
+    }
+}
+
+// Soak test: keep bot_soak_sessions bot-against-bot games running.
+void top_up_soak_sessions(void) {
+    if (!botPool) return;
+    while (soakRunning < serverConfig.botSoakSessions) {
+        int a = spawn_bot(), b = a >= 0 ? spawn_bot() : -1;
+        if (b < 0) {
+            if (a >= 0) client_close(a);
+            return;
+        }
+        GameSession *session = start_session(soakNextGame++ % GAME_TYPE_COUNT, a, b, NULL, -1);
+        if (!session) {
+            client_close(a);
+            client_close(b);
+            return;
+        }
+        session->soak = 1;
+        soakRunning++;
+    }
+}
+
+void report_soak(long long elapsedMs) {
+    static long long lastFinished, lastMoves;
+    double secs = elapsedMs / 1000.0;
+    LOG_INFO("Soak: %d sessions running, %lld finished (%.1f/s), %lld bot moves (%.0f/s), %lld over budget",
+           soakRunning, soakFinished, (soakFinished - lastFinished) / secs, botMoves, (botMoves - lastMoves) / secs, botDegraded);
+    lastFinished = soakFinished;
+    lastMoves = botMoves;
+}
+
+// Cluster mode
+// Nodes take no connections of their own: the coordinator hands over
+// players it has already matched, with the sockets attached.
+long long nextClusterReport;
+uint64_t lastReportNs, lastCpuNs;
+
+int cluster_join(void) {
+    clusterFd = cluster_connect(serverConfig.clusterSocket);
+    if (clusterFd < 0) return -1;
+    ClusterMsg msg = {.type = CLUSTER_HELLO, .pid = getpid()};
+    char names[CLUSTER_GAME_NAMES_SIZE] = "";
+    for (int g = 0; g < GAME_TYPE_COUNT && g < CLUSTER_MAX_GAMES; g++) {
+        if (g > 0) strcat(names, ",");
+        strcat(names, games[g].name);
+    }
+    if (cluster_send(clusterFd, &msg, names, strlen(names), NULL, 0) != 0 || io_loop_add_wake(ioLoop, clusterFd) != 0) {
+        close(clusterFd);
+        clusterFd = -1;
+        return -1;
+    }
+    lastReportNs = now_ns();
+    return 0;
+}
+
+uint64_t cpu_time_ns(void) {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return (uint64_t)(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000000ull +
+           (uint64_t)(ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) * 1000ull;
+}
+
+// Sessions, connections, CPU share and queue depth since the last report.
+void cluster_report(void) {
+    if (clusterFd < 0) return;
+    uint64_t now = now_ns(), cpu = cpu_time_ns();
+    ClusterMsg msg = {.type = CLUSTER_LOAD, .pid = getpid()};
+    msg.sessions = numSessions;
+    msg.clients = clientCapacity - numFreeClients;
+    if (now > lastReportNs) msg.cpuPermille = (cpu - lastCpuNs) * 1000 / (now - lastReportNs);
+    for (int g = 0; g < GAME_TYPE_COUNT && g < CLUSTER_MAX_GAMES; g++)
+        msg.queueDepth[g] = (waitingPlayer[g] >= 0) + (tournamentLobby[g] ? tournamentLobby[g]->count : 0);
+    lastReportNs = now;
+    lastCpuNs = cpu;
+    if (cluster_send(clusterFd, &msg, NULL, 0, NULL, 0) != 0) LOG_WARN("Load report to the coordinator failed");
+}
+
+// Adopts the connections the coordinator passed: a matched pair starts
+// playing at once, a lone player waits here (its bot fill is already
+// due), and anything else goes through its input as usual.
+void cluster_handoff(const ClusterMsg *msg, const char *data, int len, const int *fds, int numFds) {
+    int ids[2];
+    size_t offset = 0;
+    for (int i = 0; i < numFds; i++) {
+        size_t n = i < (int)msg->count ? msg->inputLen[i] : 0;
+        if (n > CLIENT_INPUT_SIZE - 1 || offset + n > (size_t)len) n = 0;
+        ids[i] = client_adopt(fds[i]);
+        if (ids[i] >= 0) {
+            memcpy(clients[ids[i]].in, data + offset, n);
+            clients[ids[i]].inLen = n;
+        }
+        offset += n;
+    }
+    int gameType = msg->gameType;
+    if (gameType >= 0 && gameType < GAME_TYPE_COUNT) {
+        long long now = now_ms();
+        for (int i = 0; i < numFds; i++) {
+            if (ids[i] < 0) continue;
+            clients[ids[i]].gameType = gameType;
+            clients[ids[i]].joinedNs = now_ns();
+        }
+        // A pair the coordinator matched plays each other, never a player
+        // already waiting here; only a lone player joins the queue.
+        if (numFds == 2 && ids[0] >= 0 && ids[1] >= 0) {
+            if (!start_session(gameType, ids[0], ids[1], NULL, -1)) {
+                send_to_player(ids[0], "ERROR:Server is out of memory\n");
+                send_to_player(ids[1], "ERROR:Server is out of memory\n");
+            }
+        } else {
+            for (int i = 0; i < numFds; i++)
+                if (ids[i] >= 0) queue_player(ids[i], gameType, now - serverConfig.botFillMs);
+        }
+    }
+    // Input typed ahead; the first player's may have ended the second's game.
+    for (int i = 0; i < numFds; i++)
+        if (ids[i] >= 0 && clients[ids[i]].fd == fds[i] && clients[ids[i]].inLen > 0) process_client_input(ids[i]);
+}
+
+// Reads every queued message: io_uring only reports new arrivals.
+void cluster_receive(void) {
+    ClusterMsg msg;
+    char data[2 * CLUSTER_MAX_INPUT];
+    int fds[2], numFds, len;
+    while ((len = cluster_recv(clusterFd, &msg, data, sizeof(data), fds, 2, &numFds)) >= 0) {
+        if (msg.type == CLUSTER_HANDOFF) cluster_handoff(&msg, data, len, fds, numFds);
+        else for (int i = 0; i < numFds; i++) close(fds[i]);
+    }
+    if (errno == EAGAIN || errno == EINTR) return;
+    LOG_WARN("Lost the coordinator, finishing the games in progress");
+    io_loop_remove_wake(ioLoop, clusterFd);
+    close(clusterFd);
+    clusterFd = -1;
+}
+
+// Time until the next bot fill, report, stats snapshot or lobby update is due, for poll.
+int next_timer_ms(long long now, long long nextReport) {
+    long long wait = -1;
+    if (clusterFd >= 0) wait = nextClusterReport > now ? nextClusterReport - now : 0;
+    if (serverConfig.statsPath[0] && (wait < 0 || nextStatsSnapshot - now < wait))
+        wait = nextStatsSnapshot > now ? nextStatsSnapshot - now : 0;
+    if (numLobbyWatchers > 0 && (lobbyDirty || numLobbyStale) && (wait < 0 || nextLobbyUpdate - now < wait))
+        wait = nextLobbyUpdate > now ? nextLobbyUpdate - now : 0;
+    if (!botPool) return wait < 0 ? -1 : (int)wait;
+    if (serverConfig.botFillMs > 0) {
+        for (int g = 0; g < GAME_TYPE_COUNT; g++) {
+            if (waitingPlayer[g] < 0) continue;
+            long long left = clients[waitingPlayer[g]].waitingSince + serverConfig.botFillMs - now;
+            if (wait < 0 || left < wait) wait = left;
+        }
+    }
+    if (serverConfig.botSoakSessions > 0 && (wait < 0 || nextReport - now < wait)) wait = nextReport - now;
+    return wait < 0 ? -1 : (int)(wait > 0 ? wait : 0);
+}
+
+// Main Server Logic
+// microbench.c and game_sim.c include this file with GAME_SERVER_NO_MAIN to reach the game code.
+#ifndef GAME_SERVER_NO_MAIN
+int main(int argc, char **argv) {
+    int sockfd;
+    struct sockaddr_in servaddr;
+
+    if (log_start() != 0) printf("Logger failed to start, logging is off\n");
+    const char *configPath = argc > 1 ? argv[1] : SERVER_CONFIG_PATH;
+    int configStatus = server_config_load(configPath);
+    if (configStatus < 0) {
+        LOG_ERROR("Invalid configuration in %s", configPath);
+        exit(0);
+    }
+    // Options after the file override it, e.g. admin_port=9082 for a second node.
+    for (int i = 2; i < argc; i++) {
+        if (server_config_set(argv[i]) != 0) {
+            LOG_ERROR("Invalid option %s", argv[i]);
+            exit(0);
+        }
+    }
+    LOG_INFO(configStatus == 0 ? "Loaded configuration from %s" : "No %s found, using defaults", configPath);
+    int level = log_parse_level(serverConfig.logLevel);
+    if (level < 0) {
+        LOG_ERROR("Invalid log level '%s', use debug, info, warn or error", serverConfig.logLevel);
+        exit(0);
+    }
+    log_set_level(level);
+    int tracing = trace_start(serverConfig.tracePath, serverConfig.traceSample, serverConfig.traceSessions);
+    if (tracing < 0) {
+        LOG_ERROR("Cannot write trace to %s", serverConfig.tracePath);
+        exit(0);
+    }
+    if (tracing) LOG_INFO("Tracing sessions to %s", serverConfig.tracePath);
+
+    if (serverConfig.tttRows * serverConfig.tttCols > TTT_MAX_CELLS) {
+        LOG_ERROR("Tic Tac Toe board %dx%d has %d cells, at most %d are supported", serverConfig.tttRows, serverConfig.tttCols,
+                  serverConfig.tttRows * serverConfig.tttCols, TTT_MAX_CELLS);
+        exit(0);
+    }
+    if (ttt_geometry_init(&tttGeometry, serverConfig.tttRows, serverConfig.tttCols, serverConfig.tttWinLength) != 0) {
+        LOG_ERROR("Invalid Tic Tac Toe board %dx%d with %d in a row", serverConfig.tttRows, serverConfig.tttCols, serverConfig.tttWinLength);
+        exit(0);
+    }
+    // Hints search with it, so there is no running without one.
+    tttBot = ttt_bot_create(&tttGeometry, TTT_BOT_TT_BITS);
+    if (!tttBot) {
+        LOG_ERROR("Out of memory for the Tic Tac Toe engine");
+        exit(0);
+    }
+
+    char layoutError[128];
+    if (sl_layout_parse(&slLayout, serverConfig.slBoardSize, serverConfig.slSnakes, serverConfig.slLadders,
+                        layoutError, sizeof(layoutError)) != 0) {
+        LOG_ERROR("Invalid Snake and Ladder layout: %s", layoutError);
+        exit(0);
+    }
+    build_sl_board_message();
+
+    if (strcasecmp(serverConfig.tournamentFormat, "swiss") != 0 && strcasecmp(serverConfig.tournamentFormat, "bracket") != 0) {
+        LOG_ERROR("Invalid tournament format '%s', use swiss or bracket", serverConfig.tournamentFormat);
+        exit(0);
+    }
+    for (int g = 0; g < GAME_TYPE_COUNT; g++) waitingPlayer[g] = -1;
+    for (botPolicy = BOT_RANDOM; botPolicy <= BOT_ENGINE; botPolicy++)
+        if (strcasecmp(serverConfig.botPolicy, botPolicyNames[botPolicy]) == 0) break;
+    if (botPolicy > BOT_ENGINE) {
+        LOG_ERROR("Invalid bot policy '%s', use random, greedy or engine", serverConfig.botPolicy);
+        exit(0);
+    }
+    raise_fd_limit();
+
+    for (int g = 0; g < GAME_TYPE_COUNT; g++) gameNames[g] = games[g].name;
+    metrics_init("game", gameNames, GAME_TYPE_COUNT);
+    if (metrics_serve(serverConfig.adminPort, serverConfig.adminSocket) != 0)
+        LOG_WARN("Metrics endpoint unavailable on port %d / socket '%s'", serverConfig.adminPort, serverConfig.adminSocket);
+    else if (serverConfig.adminPort > 0 || serverConfig.adminSocket[0])
+        LOG_INFO("Metrics on 127.0.0.1:%d%s%s", serverConfig.adminPort, serverConfig.adminSocket[0] ? " and " : "", serverConfig.adminSocket);
+
+    if (player_stats_init(GAME_TYPE_COUNT, gameNames) != 0) {
+        LOG_ERROR("Out of memory for player stats");
+        exit(0);
+    }
+    if (serverConfig.statsPath[0]) {
+        int loaded = player_stats_load(serverConfig.statsPath);
+        if (loaded < 0) {
+            // Saving would replace the file with fewer players than it holds.
+            LOG_ERROR("Player stats in %s are unreadable, keeping new ones in memory only", serverConfig.statsPath);
+            serverConfig.statsPath[0] = '\0';
+        } else if (loaded > 0) {
+            LOG_INFO("Loaded stats for %d players from %s", loaded, serverConfig.statsPath);
+        }
+    }
+    nextStatsSnapshot = now_ms() + serverConfig.statsSnapshotMs;
+
+    int flush = sock_parse_flush(serverConfig.tcpFlush);
+    if (flush < 0) {
+        LOG_ERROR("Invalid TCP flush policy '%s', use nagle, nodelay or cork", serverConfig.tcpFlush);
+        exit(0);
+    }
+    sockOptions = (SockOptions){flush, serverConfig.listenBacklog, serverConfig.tcpDeferAcceptS,
+                                serverConfig.tcpKeepaliveS, serverConfig.tcpUserTimeoutMs};
+
+    int clusterNode = serverConfig.clusterSocket[0] != '\0';
+    if (clusterNode) {
+        sockfd = -1;
+    } else {
+        sockfd = socket(AF_INET, SOCK_STREAM, 0);
+        if (sockfd == -1) {
+            LOG_ERROR("Socket creation failed...");
+            exit(0);
+        }
+        LOG_INFO("Socket successfully created..");
+
+        int opt = 1;
+        setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+        bzero(&servaddr, sizeof(servaddr));
+        servaddr.sin_family = AF_INET;
+        servaddr.sin_addr.s_addr = htonl(INADDR_ANY);
+        servaddr.sin_port = htons(PORT);
+
+        if (bind(sockfd, (SA*)&servaddr, sizeof(servaddr)) != 0) {
+            LOG_ERROR("Socket bind failed...");
+            exit(0);
+        }
+        LOG_INFO("Socket successfully bound..");
+
+        if (set_nonblocking(sockfd) != 0 || sock_listen(sockfd, &sockOptions) != 0) {
+            LOG_ERROR("Listen failed...");
+            exit(0);
         }
+        const char *flushNames[] = SOCK_FLUSH_NAMES;
+        LOG_INFO("Server listening.. (backlog %d, %s flush)", sockOptions.backlog, flushNames[sockOptions.flush]);
+    }
+
+    int answers = wordle_dict_load(WORDLE_ANSWERS_PATH, WORDLE_ALLOWED_PATH);
+    if (answers > 0)
+        LOG_INFO("Wordle dictionary loaded: %d answers, %d allowed guesses", answers, wordle_dict_allowed_count());
+    else
+        LOG_INFO("Wordle dictionary unavailable, using %d built-in words", wordListSize);
+    if (answers > 0 && wordle_solver_init(&wordleSolver, WORDLE_PRECOMPUTE_PATTERNS) == 0) {
+        wordleSolverReady = 1;
+        LOG_INFO("Wordle hint solver ready (%s kernel)", wordle_kernel_name(wordle_kernel_select(WORDLE_KERNEL_AUTO)));
+    }
+
+    if (pgn_archive_start(ARCHIVE_DIR, ARCHIVE_ROTATE_BYTES) != 0)
+        LOG_WARN("Chess archive disabled, games will not be recorded");
+    if (replay_start(REPLAY_DIR, REPLAY_ROTATE_BYTES) != 0)
+        LOG_WARN("Replays disabled, games will not be recorded");
+
+    if (serverConfig.botFillMs > 0 || serverConfig.botSoakSessions > 0) {
+        botPool = worker_pool_create(serverConfig.botWorkers, bot_worker_init, bot_worker_free, NULL);
+        if (botPool)
+            LOG_INFO("Bots ready: %s policy, %d workers, %d ms budget", botPolicyNames[botPolicy],
+                   worker_pool_threads(botPool), serverConfig.botBudgetMs);
+        else
+            LOG_WARN("Bot workers failed to start, bots disabled");
+    }
+    long long nextSoakReport = now_ms() + SOAK_REPORT_MS;
+
+    int backend = io_loop_parse_backend(serverConfig.ioBackend);
+    if (backend < 0) {
+        LOG_ERROR("Invalid I/O backend '%s', use poll, epoll or io_uring", serverConfig.ioBackend);
+        exit(0);
+    }
+    ioLoop = io_loop_create(backend, sockfd, botPool ? worker_pool_wake_fd(botPool) : -1, &ioCallbacks, NULL);
+    if (!ioLoop) {
+        LOG_ERROR("Event loop failed to start...");
+        exit(0);
+    }
+    ioSendAsync = io_loop_backend(ioLoop) == IO_URING;
+    const char *backendNames[] = IO_BACKEND_NAMES;
+    LOG_INFO("Event loop: %s", backendNames[io_loop_backend(ioLoop)]);
+    if (catch_stop_signals() != 0) LOG_WARN("Cannot catch SIGINT/SIGTERM, archives may lose their last games");
+    if (clusterNode) {
+        if (cluster_join() != 0) {
+            LOG_ERROR("Cannot reach the coordinator at %s", serverConfig.clusterSocket);
+            exit(0);
+        }
+        LOG_INFO("Cluster node %d registered with %s", (int)getpid(), serverConfig.clusterSocket);
+        nextClusterReport = now_ms();
+    }
+
+    while (1) {
+        top_up_soak_sessions();
+        drop_broken_clients();
+        uncork_clients();
+        if (io_loop_wait(ioLoop, next_timer_ms(now_ms(), nextSoakReport)) < 0) {
+            if (errno == EINTR) continue;
+            LOG_ERROR("Event loop failed...");
+            break;
+        }
+        loopWakeNs = now_ns();
+        io_loop_dispatch(ioLoop);
+        trace_enter(-1, -1);
+        drop_broken_clients();
+        long long now = now_ms();
+        fill_waiting_players(now);
+        if (serverConfig.botSoakSessions > 0 && now >= nextSoakReport) {
+            report_soak(now - (nextSoakReport - SOAK_REPORT_MS));
+            nextSoakReport = now + SOAK_REPORT_MS;
+        }
+        if (clusterFd >= 0 && now >= nextClusterReport) {
+            cluster_report();
+            nextClusterReport = now + serverConfig.clusterReportMs;
+        }
+        lobby_poll(now);
+        if (serverConfig.statsPath[0] && now >= nextStatsSnapshot) {
+            if (player_stats_snapshot(serverConfig.statsPath) < 0) LOG_WARN("Could not start a player stats snapshot");
+            nextStatsSnapshot = now + serverConfig.statsSnapshotMs;
+        }
+        // A node cut off from its coordinator gets no new players.
+        if (clusterNode && clusterFd < 0 && numFreeClients == clientCapacity) break;
+        if (stopRequested) {
+            LOG_INFO("Stopping, %d games in progress are abandoned", numSessions);
+            break;
+        }
+    }
+    io_loop_free(ioLoop);
+    replay_stop();
+    pgn_archive_stop();
+    if (serverConfig.statsPath[0]) {
+        player_stats_wait();
+        player_stats_snapshot(serverConfig.statsPath);
+        player_stats_wait();
     }
-    close(sockfd);
+    if (sockfd >= 0) close(sockfd);
     return 0;
 }
+#endif
@@ -0,0 +1,174 @@
+// Loopback latency of the TCP flush policies in sock_opts.h. For each
+// policy a server thread answers every request line with a reply sent the
+// way the game server sends a chess turn, in several writes (a short
+// line, the board, more short lines, then YOUR_TURN), and the client
+// times each request until YOUR_TURN arrives. reads_per_turn counts the
+// client's reads per reply, about the segments the reply came in.
+// Usage: ./flush_bench [-n turns] [-w writes_per_reply] [-b board_bytes]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include "latency_hist.h"
+#include "sock_opts.h"
+
+#define WARMUP_TURNS 50
+#define REPLY_END "YOUR_TURN\n"
+#define MAX_BOARD_BYTES 16384
+
+typedef struct {
+    int fd;
+    SockFlush flush;
+    int writes;
+    int boardBytes;
+} Responder;
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int send_all(int fd, const char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, buf, len, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        buf += n;
+        len -= n;
+    }
+    return 0;
+}
+
+// Answers requests until the client hangs up, corking as the server does:
+// from the second write of a reply until the reply is done.
+static void *respond(void *arg) {
+    Responder *r = arg;
+    static char board[MAX_BOARD_BYTES];
+    memset(board, '.', r->boardBytes);
+    board[r->boardBytes - 1] = '\n';
+    char in[256];
+    for (;;) {
+        ssize_t n = recv(r->fd, in, sizeof(in), 0);
+        if (n <= 0) break;
+        if (in[n - 1] != '\n') continue;
+        for (int w = 0; w < r->writes; w++) {
+            if (w == 1 && r->flush == SOCK_FLUSH_CORK) sock_cork(r->fd, 1);
+            int failed;
+            if (w == r->writes - 1) failed = send_all(r->fd, REPLY_END, strlen(REPLY_END));
+            else if (w == 1) failed = send_all(r->fd, board, r->boardBytes);
+            else failed = send_all(r->fd, w == 0 ? "MOVE_OK\n" : "OPPONENT_INFO\n", w == 0 ? 8 : 14);
+            if (failed) return NULL;
+        }
+        if (r->writes > 1 && r->flush == SOCK_FLUSH_CORK) sock_cork(r->fd, 0);
+    }
+    return NULL;
+}
+
+// Plays turns over a fresh loopback connection; 0, or -1 if it failed.
+static int run(SockFlush flush, int turns, int writes, int boardBytes, LatencyHist *hist, double *readsPerTurn, double *seconds) {
+    int listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = {0};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    SockOptions options = {flush, 1, 0, 0, 0};
+    if (listenFd < 0 || bind(listenFd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        sock_listen(listenFd, &options) != 0 || getsockname(listenFd, (struct sockaddr *)&addr, &len) != 0) {
+        if (listenFd >= 0) close(listenFd);
+        return -1;
+    }
+    int clientFd = socket(AF_INET, SOCK_STREAM, 0);
+    if (clientFd < 0 || connect(clientFd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(listenFd);
+        if (clientFd >= 0) close(clientFd);
+        return -1;
+    }
+    Responder responder = {accept(listenFd, NULL, NULL), flush, writes, boardBytes};
+    close(listenFd);
+    pthread_t thread;
+    if (responder.fd < 0 || sock_tune(responder.fd, &options) != 0 ||
+        pthread_create(&thread, NULL, respond, &responder) != 0) {
+        if (responder.fd >= 0) close(responder.fd);
+        close(clientFd);
+        return -1;
+    }
+
+    // The client is left as game_client leaves it: Nagle on, delayed ACKs.
+    static char reply[MAX_BOARD_BYTES + 4096];
+    size_t endLen = strlen(REPLY_END);
+    long long reads = 0, start = 0;
+    int status = 0;
+    for (int t = 0; t < WARMUP_TURNS + turns && status == 0; t++) {
+        if (t == WARMUP_TURNS) {
+            reads = 0;
+            start = now_ns();
+        }
+        long long sent = now_ns();
+        if (send_all(clientFd, "MOVE:e2e4\n", 10) != 0) {
+            status = -1;
+            break;
+        }
+        size_t got = 0;
+        while (got < endLen || memcmp(reply + got - endLen, REPLY_END, endLen) != 0) {
+            ssize_t n = recv(clientFd, reply + got, sizeof(reply) - got, 0);
+            if (n <= 0 || got + n == sizeof(reply)) {
+                status = -1;
+                break;
+            }
+            got += n;
+            reads++;
+        }
+        if (t >= WARMUP_TURNS) latency_hist_record(hist, now_ns() - sent);
+    }
+    *seconds = (now_ns() - start) / 1e9;
+    *readsPerTurn = (double)reads / turns;
+    close(clientFd);
+    pthread_join(thread, NULL);
+    close(responder.fd);
+    return status;
+}
+
+static void usage(const char *prog) {
+    printf("Usage: %s [-n turns] [-w writes_per_reply] [-b board_bytes]\n", prog);
+}
+
+int main(int argc, char *argv[]) {
+    int opt, turns = 200, writes = 4, boardBytes = 600;
+    while ((opt = getopt(argc, argv, "n:w:b:")) != -1) {
+        switch (opt) {
+        case 'n': turns = atoi(optarg); break;
+        case 'w': writes = atoi(optarg); break;
+        case 'b': boardBytes = atoi(optarg); break;
+        default: usage(argv[0]); return 1;
+        }
+    }
+    if (turns < 1 || writes < 2 || writes > 64 || boardBytes < 1 || boardBytes > MAX_BOARD_BYTES) {
+        usage(argv[0]);
+        return 1;
+    }
+    printf("Flush policies on loopback: %d turns of %d writes, board %d bytes\n", turns, writes, boardBytes);
+    const char *names[] = SOCK_FLUSH_NAMES;
+    for (int flush = SOCK_FLUSH_NAGLE; flush <= SOCK_FLUSH_CORK; flush++) {
+        LatencyHist hist;
+        latency_hist_reset(&hist);
+        double readsPerTurn, seconds;
+        if (run(flush, turns, writes, boardBytes, &hist, &readsPerTurn, &seconds) != 0) {
+            printf("policy=%s failed: %s\n", names[flush], strerror(errno));
+            return 1;
+        }
+        printf("policy=%s turns=%llu p50_us=%.1f p99_us=%.1f p999_us=%.1f max_us=%.1f reads_per_turn=%.2f turns_per_sec=%.0f\n",
+               names[flush], (unsigned long long)hist.total, latency_hist_percentile(&hist, 0.50) / 1e3,
+               latency_hist_percentile(&hist, 0.99) / 1e3, latency_hist_percentile(&hist, 0.999) / 1e3, hist.max / 1e3,
+               readsPerTurn, hist.total / seconds);
+    }
+    return 0;
+}
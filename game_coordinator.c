@@ -0,0 +1,416 @@
+// Cluster coordinator: takes the players' connections on the game port,
+// pairs players asking for the same game and hands each pair, sockets
+// included, to the least loaded game_server node registered on
+// cluster_socket. The coordinator never plays: once a connection is
+// handed over it is closed here, and the node talks to the player
+// directly.
+// Usage: ./game_coordinator [config] [key=value ...]
+// Reads cluster_socket, bot_fill_ms, log_level, listen_backlog and the
+// tcp_ socket options from the server's configuration (gamesys.conf by
+// default).
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include "cluster.h"
+#include "server_config.h"
+#include "logger.h"
+#include "sock_opts.h"
+
+#define PORT 8081
+#define MAX_NODES 64
+#define REPORT_INTERVAL_MS 10000
+#define CPU_BUSY_PERMILLE 900           // nodes above this only get players when every node is
+
+typedef struct {
+    int fd;                     // -1 when the slot is free
+    int pid;
+    int registered;             // sent its hello
+    ClusterMsg load;            // last report
+    int routed;                 // players handed over since that report
+    long long handedOff;
+} Node;
+
+typedef struct {
+    int fd;
+    int game;                   // waiting for this game, or -1
+    long long waitingSince;
+    char in[CLUSTER_MAX_INPUT];
+    int inLen;
+} Player;
+
+Node nodes[MAX_NODES];
+Player *players;
+int numPlayers, playerCapacity;
+int waiting[CLUSTER_MAX_GAMES];        // player index per game, -1 = none
+char gameNames[CLUSTER_MAX_GAMES][32];
+int numGames;
+long long handoffs, handoffFailures;
+SockOptions sockOptions;
+
+long long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+void raise_fd_limit(void) {
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+}
+
+int find_game(const char *name) {
+    for (int g = 0; g < numGames; g++)
+        if (strcmp(name, gameNames[g]) == 0) return g;
+    return -1;
+}
+
+// The games the nodes serve, in their order, from a node's hello.
+void set_game_names(const char *names, int len) {
+    char list[CLUSTER_GAME_NAMES_SIZE];
+    snprintf(list, sizeof(list), "%.*s", len, names);
+    numGames = 0;
+    for (char *name = strtok(list, ","); name && numGames < CLUSTER_MAX_GAMES; name = strtok(NULL, ","))
+        snprintf(gameNames[numGames++], sizeof(gameNames[0]), "%s", name);
+}
+
+// Fewest sessions, counting the players sent since the node last
+// reported; nodes short of CPU only when all of them are.
+int pick_node(void) {
+    int best = -1;
+    for (int pass = 0; pass < 2 && best < 0; pass++) {
+        for (int i = 0; i < MAX_NODES; i++) {
+            Node *n = &nodes[i];
+            if (n->fd < 0 || !n->registered) continue;
+            if (pass == 0 && n->load.cpuPermille >= CPU_BUSY_PERMILLE) continue;
+            if (best < 0) {
+                best = i;
+                continue;
+            }
+            long long load = (long long)n->load.sessions * 2 + n->routed;
+            long long bestLoad = (long long)nodes[best].load.sessions * 2 + nodes[best].routed;
+            if (load < bestLoad || (load == bestLoad && n->load.cpuPermille < nodes[best].load.cpuPermille)) best = i;
+        }
+    }
+    return best;
+}
+
+// Tournament lobbies are per node, so all registrations go to one node.
+int tournament_node(void) {
+    for (int i = 0; i < MAX_NODES; i++)
+        if (nodes[i].fd >= 0 && nodes[i].registered) return i;
+    return -1;
+}
+
+void node_lost(int i) {
+    LOG_WARN("Node %d left the cluster after %lld players", nodes[i].pid, nodes[i].handedOff);
+    close(nodes[i].fd);
+    nodes[i].fd = -1;
+}
+
+void player_close(int p) {
+    Player *pl = &players[p];
+    if (pl->game >= 0 && waiting[pl->game] == p) waiting[pl->game] = -1;
+    close(pl->fd);
+    pl->fd = -1;
+}
+
+// Passes the players (one, or a pair for game) to a node with what they
+// typed that is still unread. Tries the next node when one fails.
+void hand_off(const int *ps, int count, int game, int tournament) {
+    ClusterMsg msg = {.type = CLUSTER_HANDOFF, .gameType = game, .count = count};
+    char data[2 * CLUSTER_MAX_INPUT];
+    int fds[2];
+    size_t len = 0;
+    for (int i = 0; i < count; i++) {
+        Player *pl = &players[ps[i]];
+        fds[i] = pl->fd;
+        msg.inputLen[i] = pl->inLen;
+        memcpy(data + len, pl->in, pl->inLen);
+        len += pl->inLen;
+    }
+    for (;;) {
+        int node = tournament ? tournament_node() : pick_node();
+        if (node < 0) {
+            handoffFailures++;
+            for (int i = 0; i < count; i++) {
+                const char *error = "ERROR:No game server available\n";
+                send(fds[i], error, strlen(error), MSG_NOSIGNAL);
+            }
+            break;
+        }
+        if (cluster_send(nodes[node].fd, &msg, data, len, fds, count) == 0) {
+            nodes[node].routed += count;
+            nodes[node].handedOff += count;
+            handoffs++;
+            break;
+        }
+        node_lost(node);
+    }
+    for (int i = 0; i < count; i++) player_close(ps[i]);
+}
+
+// The first complete line decides: GAME: waits for an opponent here,
+// anything else goes to a node as it is. Lines from a waiting player
+// are dropped, as the server drops them.
+void player_input(int p) {
+    Player *pl = &players[p];
+    char *nl;
+    while (pl->fd >= 0 && (nl = memchr(pl->in, '\n', pl->inLen))) {
+        int consumed = nl + 1 - pl->in;
+        int lineLen = consumed - 1;
+        char line[CLUSTER_MAX_INPUT];
+        memcpy(line, pl->in, lineLen);
+        line[lineLen] = '\0';
+        if (lineLen > 0 && line[lineLen - 1] == '\r') line[--lineLen] = '\0';
+        if (pl->game < 0 && lineLen > 0) {
+            int game = strncmp(line, "GAME:", 5) == 0 ? find_game(line + 5) : -1;
+            if (game < 0) {
+                hand_off(&p, 1, -1, strncmp(line, "TOURNAMENT:", 11) == 0);
+                return;
+            }
+            send(pl->fd, "WAITING\n", 8, MSG_NOSIGNAL);
+            int other = waiting[game];
+            if (other >= 0) {
+                waiting[game] = -1;
+                players[other].game = -1;
+                players[other].inLen = 0;       // typed while waiting
+                pl->inLen -= consumed;
+                memmove(pl->in, pl->in + consumed, pl->inLen);
+                int pair[2] = {other, p};
+                hand_off(pair, 2, game, 0);
+                return;
+            }
+            pl->game = game;
+            pl->waitingSince = now_ms();
+            waiting[game] = p;
+        }
+        pl->inLen -= consumed;
+        memmove(pl->in, pl->in + consumed, pl->inLen);
+    }
+    // A line longer than a node would take: let the node refuse it.
+    if (pl->fd >= 0 && pl->game < 0 && pl->inLen == CLUSTER_MAX_INPUT - 1) hand_off(&p, 1, -1, 0);
+}
+
+void player_read(int p) {
+    Player *pl = &players[p];
+    ssize_t n = read(pl->fd, pl->in + pl->inLen, CLUSTER_MAX_INPUT - 1 - pl->inLen);
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) return;
+    if (n <= 0) {
+        player_close(p);
+        return;
+    }
+    pl->inLen += n;
+    player_input(p);
+}
+
+void accept_players(int listenFd) {
+    for (;;) {
+        int fd = accept4(listenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) LOG_ERROR("Accept failed...");
+            return;
+        }
+        // Keepalive drops players who vanish while waiting; the node tunes the socket again on adopting it.
+        sock_tune(fd, &sockOptions);
+        if (numPlayers == playerCapacity) {
+            int capacity = playerCapacity ? playerCapacity * 2 : 256;
+            Player *grown = realloc(players, capacity * sizeof(Player));
+            if (!grown) {
+                close(fd);
+                continue;
+            }
+            players = grown;
+            playerCapacity = capacity;
+        }
+        players[numPlayers++] = (Player){.fd = fd, .game = -1};
+        send(fd, "SELECT_GAME\n", 12, MSG_NOSIGNAL);
+    }
+}
+
+void accept_nodes(int clusterListenFd) {
+    for (;;) {
+        int fd = accept4(clusterListenFd, NULL, NULL, SOCK_CLOEXEC);
+        if (fd < 0) return;
+        int slot = 0;
+        while (slot < MAX_NODES && nodes[slot].fd >= 0) slot++;
+        if (slot == MAX_NODES) {
+            LOG_WARN("Cluster full, refusing a node");
+            close(fd);
+            continue;
+        }
+        nodes[slot] = (Node){.fd = fd};
+    }
+}
+
+void node_read(int i) {
+    Node *n = &nodes[i];
+    ClusterMsg msg;
+    char data[CLUSTER_GAME_NAMES_SIZE];
+    int fds[2], numFds;
+    int len = cluster_recv(n->fd, &msg, data, sizeof(data), fds, 2, &numFds);
+    for (int k = 0; k < numFds; k++) close(fds[k]);
+    if (len < 0) {
+        node_lost(i);
+        return;
+    }
+    if (msg.type == CLUSTER_HELLO) {
+        n->pid = msg.pid;
+        n->registered = 1;
+        set_game_names(data, len);
+        LOG_INFO("Node %d joined the cluster (%d games)", n->pid, numGames);
+    } else if (msg.type == CLUSTER_LOAD) {
+        n->load = msg;
+        n->routed = 0;
+    }
+}
+
+// Players whose bot fill is due go to a node on their own, which starts
+// the bot at once.
+void hand_off_lone_players(long long now) {
+    if (serverConfig.botFillMs == 0) return;
+    for (int g = 0; g < numGames; g++) {
+        int p = waiting[g];
+        if (p < 0 || now - players[p].waitingSince < serverConfig.botFillMs) continue;
+        waiting[g] = -1;
+        players[p].game = -1;
+        players[p].inLen = 0;
+        hand_off(&p, 1, g, 0);
+    }
+}
+
+int next_timeout(long long now, long long nextReport) {
+    long long wait = nextReport - now;
+    for (int g = 0; g < numGames && serverConfig.botFillMs > 0; g++) {
+        if (waiting[g] < 0) continue;
+        long long left = players[waiting[g]].waitingSince + serverConfig.botFillMs - now;
+        if (left < wait) wait = left;
+    }
+    return wait > 0 ? (int)wait : 0;
+}
+
+// Closed players leave holes; fill them from the end, fixing the queue.
+void compact_players(void) {
+    for (int p = 0; p < numPlayers;) {
+        if (players[p].fd >= 0) {
+            p++;
+            continue;
+        }
+        int last = --numPlayers;
+        if (p == last) break;
+        players[p] = players[last];
+        if (players[p].game >= 0 && waiting[players[p].game] == last) waiting[players[p].game] = p;
+    }
+}
+
+// One line per node: log records hold only a few arguments.
+void report(void) {
+    LOG_INFO("%lld handoffs, %lld failed, %d players here", handoffs, handoffFailures, numPlayers);
+    for (int i = 0; i < MAX_NODES; i++) {
+        if (nodes[i].fd < 0 || !nodes[i].registered) continue;
+        LOG_INFO("Node %d: %u sessions, %u clients, %u%% CPU, %lld players handed over", nodes[i].pid,
+                 nodes[i].load.sessions, nodes[i].load.clients, nodes[i].load.cpuPermille / 10, nodes[i].handedOff);
+    }
+}
+
+int main(int argc, char **argv) {
+    if (log_start() != 0) printf("Logger failed to start, logging is off\n");
+    const char *configPath = argc > 1 ? argv[1] : SERVER_CONFIG_PATH;
+    if (server_config_load(configPath) < 0) {
+        LOG_ERROR("Invalid configuration in %s", configPath);
+        return 1;
+    }
+    for (int i = 2; i < argc; i++) {
+        if (server_config_set(argv[i]) != 0) {
+            LOG_ERROR("Invalid option %s", argv[i]);
+            return 1;
+        }
+    }
+    int level = log_parse_level(serverConfig.logLevel);
+    if (level >= 0) log_set_level(level);
+    if (serverConfig.clusterSocket[0] == '\0') {
+        LOG_ERROR("Set cluster_socket for the nodes to register on");
+        return 1;
+    }
+    raise_fd_limit();
+    for (int i = 0; i < MAX_NODES; i++) nodes[i].fd = -1;
+    for (int g = 0; g < CLUSTER_MAX_GAMES; g++) waiting[g] = -1;
+
+    int clusterListenFd = cluster_listen(serverConfig.clusterSocket);
+    if (clusterListenFd < 0) {
+        LOG_ERROR("Cannot listen on %s: %s", serverConfig.clusterSocket, strerror(errno));
+        return 1;
+    }
+    int flush = sock_parse_flush(serverConfig.tcpFlush);
+    if (flush < 0) {
+        LOG_ERROR("Invalid TCP flush policy '%s', use nagle, nodelay or cork", serverConfig.tcpFlush);
+        return 1;
+    }
+    sockOptions = (SockOptions){flush, serverConfig.listenBacklog, serverConfig.tcpDeferAcceptS,
+                                serverConfig.tcpKeepaliveS, serverConfig.tcpUserTimeoutMs};
+    int listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int opt = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    struct sockaddr_in addr = {0};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(PORT);
+    if (listenFd < 0 || bind(listenFd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || sock_listen(listenFd, &sockOptions) != 0) {
+        LOG_ERROR("Cannot listen on port %d: %s", PORT, strerror(errno));
+        return 1;
+    }
+    LOG_INFO("Coordinator on port %d, nodes register on %s", PORT, serverConfig.clusterSocket);
+
+    struct pollfd *fds = NULL;
+    int fdsCapacity = 0;
+    long long nextReport = now_ms() + REPORT_INTERVAL_MS;
+    while (1) {
+        int needed = 2 + MAX_NODES + numPlayers;
+        if (needed > fdsCapacity) {
+            struct pollfd *grown = realloc(fds, needed * sizeof(struct pollfd));
+            if (!grown) {
+                LOG_ERROR("Out of memory");
+                break;
+            }
+            fds = grown;
+            fdsCapacity = needed;
+        }
+        int n = 0;
+        fds[n++] = (struct pollfd){listenFd, POLLIN, 0};
+        fds[n++] = (struct pollfd){clusterListenFd, POLLIN, 0};
+        for (int i = 0; i < MAX_NODES; i++) fds[n++] = (struct pollfd){nodes[i].fd, POLLIN, 0};
+        int polledPlayers = numPlayers;
+        for (int p = 0; p < polledPlayers; p++) fds[n++] = (struct pollfd){players[p].fd, POLLIN, 0};
+        if (poll(fds, n, next_timeout(now_ms(), nextReport)) < 0) {
+            if (errno == EINTR) continue;
+            LOG_ERROR("poll failed: %s", strerror(errno));
+            break;
+        }
+        for (int i = 0; i < MAX_NODES; i++)
+            if (nodes[i].fd >= 0 && (fds[2 + i].revents & (POLLIN | POLLHUP | POLLERR))) node_read(i);
+        for (int p = 0; p < polledPlayers; p++)
+            if (players[p].fd >= 0 && (fds[2 + MAX_NODES + p].revents & (POLLIN | POLLHUP | POLLERR))) player_read(p);
+        if (fds[1].revents & POLLIN) accept_nodes(clusterListenFd);
+        long long now = now_ms();
+        hand_off_lone_players(now);
+        compact_players();
+        if (fds[0].revents & POLLIN) accept_players(listenFd);
+        if (now >= nextReport) {
+            report();
+            nextReport = now + REPORT_INTERVAL_MS;
+        }
+    }
+    return 0;
+}
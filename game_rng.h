@@ -0,0 +1,64 @@
+#ifndef GAME_RNG_H
+#define GAME_RNG_H
+
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/random.h>
+
+// xoshiro256** seeded through splitmix64. Each session owns one, so dice
+// are independent between sessions and threads and a game can be replayed
+// exactly from the seed printed when it starts.
+typedef struct {
+    uint64_t s[4];
+} GameRng;
+
+static inline uint64_t game_rng_splitmix(uint64_t *x) {
+    uint64_t z = (*x += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+static inline void game_rng_seed(GameRng *rng, uint64_t seed) {
+    for (int i = 0; i < 4; i++) rng->s[i] = game_rng_splitmix(&seed);
+}
+
+static inline uint64_t game_rng_rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+static inline uint64_t game_rng_next(GameRng *rng) {
+    uint64_t *s = rng->s;
+    uint64_t result = game_rng_rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = game_rng_rotl(s[3], 45);
+    return result;
+}
+
+// Uniform integer in [0, n) without modulo bias (Lemire's method).
+static inline uint32_t game_rng_range(GameRng *rng, uint32_t n) {
+    uint64_t m = (uint64_t)(uint32_t)(game_rng_next(rng) >> 32) * n;
+    if ((uint32_t)m < n) {
+        uint32_t threshold = -n % n;
+        while ((uint32_t)m < threshold) m = (uint64_t)(uint32_t)(game_rng_next(rng) >> 32) * n;
+    }
+    return m >> 32;
+}
+
+// A fresh seed from the kernel, falling back to the clock.
+static inline uint64_t game_rng_fresh_seed(void) {
+    uint64_t seed;
+    if (getrandom(&seed, sizeof(seed), GRND_NONBLOCK) == sizeof(seed)) return seed;
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    seed = (uint64_t)ts.tv_sec * 1000000007ull ^ (uint64_t)ts.tv_nsec ^ ((uint64_t)getpid() << 32);
+    return game_rng_splitmix(&seed);
+}
+
+#endif
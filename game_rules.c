@@ -0,0 +1,186 @@
+#include "game_rules.h"
+#include "wordle_dict.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Chess
+void get_chess_board_string(ChessBoard* board, char* board_str) {
+    char* p = board_str;
+    p += sprintf(p, "\n\033[1;34m✨ CHESS BOARD ✨\033[0m\n");
+    p += sprintf(p, "    a   b   c   d   e   f   g   h\n");
+    p += sprintf(p, "  ┌───┬───┬───┬───┬───┬───┬───┬───┐\n");
+    for (int i = 0; i < 8; i++) {
+        p += sprintf(p, "\033[1;34m%d\033[0m │", 8 - i);
+        for (int j = 0; j < 8; j++) {
+            if (board->board[i][j]) {
+                char* color = board->board[i][j]->color == WHITE ? "\033[1;37m" : "\033[1;30m";
+                p += sprintf(p, "%s%-3s\033[0m│", color, board->board[i][j]->id);
+            } else {
+                p += sprintf(p, " . │");
+            }
+        }
+        p += sprintf(p, "\n");
+        if (i < 7) p += sprintf(p, "  ├───┼───┼───┼───┼───┼───┼───┼───┤\n");
+    }
+    p += sprintf(p, "  └───┴───┴───┴───┴───┴───┴───┴───┘\n");
+    p += sprintf(p, "    a   b   c   d   e   f   g   h\n\n");
+}
+
+static const char *skip_escapes(const char *p) {
+    while (*p == '\033') {
+        p++;
+        while (*p && !(*p >= '@' && *p <= '~' && *p != '[')) p++;
+        if (*p) p++;
+    }
+    return p;
+}
+
+int chess_parse_board_row(const char *line, ChessBoard *board, Piece storage[8][8]) {
+    static const char *bar = "│";
+    const char *p = skip_escapes(line);
+    if (*p < '1' || *p > '8') return 0;
+    int row = 8 - (*p - '0');
+    p = strstr(p, bar);
+    for (int col = 0; col < 8; col++) {
+        if (!p) return 0;
+        p = skip_escapes(p + strlen(bar));
+        char id[4] = "";
+        sscanf(p, "%3[^ \033│]", id);
+        board->board[row][col] = NULL;
+        if (id[0] && strcmp(id, ".") != 0) {
+            Piece *piece = &storage[row][col];
+            switch (id[0]) {
+                case 'P': piece->type = PAWN; break;
+                case 'K': piece->type = strlen(id) == 3 ? KNIGHT : KING; break;     // "K1W" is a knight, "KW" the king
+                case 'B': piece->type = BISHOP; break;
+                case 'R': piece->type = ROOK; break;
+                case 'Q': piece->type = QUEEN; break;
+                default: return 0;
+            }
+            piece->color = id[strlen(id) - 1] == 'W' ? WHITE : BLACK;
+            snprintf(piece->id, sizeof(piece->id), "%s", id);
+            board->board[row][col] = piece;
+        }
+        p = strstr(p, bar);
+    }
+    return 1;
+}
+
+int is_path_clear(ChessBoard* board, int fromX, int fromY, int toX, int toY) {
+    int dx = toX - fromX;
+    int dy = toY - fromY;
+    int steps = abs(dx) > abs(dy) ? abs(dx) : abs(dy);
+    int stepX = dx ? dx / abs(dx) : 0;
+    int stepY = dy ? dy / abs(dy) : 0;
+    for (int i = 1; i < steps; i++) {
+        int x = fromX + i * stepX;
+        int y = fromY + i * stepY;
+        if (board->board[x][y]) return 0;
+    }
+    return 1;
+}
+
+int is_legal_move(ChessBoard* board, int fromX, int fromY, int toX, int toY, char* feedback) {
+    Piece* piece = board->board[fromX][fromY];
+    int dx = toX - fromX;
+    int dy = toY - fromY;
+    if (fromX == toX && fromY == toY) {
+        strcpy(feedback, "\033[1;31mInvalid move! Cannot move to the same square.\033[0m");
+        return 0;
+    }
+    if (board->board[toX][toY] && board->board[toX][toY]->color == piece->color) {
+        strcpy(feedback, "\033[1;31mInvalid move! Cannot capture your own piece.\033[0m");
+        return 0;
+    }
+    switch (piece->type) {
+        case PAWN:
+            if (piece->color == WHITE) {
+                if (dx == -1 && dy == 0 && !board->board[toX][toY]) return 1;
+                if (fromX == 6 && dx == -2 && dy == 0 && !board->board[toX][toY] && !board->board[fromX - 1][fromY]) return 1;
+                if (dx == -1 && (dy == 1 || dy == -1) && board->board[toX][toY] && board->board[toX][toY]->color == BLACK) return 1;
+                strcpy(feedback, "\033[1;31mInvalid pawn move! White pawns move up one (or two from row 2) or capture diagonally.\033[0m");
+            } else {
+                if (dx == 1 && dy == 0 && !board->board[toX][toY]) return 1;
+                if (fromX == 1 && dx == 2 && dy == 0 && !board->board[toX][toY] && !board->board[fromX + 1][fromY]) return 1;
+                if (dx == 1 && (dy == 1 || dy == -1) && board->board[toX][toY] && board->board[toX][toY]->color == WHITE) return 1;
+                strcpy(feedback, "\033[1;31mInvalid pawn move! Black pawns move down one (or two from row 7) or capture diagonally.\033[0m");
+            }
+            return 0;
+        case KNIGHT:
+            if ((abs(dx) == 2 && abs(dy) == 1) || (abs(dx) == 1 && abs(dy) == 2)) return 1;
+            strcpy(feedback, "\033[1;31mInvalid knight move! Knights move in an L-shape (2x1 or 1x2).\033[0m");
+            return 0;
+        case BISHOP:
+            if (abs(dx) == abs(dy) && is_path_clear(board, fromX, fromY, toX, toY)) return 1;
+            strcpy(feedback, "\033[1;31mInvalid bishop move! Bishops move diagonally any distance.\033[0m");
+            return 0;
+        case ROOK:
+            if ((dx == 0 || dy == 0) && is_path_clear(board, fromX, fromY, toX, toY)) return 1;
+            strcpy(feedback, "\033[1;31mInvalid rook move! Rooks move horizontally or vertically any distance.\033[0m");
+            return 0;
+        case QUEEN:
+            if ((abs(dx) == abs(dy) || dx == 0 || dy == 0) && is_path_clear(board, fromX, fromY, toX, toY)) return 1;
+            strcpy(feedback, "\033[1;31mInvalid queen move! Queens move diagonally, horizontally, or vertically any distance.\033[0m");
+            return 0;
+        case KING:
+            if (abs(dx) <= 1 && abs(dy) <= 1) return 1;
+            strcpy(feedback, "\033[1;31mInvalid king move! Kings move one square in any direction.\033[0m");
+            return 0;
+    }
+    return 0;
+}
+
+int find_piece(ChessBoard* board, const char* pieceId, Color playerColor, int* x, int* y) {
+    for (int i = 0; i < 8; i++) {
+        for (int j = 0; j < 8; j++) {
+            if (board->board[i][j] && strcmp(board->board[i][j]->id, pieceId) == 0 && board->board[i][j]->color == playerColor) {
+                *x = i;
+                *y = j;
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+// Finds the piece and checks the move; fills in its squares when it is legal.
+int check_chess_move(ChessBoard* board, const char* pieceId, const char* to, Color playerColor,
+                     int *fromX, int *fromY, int *toX, int *toY, char* feedback) {
+    if (!find_piece(board, pieceId, playerColor, fromX, fromY)) {
+        strcpy(feedback, "\033[1;31mPiece not found or not yours!\033[0m");
+        return 0;
+    }
+    if (strlen(to) != 2) {
+        strcpy(feedback, "\033[1;31mInvalid destination format! Use e.g., 'e5'\033[0m");
+        return 0;
+    }
+    *toY = to[0] - 'a';
+    *toX = 8 - (to[1] - '0');
+    if (*toX < 0 || *toX > 7 || *toY < 0 || *toY > 7) {
+        strcpy(feedback, "\033[1;31mDestination out of bounds!\033[0m");
+        return 0;
+    }
+    return is_legal_move(board, *fromX, *fromY, *toX, *toY, feedback);
+}
+
+// Wordle
+const char *wordle_check_guess(char *guess) {
+    int letters = strlen(guess) == 5;
+    for (int i = 0; letters && i < 5; i++) {
+        if (guess[i] >= 'a' && guess[i] <= 'z') guess[i] -= 32;
+        if (guess[i] < 'A' || guess[i] > 'Z') letters = 0;
+    }
+    if (!letters) return "Invalid guess! Must be 5 letters.";
+    if (!wordle_dict_is_valid(guess)) return "Not in word list! Try another word.";
+    return NULL;
+}
+
+// Tic Tac Toe
+int ttt_parse_move(const char *line, int rows, int cols, TttMask occupied) {
+    int row, col;
+    if (sscanf(line, "%d %d", &row, &col) != 2 || row < 0 || row >= rows || col < 0 || col >= cols) return -1;
+    int cell = row * cols + col;
+    return (occupied >> cell) & 1 ? -1 : cell;
+}
@@ -0,0 +1,50 @@
+#ifndef GAME_RULES_H
+#define GAME_RULES_H
+
+#include "ttt_engine.h"
+
+// Rules shared by the server, which enforces them, and the client, which
+// checks what the player types against them before sending it. The server
+// stays authoritative: the client only saves a round trip on input that
+// is certain to be refused.
+
+#define WORDLE_ANSWERS_PATH "data/wordle_answers.txt"
+#define WORDLE_ALLOWED_PATH "data/wordle_allowed.txt"
+
+// Chess
+typedef enum { PAWN, KNIGHT, BISHOP, ROOK, QUEEN, KING } PieceType;
+typedef enum { WHITE, BLACK } Color;
+
+typedef struct {
+    PieceType type;
+    Color color;
+    char id[4];
+} Piece;
+
+typedef struct {
+    Piece* board[8][8];
+} ChessBoard;
+
+// The board as the server sends it: a header, one line per rank starting
+// with its number, and a footer.
+void get_chess_board_string(ChessBoard* board, char* board_str);
+// Reads one rank line of that text back into board, using storage for the
+// pieces. Returns 0 if line is not a rank line.
+int chess_parse_board_row(const char *line, ChessBoard *board, Piece storage[8][8]);
+
+int is_path_clear(ChessBoard* board, int fromX, int fromY, int toX, int toY);
+int is_legal_move(ChessBoard* board, int fromX, int fromY, int toX, int toY, char* feedback);
+int find_piece(ChessBoard* board, const char* pieceId, Color playerColor, int* x, int* y);
+// Finds the piece and checks the move; fills in its squares when it is legal.
+int check_chess_move(ChessBoard* board, const char* pieceId, const char* to, Color playerColor,
+                     int *fromX, int *fromY, int *toX, int *toY, char* feedback);
+
+// Wordle: uppercases guess in place. Returns NULL if it is a five-letter
+// word in the dictionary (when one is loaded), otherwise the reason not.
+const char *wordle_check_guess(char *guess);
+
+// Tic Tac Toe: the cell of a "row col" move onto an empty square of a
+// rows x cols board, or -1.
+int ttt_parse_move(const char *line, int rows, int cols, TttMask occupied);
+
+#endif
@@ -0,0 +1,851 @@
+// Deterministic simulation of the server. The server source is compiled
+// into this file and its event loop runs against in-memory connections
+// under a virtual clock: a seeded scheduler decides every connect, every
+// piece of input delivered (split at random, as partial reads), every
+// acknowledgement of output, and every fault (a peer dropping, a send
+// failing, a reader stalling), so a run depends on nothing but its seed.
+// Usage: ./game_sim [-s seed] [-r runs] [-n sessions] [-c connections] [-f config] [-v]
+// Each run plays until n sessions have started, with up to c connections
+// open, and checks the server's bookkeeping after every event. A failed
+// check or a crash prints the seed; running that seed again repeats the
+// run event for event (-v prints them).
+#define _GNU_SOURCE
+#define GAME_SERVER_NO_MAIN
+#define GAME_SERVER_VIRTUAL_CLOCK
+#include "complete_game_server.c"
+
+#include <signal.h>
+#include <stdarg.h>
+#include <inttypes.h>
+
+#define SIM_MAX_CONNS 4096
+#define SIM_CHANNELS 3                  // players per connection: 0 plain, 1 and 2 multiplexed
+#define SIM_LINE_SIZE 8192
+#define SIM_STEP_NS 2000000             // virtual time between events, at most
+#define SIM_DRAIN_NS 30000000000LL      // after the last session starts, then everyone hangs up
+#define SIM_MAX_STEPS_PER_SESSION 5000  // a run taking longer is stuck
+#define SIM_BRACKET_MAX_PLAYERS 17
+#define SIM_BRACKET_TRIALS 16           // per bracket size and run
+#define SIM_BRACKET_MAX_MESSAGES 100000 // a bracket sending more is stuck
+
+// The in-memory transport: the server calls these instead of io_loop.c's.
+typedef struct SimConn SimConn;
+
+struct IoLoop {
+    SimConn **byId;             // server client id -> connection
+    int capacity;
+    SimConn *adopting;          // the connection client_adopt is adding
+};
+
+typedef struct {
+    int open;
+    int opened;                 // channels: was ever opened, so frames for it may come
+    int joined;                 // has asked for a game, a tournament or a seat
+    int game;
+    int moves;                  // lines sent since joining
+    int cap;                    // gives up after this many
+    int unseen;                 // lines received since it last acted
+    int lobbySeen;              // has been sent the whole lobby
+    unsigned lobbySeq;          // the last lobby update it was sent
+} SimPlayer;
+
+struct SimConn {
+    int fd;
+    int id;                     // server client id, -1 once the server removed it
+    int serial;
+    int multiplexed;
+    int sendFailed;
+    long long stalledUntil;     // ns: its output is not read before then
+    SimPlayer players[SIM_CHANNELS];
+    char *in;                   // typed, not yet delivered
+    size_t inLen, inCap;
+    char *out;                  // queued by the server, not yet acknowledged
+    size_t outStart, outLen, outCap;
+    char line[SIM_LINE_SIZE];   // acknowledged output, split into lines
+    size_t lineLen;
+};
+
+typedef struct {
+    long long steps, connects, drops, reconnects, sendFailures, stalls, partialReads, lines;
+} SimStats;
+
+static struct IoLoop simLoop;
+static SimConn *conns[SIM_MAX_CONNS];
+static int numConns, maxConns = 64, connSerial;
+static GameRng simRng;
+static uint64_t runSeed;
+static long long virtualNs;
+static int verbose, spawning;
+static SimStats stats;
+static int nullFd = -1;
+static char crashMsg[128];
+
+long long now_ns(void) {
+    return virtualNs;
+}
+
+static void sim_log(SimConn *c, const char *fmt, ...) {
+    if (!verbose) return;
+    va_list ap;
+    va_start(ap, fmt);
+    printf("%lld.%06lld step %lld", virtualNs / 1000000000, virtualNs / 1000 % 1000000, stats.steps);
+    if (c) printf(" conn %d (id %d)", c->serial, c->id);
+    printf(": ");
+    vprintf(fmt, ap);
+    printf("\n");
+    va_end(ap);
+}
+
+static void sim_fail(const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    printf("FAIL seed=%" PRIu64 " step=%lld: ", runSeed, stats.steps);
+    vprintf(fmt, ap);
+    printf("\n");
+    va_end(ap);
+    printf("Repeat it with: ./game_sim -s %" PRIu64 " -n <same> -c %d -v\n", runSeed, maxConns);
+    fflush(stdout);
+    exit(1);
+}
+
+// Names the seed when the server itself crashes.
+static void sim_crashed(int sig) {
+    ssize_t unused = write(STDOUT_FILENO, crashMsg, strlen(crashMsg));
+    (void)unused;
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+
+static void *sim_grow(void *buf, size_t *cap, size_t need) {
+    if (need <= *cap) return buf;
+    size_t size = *cap ? *cap : 256;
+    while (size < need) size *= 2;
+    char *grown = realloc(buf, size);
+    if (!grown) sim_fail("out of memory");
+    *cap = size;
+    return grown;
+}
+
+IoLoop *io_loop_create(IoBackend backend, int listenFd, int wakeFd, const IoCallbacks *callbacks, void *ctx) {
+    return &simLoop;
+}
+
+void io_loop_free(IoLoop *loop) {
+}
+
+IoBackend io_loop_backend(const IoLoop *loop) {
+    return IO_URING;
+}
+
+int io_loop_parse_backend(const char *name) {
+    return IO_URING;
+}
+
+int io_loop_add_wake(IoLoop *loop, int fd) {
+    return -1;
+}
+
+void io_loop_remove_wake(IoLoop *loop, int fd) {
+}
+
+int io_loop_add(IoLoop *loop, int id, int fd) {
+    SimConn *c = loop->adopting;
+    if (!c || c->fd != fd) sim_fail("io_loop_add(%d, %d) for a connection that was not accepted", id, fd);
+    if (id >= loop->capacity) {
+        int capacity = loop->capacity ? loop->capacity : 64;
+        while (capacity <= id) capacity *= 2;
+        SimConn **grown = realloc(loop->byId, capacity * sizeof(SimConn *));
+        if (!grown) return -1;
+        memset(grown + loop->capacity, 0, (capacity - loop->capacity) * sizeof(SimConn *));
+        loop->byId = grown;
+        loop->capacity = capacity;
+    }
+    if (loop->byId[id]) sim_fail("io_loop_add: id %d is already connection %d", id, loop->byId[id]->serial);
+    loop->byId[id] = c;
+    c->id = id;
+    return 0;
+}
+
+static SimConn *sim_conn(int id, const char *op) {
+    if (id < 0 || id >= simLoop.capacity || !simLoop.byId[id]) sim_fail("%s on id %d, which has no connection", op, id);
+    return simLoop.byId[id];
+}
+
+// The socket is closed: what it had not sent is gone.
+void io_loop_remove(IoLoop *loop, int id) {
+    SimConn *c = sim_conn(id, "io_loop_remove");
+    sim_log(c, "closed by the server, %zu bytes unsent", c->outLen);
+    loop->byId[id] = NULL;
+    c->id = -1;
+    c->fd = -1;
+    c->outLen = 0;
+}
+
+void io_loop_want_write(IoLoop *loop, int id, int on) {
+    sim_fail("io_loop_want_write(%d) with the loop owning the output", id);
+}
+
+int io_loop_send(IoLoop *loop, int id, const char *data, size_t len) {
+    SimConn *c = sim_conn(id, "io_loop_send");
+    if (c->outStart + c->outLen + len > c->outCap && c->outStart > 0) {
+        memmove(c->out, c->out + c->outStart, c->outLen);
+        c->outStart = 0;
+    }
+    c->out = sim_grow(c->out, &c->outCap, c->outStart + c->outLen + len);
+    memcpy(c->out + c->outStart + c->outLen, data, len);
+    c->outLen += len;
+    return 0;
+}
+
+int io_loop_wait(IoLoop *loop, int timeoutMs) {
+    return 0;
+}
+
+void io_loop_dispatch(IoLoop *loop) {
+}
+
+// Players
+// The server client a player speaks through: the connection, or its channel.
+static int sim_client_id(SimConn *c, int ch) {
+    if (c->id < 0) return -1;
+    if (!c->multiplexed) return c->id;
+    return clients[c->id].channels[ch] - 1;
+}
+
+static void sim_type(SimConn *c, int ch, const char *line) {
+    char prefix[8] = "";
+    if (c->multiplexed) snprintf(prefix, sizeof(prefix), "@%d ", ch);
+    size_t prefixLen = strlen(prefix), len = strlen(line);
+    c->in = sim_grow(c->in, &c->inCap, c->inLen + prefixLen + len + 1);
+    memcpy(c->in + c->inLen, prefix, prefixLen);
+    memcpy(c->in + c->inLen + prefixLen, line, len);
+    c->inLen += prefixLen + len;
+    c->in[c->inLen++] = '\n';
+    sim_log(c, "typed on channel %d: %.60s", ch, line);
+}
+
+// Input the server has to cope with: noise, bad frames, CRLF, control
+// bytes and the odd line longer than its input buffer.
+static void sim_garbage(char *line, size_t size) {
+    uint32_t kind = game_rng_range(&simRng, 100);
+    if (kind < 2) {
+        size_t len = size - 1;
+        for (size_t i = 0; i < len; i++) line[i] = 'A' + game_rng_range(&simRng, 26);
+        line[len] = '\0';
+        return;
+    }
+    if (kind < 10) {
+        // Channels the server refuses; a good one would open a channel the player does not know of.
+        uint32_t ch = kind & 1 ? 0 : CLIENT_MAX_CHANNELS + game_rng_range(&simRng, 10);
+        snprintf(line, size, "@%u %s", ch, kind < 6 ? "LIST" : "CLOSE");
+        return;
+    }
+    if (kind < 15) {
+        strcpy(line, "LIST\r");
+        return;
+    }
+    size_t len = 1 + game_rng_range(&simRng, 40);
+    for (size_t i = 0; i < len; i++) {
+        char b = kind < 30 ? (char)(1 + game_rng_range(&simRng, 255)) : (char)(' ' + game_rng_range(&simRng, 95));
+        line[i] = b == '\n' ? ' ' : b;
+    }
+    line[len] = '\0';
+}
+
+// A plausible move for the game, legal more often than not.
+static void sim_move(int sid, char *line, size_t size) {
+    GameSession *session = clients[sid].session;
+    int player = clients[sid].player;
+    switch (session->gameType) {
+        case WORDLE:
+            if (game_rng_range(&simRng, 20) == 0) strcpy(line, "HINT");
+            else bot_answer(game_rng_range(&simRng, bot_answer_count()), line);
+            break;
+        case CHESS: {
+            BotChessMove moves[BOT_CHESS_MAX_MOVES];
+            Color color = player == 0 ? WHITE : BLACK;
+            int n = session->chessState == PLAYING && session->chessTurn == player ?
+                    bot_chess_moves(&session->chessBoard, color, moves) : 0;
+            if (n > 0 && game_rng_range(&simRng, 10) != 0) {
+                BotChessMove m = moves[game_rng_range(&simRng, n)];
+                snprintf(line, size, "MOVE:%s %c%d", session->chessBoard.board[m.fromX][m.fromY]->id, 'a' + m.toY, 8 - m.toX);
+            } else {
+                snprintf(line, size, "MOVE:P%u%c %c%u", 1 + game_rng_range(&simRng, 8), color == WHITE ? 'W' : 'B',
+                         'a' + game_rng_range(&simRng, 8), 1 + game_rng_range(&simRng, 8));
+            }
+            break;
+        }
+        case SNAKE_LADDER:
+            strcpy(line, "ROLL");
+            break;
+        case TIC_TAC_TOE:
+            if (game_rng_range(&simRng, 20) == 0) strcpy(line, "HINT");
+            else snprintf(line, size, "%u %u", game_rng_range(&simRng, tttGeometry.rows), game_rng_range(&simRng, tttGeometry.cols));
+            break;
+        case ROCK_PAPER_SCISSOR:
+            strcpy(line, rpsMoveNames[game_rng_range(&simRng, 3)]);
+            break;
+        default:
+            break;
+    }
+}
+
+static void sim_join(SimPlayer *p, char *line, size_t size) {
+    uint32_t kind = game_rng_range(&simRng, 100);
+    if (kind < 85) {
+        snprintf(line, size, "GAME:%s", games[p->game].name);
+        p->joined = 1;
+    } else if (kind < 90) {
+        p->game = ROCK_PAPER_SCISSOR;
+        snprintf(line, size, "TOURNAMENT:%s", games[p->game].name);
+        p->joined = 1;
+    } else if (kind < 91) {
+        strcpy(line, game_rng_range(&simRng, 2) ? "LIST" : "LOBBY");
+    } else if (kind < 93) {
+        // A few dozen names, so players meet again across sessions.
+        uint32_t which = game_rng_range(&simRng, 3);
+        if (which == 0) snprintf(line, size, "NAME:p%u", game_rng_range(&simRng, 40));
+        else snprintf(line, size, "%s:%s", which == 1 ? "STATS" : "TOP", games[p->game].name);
+    } else if (kind < 97) {
+        snprintf(line, size, "SPECTATE:%u", nextSessionId > 0 ? game_rng_range(&simRng, nextSessionId) : 0);
+        p->joined = 1;
+    } else if (kind < 98) {
+        snprintf(line, size, "REPLAY:%u", game_rng_range(&simRng, nextSessionId + 1));
+        p->joined = 1;
+    } else {
+        snprintf(line, size, "GAME:%s", kind & 1 ? "NOPE" : "");
+    }
+}
+
+// Forgets the connection; the server has closed it or is told it went away.
+static void sim_drop(SimConn *c, const char *why) {
+    sim_log(c, "hangs up (%s)", why);
+    if (c->id >= 0) ioCallbacks.received(NULL, c->id, NULL, 0);
+    if (c->id >= 0) sim_fail("client %d still connected after its peer hung up", c->id);
+}
+
+// One player of the connection reacts to what it was sent, or now and
+// then to nothing, and gives up once past its cap.
+static void sim_act(SimConn *c) {
+    int chs[SIM_CHANNELS], n = 0;
+    for (int ch = 0; ch < SIM_CHANNELS; ch++)
+        if (c->players[ch].open) chs[n++] = ch;
+    if (n == 0) {
+        if (c->inLen == 0) sim_drop(c, "all channels closed");
+        return;
+    }
+    int ch = chs[game_rng_range(&simRng, n)];
+    SimPlayer *p = &c->players[ch];
+    if (!p->unseen && game_rng_range(&simRng, 8) != 0) return;
+    p->unseen = 0;
+    if (++p->moves > p->cap) {
+        if (!c->multiplexed) {
+            sim_drop(c, "gave up");
+            return;
+        }
+        sim_type(c, ch, "CLOSE");
+        p->open = 0;
+        return;
+    }
+    char line[CLIENT_INPUT_SIZE + 16];
+    int sid = sim_client_id(c, ch);
+    ClientState state = sid >= 0 ? clients[sid].state : CLIENT_SELECTING;
+    if (game_rng_range(&simRng, 50) == 0) {
+        sim_garbage(line, game_rng_range(&simRng, 4) == 0 ? sizeof(line) : 64);
+    } else if (!p->joined || (state == CLIENT_SELECTING && c->inLen == 0)) {
+        sim_join(p, line, sizeof(line));
+    } else if (state == CLIENT_PLAYING) {
+        if (game_rng_range(&simRng, 100) == 0) strcpy(line, "exit");
+        else sim_move(sid, line, sizeof(line));
+    } else if (state == CLIENT_SPECTATING || state == CLIENT_REPLAYING) {
+        strcpy(line, game_rng_range(&simRng, 4) == 0 ? "LEAVE" : "LIST");
+    } else {
+        uint32_t kind = game_rng_range(&simRng, 8);
+        strcpy(line, kind == 0 ? "LOBBY" : kind == 1 ? "LOBBY:OFF" : "LIST");
+    }
+    sim_type(c, ch, line);
+}
+
+// Output
+static void sim_line(SimConn *c, char *line) {
+    stats.lines++;
+    int ch = 0;
+    char *msg = line;
+    if (line[0] == '@' && isdigit((unsigned char)line[1])) {
+        char *rest;
+        long n = strtol(line + 1, &rest, 10);
+        if (!c->multiplexed) sim_fail("channel frame on plain connection %d: %.60s", c->serial, line);
+        if (n < 1 || n >= SIM_CHANNELS || !c->players[n].opened || *rest != ' ')
+            sim_fail("frame for channel %ld, never opened on connection %d: %.60s", n, c->serial, line);
+        ch = n;
+        msg = rest + 1;
+        if (strcmp(msg, "CLOSED") == 0) {
+            c->players[ch].open = 0;
+            return;
+        }
+    }
+    SimPlayer *p = &c->players[ch];
+    p->unseen++;
+    // Deltas follow the whole lobby and each other without a gap.
+    unsigned seq;
+    if (sscanf(msg, "LOBBY:FULL %u", &seq) == 1) {
+        p->lobbySeen = 1;
+        p->lobbySeq = seq;
+    } else if (sscanf(msg, "LOBBY:DELTA %u", &seq) == 1) {
+        if (!p->lobbySeen || seq != p->lobbySeq + 1)
+            sim_fail("connection %d channel %d: lobby update %u after %u", c->serial, ch, seq, p->lobbySeq);
+        p->lobbySeq = seq;
+    }
+}
+
+static void sim_receive(SimConn *c, const char *data, size_t len) {
+    while (len > 0) {
+        size_t n = SIM_LINE_SIZE - 1 - c->lineLen;
+        if (n > len) n = len;
+        memcpy(c->line + c->lineLen, data, n);
+        c->lineLen += n;
+        data += n;
+        len -= n;
+        size_t start = 0;
+        char *nl;
+        while ((nl = memchr(c->line + start, '\n', c->lineLen - start))) {
+            *nl = '\0';
+            sim_line(c, c->line + start);
+            start = nl + 1 - c->line;
+        }
+        // A line longer than the buffer counts as one.
+        if (start == 0 && c->lineLen == SIM_LINE_SIZE - 1) {
+            c->line[c->lineLen] = '\0';
+            sim_line(c, c->line);
+            start = c->lineLen;
+        }
+        memmove(c->line, c->line + start, c->lineLen - start);
+        c->lineLen -= start;
+    }
+}
+
+// Events
+static void sim_connect(int reconnect) {
+    if (numConns == SIM_MAX_CONNS) return;
+    SimConn *c = calloc(1, sizeof(SimConn));
+    if (!c) sim_fail("out of memory");
+    c->fd = dup(nullFd);
+    if (c->fd < 0) sim_fail("dup: %s", strerror(errno));
+    c->id = -1;
+    c->serial = ++connSerial;
+    c->multiplexed = game_rng_range(&simRng, 8) == 0;
+    int game = game_rng_range(&simRng, GAME_TYPE_COUNT);
+    for (int ch = c->multiplexed; ch < (c->multiplexed ? SIM_CHANNELS : 1); ch++) {
+        SimPlayer *p = &c->players[ch];
+        p->open = p->opened = 1;
+        p->unseen = 1;
+        // Channels of one connection often ask for the same game, and so play each other.
+        p->game = ch > 1 && game_rng_range(&simRng, 2) ? c->players[1].game : game;
+        game = game_rng_range(&simRng, GAME_TYPE_COUNT);
+        p->cap = 5 + game_rng_range(&simRng, 200);
+    }
+    conns[numConns++] = c;
+    stats.connects++;
+    stats.reconnects += reconnect;
+    simLoop.adopting = c;
+    int fd = c->fd;
+    ioCallbacks.accepted(NULL, fd);
+    simLoop.adopting = NULL;
+    sim_log(c, "connected%s%s", c->multiplexed ? ", multiplexed" : "", reconnect ? ", again" : "");
+    if (c->id < 0) c->fd = -1;
+}
+
+// Hands the server some of the typed input: all of it, or a piece.
+static void sim_deliver(SimConn *c) {
+    char data[CLIENT_INPUT_SIZE];
+    size_t n = c->inLen < sizeof(data) ? c->inLen : sizeof(data);
+    if (n > 1 && game_rng_range(&simRng, 2)) {
+        n = 1 + game_rng_range(&simRng, n - 1);
+        stats.partialReads++;
+    }
+    memcpy(data, c->in, n);
+    memmove(c->in, c->in + n, c->inLen - n);
+    c->inLen -= n;
+    sim_log(c, "delivered %zu bytes", n);
+    ioCallbacks.received(NULL, c->id, data, n);
+}
+
+// The kernel took some of the queued output.
+static void sim_ack(SimConn *c) {
+    size_t n = c->outLen;
+    if (n > 1 && game_rng_range(&simRng, 2)) n = 1 + game_rng_range(&simRng, n - 1);
+    char *data = c->out + c->outStart;
+    c->outStart += n;
+    c->outLen -= n;
+    sim_receive(c, data, n);
+    if (c->outLen == 0) c->outStart = 0;
+    sim_log(c, "sent %zu bytes", n);
+    ioCallbacks.sent(NULL, c->id, n);
+}
+
+static void sim_fault(SimConn *c) {
+    uint32_t kind = game_rng_range(&simRng, 3);
+    if (kind == 0) {
+        stats.drops++;
+        sim_drop(c, "dropped");
+        if (spawning && game_rng_range(&simRng, 2)) sim_connect(1);
+    } else if (kind == 1 && !c->sendFailed) {
+        stats.sendFailures++;
+        c->sendFailed = 1;
+        sim_log(c, "send failed");
+        ioCallbacks.sent(NULL, c->id, -1);
+    } else {
+        stats.stalls++;
+        c->stalledUntil = virtualNs + game_rng_range(&simRng, 2000) * 1000000LL;
+        sim_log(c, "stops reading for %lld ms", (c->stalledUntil - virtualNs) / 1000000);
+    }
+}
+
+static void sim_event(SimConn *c) {
+    if (game_rng_range(&simRng, 1000) < 8) {
+        sim_fault(c);
+        return;
+    }
+    int canDeliver = c->inLen > 0;
+    int canAck = c->outLen > 0 && !c->sendFailed && virtualNs >= c->stalledUntil;
+    uint32_t pick = game_rng_range(&simRng, 3);
+    if (pick == 0 && canDeliver) sim_deliver(c);
+    else if (pick == 1 && canAck) sim_ack(c);
+    else sim_act(c);
+}
+
+// Frees the connections that are closed on both sides.
+static void sim_reap(void) {
+    for (int i = 0; i < numConns;) {
+        SimConn *c = conns[i];
+        if (c->id >= 0) {
+            i++;
+            continue;
+        }
+        free(c->in);
+        free(c->out);
+        free(c);
+        conns[i] = conns[--numConns];
+    }
+}
+
+// Invariants
+// The server's tables agree with each other and with the transport.
+static void sim_check(void) {
+    int sessions = 0, spectators = 0;
+    for (GameSession *s = activeSessions; s; s = s->next) {
+        if (++sessions > numSessions) sim_fail("more sessions listed than numSessions (%d)", numSessions);
+        if (s->next && s->next->prev != s) sim_fail("session %d: broken list links", s->id);
+        if (s->player1_id == s->player2_id) sim_fail("session %d: client %d plays itself", s->id, s->player1_id);
+        for (int player = 0; player < 2; player++) {
+            int id = session_player(s, player);
+            if (id < 0 || id >= clientHigh) sim_fail("session %d: player %d is client %d", s->id, player, id);
+            Client *c = &clients[id];
+            if (c->state != CLIENT_PLAYING || c->session != s || c->player != player)
+                sim_fail("session %d: player %d is client %d in state %d", s->id, player, id, c->state);
+        }
+        for (int i = 0; i < s->numSpectators; i++) {
+            Client *c = &clients[s->spectators[i]];
+            if (c->state != CLIENT_SPECTATING || c->session != s)
+                sim_fail("session %d: spectator %d is in state %d", s->id, s->spectators[i], c->state);
+        }
+        spectators += s->numSpectators;
+    }
+    if (sessions != numSessions) sim_fail("%d sessions listed, numSessions is %d", sessions, numSessions);
+    for (int i = 0; i < numLobbyWatchers; i++) {
+        int id = lobbyWatchers[i];
+        if (id < 0 || id >= clientHigh || clients[id].state == CLIENT_FREE || clients[id].lobbyWatcher != i + 1)
+            sim_fail("lobby watcher %d is client %d, which does not know it", i, id);
+    }
+    if (numBroken != 0) sim_fail("%d broken clients not dropped", numBroken);
+
+    int live = 0, playing = 0, spectating = 0, watching = 0, stale = 0;
+    for (int id = 0; id < clientHigh; id++) {
+        Client *c = &clients[id];
+        if (c->state == CLIENT_FREE) continue;
+        live++;
+        watching += c->lobbyWatcher > 0;
+        stale += c->lobbyStale;
+        if (c->broken) sim_fail("client %d is broken but still connected", id);
+        if (c->state == CLIENT_PLAYING) playing++;
+        if (c->state == CLIENT_SPECTATING) spectating++;
+        if (c->state == CLIENT_WAITING && waitingPlayer[c->gameType] != id)
+            sim_fail("client %d waits for %s but is not the waiting player", id, games[c->gameType].name);
+        if (c->state == CLIENT_TOURNAMENT && !c->tournament) sim_fail("client %d in a tournament it has no entry for", id);
+        if (c->fd >= 0) {
+            SimConn *conn = id < simLoop.capacity ? simLoop.byId[id] : NULL;
+            if (!conn || conn->fd != c->fd) sim_fail("client %d has fd %d, which has no connection", id, c->fd);
+            if (conn->outLen != c->outLen)
+                sim_fail("client %d counts %zu bytes queued, the transport holds %zu", id, c->outLen, conn->outLen);
+            if (c->closing && c->outLen == 0) sim_fail("client %d is closing with nothing queued but still open", id);
+        }
+        if (c->conn >= 0) {
+            Client *conn = &clients[c->conn];
+            if (conn->state == CLIENT_FREE || conn->channels[c->channel] - 1 != id)
+                sim_fail("channel client %d is not channel %d of client %d", id, c->channel, c->conn);
+        } else if (c->fd < 0 && !c->bot) {
+            sim_fail("client %d has neither a socket nor a connection", id);
+        }
+    }
+    if (playing != 2 * numSessions) sim_fail("%d clients playing in %d sessions", playing, numSessions);
+    if (spectating != spectators) sim_fail("%d clients spectating, sessions list %d", spectating, spectators);
+    if (watching != numLobbyWatchers || stale != numLobbyStale)
+        sim_fail("%d clients watch the lobby (%d stale), the list has %d (%d)", watching, stale, numLobbyWatchers, numLobbyStale);
+    if (live + numFreeClients != clientCapacity)
+        sim_fail("%d clients live and %d free of %d", live, numFreeClients, clientCapacity);
+    for (int g = 0; g < GAME_TYPE_COUNT; g++) {
+        int id = waitingPlayer[g];
+        if (id >= 0 && (id >= clientHigh || clients[id].state != CLIENT_WAITING || clients[id].gameType != g))
+            sim_fail("waiting player for %s is client %d in state %d", games[g].name, id, id < clientHigh ? clients[id].state : -1);
+    }
+    for (int i = 0; i < numConns; i++) {
+        SimConn *c = conns[i];
+        if (c->id >= 0 && (clients[c->id].state == CLIENT_FREE || clients[c->id].fd != c->fd))
+            sim_fail("connection %d is open, client %d is not", c->serial, c->id);
+    }
+}
+
+// One turn of the server's main loop, with the scheduler choosing what
+// the wait returns.
+static void sim_step(void) {
+    drop_broken_clients();
+    virtualNs += 1 + game_rng_range(&simRng, SIM_STEP_NS);
+    loopWakeNs = now_ns();
+    if (spawning && numConns < maxConns && (numConns == 0 || game_rng_range(&simRng, 10) == 0))
+        sim_connect(0);
+    else if (numConns > 0)
+        sim_event(conns[game_rng_range(&simRng, numConns)]);
+    lobby_poll(now_ms());
+    trace_enter(-1, -1);
+    drop_broken_clients();
+    sim_reap();
+    stats.steps++;
+    sim_check();
+}
+
+// Bracket tournaments driven straight through tournament.c. The server
+// plays only the configured format, and withdrawals that meet in a later
+// round are rare in a run, so every size up to SIM_BRACKET_MAX_PLAYERS
+// (odd ones give byes) is played with random results and withdrawals,
+// often of both players of a match (a double walkover).
+typedef struct {
+    int ids[SIM_BRACKET_MAX_PLAYERS * 2], a[SIM_BRACKET_MAX_PLAYERS * 2], b[SIM_BRACKET_MAX_PLAYERS * 2];
+    int numStarted;             // started and not yet reported, newest last
+    int messages;
+    int over[SIM_BRACKET_MAX_PLAYERS];
+    int finished;
+} SimBracket;
+
+static void sim_bracket_start(void *ctx, int matchId, int a, int b) {
+    SimBracket *sb = ctx;
+    if (sb->numStarted == SIM_BRACKET_MAX_PLAYERS * 2) sim_fail("bracket: too many matches running");
+    sb->ids[sb->numStarted] = matchId;
+    sb->a[sb->numStarted] = a;
+    sb->b[sb->numStarted++] = b;
+}
+
+static void sim_bracket_message(void *ctx, int participant, const char *msg) {
+    SimBracket *sb = ctx;
+    if (++sb->messages > SIM_BRACKET_MAX_MESSAGES) sim_fail("bracket: %d messages, last to player %d: %s", sb->messages, participant, msg);
+    if (strncmp(msg, "TOURNAMENT_OVER:", 16) == 0) sb->over[participant]++;
+}
+
+static void sim_bracket_finished(void *ctx) {
+    ((SimBracket *)ctx)->finished++;
+}
+
+static void sim_check_brackets(uint64_t seed) {
+    TournamentCallbacks callbacks = {sim_bracket_start, sim_bracket_message, sim_bracket_finished};
+    GameRng rng;
+    game_rng_seed(&rng, seed);
+    for (int n = 2; n <= SIM_BRACKET_MAX_PLAYERS; n++) {
+        for (int trial = 0; trial < SIM_BRACKET_TRIALS; trial++) {
+            SimBracket sb = {0};
+            int withdrawn[SIM_BRACKET_MAX_PLAYERS] = {0};
+            Tournament *t = tournament_create(TOURNAMENT_BRACKET, n, 0, &callbacks, &sb);
+            if (!t) sim_fail("bracket: out of memory");
+            tournament_start(t);
+            while (!tournament_is_over(t)) {
+                if (sb.numStarted == 0) sim_fail("bracket of %d: nothing running and not over", n);
+                int i = game_rng_range(&rng, sb.numStarted);
+                int id = sb.ids[i], a = sb.a[i], b = sb.b[i];
+                sb.numStarted--;
+                sb.ids[i] = sb.ids[sb.numStarted];
+                sb.a[i] = sb.a[sb.numStarted];
+                sb.b[i] = sb.b[sb.numStarted];
+                // Like the server: a player who leaves loses the match being played.
+                int result = (int)game_rng_range(&rng, 5) - 1;     // -1 (replayed), 0 or 1
+                uint32_t leave = game_rng_range(&rng, 8);
+                if (leave == 0 || leave == 2) withdrawn[a] = 1, result = 1, tournament_withdraw(t, a);
+                if (leave == 1 || leave == 2) withdrawn[b] = 1, result = 0, tournament_withdraw(t, b);
+                tournament_report(t, id, result);
+            }
+            if (sb.finished != 1) sim_fail("bracket of %d: finished %d times", n, sb.finished);
+            if (sb.numStarted != 0) sim_fail("bracket of %d: over with %d matches running", n, sb.numStarted);
+            for (int p = 0; p < n; p++)
+                if (sb.over[p] != !withdrawn[p]) sim_fail("bracket of %d: player %d told it is over %d times", n, p, sb.over[p]);
+            tournament_free(t);
+        }
+    }
+}
+
+// Starts the server afresh, so a run depends only on its seed.
+static void sim_reset(uint64_t seed) {
+    free(clients);
+    free(freeClientIds);
+    clients = NULL;
+    freeClientIds = NULL;
+    clientCapacity = clientHigh = numFreeClients = 0;
+    nextSessionId = 0;
+    for (int g = 0; g < GAME_TYPE_COUNT; g++) {
+        waitingPlayer[g] = -1;
+        if (tournamentLobby[g]) free(tournamentLobby[g]->players);
+        free(tournamentLobby[g]);
+        tournamentLobby[g] = NULL;
+    }
+    free(lobbyWatchers);
+    lobbyWatchers = NULL;
+    numLobbyWatchers = lobbyWatcherCapacity = numLobbyStale = 0;
+    memset(&lobbyPublished, 0, sizeof(lobbyPublished));
+    lobbySeq = 0;
+    lobbyFullLen = 0;
+    lobbyDirty = 1;
+    nextLobbyUpdate = 0;
+    free(simLoop.byId);
+    simLoop = (struct IoLoop){0};
+    connSerial = 0;
+    virtualNs = 1000000000LL;
+    runSeed = seed;
+    uint64_t x = seed;
+    game_rng_seed(&simRng, game_rng_splitmix(&x));
+    serverConfig.rngSeed = (int)(game_rng_splitmix(&x) & 0x7fffffff) | 1;
+    memset(&stats, 0, sizeof(stats));
+    if (player_stats_init(GAME_TYPE_COUNT, gameNames) != 0) sim_fail("out of memory for player stats");
+    snprintf(crashMsg, sizeof(crashMsg), "CRASH seed=%" PRIu64 ": repeat it with ./game_sim -s %" PRIu64 " -v\n", seed, seed);
+}
+
+static void sim_run(uint64_t seed, int sessions) {
+    sim_reset(seed);
+    sim_check_brackets(seed);
+    spawning = 1;
+    long long drainAt = 0, maxSteps = (long long)sessions * SIM_MAX_STEPS_PER_SESSION + 100000;
+    while (numConns > 0 || spawning) {
+        if (spawning && nextSessionId >= sessions) {
+            spawning = 0;
+            drainAt = virtualNs + SIM_DRAIN_NS;
+        }
+        if (!spawning && virtualNs >= drainAt) {
+            while (numConns > 0) {
+                sim_drop(conns[0], "run over");
+                drop_broken_clients();
+                sim_reap();
+            }
+            break;
+        }
+        sim_step();
+        if (stats.steps > maxSteps) sim_fail("no progress: %d sessions after %lld steps", nextSessionId, stats.steps);
+    }
+    drop_broken_clients();
+    sim_check();
+    if (numSessions || clientCapacity != numFreeClients) sim_fail("%d sessions and %d clients left after the run", numSessions, clientCapacity - numFreeClients);
+    for (int g = 0; g < GAME_TYPE_COUNT; g++)
+        if (waitingPlayer[g] >= 0 || (tournamentLobby[g] && tournamentLobby[g]->count > 0)) sim_fail("%s queue not empty after the run", games[g].name);
+}
+
+static void usage(const char *prog) {
+    printf("Usage: %s [-s seed] [-r runs] [-n sessions] [-c connections] [-f config] [-v]\n"
+           "  -s  seed of the first run (default: random, printed)\n"
+           "  -r  runs, with seeds seed, seed+1, ... (default 1)\n"
+           "  -n  sessions per run (default 2000)\n"
+           "  -c  connections open at once (default 64, at most %d)\n"
+           "  -f  configuration file (default %s)\n"
+           "  -v  print every event\n", prog, SIM_MAX_CONNS, SERVER_CONFIG_PATH);
+}
+
+int main(int argc, char **argv) {
+    uint64_t seed = game_rng_fresh_seed() % 1000000000;
+    int runs = 1, sessions = 2000;
+    const char *configPath = SERVER_CONFIG_PATH;
+    int opt;
+    while ((opt = getopt(argc, argv, "s:r:n:c:f:vh")) != -1) {
+        switch (opt) {
+            case 's': seed = strtoull(optarg, NULL, 10); break;
+            case 'r': runs = atoi(optarg); break;
+            case 'n': sessions = atoi(optarg); break;
+            case 'c': maxConns = atoi(optarg); break;
+            case 'f': configPath = optarg; break;
+            case 'v': verbose = 1; break;
+            default: usage(argv[0]); return opt == 'h' ? 0 : 2;
+        }
+    }
+    if (runs < 1 || sessions < 1 || maxConns < 2 || maxConns > SIM_MAX_CONNS) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    if (server_config_load(configPath) < 0) {
+        printf("Invalid configuration in %s\n", configPath);
+        return 2;
+    }
+    // The server's own logging would only slow the runs down; -v prints the events.
+    log_set_level(LOG_LEVEL_ERROR);
+    log_start();
+    char layoutError[128];
+    if (ttt_geometry_init(&tttGeometry, serverConfig.tttRows, serverConfig.tttCols, serverConfig.tttWinLength) != 0 ||
+        sl_layout_parse(&slLayout, serverConfig.slBoardSize, serverConfig.slSnakes, serverConfig.slLadders,
+                        layoutError, sizeof(layoutError)) != 0) {
+        printf("Invalid game settings in %s\n", configPath);
+        return 2;
+    }
+    tttBot = ttt_bot_create(&tttGeometry, TTT_BOT_TT_BITS);
+    if (!tttBot) {
+        printf("Out of memory for the Tic Tac Toe engine\n");
+        return 2;
+    }
+    build_sl_board_message();
+    if (wordle_dict_load(WORDLE_ANSWERS_PATH, WORDLE_ALLOWED_PATH) > 0 &&
+        wordle_solver_init(&wordleSolver, WORDLE_PRECOMPUTE_PATTERNS) == 0)
+        wordleSolverReady = 1;
+    for (int g = 0; g < GAME_TYPE_COUNT; g++) gameNames[g] = games[g].name;
+    metrics_init("game", gameNames, GAME_TYPE_COUNT);
+    // Bots are off: their worker threads would make runs depend on timing.
+    botPool = NULL;
+    ioLoop = &simLoop;
+    ioSendAsync = 1;
+    nullFd = open("/dev/null", O_RDWR | O_CLOEXEC);
+    if (nullFd < 0) {
+        printf("Cannot open /dev/null\n");
+        return 2;
+    }
+    signal(SIGSEGV, sim_crashed);
+    signal(SIGABRT, sim_crashed);
+    signal(SIGFPE, sim_crashed);
+    signal(SIGBUS, sim_crashed);
+
+    printf("seed=%" PRIu64 " runs=%d sessions=%d connections=%d\n", seed, runs, sessions, maxConns);
+    fflush(stdout);
+    SimStats total = {0};
+    long long totalSessions = 0, virtualTotal = 0;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int r = 0; r < runs; r++) {
+        sim_run(seed + r, sessions);
+        totalSessions += nextSessionId;
+        virtualTotal += virtualNs - 1000000000LL;
+        total.steps += stats.steps;
+        total.connects += stats.connects;
+        total.drops += stats.drops;
+        total.reconnects += stats.reconnects;
+        total.sendFailures += stats.sendFailures;
+        total.stalls += stats.stalls;
+        total.partialReads += stats.partialReads;
+        total.lines += stats.lines;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double wall = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("ok runs=%d sessions=%lld steps=%lld connects=%lld lines_out=%lld partial_reads=%lld drops=%lld reconnects=%lld "
+           "send_failures=%lld stalls=%lld virtual_s=%.1f wall_s=%.2f sessions_per_s=%.0f\n",
+           runs, totalSessions, total.steps, total.connects, total.lines, total.partialReads, total.drops, total.reconnects,
+           total.sendFailures, total.stalls, virtualTotal / 1e9, wall, totalSessions / wall);
+    return 0;
+}
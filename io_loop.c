@@ -0,0 +1,629 @@
+#include "io_loop.h"
+#include "logger.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#define EPOLL_EVENTS 256                // per epoll_wait
+#define URING_ENTRIES 4096              // submission queue; the completion queue is 4x
+#define URING_BUFFERS 1024              // provided receive buffers, a power of two
+#define URING_BUFFER_SIZE 4096
+#define URING_GROUP 0
+
+// io_uring user_data: the low 3 bits say what completed. A send carries a
+// pointer to its UringSend (8-byte aligned, so those bits are 0); a
+// receive carries the connection id and generation, a wake poll the
+// index of its fd.
+#define OP_SEND 0
+#define OP_ACCEPT 1
+#define OP_WAKE 2
+#define OP_RECV 3
+#define OP_CANCEL 4
+
+#define ID_LISTEN -1
+#define ID_WAKE -2
+
+typedef struct {
+    int id;
+    uint32_t gen;
+    char *buf;
+    size_t len, off;
+} UringSend;
+
+typedef struct {
+    int fd;                     // -1 when the id is not watched
+    uint32_t gen;               // tells a connection apart from a later one with the same id
+    int wantWrite;
+    // io_uring
+    UringSend *sending;         // in flight, at most one per connection to keep the order
+    char *staged;               // queued by io_loop_send since
+    size_t stagedLen, stagedCap;
+    int dirty;                  // in the dirty list
+} IoConn;
+
+typedef struct {
+    int fd;
+    unsigned *sqHead, *sqTail, *sqMask, *sqArray;
+    unsigned *cqHead, *cqTail, *cqMask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *ringMap;
+    size_t ringMapSize, sqesSize;
+    unsigned sqEntries, localTail, toSubmit;
+    struct io_uring_buf_ring *bufRing;
+    char *bufs;
+    size_t bufRingSize;
+} Uring;
+
+struct IoLoop {
+    IoBackend backend;
+    int listenFd;
+    int wakeFds[IO_MAX_WAKE_FDS];
+    int numWakeFds;
+    IoCallbacks cb;
+    void *ctx;
+    IoConn *conns;
+    int capacity;
+    int high;                   // ids below this have been watched
+    // poll
+    struct pollfd *pollFds;
+    int *pollIds;
+    int pollCapacity, numPollFds;
+    // epoll
+    int epollFd;
+    struct epoll_event events[EPOLL_EVENTS];
+    int numEvents;
+    // io_uring
+    Uring uring;
+    int *dirty;
+    int numDirty, dirtyCapacity;
+};
+
+static const char *backendNames[] = IO_BACKEND_NAMES;
+
+int io_loop_parse_backend(const char *name) {
+    for (int b = 0; b < IO_BACKEND_COUNT; b++)
+        if (strcmp(name, backendNames[b]) == 0) return b;
+    return -1;
+}
+
+IoBackend io_loop_backend(const IoLoop *loop) {
+    return loop->backend;
+}
+
+static int valid(IoLoop *loop, int id, uint32_t gen) {
+    return id >= 0 && id < loop->capacity && loop->conns[id].fd >= 0 && loop->conns[id].gen == gen;
+}
+
+// Accepts until the queue is empty, for the readiness backends.
+static void accept_all(IoLoop *loop) {
+    for (;;) {
+        int fd = accept(loop->listenFd, NULL, NULL);
+        if (fd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) LOG_ERROR("Accept failed...");
+            return;
+        }
+        loop->cb.accepted(loop->ctx, fd);
+    }
+}
+
+// epoll
+static uint64_t epoll_key(int id, uint32_t gen) {
+    return (uint64_t)gen << 32 | (uint32_t)id;
+}
+
+static int epoll_watch(IoLoop *loop, int op, int fd, uint32_t events, uint64_t key) {
+    struct epoll_event ev = {events, {.u64 = key}};
+    return epoll_ctl(loop->epollFd, op, fd, &ev);
+}
+
+static int epoll_start(IoLoop *loop) {
+    loop->epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (loop->epollFd < 0) return -1;
+    if (loop->listenFd >= 0 && epoll_watch(loop, EPOLL_CTL_ADD, loop->listenFd, EPOLLIN, epoll_key(ID_LISTEN, 0)) != 0) {
+        close(loop->epollFd);
+        return -1;
+    }
+    return 0;
+}
+
+static void epoll_dispatch(IoLoop *loop) {
+    for (int i = 0; i < loop->numEvents; i++) {
+        struct epoll_event *ev = &loop->events[i];
+        int id = (int32_t)(uint32_t)ev->data.u64;
+        if (id == ID_LISTEN) accept_all(loop);
+        else if (id == ID_WAKE) {
+            int fd = loop->wakeFds[ev->data.u64 >> 32];
+            if (fd >= 0) loop->cb.wake(loop->ctx, fd);
+        }
+        else if (valid(loop, id, ev->data.u64 >> 32))
+            loop->cb.ready(loop->ctx, id, (ev->events & EPOLLOUT ? IO_WRITE : 0) |
+                                          (ev->events & (EPOLLIN | EPOLLHUP | EPOLLERR) ? IO_READ : 0));
+    }
+    loop->numEvents = 0;
+}
+
+// poll: the descriptor set is rebuilt on every wait.
+static int poll_wait(IoLoop *loop, int timeoutMs) {
+    if (loop->pollCapacity < loop->high + 1 + IO_MAX_WAKE_FDS) {
+        int capacity = loop->capacity + 1 + IO_MAX_WAKE_FDS;
+        struct pollfd *fds = realloc(loop->pollFds, capacity * sizeof(struct pollfd));
+        if (fds) loop->pollFds = fds;
+        int *ids = realloc(loop->pollIds, capacity * sizeof(int));
+        if (ids) loop->pollIds = ids;
+        if (!fds || !ids) {
+            errno = ENOMEM;
+            return -1;
+        }
+        loop->pollCapacity = capacity;
+    }
+    int n = 0;
+    loop->pollFds[n++] = (struct pollfd){loop->listenFd, POLLIN, 0};
+    for (int i = 0; i < loop->numWakeFds; i++) loop->pollFds[n++] = (struct pollfd){loop->wakeFds[i], POLLIN, 0};
+    for (int id = 0; id < loop->high; id++) {
+        IoConn *c = &loop->conns[id];
+        if (c->fd < 0) continue;
+        loop->pollIds[n] = id;
+        loop->pollFds[n++] = (struct pollfd){c->fd, POLLIN | (c->wantWrite ? POLLOUT : 0), 0};
+    }
+    loop->numPollFds = 0;
+    int ready = poll(loop->pollFds, n, timeoutMs);
+    if (ready >= 0) loop->numPollFds = n;
+    return ready;
+}
+
+static void poll_dispatch(IoLoop *loop) {
+    struct pollfd *fds = loop->pollFds;
+    for (int k = 1 + loop->numWakeFds; k < loop->numPollFds; k++) {
+        int id = loop->pollIds[k];
+        if (!fds[k].revents || loop->conns[id].fd != fds[k].fd) continue;
+        loop->cb.ready(loop->ctx, id, (fds[k].revents & POLLOUT ? IO_WRITE : 0) |
+                                      (fds[k].revents & (POLLIN | POLLHUP | POLLERR) ? IO_READ : 0));
+    }
+    if (fds[0].revents & POLLIN) accept_all(loop);
+    for (int i = 0; i < loop->numWakeFds; i++)
+        if ((fds[1 + i].revents & POLLIN) && loop->wakeFds[i] >= 0) loop->cb.wake(loop->ctx, loop->wakeFds[i]);
+    loop->numPollFds = 0;
+}
+
+// io_uring, through the raw system calls.
+static int uring_enter(Uring *u, int wait, int timeoutMs) {
+    __atomic_store_n(u->sqTail, u->localTail, __ATOMIC_RELEASE);
+    unsigned flags = wait ? IORING_ENTER_GETEVENTS : 0;
+    struct __kernel_timespec ts;
+    struct io_uring_getevents_arg arg = {0};
+    if (wait && timeoutMs >= 0) {
+        ts.tv_sec = timeoutMs / 1000;
+        ts.tv_nsec = (long long)(timeoutMs % 1000) * 1000000;
+        arg.ts = (uint64_t)(uintptr_t)&ts;
+        flags |= IORING_ENTER_EXT_ARG;
+    }
+    int ret = syscall(__NR_io_uring_enter, u->fd, u->toSubmit, wait ? 1 : 0, flags,
+                      flags & IORING_ENTER_EXT_ARG ? &arg : NULL, sizeof(arg));
+    if (ret >= 0) u->toSubmit -= ret;
+    else if (errno == ETIME) ret = 0;
+    return ret;
+}
+
+// The next free submission entry, cleared; submits first if the queue is full.
+static struct io_uring_sqe *uring_sqe(Uring *u) {
+    if (u->localTail - __atomic_load_n(u->sqHead, __ATOMIC_ACQUIRE) == u->sqEntries) {
+        uring_enter(u, 0, 0);
+        if (u->localTail - __atomic_load_n(u->sqHead, __ATOMIC_ACQUIRE) == u->sqEntries) return NULL;
+    }
+    unsigned index = u->localTail & *u->sqMask;
+    struct io_uring_sqe *sqe = &u->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    u->sqArray[index] = index;
+    u->localTail++;
+    u->toSubmit++;
+    return sqe;
+}
+
+static void uring_recycle(Uring *u, unsigned bid) {
+    unsigned short tail = u->bufRing->tail;
+    struct io_uring_buf *buf = &u->bufRing->bufs[tail & (URING_BUFFERS - 1)];
+    buf->addr = (uint64_t)(uintptr_t)(u->bufs + (size_t)bid * URING_BUFFER_SIZE);
+    buf->len = URING_BUFFER_SIZE;
+    buf->bid = bid;
+    __atomic_store_n(&u->bufRing->tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+static void uring_arm_accept(IoLoop *loop) {
+    struct io_uring_sqe *sqe = uring_sqe(&loop->uring);
+    if (!sqe) return;
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = loop->listenFd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_CLOEXEC;
+    sqe->user_data = OP_ACCEPT;
+}
+
+static int uring_arm_wake(IoLoop *loop, int i) {
+    struct io_uring_sqe *sqe = uring_sqe(&loop->uring);
+    if (!sqe) return -1;
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = loop->wakeFds[i];
+    sqe->len = IORING_POLL_ADD_MULTI;
+    sqe->poll32_events = POLLIN;
+    sqe->user_data = (uint64_t)i << 3 | OP_WAKE;
+    return 0;
+}
+
+static uint64_t recv_key(int id, uint32_t gen) {
+    return (uint64_t)gen << 32 | (uint64_t)id << 3 | OP_RECV;
+}
+
+static int uring_arm_recv(IoLoop *loop, int id) {
+    struct io_uring_sqe *sqe = uring_sqe(&loop->uring);
+    if (!sqe) return -1;
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = loop->conns[id].fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = URING_GROUP;
+    sqe->user_data = recv_key(id, loop->conns[id].gen);
+    return 0;
+}
+
+static void uring_submit_send(IoLoop *loop, UringSend *op) {
+    struct io_uring_sqe *sqe = uring_sqe(&loop->uring);
+    if (!sqe) {
+        // Nothing left to retry with; the connection is lost.
+        int id = op->id;
+        loop->conns[id].sending = NULL;
+        free(op->buf);
+        free(op);
+        loop->cb.sent(loop->ctx, id, -1);
+        return;
+    }
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = loop->conns[op->id].fd;
+    sqe->addr = (uint64_t)(uintptr_t)(op->buf + op->off);
+    sqe->len = op->len - op->off;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = (uint64_t)(uintptr_t)op;
+}
+
+// Everything staged for id goes out as one send.
+static void uring_start_send(IoLoop *loop, int id) {
+    IoConn *c = &loop->conns[id];
+    if (c->sending || c->stagedLen == 0) return;
+    UringSend *op = malloc(sizeof(UringSend));
+    if (!op) {
+        loop->cb.sent(loop->ctx, id, -1);
+        return;
+    }
+    *op = (UringSend){id, c->gen, c->staged, c->stagedLen, 0};
+    c->staged = NULL;
+    c->stagedLen = c->stagedCap = 0;
+    c->sending = op;
+    uring_submit_send(loop, op);
+}
+
+static void uring_sent(IoLoop *loop, UringSend *op, int res) {
+    int live = valid(loop, op->id, op->gen);
+    if (res == -EAGAIN || res == -EINTR) {
+        if (live) {
+            uring_submit_send(loop, op);
+            return;
+        }
+    } else if (res >= 0 && live) {
+        op->off += res;
+        loop->cb.sent(loop->ctx, op->id, res);
+        if (op->off < op->len && valid(loop, op->id, op->gen)) {
+            uring_submit_send(loop, op);
+            return;
+        }
+    } else if (live) {
+        loop->cb.sent(loop->ctx, op->id, -1);
+    }
+    if (valid(loop, op->id, op->gen)) {
+        loop->conns[op->id].sending = NULL;
+        uring_start_send(loop, op->id);
+    }
+    free(op->buf);
+    free(op);
+}
+
+static void uring_received(IoLoop *loop, const struct io_uring_cqe *cqe) {
+    Uring *u = &loop->uring;
+    int id = (cqe->user_data >> 3) & 0x1fffffff;
+    uint32_t gen = cqe->user_data >> 32;
+    if (cqe->res > 0 && valid(loop, id, gen)) {
+        unsigned bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+        loop->cb.received(loop->ctx, id, u->bufs + (size_t)bid * URING_BUFFER_SIZE, cqe->res);
+    }
+    if (cqe->flags & IORING_CQE_F_BUFFER) uring_recycle(u, cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+    if ((cqe->flags & IORING_CQE_F_MORE) || !valid(loop, id, gen)) return;
+    // The multishot receive ended: out of buffers, or the connection is done.
+    if (cqe->res > 0 || cqe->res == -ENOBUFS || cqe->res == -EAGAIN || cqe->res == -EINTR) {
+        if (uring_arm_recv(loop, id) == 0) return;
+    }
+    loop->cb.received(loop->ctx, id, NULL, 0);
+}
+
+static void uring_dispatch(IoLoop *loop) {
+    Uring *u = &loop->uring;
+    unsigned head = *u->cqHead;
+    while (head != __atomic_load_n(u->cqTail, __ATOMIC_ACQUIRE)) {
+        struct io_uring_cqe cqe = u->cqes[head & *u->cqMask];
+        __atomic_store_n(u->cqHead, ++head, __ATOMIC_RELEASE);
+        switch (cqe.user_data & 7) {
+            case OP_SEND:
+                uring_sent(loop, (UringSend *)(uintptr_t)cqe.user_data, cqe.res);
+                break;
+            case OP_ACCEPT:
+                if (cqe.res >= 0) loop->cb.accepted(loop->ctx, cqe.res);
+                else if (cqe.res != -EAGAIN && cqe.res != -EINTR) LOG_ERROR("Accept failed...");
+                if (!(cqe.flags & IORING_CQE_F_MORE)) uring_arm_accept(loop);
+                break;
+            case OP_WAKE: {
+                int i = cqe.user_data >> 3;
+                if (loop->wakeFds[i] < 0) break;        // removed
+                loop->cb.wake(loop->ctx, loop->wakeFds[i]);
+                if (!(cqe.flags & IORING_CQE_F_MORE) && loop->wakeFds[i] >= 0) uring_arm_wake(loop, i);
+                break;
+            }
+            case OP_RECV:
+                uring_received(loop, &cqe);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+static void uring_free(Uring *u) {
+    if (u->bufs) munmap(u->bufs, (size_t)URING_BUFFERS * URING_BUFFER_SIZE);
+    if (u->bufRing) munmap(u->bufRing, u->bufRingSize);
+    if (u->sqes) munmap(u->sqes, u->sqesSize);
+    if (u->ringMap) munmap(u->ringMap, u->ringMapSize);
+    if (u->fd >= 0) close(u->fd);
+}
+
+static int uring_start(IoLoop *loop) {
+    Uring *u = &loop->uring;
+    memset(u, 0, sizeof(*u));
+    // Deferred task running needs 6.1; older kernels get the plain ring.
+    const unsigned flagSets[] = {
+        IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN | IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN,
+        IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN, 0};
+    struct io_uring_params p;
+    u->fd = -1;
+    for (size_t i = 0; i < sizeof(flagSets) / sizeof(flagSets[0]) && u->fd < 0; i++) {
+        memset(&p, 0, sizeof(p));
+        p.flags = flagSets[i] | IORING_SETUP_CQSIZE;
+        p.cq_entries = URING_ENTRIES * 4;
+        u->fd = syscall(__NR_io_uring_setup, URING_ENTRIES, &p);
+    }
+    if (u->fd < 0) return -1;
+    if (!(p.features & IORING_FEAT_SINGLE_MMAP) || !(p.features & IORING_FEAT_EXT_ARG) ||
+        !(p.features & IORING_FEAT_NODROP))
+        goto fail;
+
+    size_t sqSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    size_t cqSize = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    u->ringMapSize = sqSize > cqSize ? sqSize : cqSize;
+    u->ringMap = mmap(NULL, u->ringMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_SQ_RING);
+    u->sqesSize = p.sq_entries * sizeof(struct io_uring_sqe);
+    u->sqes = mmap(NULL, u->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_SQES);
+    if (u->ringMap == MAP_FAILED || u->sqes == MAP_FAILED) {
+        if (u->ringMap == MAP_FAILED) u->ringMap = NULL;
+        if (u->sqes == MAP_FAILED) u->sqes = NULL;
+        goto fail;
+    }
+    char *ring = u->ringMap;
+    u->sqHead = (unsigned *)(ring + p.sq_off.head);
+    u->sqTail = (unsigned *)(ring + p.sq_off.tail);
+    u->sqMask = (unsigned *)(ring + p.sq_off.ring_mask);
+    u->sqArray = (unsigned *)(ring + p.sq_off.array);
+    u->cqHead = (unsigned *)(ring + p.cq_off.head);
+    u->cqTail = (unsigned *)(ring + p.cq_off.tail);
+    u->cqMask = (unsigned *)(ring + p.cq_off.ring_mask);
+    u->cqes = (struct io_uring_cqe *)(ring + p.cq_off.cqes);
+    u->sqEntries = p.sq_entries;
+    u->localTail = *u->sqTail;
+
+    // The receive buffer pool, shared by all connections.
+    u->bufRingSize = URING_BUFFERS * sizeof(struct io_uring_buf);
+    u->bufRing = mmap(NULL, u->bufRingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    u->bufs = mmap(NULL, (size_t)URING_BUFFERS * URING_BUFFER_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (u->bufRing == MAP_FAILED || u->bufs == MAP_FAILED) {
+        if (u->bufRing == MAP_FAILED) u->bufRing = NULL;
+        if (u->bufs == MAP_FAILED) u->bufs = NULL;
+        goto fail;
+    }
+    struct io_uring_buf_reg reg = {.ring_addr = (uint64_t)(uintptr_t)u->bufRing, .ring_entries = URING_BUFFERS, .bgid = URING_GROUP};
+    if (syscall(__NR_io_uring_register, u->fd, IORING_REGISTER_PBUF_RING, &reg, 1) != 0) goto fail;
+    for (unsigned bid = 0; bid < URING_BUFFERS; bid++) uring_recycle(u, bid);
+
+    if (loop->listenFd >= 0) uring_arm_accept(loop);
+    if (uring_enter(u, 0, 0) < 0) goto fail;
+    return 0;
+fail:
+    uring_free(u);
+    return -1;
+}
+
+IoLoop *io_loop_create(IoBackend backend, int listenFd, int wakeFd, const IoCallbacks *callbacks, void *ctx) {
+    IoLoop *loop = calloc(1, sizeof(IoLoop));
+    if (!loop) return NULL;
+    loop->listenFd = listenFd;
+    loop->cb = *callbacks;
+    loop->ctx = ctx;
+    loop->epollFd = -1;
+    loop->uring.fd = -1;
+    for (int b = backend; b >= IO_POLL; b--) {
+        if (b == IO_URING && uring_start(loop) != 0) continue;
+        if (b == IO_EPOLL && epoll_start(loop) != 0) continue;
+        if (b != (int)backend) LOG_WARN("%s unavailable, using %s", backendNames[backend], backendNames[b]);
+        loop->backend = b;
+        if (wakeFd >= 0 && io_loop_add_wake(loop, wakeFd) != 0) break;
+        return loop;
+    }
+    io_loop_free(loop);
+    return NULL;
+}
+
+int io_loop_add_wake(IoLoop *loop, int fd) {
+    if (loop->numWakeFds == IO_MAX_WAKE_FDS) return -1;
+    int i = loop->numWakeFds;
+    loop->wakeFds[i] = fd;
+    int ok = 0;
+    if (loop->backend == IO_EPOLL) ok = epoll_watch(loop, EPOLL_CTL_ADD, fd, EPOLLIN, epoll_key(ID_WAKE, i));
+    else if (loop->backend == IO_URING) ok = uring_arm_wake(loop, i);
+    if (ok == 0) loop->numWakeFds++;
+    return ok;
+}
+
+void io_loop_remove_wake(IoLoop *loop, int fd) {
+    for (int i = 0; i < loop->numWakeFds; i++) {
+        if (loop->wakeFds[i] != fd) continue;
+        if (loop->backend == IO_EPOLL) {
+            epoll_ctl(loop->epollFd, EPOLL_CTL_DEL, fd, NULL);
+        } else if (loop->backend == IO_URING) {
+            struct io_uring_sqe *sqe = uring_sqe(&loop->uring);
+            if (sqe) {
+                sqe->opcode = IORING_OP_POLL_REMOVE;
+                sqe->addr = (uint64_t)i << 3 | OP_WAKE;
+                sqe->user_data = OP_CANCEL;
+            }
+        }
+        // The slot is not reused: a poll being cancelled may still complete.
+        loop->wakeFds[i] = -1;
+    }
+}
+
+void io_loop_free(IoLoop *loop) {
+    if (!loop) return;
+    for (int id = 0; id < loop->high; id++) {
+        free(loop->conns[id].staged);
+        if (loop->conns[id].sending) free(loop->conns[id].sending->buf);
+        free(loop->conns[id].sending);
+    }
+    if (loop->epollFd >= 0) close(loop->epollFd);
+    if (loop->backend == IO_URING) uring_free(&loop->uring);
+    free(loop->conns);
+    free(loop->pollFds);
+    free(loop->pollIds);
+    free(loop->dirty);
+    free(loop);
+}
+
+int io_loop_add(IoLoop *loop, int id, int fd) {
+    if (id >= loop->capacity) {
+        int capacity = loop->capacity ? loop->capacity : 64;
+        while (capacity <= id) capacity *= 2;
+        IoConn *grown = realloc(loop->conns, capacity * sizeof(IoConn));
+        if (!grown) return -1;
+        memset(grown + loop->capacity, 0, (capacity - loop->capacity) * sizeof(IoConn));
+        for (int i = loop->capacity; i < capacity; i++) grown[i].fd = -1;
+        loop->conns = grown;
+        loop->capacity = capacity;
+    }
+    IoConn *c = &loop->conns[id];
+    c->fd = fd;
+    c->gen++;
+    c->wantWrite = 0;
+    if (id >= loop->high) loop->high = id + 1;
+    int ok = 0;
+    if (loop->backend == IO_EPOLL) ok = epoll_watch(loop, EPOLL_CTL_ADD, fd, EPOLLIN, epoll_key(id, c->gen));
+    else if (loop->backend == IO_URING) ok = uring_arm_recv(loop, id);
+    if (ok != 0) c->fd = -1;
+    return ok;
+}
+
+void io_loop_remove(IoLoop *loop, int id) {
+    if (id >= loop->capacity || loop->conns[id].fd < 0) return;
+    IoConn *c = &loop->conns[id];
+    if (loop->backend == IO_EPOLL) {
+        epoll_ctl(loop->epollFd, EPOLL_CTL_DEL, c->fd, NULL);
+    } else if (loop->backend == IO_URING) {
+        // The receive holds the socket open until it is cancelled. A send
+        // in flight finishes and is then freed.
+        struct io_uring_sqe *sqe = uring_sqe(&loop->uring);
+        if (sqe) {
+            sqe->opcode = IORING_OP_ASYNC_CANCEL;
+            sqe->addr = recv_key(id, c->gen);
+            sqe->user_data = OP_CANCEL;
+        }
+        free(c->staged);
+        c->staged = NULL;
+        c->stagedLen = c->stagedCap = 0;
+        c->sending = NULL;
+    }
+    c->fd = -1;
+}
+
+void io_loop_want_write(IoLoop *loop, int id, int on) {
+    IoConn *c = &loop->conns[id];
+    if (c->fd < 0 || c->wantWrite == on) return;
+    c->wantWrite = on;
+    if (loop->backend == IO_EPOLL)
+        epoll_watch(loop, EPOLL_CTL_MOD, c->fd, EPOLLIN | (on ? EPOLLOUT : 0), epoll_key(id, c->gen));
+}
+
+int io_loop_send(IoLoop *loop, int id, const char *data, size_t len) {
+    IoConn *c = &loop->conns[id];
+    if (c->stagedLen + len > c->stagedCap) {
+        size_t cap = c->stagedCap ? c->stagedCap : URING_BUFFER_SIZE;
+        while (cap < c->stagedLen + len) cap *= 2;
+        char *grown = realloc(c->staged, cap);
+        if (!grown) return -1;
+        c->staged = grown;
+        c->stagedCap = cap;
+    }
+    memcpy(c->staged + c->stagedLen, data, len);
+    c->stagedLen += len;
+    // Sends wait for the end of the tick, so one goes out per connection.
+    if (!c->sending && !c->dirty) {
+        if (loop->numDirty == loop->dirtyCapacity) {
+            int capacity = loop->dirtyCapacity ? loop->dirtyCapacity * 2 : 64;
+            int *grownDirty = realloc(loop->dirty, capacity * sizeof(int));
+            if (!grownDirty) return -1;
+            loop->dirty = grownDirty;
+            loop->dirtyCapacity = capacity;
+        }
+        loop->dirty[loop->numDirty++] = id;
+        c->dirty = 1;
+    }
+    return 0;
+}
+
+int io_loop_wait(IoLoop *loop, int timeoutMs) {
+    switch (loop->backend) {
+        case IO_EPOLL:
+            loop->numEvents = epoll_wait(loop->epollFd, loop->events, EPOLL_EVENTS, timeoutMs);
+            if (loop->numEvents >= 0) return loop->numEvents;
+            loop->numEvents = 0;
+            return -1;
+        case IO_URING:
+            for (int i = 0; i < loop->numDirty; i++) {
+                int id = loop->dirty[i];
+                loop->conns[id].dirty = 0;
+                if (loop->conns[id].fd >= 0) uring_start_send(loop, id);
+            }
+            loop->numDirty = 0;
+            return uring_enter(&loop->uring, 1, timeoutMs);
+        default:
+            return poll_wait(loop, timeoutMs);
+    }
+}
+
+void io_loop_dispatch(IoLoop *loop) {
+    switch (loop->backend) {
+        case IO_EPOLL: epoll_dispatch(loop); break;
+        case IO_URING: uring_dispatch(loop); break;
+        default: poll_dispatch(loop); break;
+    }
+}
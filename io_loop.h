@@ -0,0 +1,65 @@
+#ifndef IO_LOOP_H
+#define IO_LOOP_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+// The server's event loop: the listening socket, the client sockets and a
+// wake fd, behind one interface with three backends. poll and epoll report
+// readiness and the server reads and writes the sockets itself. io_uring
+// keeps a multishot accept and a multishot receive per connection armed,
+// receiving into buffers the kernel takes from a shared pool, and sends
+// what io_loop_send staged; one io_uring_enter per tick submits all of it
+// and collects the completions.
+typedef enum { IO_POLL, IO_EPOLL, IO_URING, IO_BACKEND_COUNT } IoBackend;
+
+#define IO_BACKEND_NAMES {"poll", "epoll", "io_uring"}
+
+#define IO_MAX_WAKE_FDS 4
+
+#define IO_READ 1
+#define IO_WRITE 2
+
+typedef struct {
+    void (*accepted)(void *ctx, int fd);        // a new connection, added with io_loop_add if wanted
+    void (*wake)(void *ctx, int fd);            // a wake fd is readable
+    // poll and epoll: the socket is readable (or closed) and/or writable
+    void (*ready)(void *ctx, int id, int events);
+    // io_uring: bytes read from the socket; len 0 when the peer closed or the read failed
+    void (*received)(void *ctx, int id, const char *data, size_t len);
+    // io_uring: len bytes of what io_loop_send staged went out; -1 when the send failed
+    void (*sent)(void *ctx, int id, ssize_t len);
+} IoCallbacks;
+
+typedef struct IoLoop IoLoop;
+
+// Starts the backend asked for or, if it is unavailable here, the best one
+// before it (io_uring, then epoll, then poll). listenFd is non-blocking,
+// or -1 when connections come from elsewhere; wakeFd may be -1. Returns
+// NULL when none starts.
+IoLoop *io_loop_create(IoBackend backend, int listenFd, int wakeFd, const IoCallbacks *callbacks, void *ctx);
+void io_loop_free(IoLoop *loop);
+IoBackend io_loop_backend(const IoLoop *loop);
+int io_loop_parse_backend(const char *name);     // -1 if unknown
+
+// Also calls wake when fd is readable, like the wakeFd given at creation
+// (up to IO_MAX_WAKE_FDS in all). The callback reads fd itself.
+int io_loop_add_wake(IoLoop *loop, int fd);
+// Stops watching fd; call before closing it. Its slot is not reused.
+void io_loop_remove_wake(IoLoop *loop, int fd);
+// Watches fd as connection id. Remove it before closing fd.
+int io_loop_add(IoLoop *loop, int id, int fd);
+void io_loop_remove(IoLoop *loop, int id);
+// poll and epoll: also report when id's socket can take more output.
+void io_loop_want_write(IoLoop *loop, int id, int on);
+// io_uring: queues a copy of data for id, sent in order with what was
+// queued before. Returns -1 if out of memory.
+int io_loop_send(IoLoop *loop, int id, const char *data, size_t len);
+
+// Submits queued work and waits up to timeoutMs (-1 = no limit) for
+// events. Returns -1 with errno set on failure (EINTR included).
+int io_loop_wait(IoLoop *loop, int timeoutMs);
+// Runs the callbacks for what the last wait returned.
+void io_loop_dispatch(IoLoop *loop);
+
+#endif
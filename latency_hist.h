@@ -0,0 +1,72 @@
+#ifndef LATENCY_HIST_H
+#define LATENCY_HIST_H
+
+#include <stdint.h>
+#include <string.h>
+
+// Log-linear latency histogram in the style of HdrHistogram: every power of
+// two is split into LATENCY_HIST_SUB linear buckets, so any recorded value
+// is reported within about 3% while the whole table stays a few KB.
+// Values are in nanoseconds and anything past ~18 minutes is clamped.
+#define LATENCY_HIST_SUB_BITS 5
+#define LATENCY_HIST_SUB (1 << LATENCY_HIST_SUB_BITS)
+#define LATENCY_HIST_MAX_BITS 40
+#define LATENCY_HIST_BUCKETS ((LATENCY_HIST_MAX_BITS - LATENCY_HIST_SUB_BITS + 1) * LATENCY_HIST_SUB)
+
+typedef struct {
+    uint64_t counts[LATENCY_HIST_BUCKETS];
+    uint64_t total;
+    uint64_t sum;
+    uint64_t max;
+} LatencyHist;
+
+static inline int latency_hist_bucket(uint64_t value) {
+    if (value >= (1ull << LATENCY_HIST_MAX_BITS)) value = (1ull << LATENCY_HIST_MAX_BITS) - 1;
+    if (value < LATENCY_HIST_SUB) return (int)value;
+    int shift = 63 - __builtin_clzll(value) - LATENCY_HIST_SUB_BITS;
+    return shift * LATENCY_HIST_SUB + (int)(value >> shift);
+}
+
+// Largest value that lands in the bucket.
+static inline uint64_t latency_hist_bucket_value(int bucket) {
+    if (bucket < 2 * LATENCY_HIST_SUB) return (uint64_t)bucket;
+    int shift = bucket / LATENCY_HIST_SUB - 1;
+    uint64_t mantissa = (uint64_t)(bucket - shift * LATENCY_HIST_SUB);
+    return ((mantissa + 1) << shift) - 1;
+}
+
+static inline void latency_hist_reset(LatencyHist *h) {
+    memset(h, 0, sizeof(*h));
+}
+
+static inline void latency_hist_record(LatencyHist *h, uint64_t value) {
+    h->counts[latency_hist_bucket(value)]++;
+    h->total++;
+    h->sum += value;
+    if (value > h->max) h->max = value;
+}
+
+static inline void latency_hist_merge(LatencyHist *into, const LatencyHist *from) {
+    for (int i = 0; i < LATENCY_HIST_BUCKETS; i++) into->counts[i] += from->counts[i];
+    into->total += from->total;
+    into->sum += from->sum;
+    if (from->max > into->max) into->max = from->max;
+}
+
+// Value at or below which the given fraction (0..1) of samples fall.
+static inline uint64_t latency_hist_percentile(const LatencyHist *h, double fraction) {
+    if (h->total == 0) return 0;
+    uint64_t rank = (uint64_t)(fraction * h->total + 0.5);
+    if (rank < 1) rank = 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < LATENCY_HIST_BUCKETS; i++) {
+        seen += h->counts[i];
+        if (seen >= rank) {
+            uint64_t value = latency_hist_bucket_value(i);
+            return value < h->max ? value : h->max;
+        }
+    }
+    return h->max;
+}
+
+#endif
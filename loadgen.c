@@ -0,0 +1,513 @@
+// Headless load generator: opens many connections from one process and
+// plays every game with scripted players over the normal client protocol.
+// Usage: ./loadgen [-H host] [-p port] [-c connections] [-r connects_per_sec]
+//                  [-d seconds] [-g games] [-k think_ms] [-m max_moves]
+//                  [-w words_file] [-s seed]
+// games is a comma-separated list (WORDLE,CHESS,SNAKE_LADDER,TIC_TAC_TOE,
+// ROCK_PAPER_SCISSOR) or "all". Each connection plays one game; when it
+// closes a new one takes its place until the run ends.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include "game_rng.h"
+#include "latency_hist.h"
+
+#define PORT 8081
+#define CONN_INPUT_SIZE 16384
+#define CONN_OUTPUT_SIZE 256
+#define REPORT_INTERVAL_MS 5000
+#define MAX_WORDS 4096
+#define MAX_GAMES 5
+
+typedef enum { WORDLE, CHESS, SNAKE_LADDER, TIC_TAC_TOE, ROCK_PAPER_SCISSOR } GameType;
+
+const char *gameNames[MAX_GAMES] = {"WORDLE", "CHESS", "SNAKE_LADDER", "TIC_TAC_TOE", "ROCK_PAPER_SCISSOR"};
+const char *rpsMoveNames[] = {"STONE", "PAPER", "SCISSORS"};
+const char *fallbackWords[] = {"APPLE", "GRAPE", "MANGO", "BERRY", "LEMON", "WATER", "ORBIT"};
+
+typedef enum { CONN_FREE, CONN_CONNECTING, CONN_SELECTING, CONN_WAITING, CONN_PLAYING } ConnState;
+
+typedef struct {
+    int fd;
+    ConnState state;
+    GameType game;
+    long long startedAt;        // connect() or GAME: sent, for the connect and match latencies
+    long long moveSentAt;       // 0 unless a move is waiting for the server's answer
+    long long replyDue;         // think time: when the queued reply goes out
+    int replyTimed;             // whether the queued reply counts towards turn latency
+    int moves;
+    char reply[64];
+    char in[CONN_INPUT_SIZE];
+    int inLen;
+    char out[CONN_OUTPUT_SIZE];
+    int outLen;
+    // Game state the scripts need
+    char color;                 // chess: 'W' or 'B'
+    char board[8][8][4];        // chess piece ids, "" for empty
+    int tttMaxRow, tttMaxCol;
+    int rpsOpponentLocked;
+} Conn;
+
+typedef struct {
+    const char *host;
+    int port;
+    int connections;
+    int rate;
+    int seconds;
+    int thinkMs;
+    int maxMoves;
+    int games[MAX_GAMES];
+    int numGames;
+    const char *wordsPath;
+    uint64_t seed;
+} LoadConfig;
+
+LoadConfig cfg = {"127.0.0.1", PORT, 1000, 200, 30, 0, 400, {0}, 0, "data/wordle_answers.txt", 0};
+Conn *conns;
+struct pollfd *pollfds;
+int *pollConn;
+GameRng rng;
+char (*words)[6];
+int numWords;
+struct sockaddr_in serverAddr;
+
+// Counters
+long long attempts, opened, connectFailed, finished, aborted, dropped, nextGame;
+long long bytesIn, bytesOut, movesSent;
+LatencyHist connectHist, matchHist, turnHist;
+
+long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+void raise_fd_limit(void) {
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+}
+
+int set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags < 0 ? -1 : fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+void load_words(const char *path) {
+    words = malloc(MAX_WORDS * sizeof(*words));
+    FILE *fp = fopen(path, "r");
+    char line[64];
+    while (fp && numWords < MAX_WORDS && fgets(line, sizeof(line), fp)) {
+        if (strlen(line) < 5) continue;
+        memcpy(words[numWords], line, 5);
+        words[numWords++][5] = '\0';
+    }
+    if (fp) fclose(fp);
+    if (numWords > 0) return;
+    printf("No word list at %s, using %d built-in words\n", path, (int)(sizeof(fallbackWords) / sizeof(*fallbackWords)));
+    for (; numWords < (int)(sizeof(fallbackWords) / sizeof(*fallbackWords)); numWords++) strcpy(words[numWords], fallbackWords[numWords]);
+}
+
+int parse_games(char *list) {
+    if (strcasecmp(list, "all") == 0) {
+        for (int g = 0; g < MAX_GAMES; g++) cfg.games[g] = g;
+        cfg.numGames = MAX_GAMES;
+        return 0;
+    }
+    cfg.numGames = 0;
+    for (char *name = strtok(list, ","); name; name = strtok(NULL, ",")) {
+        int g = 0;
+        while (g < MAX_GAMES && strcasecmp(name, gameNames[g]) != 0) g++;
+        if (g == MAX_GAMES || cfg.numGames == MAX_GAMES) return -1;
+        cfg.games[cfg.numGames++] = g;
+    }
+    return cfg.numGames > 0 ? 0 : -1;
+}
+
+// Connections
+void conn_flush(Conn *c) {
+    while (c->outLen > 0) {
+        ssize_t n = send(c->fd, c->out, c->outLen, MSG_NOSIGNAL);
+        if (n <= 0) return;
+        bytesOut += n;
+        memmove(c->out, c->out + n, c->outLen - n);
+        c->outLen -= n;
+    }
+}
+
+void conn_send(Conn *c, const char *line) {
+    int len = strlen(line);
+    if (c->outLen + len > CONN_OUTPUT_SIZE) return;
+    memcpy(c->out + c->outLen, line, len);
+    c->outLen += len;
+    conn_flush(c);
+}
+
+// A move goes out after the think time; its turn latency runs from the
+// moment it is sent to the first line the server answers with.
+void conn_move(Conn *c, const char *line, int timed) {
+    snprintf(c->reply, sizeof(c->reply), "%s", line);
+    c->replyDue = now_ns() + cfg.thinkMs * 1000000LL;
+    c->replyTimed = timed;
+}
+
+void conn_send_reply(Conn *c, long long now) {
+    conn_send(c, c->reply);
+    c->reply[0] = '\0';
+    c->replyDue = 0;
+    c->moveSentAt = c->replyTimed ? now : 0;
+    c->moves++;
+    movesSent++;
+}
+
+void conn_close(Conn *c) {
+    close(c->fd);
+    if (c->state == CONN_PLAYING) {
+        if (c->moves >= cfg.maxMoves) aborted++;
+        else finished++;
+    } else if (c->state == CONN_CONNECTING) {
+        connectFailed++;
+    } else {
+        dropped++;
+    }
+    c->state = CONN_FREE;
+    c->fd = -1;
+}
+
+int conn_open(Conn *c) {
+    attempts++;
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0 || set_nonblocking(fd) < 0) {
+        if (fd >= 0) close(fd);
+        connectFailed++;
+        return -1;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    memset(c, 0, sizeof(*c));
+    c->fd = fd;
+    c->state = CONN_CONNECTING;
+    c->game = cfg.games[(nextGame++ / 2) % cfg.numGames];     // neighbours ask for the same game
+    c->startedAt = now_ns();
+    if (connect(fd, (struct sockaddr *)&serverAddr, sizeof(serverAddr)) < 0 && errno != EINPROGRESS) {
+        close(fd);
+        c->state = CONN_FREE;
+        c->fd = -1;
+        connectFailed++;
+        return -1;
+    }
+    return 0;
+}
+
+// Scripted players
+void strip_escapes(char *line) {
+    char *src = line, *dst = line;
+    while (*src) {
+        if (*src == '\033') {
+            while (*src && *src != 'm') src++;
+            if (*src) src++;
+            continue;
+        }
+        *dst++ = *src++;
+    }
+    *dst = '\0';
+}
+
+// Board rows look like "8 │R1B│K1B│ . │...".
+void chess_parse_row(Conn *c, char *line) {
+    static const char *bar = "│";
+    int row = 8 - (line[0] - '0');
+    char *cell = strstr(line, bar);
+    for (int col = 0; col < 8 && cell; col++) {
+        cell += strlen(bar);
+        char *end = strstr(cell, bar);
+        if (!end) return;
+        char id[4] = "";
+        sscanf(cell, "%3s", id);
+        if (end - cell > 3 || strcmp(id, ".") == 0) id[0] = '\0';
+        strcpy(c->board[row][col], id);
+        cell = end;
+    }
+}
+
+int chess_own(Conn *c, int row, int col) {
+    const char *id = c->board[row][col];
+    return id[0] && id[strlen(id) - 1] == c->color;
+}
+
+// Random piece, random target the piece could plausibly reach; the server
+// has the final say and answers invalid moves with another TURN.
+void chess_pick_move(Conn *c, char *line, int size) {
+    static const int knight[8][2] = {{1, 2}, {2, 1}, {-1, 2}, {-2, 1}, {1, -2}, {2, -1}, {-1, -2}, {-2, -1}};
+    for (int attempt = 0; attempt < 256; attempt++) {
+        int r = game_rng_range(&rng, 8), f = game_rng_range(&rng, 8);
+        if (!chess_own(c, r, f)) continue;
+        const char *id = c->board[r][f];
+        int dr, df;
+        if (id[0] == 'P') {
+            dr = c->color == 'W' ? -1 : 1;
+            df = (int)game_rng_range(&rng, 3) - 1;     // diagonal only onto a piece, which must be the enemy's
+            if (df && r + dr >= 0 && r + dr < 8 && f + df >= 0 && f + df < 8 && !c->board[r + dr][f + df][0]) df = 0;
+        } else if (id[0] == 'K' && strlen(id) == 3) {
+            int k = game_rng_range(&rng, 8);
+            dr = knight[k][0];
+            df = knight[k][1];
+        } else {
+            int dist = id[0] == 'K' ? 1 : 1 + (int)game_rng_range(&rng, 7);
+            dr = ((int)game_rng_range(&rng, 3) - 1) * dist;
+            df = ((int)game_rng_range(&rng, 3) - 1) * dist;
+            if (id[0] == 'R' && dr && df) df = 0;
+            if (id[0] == 'B' && (!dr || !df)) continue;
+        }
+        int tr = r + dr, tf = f + df;
+        if ((dr == 0 && df == 0) || tr < 0 || tr > 7 || tf < 0 || tf > 7 || chess_own(c, tr, tf)) continue;
+        snprintf(line, size, "MOVE:%s %c%d\n", id, 'a' + tf, 8 - tr);
+        return;
+    }
+    snprintf(line, size, "MOVE:P1%c a5\n", c->color);
+}
+
+void play_line(Conn *c, char *line) {
+    char move[64];
+    strip_escapes(line);
+    switch (c->game) {
+    case WORDLE:
+        if (strstr(line, "Enter a 5-letter guess") || strstr(line, "Not in word list")) {
+            snprintf(move, sizeof(move), "%s\n", words[game_rng_range(&rng, numWords)]);
+            conn_move(c, move, 1);
+        }
+        break;
+    case CHESS:
+        if (strncmp(line, "Connected as Player", 19) == 0) c->color = line[20] == '1' ? 'W' : 'B';
+        else if (line[0] >= '1' && line[0] <= '8' && line[1] == ' ' && strstr(line, "│")) chess_parse_row(c, line);
+        else if (strcmp(line, "TURN") == 0) {
+            chess_pick_move(c, move, sizeof(move));
+            conn_move(c, move, 1);
+        }
+        break;
+    case SNAKE_LADDER:
+        if (strcmp(line, "TURN") == 0) conn_move(c, "ROLL\n", 1);
+        break;
+    case TIC_TAC_TOE:
+        if (sscanf(line, "Your turn Player %*c. Enter row and col (0-%d 0-%d)", &c->tttMaxRow, &c->tttMaxCol) == 2 ||
+            strncmp(line, "Invalid move", 12) == 0) {
+            snprintf(move, sizeof(move), "%d %d\n", (int)game_rng_range(&rng, c->tttMaxRow + 1),
+                     (int)game_rng_range(&rng, c->tttMaxCol + 1));
+            conn_move(c, move, 1);
+        }
+        break;
+    case ROCK_PAPER_SCISSOR:
+        // The first player to commit waits for the opponent, so only the
+        // second commit of a round has a server-side latency to measure.
+        if (strncmp(line, "Opponent has locked in", 22) == 0) c->rpsOpponentLocked = 1;
+        else if (strncmp(line, "Result:", 7) == 0) c->rpsOpponentLocked = 0;
+        else if (strncmp(line, "Enter STONE", 11) == 0 || strncmp(line, "Invalid move!", 13) == 0) {
+            snprintf(move, sizeof(move), "%s\n", rpsMoveNames[game_rng_range(&rng, 3)]);
+            conn_move(c, move, c->rpsOpponentLocked);
+        }
+        break;
+    }
+}
+
+void handle_line(Conn *c, char *line, long long now) {
+    if (c->moveSentAt > 0) {
+        latency_hist_record(&turnHist, now - c->moveSentAt);
+        c->moveSentAt = 0;
+    }
+    if (c->state == CONN_SELECTING && strcmp(line, "SELECT_GAME") == 0) {
+        char msg[64];
+        snprintf(msg, sizeof(msg), "GAME:%s\n", gameNames[c->game]);
+        conn_send(c, msg);
+        c->state = CONN_WAITING;
+        c->startedAt = now;
+    } else if (c->state == CONN_WAITING && strncmp(line, "START:", 6) == 0) {
+        latency_hist_record(&matchHist, now - c->startedAt);
+        c->state = CONN_PLAYING;
+        c->tttMaxRow = c->tttMaxCol = 2;
+    } else if (c->state == CONN_PLAYING) {
+        play_line(c, line);
+    }
+}
+
+// Returns -1 once the connection is gone.
+int conn_read(Conn *c, long long now) {
+    for (;;) {
+        ssize_t n = recv(c->fd, c->in + c->inLen, CONN_INPUT_SIZE - 1 - c->inLen, 0);
+        if (n == 0) return -1;
+        if (n < 0) return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ? 0 : -1;
+        bytesIn += n;
+        c->inLen += n;
+        int start = 0;
+        for (int i = 0; i < c->inLen; i++) {
+            if (c->in[i] != '\n') continue;
+            c->in[i] = '\0';
+            if (i > start && c->in[i - 1] == '\r') c->in[i - 1] = '\0';
+            if (i > start) handle_line(c, c->in + start, now);
+            start = i + 1;
+        }
+        if (start == 0 && c->inLen == CONN_INPUT_SIZE - 1) start = c->inLen;     // oversized line: drop it
+        memmove(c->in, c->in + start, c->inLen - start);
+        c->inLen -= start;
+    }
+}
+
+void print_hist(const char *name, const LatencyHist *h) {
+    printf("latency=%s count=%llu p50_us=%.1f p99_us=%.1f p999_us=%.1f max_us=%.1f\n", name,
+           (unsigned long long)h->total, latency_hist_percentile(h, 0.50) / 1e3, latency_hist_percentile(h, 0.99) / 1e3,
+           latency_hist_percentile(h, 0.999) / 1e3, h->max / 1e3);
+}
+
+void usage(const char *prog) {
+    printf("Usage: %s [-H host] [-p port] [-c connections] [-r connects_per_sec] [-d seconds]\n"
+           "          [-g games|all] [-k think_ms] [-m max_moves] [-w words_file] [-s seed]\n", prog);
+}
+
+int main(int argc, char *argv[]) {
+    int opt;
+    char gameList[128] = "all";
+    while ((opt = getopt(argc, argv, "H:p:c:r:d:g:k:m:w:s:")) != -1) {
+        switch (opt) {
+        case 'H': cfg.host = optarg; break;
+        case 'p': cfg.port = atoi(optarg); break;
+        case 'c': cfg.connections = atoi(optarg); break;
+        case 'r': cfg.rate = atoi(optarg); break;
+        case 'd': cfg.seconds = atoi(optarg); break;
+        case 'g': snprintf(gameList, sizeof(gameList), "%s", optarg); break;
+        case 'k': cfg.thinkMs = atoi(optarg); break;
+        case 'm': cfg.maxMoves = atoi(optarg); break;
+        case 'w': cfg.wordsPath = optarg; break;
+        case 's': cfg.seed = strtoull(optarg, NULL, 0); break;
+        default: usage(argv[0]); return 1;
+        }
+    }
+    if (parse_games(gameList) < 0 || cfg.connections < 1 || cfg.rate < 1 || cfg.seconds < 1 || cfg.thinkMs < 0 || cfg.maxMoves < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+    memset(&serverAddr, 0, sizeof(serverAddr));
+    serverAddr.sin_family = AF_INET;
+    serverAddr.sin_port = htons(cfg.port);
+    if (inet_pton(AF_INET, cfg.host, &serverAddr.sin_addr) != 1) {
+        printf("Invalid address %s\n", cfg.host);
+        return 1;
+    }
+
+    raise_fd_limit();
+    load_words(cfg.wordsPath);
+    game_rng_seed(&rng, cfg.seed ? cfg.seed : game_rng_fresh_seed());
+    conns = calloc(cfg.connections, sizeof(Conn));
+    pollfds = malloc(cfg.connections * sizeof(struct pollfd));
+    pollConn = malloc(cfg.connections * sizeof(int));
+    if (!conns || !pollfds || !pollConn || !words) {
+        printf("Out of memory for %d connections\n", cfg.connections);
+        return 1;
+    }
+    for (int i = 0; i < cfg.connections; i++) conns[i].fd = -1;
+    printf("Load: %d connections at %d/s for %ds against %s:%d, think %dms\n", cfg.connections, cfg.rate,
+           cfg.seconds, cfg.host, cfg.port, cfg.thinkMs);
+
+    long long start = now_ns(), end = start + cfg.seconds * 1000000000LL;
+    long long nextReport = start + REPORT_INTERVAL_MS * 1000000LL, lastFinished = 0;
+    int live = 0;
+    for (;;) {
+        long long now = now_ns();
+        if (now >= end) break;
+
+        // Ramp: the number of connect() calls so far never runs ahead of rate * elapsed.
+        long long allowed = (now - start) / 1000 * cfg.rate / 1000000 + 1;
+        for (int i = 0; i < cfg.connections && live < cfg.connections && attempts < allowed; i++)
+            if (conns[i].state == CONN_FREE && conn_open(&conns[i]) == 0) live++;
+
+        int nfds = 0;
+        long long wake = now + 100000000LL;     // re-check the ramp at least every 100 ms
+        if (wake > end) wake = end;
+        for (int i = 0; i < cfg.connections; i++) {
+            Conn *c = &conns[i];
+            if (c->state == CONN_FREE) continue;
+            if (c->replyDue && c->replyDue <= now) conn_send_reply(c, now);
+            if (c->replyDue && c->replyDue < wake) wake = c->replyDue;
+            pollfds[nfds].fd = c->fd;
+            pollfds[nfds].events = c->state == CONN_CONNECTING || c->outLen > 0 ? POLLIN | POLLOUT : POLLIN;
+            pollfds[nfds].revents = 0;
+            pollConn[nfds++] = i;
+        }
+        if (live < cfg.connections) {
+            long long nextConnect = start + attempts * 1000000000LL / cfg.rate;
+            if (nextConnect < wake) wake = nextConnect;
+        }
+        int timeout = wake > now ? (int)((wake - now + 999999) / 1000000) : 0;
+        if (poll(pollfds, nfds, timeout) < 0 && errno != EINTR) {
+            perror("poll");
+            break;
+        }
+
+        now = now_ns();
+        for (int i = 0; i < nfds; i++) {
+            Conn *c = &conns[pollConn[i]];
+            short revents = pollfds[i].revents;
+            if (!revents) continue;
+            if (c->state == CONN_CONNECTING) {
+                int err = 0;
+                socklen_t len = sizeof(err);
+                if (getsockopt(c->fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0 || err) {
+                    conn_close(c);
+                    live--;
+                    continue;
+                }
+                latency_hist_record(&connectHist, now - c->startedAt);
+                c->state = CONN_SELECTING;
+                opened++;
+            }
+            if (revents & POLLOUT) conn_flush(c);
+            if ((revents & (POLLIN | POLLHUP | POLLERR)) && conn_read(c, now) < 0) {
+                conn_close(c);
+                live--;
+                continue;
+            }
+            // The scripted players give up on endless games.
+            if (c->moves >= cfg.maxMoves && c->state == CONN_PLAYING) {
+                conn_close(c);
+                live--;
+            }
+        }
+
+        if (now >= nextReport) {
+            double elapsed = (now - start) / 1e9;
+            printf("t=%.0fs open=%d opened=%lld failed=%lld games_finished=%lld sessions_per_sec=%.1f moves=%lld\n",
+                   elapsed, live, opened, connectFailed, finished,
+                   (finished - lastFinished) / 2.0 / (REPORT_INTERVAL_MS / 1000.0), movesSent);
+            fflush(stdout);
+            lastFinished = finished;
+            nextReport += REPORT_INTERVAL_MS * 1000000LL;
+        }
+    }
+
+    double elapsed = (now_ns() - start) / 1e9;
+    for (int i = 0; i < cfg.connections; i++)
+        if (conns[i].state != CONN_FREE) close(conns[i].fd);
+    printf("seconds=%.1f opened=%lld connect_failed=%lld games_finished=%lld games_abandoned=%lld dropped=%lld\n",
+           elapsed, opened, connectFailed, finished, aborted, dropped);
+    printf("sessions=%lld sessions_per_sec=%.1f moves=%lld moves_per_sec=%.0f bytes_in=%lld bytes_out=%lld\n",
+           finished / 2, finished / 2.0 / elapsed, movesSent, movesSent / elapsed, bytesIn, bytesOut);
+    print_hist("connect", &connectHist);
+    print_hist("match", &matchHist);
+    print_hist("turn", &turnHist);
+    free(conns);
+    free(pollfds);
+    free(pollConn);
+    free(words);
+    return 0;
+}
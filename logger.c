@@ -0,0 +1,255 @@
+#include "logger.h"
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+#define LOG_RING_RECORDS 4096           // per thread, a power of two
+#define LOG_MAX_ARGS 6
+#define LOG_STRING_BYTES 56
+#define LOG_LINE_SIZE 512
+#define LOG_IDLE_NS 2000000             // drain thread sleep when there is nothing to print
+
+typedef struct {
+    uint64_t timeNs;
+    const char *fmt;
+    uint8_t level;
+    uint8_t numArgs;
+    uint8_t stringUsed;
+    uint64_t args[LOG_MAX_ARGS];        // %s arguments hold an offset into strings
+    char strings[LOG_STRING_BYTES];
+} LogRecord;
+
+// Single producer (the owning thread), single consumer (the drain thread).
+typedef struct LogRing {
+    uint32_t head;                      // written by the producer
+    uint32_t tail;                      // written by the consumer
+    uint64_t dropped;                   // written by the producer
+    uint64_t reported;                  // drops already reported, consumer only
+    struct LogRing *next;
+    LogRecord records[LOG_RING_RECORDS];
+} LogRing;
+
+int logLevel = LOG_LEVEL_INFO;
+static const char *levelNames[] = {"DEBUG", "INFO", "WARN", "ERROR"};
+static __thread LogRing *threadRing;
+static LogRing *rings;
+static pthread_t drainThread;
+static int running, stopping;
+static long long startMono, startReal;      // ns, to print wall-clock times
+
+static long long clock_ns(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static LogRing *log_ring(void) {
+    if (threadRing) return threadRing;
+    LogRing *ring = calloc(1, sizeof(LogRing));
+    if (!ring) return NULL;
+    ring->next = __atomic_load_n(&rings, __ATOMIC_ACQUIRE);
+    while (!__atomic_compare_exchange_n(&rings, &ring->next, ring, 1, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE))
+        ;
+    return threadRing = ring;
+}
+
+// Walks one conversion ("%-08.3lld") and reports what it takes.
+typedef enum { ARG_NONE, ARG_INT, ARG_LONG, ARG_DOUBLE, ARG_STRING, ARG_POINTER } ArgKind;
+
+static const char *scan_conversion(const char *f, ArgKind *kind) {
+    int longs = 0;
+    f++;
+    while (*f && strchr("-+ #0123456789.", *f)) f++;
+    for (; *f && strchr("hlLzjt", *f); f++)
+        if (*f != 'h') longs = 1;
+    switch (*f) {
+        case 'd': case 'i': case 'u': case 'x': case 'X': case 'o': *kind = longs ? ARG_LONG : ARG_INT; break;
+        case 'c': *kind = ARG_INT; break;
+        case 'f': case 'F': case 'g': case 'G': case 'e': case 'E': *kind = ARG_DOUBLE; break;
+        case 's': *kind = ARG_STRING; break;
+        case 'p': *kind = ARG_POINTER; break;
+        default: *kind = ARG_NONE; break;
+    }
+    return *f ? f + 1 : f;
+}
+
+void log_write(LogLevel level, const char *fmt, ...) {
+    LogRing *ring = log_ring();
+    if (!ring) return;
+    uint32_t head = ring->head;
+    if (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) == LOG_RING_RECORDS) {
+        __atomic_store_n(&ring->dropped, ring->dropped + 1, __ATOMIC_RELAXED);
+        return;
+    }
+    LogRecord *r = &ring->records[head & (LOG_RING_RECORDS - 1)];
+    r->timeNs = clock_ns(CLOCK_MONOTONIC);
+    r->fmt = fmt;
+    r->level = level;
+    r->numArgs = 0;
+    r->stringUsed = 0;
+
+    va_list ap;
+    va_start(ap, fmt);
+    for (const char *f = fmt; *f;) {
+        if (*f != '%') {
+            f++;
+            continue;
+        }
+        if (f[1] == '%') {
+            f += 2;
+            continue;
+        }
+        ArgKind kind;
+        f = scan_conversion(f, &kind);
+        if (kind == ARG_NONE || r->numArgs == LOG_MAX_ARGS) break;
+        uint64_t value = 0;
+        switch (kind) {
+            case ARG_INT: value = (uint64_t)(int64_t)va_arg(ap, int); break;
+            case ARG_LONG: value = (uint64_t)va_arg(ap, long long); break;
+            case ARG_DOUBLE: {
+                double d = va_arg(ap, double);
+                memcpy(&value, &d, sizeof(value));
+                break;
+            }
+            case ARG_POINTER: value = (uint64_t)(uintptr_t)va_arg(ap, void *); break;
+            case ARG_STRING: {
+                const char *s = va_arg(ap, const char *);
+                size_t room = LOG_STRING_BYTES - r->stringUsed;
+                size_t len = s ? strnlen(s, room - 1) : 0;
+                value = r->stringUsed;
+                if (s) memcpy(r->strings + r->stringUsed, s, len);
+                r->strings[r->stringUsed + len] = '\0';
+                if (r->stringUsed + len + 1 < LOG_STRING_BYTES) r->stringUsed += len + 1;
+                break;
+            }
+            default: break;
+        }
+        r->args[r->numArgs++] = value;
+    }
+    va_end(ap);
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+// printf again, one conversion at a time, from the stored arguments.
+static size_t format_record(const LogRecord *r, char *out, size_t size) {
+    size_t len = 0;
+    int arg = 0;
+    const char *f = r->fmt;
+    while (*f && len < size - 1) {
+        if (*f != '%') {
+            out[len++] = *f++;
+            continue;
+        }
+        if (f[1] == '%') {
+            out[len++] = '%';
+            f += 2;
+            continue;
+        }
+        ArgKind kind;
+        const char *end = scan_conversion(f, &kind);
+        char spec[32];
+        size_t specLen = (size_t)(end - f) < sizeof(spec) - 1 ? (size_t)(end - f) : sizeof(spec) - 1;
+        memcpy(spec, f, specLen);
+        spec[specLen] = '\0';
+        f = end;
+        if (kind == ARG_NONE || arg >= r->numArgs) break;
+        uint64_t value = r->args[arg++];
+        int n = 0;
+        switch (kind) {
+            case ARG_INT: n = snprintf(out + len, size - len, spec, (int)value); break;
+            case ARG_LONG: n = snprintf(out + len, size - len, spec, (long long)value); break;
+            case ARG_DOUBLE: {
+                double d;
+                memcpy(&d, &value, sizeof(d));
+                n = snprintf(out + len, size - len, spec, d);
+                break;
+            }
+            case ARG_POINTER: n = snprintf(out + len, size - len, spec, (void *)(uintptr_t)value); break;
+            case ARG_STRING: n = snprintf(out + len, size - len, spec, r->strings + value); break;
+            default: break;
+        }
+        if (n > 0) len += (size_t)n < size - len ? (size_t)n : size - len - 1;
+    }
+    out[len] = '\0';
+    return len;
+}
+
+static void print_record(const LogRecord *r) {
+    char line[LOG_LINE_SIZE];
+    long long wall = startReal + ((long long)r->timeNs - startMono);
+    time_t secs = wall / 1000000000LL;
+    struct tm tm;
+    localtime_r(&secs, &tm);
+    size_t len = format_record(r, line, sizeof(line));
+    while (len > 0 && line[len - 1] == '\n') line[--len] = '\0';
+    printf("%02d:%02d:%02d.%06lld %-5s %s\n", tm.tm_hour, tm.tm_min, tm.tm_sec, wall % 1000000000LL / 1000,
+           levelNames[r->level], line);
+}
+
+// Prints everything queued so far; returns how many records it printed.
+static int drain(void) {
+    int printed = 0;
+    for (LogRing *ring = __atomic_load_n(&rings, __ATOMIC_ACQUIRE); ring; ring = ring->next) {
+        uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        for (uint32_t tail = ring->tail; tail != head; tail++, printed++) {
+            print_record(&ring->records[tail & (LOG_RING_RECORDS - 1)]);
+            __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+        }
+        uint64_t dropped = __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED);
+        if (dropped != ring->reported) {
+            printf("%15s %-5s %llu log records dropped, ring full\n", "", "WARN", (unsigned long long)(dropped - ring->reported));
+            ring->reported = dropped;
+        }
+    }
+    if (printed) fflush(stdout);
+    return printed;
+}
+
+static void *drain_main(void *arg) {
+    struct timespec idle = {0, LOG_IDLE_NS};
+    while (!__atomic_load_n(&stopping, __ATOMIC_ACQUIRE))
+        if (!drain()) nanosleep(&idle, NULL);
+    drain();
+    return NULL;
+}
+
+void log_set_level(LogLevel level) {
+    __atomic_store_n(&logLevel, (int)level, __ATOMIC_RELAXED);
+}
+
+int log_parse_level(const char *name) {
+    for (int level = LOG_LEVEL_DEBUG; level <= LOG_LEVEL_ERROR; level++)
+        if (strcasecmp(name, levelNames[level]) == 0) return level;
+    return -1;
+}
+
+static void adjust_level(int sig) {
+    int level = __atomic_load_n(&logLevel, __ATOMIC_RELAXED) + (sig == SIGUSR1 ? -1 : 1);
+    if (level >= LOG_LEVEL_DEBUG && level <= LOG_LEVEL_ERROR) log_set_level(level);
+}
+
+int log_start(void) {
+    if (running) return 0;
+    startMono = clock_ns(CLOCK_MONOTONIC);
+    startReal = clock_ns(CLOCK_REALTIME);
+    if (pthread_create(&drainThread, NULL, drain_main, NULL) != 0) return -1;
+    running = 1;
+    signal(SIGUSR1, adjust_level);
+    signal(SIGUSR2, adjust_level);
+    atexit(log_stop);
+    return 0;
+}
+
+void log_stop(void) {
+    if (!running) return;
+    running = 0;
+    __atomic_store_n(&stopping, 1, __ATOMIC_RELEASE);
+    pthread_join(drainThread, NULL);
+}
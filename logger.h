@@ -0,0 +1,41 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+// Asynchronous logger. A call site stores the format pointer and the raw
+// arguments in a fixed-size record on its thread's own ring buffer; a
+// background thread formats and prints them. Logging never blocks: when
+// a ring is full the record is dropped and counted.
+//
+// Formats are printf-style; %s arguments are copied (up to LOG_STRING_BYTES
+// per record in total) and '*' widths are not supported. Debug records
+// compile out unless the build defines LOG_ENABLE_DEBUG.
+typedef enum { LOG_LEVEL_DEBUG, LOG_LEVEL_INFO, LOG_LEVEL_WARN, LOG_LEVEL_ERROR } LogLevel;
+
+extern int logLevel;
+
+void log_write(LogLevel level, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+#define LOG_AT(level, ...) do { \
+    if ((int)(level) >= __atomic_load_n(&logLevel, __ATOMIC_RELAXED)) log_write((level), __VA_ARGS__); \
+} while (0)
+
+#ifdef LOG_ENABLE_DEBUG
+#define LOG_DEBUG(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) do { if (0) log_write(LOG_LEVEL_DEBUG, __VA_ARGS__); } while (0)
+#endif
+#define LOG_INFO(...) LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_WARN(...) LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+
+// Starts the drain thread. Everything logged is printed by exit, as
+// log_stop is registered with atexit. SIGUSR1 makes the log more verbose
+// by one level and SIGUSR2 quieter.
+int log_start(void);
+void log_stop(void);
+
+void log_set_level(LogLevel level);
+// "debug", "info", "warn" or "error"; -1 for anything else.
+int log_parse_level(const char *name);
+
+#endif
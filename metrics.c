@@ -0,0 +1,267 @@
+#include "metrics.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define METRICS_PREFIX "gamesys_"
+#define ADMIN_REQUEST_SIZE 2048
+#define ADMIN_TIMEOUT_SECONDS 1
+
+typedef enum { METRIC_COUNTER, METRIC_GAUGE } MetricType;
+
+typedef struct {
+    const char *name;
+    const char *help;
+    MetricType type;
+    int labelled;
+} MetricInfo;
+
+static const MetricInfo metricInfo[METRIC_COUNT] = {
+    [METRIC_CONNECTIONS_ACCEPTED] = {"connections_accepted_total", "Connections accepted.", METRIC_COUNTER, 0},
+    [METRIC_CONNECTIONS_CLOSED] = {"connections_closed_total", "Connections closed.", METRIC_COUNTER, 0},
+    [METRIC_BYTES_IN] = {"bytes_in_total", "Bytes read from clients.", METRIC_COUNTER, 0},
+    [METRIC_BYTES_OUT] = {"bytes_out_total", "Bytes written to clients.", METRIC_COUNTER, 0},
+    [METRIC_WRITE_STALLS] = {"write_queue_stalls_total", "Writes the socket did not take in full, leaving output queued.", METRIC_COUNTER, 0},
+    [METRIC_OUTPUT_OVERFLOWS] = {"output_overflows_total", "Clients dropped for letting too much output queue up.", METRIC_COUNTER, 0},
+    [METRIC_SESSIONS_STARTED] = {"sessions_started_total", "Game sessions started.", METRIC_COUNTER, 1},
+    [METRIC_SESSIONS_FINISHED] = {"sessions_finished_total", "Game sessions ended, finished or abandoned.", METRIC_COUNTER, 1},
+    [METRIC_TURNS] = {"turns_total", "Input lines handled by a game.", METRIC_COUNTER, 1},
+    [METRIC_BOT_MOVES] = {"bot_moves_total", "Moves played by bots.", METRIC_COUNTER, 1},
+    [METRIC_BOT_OVER_BUDGET] = {"bot_over_budget_total", "Bot moves played at random because the decision was late.", METRIC_COUNTER, 1},
+    [METRIC_CONNECTIONS_OPEN] = {"connections_open", "Connections currently open.", METRIC_GAUGE, 0},
+    [METRIC_QUEUE_DEPTH] = {"queue_depth", "Players waiting for an opponent or a tournament to fill.", METRIC_GAUGE, 1},
+    [METRIC_SESSIONS_ACTIVE] = {"sessions_active", "Game sessions in progress.", METRIC_GAUGE, 1},
+    [METRIC_SESSION_MEMORY] = {"session_memory_bytes", "Arena memory held by game sessions in progress.", METRIC_GAUGE, 1},
+};
+
+// Histograms are always per label.
+static const MetricInfo histInfo[METRIC_HIST_COUNT] = {
+    [METRIC_MATCH_WAIT] = {"match_wait_seconds", "Time from asking for a game to its start."},
+    [METRIC_TURN_LATENCY] = {"turn_latency_seconds", "Time from a move being readable to the game having answered it."},
+    [METRIC_BOT_DECISION] = {"bot_decision_seconds", "Time from queueing a bot move to the decision, including the wait for a worker."},
+};
+
+// Upper bounds of the exported histogram buckets, in seconds.
+static const double histBounds[] = {0.00001, 0.000025, 0.00005, 0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005,
+                                    0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30, 60, 300};
+#define HIST_BOUNDS (int)(sizeof(histBounds) / sizeof(*histBounds))
+
+__thread MetricsShard *metricsShard;
+static MetricsShard *shards;            // every thread's shard, pushed lock-free
+static MetricsShard spareShard;         // shared if a thread cannot get its own
+static const char *labelName = "label";
+static const char *const *labelValues;
+static int labelCount = 1;
+
+MetricsShard *metrics_register_thread(void) {
+    MetricsShard *s = calloc(1, sizeof(MetricsShard));
+    if (!s) return metricsShard = &spareShard;
+    s->next = __atomic_load_n(&shards, __ATOMIC_ACQUIRE);
+    while (!__atomic_compare_exchange_n(&shards, &s->next, s, 1, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE))
+        ;
+    return metricsShard = s;
+}
+
+void metrics_init(const char *name, const char *const *labels, int count) {
+    labelName = name;
+    labelValues = labels;
+    labelCount = count < METRICS_MAX_LABELS ? count : METRICS_MAX_LABELS;
+}
+
+int64_t metrics_value(Metric m, int label) {
+    int64_t total = __atomic_load_n(&spareShard.values[m][label], __ATOMIC_RELAXED);
+    for (MetricsShard *s = __atomic_load_n(&shards, __ATOMIC_ACQUIRE); s; s = s->next)
+        total += __atomic_load_n(&s->values[m][label], __ATOMIC_RELAXED);
+    return total;
+}
+
+static void add_hist(LatencyHist *into, LatencyHist *from) {
+    for (int i = 0; i < LATENCY_HIST_BUCKETS; i++) into->counts[i] += __atomic_load_n(&from->counts[i], __ATOMIC_RELAXED);
+    into->total += __atomic_load_n(&from->total, __ATOMIC_RELAXED);
+    into->sum += __atomic_load_n(&from->sum, __ATOMIC_RELAXED);
+    uint64_t max = __atomic_load_n(&from->max, __ATOMIC_RELAXED);
+    if (max > into->max) into->max = max;
+}
+
+void metrics_hist(MetricHist h, int label, LatencyHist *out) {
+    latency_hist_reset(out);
+    add_hist(out, &spareShard.hists[h][label]);
+    for (MetricsShard *s = __atomic_load_n(&shards, __ATOMIC_ACQUIRE); s; s = s->next) add_hist(out, &s->hists[h][label]);
+}
+
+typedef struct {
+    char *data;
+    size_t len, cap;
+} TextBuffer;
+
+static void append(TextBuffer *b, const char *fmt, ...) {
+    for (;;) {
+        va_list ap;
+        va_start(ap, fmt);
+        int n = b->data ? vsnprintf(b->data + b->len, b->cap - b->len, fmt, ap) : -1;
+        va_end(ap);
+        if (n >= 0 && b->len + n < b->cap) {
+            b->len += n;
+            return;
+        }
+        size_t cap = b->cap ? b->cap * 2 : 16384;
+        char *grown = realloc(b->data, cap);
+        if (!grown) return;
+        b->data = grown;
+        b->cap = cap;
+    }
+}
+
+static const char *label_value(int label) {
+    return labelValues ? labelValues[label] : "";
+}
+
+static void render_hist(TextBuffer *b, MetricHist h, int label, LatencyHist *hist) {
+    uint64_t cumulative[HIST_BOUNDS] = {0};
+    int bound = 0;
+    uint64_t seen = 0;
+    // Buckets are compared by their upper edge, so a count can land one
+    // bound late but never early; that is the usual ~3% resolution.
+    for (int i = 0; i < LATENCY_HIST_BUCKETS && bound < HIST_BOUNDS; i++) {
+        if (!hist->counts[i]) continue;
+        double seconds = latency_hist_bucket_value(i) / 1e9;
+        while (bound < HIST_BOUNDS && seconds > histBounds[bound]) cumulative[bound++] = seen;
+        seen += hist->counts[i];
+    }
+    while (bound < HIST_BOUNDS) cumulative[bound++] = seen;
+    const char *name = histInfo[h].name, *value = label_value(label);
+    for (int i = 0; i < HIST_BOUNDS; i++)
+        append(b, METRICS_PREFIX "%s_bucket{%s=\"%s\",le=\"%g\"} %llu\n", name, labelName, value, histBounds[i],
+               (unsigned long long)cumulative[i]);
+    append(b, METRICS_PREFIX "%s_bucket{%s=\"%s\",le=\"+Inf\"} %llu\n", name, labelName, value, (unsigned long long)hist->total);
+    append(b, METRICS_PREFIX "%s_sum{%s=\"%s\"} %.9f\n", name, labelName, value, hist->sum / 1e9);
+    append(b, METRICS_PREFIX "%s_count{%s=\"%s\"} %llu\n", name, labelName, value, (unsigned long long)hist->total);
+}
+
+char *metrics_render(void) {
+    TextBuffer b = {0};
+    for (int m = 0; m < METRIC_COUNT; m++) {
+        const MetricInfo *info = &metricInfo[m];
+        append(&b, "# HELP " METRICS_PREFIX "%s %s\n# TYPE " METRICS_PREFIX "%s %s\n", info->name, info->help, info->name,
+               info->type == METRIC_COUNTER ? "counter" : "gauge");
+        if (!info->labelled) {
+            append(&b, METRICS_PREFIX "%s %lld\n", info->name, (long long)metrics_value(m, 0));
+            continue;
+        }
+        for (int l = 0; l < labelCount; l++)
+            append(&b, METRICS_PREFIX "%s{%s=\"%s\"} %lld\n", info->name, labelName, label_value(l), (long long)metrics_value(m, l));
+    }
+    LatencyHist *hist = malloc(sizeof(LatencyHist));
+    for (int h = 0; h < METRIC_HIST_COUNT && hist; h++) {
+        append(&b, "# HELP " METRICS_PREFIX "%s %s\n# TYPE " METRICS_PREFIX "%s histogram\n", histInfo[h].name,
+               histInfo[h].help, histInfo[h].name);
+        for (int l = 0; l < labelCount; l++) {
+            metrics_hist(h, l, hist);
+            render_hist(&b, h, l, hist);
+        }
+    }
+    free(hist);
+    return b.data;
+}
+
+// Admin endpoint
+static int adminFds[2] = {-1, -1};
+
+// Any request gets the metrics; the request itself is read only so the
+// client does not see a reset.
+static void serve_client(int fd) {
+    struct timeval timeout = {ADMIN_TIMEOUT_SECONDS, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    char request[ADMIN_REQUEST_SIZE];
+    size_t got = 0;
+    while (got < sizeof(request) - 1) {
+        ssize_t n = recv(fd, request + got, sizeof(request) - 1 - got, 0);
+        if (n <= 0) break;
+        got += n;
+        request[got] = '\0';
+        if (strstr(request, "\r\n\r\n") || strstr(request, "\n\n")) break;
+    }
+    char *body = metrics_render();
+    size_t len = body ? strlen(body) : 0;
+    char header[160];
+    int headerLen = snprintf(header, sizeof(header),
+                             "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: %zu\r\n\r\n", len);
+    if (send(fd, header, headerLen, MSG_NOSIGNAL) == headerLen) {
+        for (size_t sent = 0; sent < len;) {
+            ssize_t n = send(fd, body + sent, len - sent, MSG_NOSIGNAL);
+            if (n <= 0) break;
+            sent += n;
+        }
+    }
+    free(body);
+    close(fd);
+}
+
+static void *admin_main(void *arg) {
+    struct pollfd fds[2];
+    for (;;) {
+        int n = 0;
+        for (int i = 0; i < 2; i++)
+            if (adminFds[i] >= 0) fds[n++] = (struct pollfd){adminFds[i], POLLIN, 0};
+        if (poll(fds, n, -1) < 0) continue;
+        for (int i = 0; i < n; i++) {
+            if (!(fds[i].revents & POLLIN)) continue;
+            int fd = accept(fds[i].fd, NULL, NULL);
+            if (fd >= 0) serve_client(fd);
+        }
+    }
+    return NULL;
+}
+
+static int listen_tcp(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    int opt = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    struct sockaddr_in addr = {0};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 16) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int listen_unix(const char *path) {
+    struct sockaddr_un addr = {0};
+    if (strlen(path) >= sizeof(addr.sun_path)) return -1;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    unlink(path);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 16) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int metrics_serve(int port, const char *socketPath) {
+    int status = 0;
+    if (port > 0 && (adminFds[0] = listen_tcp(port)) < 0) status = -1;
+    if (socketPath && socketPath[0] && (adminFds[1] = listen_unix(socketPath)) < 0) status = -1;
+    if (adminFds[0] < 0 && adminFds[1] < 0) return status;
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, admin_main, NULL) != 0) return -1;
+    pthread_detach(thread);
+    return status;
+}
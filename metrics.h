@@ -0,0 +1,94 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+#include "latency_hist.h"
+
+// Counters, gauges and latency histograms, optionally split by one label
+// (the server uses the game). Every thread records into its own shard, so
+// recording is a few plain stores with no lock and no locked instruction;
+// a scrape adds the shards together.
+#define METRICS_MAX_LABELS 8
+
+typedef enum {
+    // Counters
+    METRIC_CONNECTIONS_ACCEPTED,
+    METRIC_CONNECTIONS_CLOSED,
+    METRIC_BYTES_IN,
+    METRIC_BYTES_OUT,
+    METRIC_WRITE_STALLS,
+    METRIC_OUTPUT_OVERFLOWS,
+    METRIC_SESSIONS_STARTED,
+    METRIC_SESSIONS_FINISHED,
+    METRIC_TURNS,
+    METRIC_BOT_MOVES,
+    METRIC_BOT_OVER_BUDGET,
+    // Gauges
+    METRIC_CONNECTIONS_OPEN,
+    METRIC_QUEUE_DEPTH,
+    METRIC_SESSIONS_ACTIVE,
+    METRIC_SESSION_MEMORY,
+    METRIC_COUNT
+} Metric;
+
+typedef enum {
+    METRIC_MATCH_WAIT,
+    METRIC_TURN_LATENCY,
+    METRIC_BOT_DECISION,
+    METRIC_HIST_COUNT
+} MetricHist;
+
+typedef struct MetricsShard {
+    int64_t values[METRIC_COUNT][METRICS_MAX_LABELS];
+    LatencyHist hists[METRIC_HIST_COUNT][METRICS_MAX_LABELS];
+    struct MetricsShard *next;
+} MetricsShard;
+
+extern __thread MetricsShard *metricsShard;
+MetricsShard *metrics_register_thread(void);
+
+static inline MetricsShard *metrics_shard(void) {
+    MetricsShard *s = metricsShard;
+    return __builtin_expect(s != NULL, 1) ? s : metrics_register_thread();
+}
+
+// Only the owning thread writes a shard: a relaxed store is enough for a
+// scrape on another thread never to see a torn value.
+#define METRICS_STORE(field, value) __atomic_store_n(&(field), (value), __ATOMIC_RELAXED)
+
+static inline void metrics_add(Metric m, int label, int64_t delta) {
+    MetricsShard *s = metrics_shard();
+    METRICS_STORE(s->values[m][label], s->values[m][label] + delta);
+}
+
+// Absolute value for a gauge that only one thread ever changes.
+static inline void metrics_set(Metric m, int label, int64_t value) {
+    METRICS_STORE(metrics_shard()->values[m][label], value);
+}
+
+static inline void metrics_observe(MetricHist h, int label, uint64_t ns) {
+    LatencyHist *hist = &metrics_shard()->hists[h][label];
+    int bucket = latency_hist_bucket(ns);
+    METRICS_STORE(hist->counts[bucket], hist->counts[bucket] + 1);
+    METRICS_STORE(hist->total, hist->total + 1);
+    METRICS_STORE(hist->sum, hist->sum + ns);
+    if (ns > hist->max) METRICS_STORE(hist->max, ns);
+}
+
+// Names the label and its values, e.g. "game" and the game names.
+// Metrics that are not per game always use label 0.
+void metrics_init(const char *labelName, const char *const *labels, int count);
+
+// Sum over all threads.
+int64_t metrics_value(Metric m, int label);
+void metrics_hist(MetricHist h, int label, LatencyHist *out);
+
+// Prometheus text exposition format. Returns a malloc'd string.
+char *metrics_render(void);
+
+// Serves metrics_render() over HTTP from a background thread, on
+// 127.0.0.1:port (0 = off) and/or a Unix socket (NULL or "" = off).
+// Returns 0, or -1 if a listener could not be set up.
+int metrics_serve(int port, const char *socketPath);
+
+#endif
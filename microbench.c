@@ -0,0 +1,300 @@
+// Microbenchmarks for the server's game and I/O primitives. The server
+// source is compiled into this file, so the functions measured are the
+// ones the server runs.
+// Usage: ./microbench [-f filter] [-n samples] [-t sample_ms] [-c cpu] [-b baseline] [-r pct] [-l]
+// Each benchmark is calibrated so one sample runs for about sample_ms, then
+// timed for that many samples. Output is one key=value line per benchmark
+// (ns per operation over the samples); save it and pass it back with -b to
+// compare builds: a benchmark more than pct percent slower (default 5)
+// whose 95% confidence interval lies wholly above the baseline's is
+// flagged and the exit status is 1.
+#define _GNU_SOURCE             // sched_setaffinity
+#define GAME_SERVER_NO_MAIN
+#include "complete_game_server.c"
+
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+
+#define BENCH_MAX_SAMPLES 1000
+#define BENCH_MAX_BASELINE 64
+
+typedef struct {
+    const char *name;
+    void (*run)(long iters);
+    int opsPerIter;
+} Bench;
+
+typedef struct {
+    char name[64];
+    double mean, ci95;
+} BaselineEntry;
+
+// Keeps the compiler from folding a benchmark's inputs or discarding its result.
+#define BENCH_OPAQUE(x) __asm__ volatile("" : "+r"(x))
+#define BENCH_CONSUME(x) __asm__ volatile("" : : "r"(x) : "memory")
+
+static ChessBoard benchBoard;
+static Arena benchArena;
+static GameSession *benchSession;
+static int benchReadFds[2];
+static pthread_t drainThread;
+
+static long long bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// Reads the far ends of the socketpairs so the server side never blocks for long.
+static void *drain_main(void *arg) {
+    char buf[65536];
+    struct pollfd fds[2] = {{benchReadFds[0], POLLIN, 0}, {benchReadFds[1], POLLIN, 0}};
+    int live = 2;
+    while (live > 0 && poll(fds, 2, -1) > 0) {
+        for (int i = 0; i < 2; i++) {
+            if (!fds[i].revents) continue;
+            if (read(fds[i].fd, buf, sizeof(buf)) <= 0) {
+                fds[i].fd = -1;
+                live--;
+            }
+        }
+    }
+    return NULL;
+}
+
+// Two connected players on blocking socketpairs, as a session sees them.
+static int bench_setup(void) {
+    if (ttt_geometry_init(&tttGeometry, 3, 3, 3) != 0) return -1;
+    char layoutError[128];
+    if (sl_layout_parse(&slLayout, serverConfig.slBoardSize, serverConfig.slSnakes, serverConfig.slLadders,
+                        layoutError, sizeof(layoutError)) != 0) return -1;
+    build_sl_board_message();
+    if (init_chess_board(&benchBoard, &benchArena) != 0) return -1;
+
+    benchSession = calloc(1, sizeof(GameSession));
+    if (!benchSession) return -1;
+    for (int player = 0; player < 2; player++) {
+        int pair[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) != 0) return -1;
+        int id = client_alloc(pair[0]);
+        if (id < 0) return -1;
+        if (player == 0) benchSession->player1_id = id;
+        else benchSession->player2_id = id;
+        benchReadFds[player] = pair[1];
+    }
+    return pthread_create(&drainThread, NULL, drain_main, NULL) == 0 ? 0 : -1;
+}
+
+static void bench_teardown(void) {
+    client_close(benchSession->player1_id);
+    client_close(benchSession->player2_id);
+    pthread_join(drainThread, NULL);
+}
+
+// A knight out and back, so the board is the same after every iteration.
+static void run_move_piece(long iters) {
+    char feedback[128];
+    for (long i = 0; i < iters; i++) {
+        BENCH_CONSUME(move_piece(&benchBoard, "K1W", "c3", WHITE, feedback));
+        BENCH_CONSUME(move_piece(&benchBoard, "K1W", "b1", WHITE, feedback));
+    }
+}
+
+// A chess game's setup and teardown: the pieces from an arena and back.
+static void run_init_chess_board(long iters) {
+    ChessBoard board;
+    Arena arena = {0};
+    for (long i = 0; i < iters; i++) {
+        BENCH_CONSUME(init_chess_board(&board, &arena));
+        arena_release(&arena);
+    }
+}
+
+static void run_is_legal_move(long iters) {
+    char feedback[128];
+    int fromX = 7, fromY = 1, toX = 5, toY = 2;
+    for (long i = 0; i < iters; i++) {
+        BENCH_OPAQUE(fromX);
+        BENCH_CONSUME(is_legal_move(&benchBoard, fromX, fromY, toX, toY, feedback));
+    }
+}
+
+static void run_get_chess_board_string(long iters) {
+    char boardStr[BUFFER_SIZE];
+    for (long i = 0; i < iters; i++) {
+        get_chess_board_string(&benchBoard, boardStr);
+        BENCH_CONSUME(boardStr);
+    }
+}
+
+static void run_check_guess(long iters) {
+    char feedback[6];
+    const char *guess = "CRANE", *secret = "REACT";
+    for (long i = 0; i < iters; i++) {
+        BENCH_OPAQUE(guess);
+        checkGuess(guess, secret, feedback);
+        BENCH_CONSUME(feedback);
+    }
+}
+
+static void run_send_sl_board(long iters) {
+    for (long i = 0; i < iters; i++) send_sl_board(benchSession);
+}
+
+static void run_check_ttt_winner(long iters) {
+    GameSession *session = benchSession;
+    session->tttMasks[0] = 1 << 0 | 1 << 4 | 1 << 8;
+    session->tttMasks[1] = 1 << 1 | 1 << 2;
+    session->tttCurrentPlayer = 'X';
+    session->tttLastCell = 8;
+    for (long i = 0; i < iters; i++) {
+        BENCH_OPAQUE(session);
+        BENCH_CONSUME(check_ttt_winner(session));
+    }
+}
+
+static void run_get_rps_winner(long iters) {
+    const char *moves[] = {"STONE", "PAPER", "SCISSORS"};
+    for (long i = 0; i < iters; i++) {
+        const char **m = moves;
+        BENCH_OPAQUE(m);
+        BENCH_CONSUME(get_rps_winner(m[i % 3], m[(i + 1) % 3]));
+    }
+}
+
+static void run_broadcast(long iters) {
+    for (long i = 0; i < iters; i++) broadcast(benchSession, "ROLLED:P1=4\n");
+}
+
+static const Bench benches[] = {
+    {"move_piece", run_move_piece, 2},
+    {"init_chess_board", run_init_chess_board, 1},
+    {"is_legal_move", run_is_legal_move, 1},
+    {"get_chess_board_string", run_get_chess_board_string, 1},
+    {"checkGuess", run_check_guess, 1},
+    {"send_sl_board", run_send_sl_board, 1},
+    {"check_ttt_winner", run_check_ttt_winner, 1},
+    {"get_rps_winner", run_get_rps_winner, 1},
+    {"broadcast", run_broadcast, 1},
+};
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+static int load_baseline(const char *path, BaselineEntry *entries) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) return -1;
+    char line[512];
+    int count = 0;
+    while (count < BENCH_MAX_BASELINE && fgets(line, sizeof(line), fp)) {
+        BaselineEntry *e = &entries[count];
+        const char *mean = strstr(line, " mean_ns="), *ci = strstr(line, " ci95_ns=");
+        if (sscanf(line, "bench=%63s", e->name) != 1 || !mean || !ci) continue;
+        e->mean = atof(mean + 9);
+        e->ci95 = atof(ci + 9);
+        count++;
+    }
+    fclose(fp);
+    return count;
+}
+
+// Returns 1 when the benchmark is slower than its baseline beyond noise.
+static int run_bench(const Bench *b, int samples, long long sampleNs, const BaselineEntry *baseline, int baselineCount,
+                     double thresholdPct) {
+    // Calibrate: double the batch until one takes sampleNs; this also warms up.
+    long iters = 1;
+    for (;;) {
+        long long start = bench_now_ns();
+        b->run(iters);
+        long long elapsed = bench_now_ns() - start;
+        if (elapsed >= sampleNs || iters >= (1L << 40)) break;
+        iters = elapsed > sampleNs / 16 ? (long)((double)iters * sampleNs / elapsed) + 1 : iters * 2;
+    }
+
+    double perOp[BENCH_MAX_SAMPLES], sum = 0;
+    for (int s = 0; s < samples; s++) {
+        long long start = bench_now_ns();
+        b->run(iters);
+        perOp[s] = (double)(bench_now_ns() - start) / ((double)iters * b->opsPerIter);
+        sum += perOp[s];
+    }
+    double mean = sum / samples, var = 0;
+    for (int s = 0; s < samples; s++) var += (perOp[s] - mean) * (perOp[s] - mean);
+    double stddev = samples > 1 ? sqrt(var / (samples - 1)) : 0;
+    double ci95 = 1.96 * stddev / sqrt(samples);
+    qsort(perOp, samples, sizeof(double), compare_doubles);
+
+    printf("bench=%s samples=%d ops=%ld min_ns=%.2f median_ns=%.2f mean_ns=%.2f stddev_ns=%.2f ci95_ns=%.2f max_ns=%.2f",
+           b->name, samples, iters * b->opsPerIter, perOp[0], perOp[samples / 2], mean, stddev, ci95, perOp[samples - 1]);
+    int regressed = 0;
+    for (int i = 0; i < baselineCount; i++) {
+        if (strcmp(baseline[i].name, b->name) != 0) continue;
+        double changePct = 100.0 * (mean - baseline[i].mean) / baseline[i].mean;
+        regressed = changePct > thresholdPct && mean - ci95 > baseline[i].mean + baseline[i].ci95;
+        printf(" baseline_ns=%.2f change_pct=%+.1f regression=%d", baseline[i].mean, changePct, regressed);
+    }
+    printf("\n");
+    fflush(stdout);
+    return regressed;
+}
+
+static void usage(const char *prog) {
+    printf("Usage: %s [-f filter] [-n samples] [-t sample_ms] [-c cpu] [-b baseline] [-r pct] [-l]\n"
+           "  -f  only benchmarks whose name contains filter\n"
+           "  -n  samples per benchmark (default 30, at most %d)\n"
+           "  -t  target time per sample in ms (default 10)\n"
+           "  -c  pin to this CPU for steadier numbers\n"
+           "  -b  compare with the output of an earlier run\n"
+           "  -r  slowdown in percent that counts as a regression (default 5)\n"
+           "  -l  list the benchmarks\n", prog, BENCH_MAX_SAMPLES);
+}
+
+int main(int argc, char **argv) {
+    const char *filter = NULL, *baselinePath = NULL;
+    int samples = 30, sampleMs = 10, cpu = -1, opt;
+    double thresholdPct = 5;
+    while ((opt = getopt(argc, argv, "f:n:t:c:b:r:lh")) != -1) {
+        switch (opt) {
+            case 'f': filter = optarg; break;
+            case 'n': samples = atoi(optarg); break;
+            case 't': sampleMs = atoi(optarg); break;
+            case 'c': cpu = atoi(optarg); break;
+            case 'b': baselinePath = optarg; break;
+            case 'r': thresholdPct = atof(optarg); break;
+            case 'l':
+                for (size_t i = 0; i < sizeof(benches) / sizeof(benches[0]); i++) printf("%s\n", benches[i].name);
+                return 0;
+            default: usage(argv[0]); return 1;
+        }
+    }
+    if (samples < 2 || samples > BENCH_MAX_SAMPLES || sampleMs < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        if (sched_setaffinity(0, sizeof(set), &set) != 0) perror("sched_setaffinity");
+    }
+    BaselineEntry baseline[BENCH_MAX_BASELINE];
+    int baselineCount = 0;
+    if (baselinePath && (baselineCount = load_baseline(baselinePath, baseline)) < 0) {
+        perror(baselinePath);
+        return 1;
+    }
+    if (bench_setup() != 0) {
+        fprintf(stderr, "Benchmark setup failed\n");
+        return 1;
+    }
+
+    int regressions = 0;
+    for (size_t i = 0; i < sizeof(benches) / sizeof(benches[0]); i++)
+        if (!filter || strstr(benches[i].name, filter))
+            regressions += run_bench(&benches[i], samples, sampleMs * 1000000LL, baseline, baselineCount, thresholdPct);
+    bench_teardown();
+    return regressions ? 1 : 0;
+}
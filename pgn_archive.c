@@ -0,0 +1,278 @@
+#include "pgn_archive.h"
+#include "logger.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+
+#define PGN_QUEUE_SLOTS 2048            // must be a power of two
+#define PGN_BATCH_BYTES (1024 * 1024)   // one write() per batch
+#define PGN_RECORD_TEXT_MAX 16384
+#define PGN_FLUSH_MS 200                // the longest a game waits in the batch
+
+// Bounded multi-producer / single-consumer ring. Each slot carries a
+// sequence number so producers only ever do one CAS and never wait.
+typedef struct {
+    atomic_size_t seq;
+    PgnGameRecord record;
+} PgnSlot;
+
+static PgnSlot queue[PGN_QUEUE_SLOTS];
+static atomic_size_t enqueuePos;
+static size_t dequeuePos;
+
+static pthread_t writerThread;
+static sem_t wakeup;
+static atomic_int running;
+
+static char archiveDir[256];
+static size_t rotateLimit;
+static int archiveFd = -1;
+static size_t archiveFileBytes;
+static int archiveFileIndex;
+
+static char *batch;
+static size_t batchLen;
+static struct timespec batchDeadline;   // CLOCK_REALTIME, for sem_timedwait
+
+static atomic_ulong statSubmitted, statDropped, statWritten, statFiles;
+
+int pgn_archive_submit(const PgnGameRecord *record) {
+    if (!atomic_load_explicit(&running, memory_order_acquire)) return 0;
+    size_t pos = atomic_load_explicit(&enqueuePos, memory_order_relaxed);
+    for (;;) {
+        PgnSlot *slot = &queue[pos & (PGN_QUEUE_SLOTS - 1)];
+        size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        long diff = (long)seq - (long)pos;
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&enqueuePos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                slot->record = *record;
+                atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+                atomic_fetch_add_explicit(&statSubmitted, 1, memory_order_relaxed);
+                sem_post(&wakeup);
+                return 1;
+            }
+        } else if (diff < 0) {
+            atomic_fetch_add_explicit(&statDropped, 1, memory_order_relaxed);
+            return 0;
+        } else {
+            pos = atomic_load_explicit(&enqueuePos, memory_order_relaxed);
+        }
+    }
+}
+
+static PgnSlot *dequeue_slot(void) {
+    PgnSlot *slot = &queue[dequeuePos & (PGN_QUEUE_SLOTS - 1)];
+    size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+    if ((long)seq - (long)(dequeuePos + 1) < 0) return NULL;
+    return slot;
+}
+
+static void release_slot(PgnSlot *slot) {
+    atomic_store_explicit(&slot->seq, dequeuePos + PGN_QUEUE_SLOTS, memory_order_release);
+    dequeuePos++;
+}
+
+static const char *result_string(PgnResult result) {
+    switch (result) {
+        case PGN_WHITE_WINS: return "1-0";
+        case PGN_BLACK_WINS: return "0-1";
+        case PGN_DRAW: return "1/2-1/2";
+        default: return "*";
+    }
+}
+
+static void square_name(unsigned char sq, char *out) {
+    out[0] = 'a' + (sq & 7);
+    out[1] = '8' - (sq >> 3);
+}
+
+size_t pgn_format_game(const PgnGameRecord *record, char *out, size_t size) {
+    struct tm tm;
+    char date[16];
+    localtime_r(&record->started, &tm);
+    strftime(date, sizeof(date), "%Y.%m.%d", &tm);
+
+    int n = snprintf(out, size,
+        "[Event \"GameSys Chess\"]\n"
+        "[Site \"GameSys\"]\n"
+        "[Date \"%s\"]\n"
+        "[Round \"-\"]\n"
+        "[White \"%s\"]\n"
+        "[Black \"%s\"]\n"
+        "[Result \"%s\"]\n"
+        "[PlyCount \"%d\"]\n"
+        "[Duration \"%ld\"]\n"
+        "[Termination \"%s\"]\n\n",
+        date, record->white, record->black, result_string(record->result),
+        record->plyCount, (long)(record->finished - record->started), record->termination);
+    if (n < 0 || (size_t)n >= size) return 0;
+    size_t len = n;
+
+    int kept = record->plyCount < PGN_MAX_PLIES ? record->plyCount : PGN_MAX_PLIES;
+    int lineLen = 0;
+    for (int i = 0; i < kept; i++) {
+        const PgnMove *m = &record->moves[i];
+        char from[3] = {0}, to[3] = {0}, token[24];
+        square_name(m->from, from);
+        square_name(m->to, to);
+        // Long algebraic notation: the server does not track check or
+        // disambiguation, so SAN cannot be produced reliably.
+        int t;
+        if (i % 2 == 0)
+            t = snprintf(token, sizeof(token), "%d. %c%s%c%s", i / 2 + 1, m->piece, from, m->capture ? 'x' : '-', to);
+        else
+            t = snprintf(token, sizeof(token), "%c%s%c%s", m->piece, from, m->capture ? 'x' : '-', to);
+        if (lineLen + t + 1 > 79) {
+            if (len + 1 >= size) return 0;
+            out[len++] = '\n';
+            lineLen = 0;
+        } else if (lineLen > 0) {
+            if (len + 1 >= size) return 0;
+            out[len++] = ' ';
+            lineLen++;
+        }
+        if (len + t >= size) return 0;
+        memcpy(out + len, token, t);
+        len += t;
+        lineLen += t;
+    }
+    n = snprintf(out + len, size - len, "%s%s\n\n", lineLen > 0 ? " " : "", result_string(record->result));
+    if (n < 0 || (size_t)n >= size - len) return 0;
+    return len + n;
+}
+
+static int open_next_file(void) {
+    char path[512];
+    char stamp[32];
+    time_t now = time(NULL);
+    struct tm tm;
+    localtime_r(&now, &tm);
+    strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &tm);
+    if (archiveFd >= 0) close(archiveFd);
+    snprintf(path, sizeof(path), "%s/chess-%s-%04d.pgn", archiveDir, stamp, archiveFileIndex++);
+    archiveFd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    archiveFileBytes = 0;
+    if (archiveFd < 0) {
+        LOG_ERROR("Archive: cannot open %s: %s", path, strerror(errno));
+        return -1;
+    }
+    atomic_fetch_add_explicit(&statFiles, 1, memory_order_relaxed);
+    return 0;
+}
+
+static void flush_batch(void) {
+    if (batchLen == 0) return;
+    if (archiveFd < 0 || archiveFileBytes + batchLen > rotateLimit) {
+        if (archiveFd < 0 || archiveFileBytes > 0) open_next_file();
+    }
+    size_t off = 0;
+    while (archiveFd >= 0 && off < batchLen) {
+        ssize_t w = write(archiveFd, batch + off, batchLen - off);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            LOG_ERROR("Archive: write failed: %s", strerror(errno));
+            break;
+        }
+        off += w;
+    }
+    archiveFileBytes += off;
+    batchLen = 0;
+}
+
+static struct timespec flush_deadline(void) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_nsec += PGN_FLUSH_MS * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    return deadline;
+}
+
+static int deadline_passed(const struct timespec *deadline) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return now.tv_sec > deadline->tv_sec || (now.tv_sec == deadline->tv_sec && now.tv_nsec >= deadline->tv_nsec);
+}
+
+static void *writer_main(void *arg) {
+    (void)arg;
+    for (;;) {
+        // An empty batch waits for the next game (or to check it should
+        // stop); a started one only until its first game is due.
+        struct timespec deadline = batchLen > 0 ? batchDeadline : flush_deadline();
+        sem_timedwait(&wakeup, &deadline);
+
+        PgnSlot *slot;
+        while ((slot = dequeue_slot()) != NULL) {
+            if (batchLen + PGN_RECORD_TEXT_MAX > PGN_BATCH_BYTES) flush_batch();
+            if (batchLen == 0) batchDeadline = flush_deadline();
+            batchLen += pgn_format_game(&slot->record, batch + batchLen, PGN_BATCH_BYTES - batchLen);
+            release_slot(slot);
+            atomic_fetch_add_explicit(&statWritten, 1, memory_order_relaxed);
+        }
+        // Large batches go out as soon as they fill; small ones PGN_FLUSH_MS
+        // after their first game, so a steady trickle still turns into few
+        // writes and no game stays in memory longer than that.
+        if (batchLen >= PGN_BATCH_BYTES / 2 || (batchLen > 0 && deadline_passed(&batchDeadline))) flush_batch();
+
+        if (!atomic_load_explicit(&running, memory_order_acquire) && dequeue_slot() == NULL) {
+            flush_batch();
+            break;
+        }
+    }
+    return NULL;
+}
+
+int pgn_archive_start(const char *dir, size_t rotateBytes) {
+    if (atomic_load(&running)) return 0;
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        LOG_ERROR("Archive: cannot create %s: %s", dir, strerror(errno));
+        return -1;
+    }
+    snprintf(archiveDir, sizeof(archiveDir), "%s", dir);
+    rotateLimit = rotateBytes;
+    batch = malloc(PGN_BATCH_BYTES);
+    if (!batch) return -1;
+    batchLen = 0;
+    for (size_t i = 0; i < PGN_QUEUE_SLOTS; i++) atomic_init(&queue[i].seq, i);
+    atomic_store(&enqueuePos, 0);
+    dequeuePos = 0;
+    sem_init(&wakeup, 0, 0);
+    atomic_store(&running, 1);
+    if (pthread_create(&writerThread, NULL, writer_main, NULL) != 0) {
+        atomic_store(&running, 0);
+        free(batch);
+        batch = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+void pgn_archive_stop(void) {
+    if (!atomic_exchange(&running, 0)) return;
+    sem_post(&wakeup);
+    pthread_join(writerThread, NULL);
+    if (archiveFd >= 0) close(archiveFd);
+    archiveFd = -1;
+    sem_destroy(&wakeup);
+    free(batch);
+    batch = NULL;
+}
+
+void pgn_archive_get_stats(PgnArchiveStats *stats) {
+    stats->submitted = atomic_load(&statSubmitted);
+    stats->dropped = atomic_load(&statDropped);
+    stats->written = atomic_load(&statWritten);
+    stats->files = atomic_load(&statFiles);
+}
@@ -0,0 +1,57 @@
+#ifndef PGN_ARCHIVE_H
+#define PGN_ARCHIVE_H
+
+#include <stddef.h>
+#include <time.h>
+
+#define PGN_MAX_PLIES 512
+#define PGN_NAME_LEN 48
+
+typedef enum { PGN_WHITE_WINS, PGN_BLACK_WINS, PGN_DRAW, PGN_UNFINISHED } PgnResult;
+
+// One half-move. Squares are row * 8 + col with row 0 being rank 8,
+// the same orientation as ChessBoard.
+typedef struct {
+    unsigned char from;
+    unsigned char to;
+    char piece;             // 'P', 'N', 'B', 'R', 'Q' or 'K'
+    unsigned char capture;
+} PgnMove;
+
+// Fixed-size record so submitting a game never allocates.
+typedef struct {
+    char white[PGN_NAME_LEN];
+    char black[PGN_NAME_LEN];
+    char termination[24];
+    PgnResult result;
+    time_t started;
+    time_t finished;
+    int plyCount;           // may exceed PGN_MAX_PLIES, only the first moves are kept
+    PgnMove moves[PGN_MAX_PLIES];
+} PgnGameRecord;
+
+typedef struct {
+    unsigned long submitted;
+    unsigned long dropped;
+    unsigned long written;
+    unsigned long files;
+} PgnArchiveStats;
+
+// Starts the background writer. Files are created in dir and rotated once
+// they grow past rotateBytes. Returns 0 on success, -1 on failure.
+int pgn_archive_start(const char *dir, size_t rotateBytes);
+
+// Queues a finished game. Never blocks: if the queue is full the record is
+// dropped and counted. Returns 1 if queued, 0 if dropped or not running.
+int pgn_archive_submit(const PgnGameRecord *record);
+
+// Flushes everything still queued and joins the writer thread.
+void pgn_archive_stop(void);
+
+void pgn_archive_get_stats(PgnArchiveStats *stats);
+
+// Formats a record as PGN text. Returns the number of bytes written, or 0
+// if it does not fit in size.
+size_t pgn_format_game(const PgnGameRecord *record, char *out, size_t size);
+
+#endif
@@ -0,0 +1,381 @@
+#include "player_stats.h"
+#include "rank_tree.h"
+#include "logger.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#define PLAYER_ELO_K 32
+#define PLAYER_INITIAL_CAPACITY 1024
+
+typedef struct {
+    char name[PLAYER_NAME_SIZE];
+    uint32_t played;            // a bit per game
+} Player;
+
+static Player *players;
+static int numPlayers, playerCapacity;
+static PlayerGameStats *stats[PLAYER_STATS_MAX_GAMES];     // per game, indexed by player
+static RankTree *boards[PLAYER_STATS_MAX_GAMES];
+static const char *const *gameNames;
+static int games;
+static int dirty;               // recorded since the last snapshot
+
+// Names to ids: open addressing, -1 = empty, at most half full.
+static int *nameTable;
+static int nameTableSize;
+
+// The snapshot being written, if any.
+typedef struct {
+    char *data;
+    size_t len;
+    char path[256];
+    int error;                  // errno of the step that failed, 0 once written
+    int done;
+} Snapshot;
+
+static pthread_t writerThread;
+static Snapshot *writing;
+
+static uint32_t name_hash(const char *name) {
+    uint32_t h = 2166136261u;
+    for (; *name; name++) h = (h ^ (unsigned char)*name) * 16777619u;
+    return h;
+}
+
+static int name_slot(const char *name) {
+    int mask = nameTableSize - 1, i = name_hash(name) & mask;
+    while (nameTable[i] >= 0 && strcmp(players[nameTable[i]].name, name) != 0) i = (i + 1) & mask;
+    return i;
+}
+
+static int grow_names(void) {
+    int *old = nameTable, oldSize = nameTableSize;
+    int size = oldSize ? oldSize * 2 : PLAYER_INITIAL_CAPACITY * 2;
+    int *table = malloc(size * sizeof(int));
+    if (!table) return -1;
+    memset(table, 0xff, size * sizeof(int));
+    nameTable = table;
+    nameTableSize = size;
+    for (int i = 0; i < oldSize; i++)
+        if (old[i] >= 0) nameTable[name_slot(players[old[i]].name)] = old[i];
+    free(old);
+    return 0;
+}
+
+static int grow_players(void) {
+    int capacity = playerCapacity ? playerCapacity * 2 : PLAYER_INITIAL_CAPACITY;
+    Player *grown = realloc(players, capacity * sizeof(Player));
+    if (!grown) return -1;
+    players = grown;
+    for (int g = 0; g < games; g++) {
+        PlayerGameStats *table = realloc(stats[g], capacity * sizeof(PlayerGameStats));
+        if (!table) return -1;
+        memset(table + playerCapacity, 0, (capacity - playerCapacity) * sizeof(PlayerGameStats));
+        stats[g] = table;
+    }
+    playerCapacity = capacity;
+    return 0;
+}
+
+static void clear_tables(void) {
+    for (int g = 0; g < PLAYER_STATS_MAX_GAMES; g++) {
+        free(stats[g]);
+        rank_tree_free(boards[g]);
+        stats[g] = NULL;
+        boards[g] = NULL;
+    }
+    free(players);
+    free(nameTable);
+    players = NULL;
+    nameTable = NULL;
+    numPlayers = playerCapacity = nameTableSize = 0;
+    dirty = 0;
+}
+
+int player_stats_init(int count, const char *const *names) {
+    clear_tables();
+    games = count < PLAYER_STATS_MAX_GAMES ? count : PLAYER_STATS_MAX_GAMES;
+    gameNames = names;
+    for (int g = 0; g < games; g++) {
+        boards[g] = rank_tree_create(PLAYER_INITIAL_CAPACITY);
+        if (!boards[g]) {
+            clear_tables();
+            games = 0;
+            return -1;
+        }
+    }
+    if (grow_players() != 0 || grow_names() != 0) {
+        clear_tables();
+        games = 0;
+        return -1;
+    }
+    return 0;
+}
+
+void player_stats_free(void) {
+    player_stats_wait();
+    clear_tables();
+    games = 0;
+}
+
+int player_stats_valid_name(const char *name) {
+    size_t len = strlen(name);
+    if (len == 0 || len >= PLAYER_NAME_SIZE) return 0;
+    for (size_t i = 0; i < len; i++)
+        if (!isalnum((unsigned char)name[i]) && name[i] != '_' && name[i] != '-') return 0;
+    return 1;
+}
+
+int player_stats_find(const char *name) {
+    if (!nameTable || !player_stats_valid_name(name)) return -1;
+    return nameTable[name_slot(name)];
+}
+
+int player_stats_player(const char *name) {
+    if (!nameTable || !player_stats_valid_name(name)) return -1;
+    int slot = name_slot(name);
+    if (nameTable[slot] >= 0) return nameTable[slot];
+    if (numPlayers == playerCapacity && grow_players() != 0) return -1;
+    if ((numPlayers + 1) * 2 > nameTableSize) {
+        if (grow_names() != 0) return -1;
+        slot = name_slot(name);
+    }
+    int id = numPlayers++;
+    memset(&players[id], 0, sizeof(Player));
+    strcpy(players[id].name, name);
+    nameTable[slot] = id;
+    dirty = 1;
+    return id;
+}
+
+const char *player_stats_name(int player) {
+    return player >= 0 && player < numPlayers ? players[player].name : NULL;
+}
+
+int player_stats_count(void) {
+    return numPlayers;
+}
+
+static int has_played(int game, int player) {
+    return (players[player].played >> game) & 1;
+}
+
+static RankKey board_key(int game, int player) {
+    return (RankKey){stats[game][player].rating, (uint32_t)player};
+}
+
+void player_stats_record(int game, const int ids[2], int winner, const uint32_t turns[2], const uint64_t turnNs[2]) {
+    if (game < 0 || game >= games || (ids[0] < 0 && ids[1] < 0) || ids[0] == ids[1]) return;
+    int32_t ratings[2];
+    for (int side = 0; side < 2; side++)
+        ratings[side] = ids[side] >= 0 && has_played(game, ids[side]) ? stats[game][ids[side]].rating : PLAYER_RATING_START;
+    for (int side = 0; side < 2; side++) {
+        int id = ids[side];
+        if (id < 0 || id >= numPlayers) continue;
+        PlayerGameStats *s = &stats[game][id];
+        if (has_played(game, id)) rank_tree_remove(boards[game], board_key(game, id));
+        players[id].played |= 1u << game;
+        double expected = 1.0 / (1.0 + pow(10.0, (ratings[1 - side] - ratings[side]) / 400.0));
+        double score = winner < 0 ? 0.5 : winner == side ? 1.0 : 0.0;
+        s->rating = ratings[side] + (int32_t)lround(PLAYER_ELO_K * (score - expected));
+        if (winner < 0) s->draws++;
+        else if (winner == side) s->wins++;
+        else s->losses++;
+        s->turns += turns[side];
+        s->turnNs += turnNs[side];
+        if (rank_tree_insert(boards[game], board_key(game, id)) != 0)
+            LOG_WARN("Stats: out of memory, %s is missing from the %s leaderboard", players[id].name, gameNames[game]);
+    }
+    dirty = 1;
+}
+
+const PlayerGameStats *player_stats_get(int game, int player) {
+    if (game < 0 || game >= games || player < 0 || player >= numPlayers || !has_played(game, player)) return NULL;
+    return &stats[game][player];
+}
+
+int player_stats_rank(int game, int player, int *total) {
+    *total = game >= 0 && game < games ? rank_tree_size(boards[game]) : 0;
+    if (!player_stats_get(game, player)) return -1;
+    return rank_tree_rank(boards[game], board_key(game, player));
+}
+
+int player_stats_at(int game, int rank) {
+    RankKey key;
+    if (game < 0 || game >= games || rank_tree_select(boards[game], rank, &key) != 0) return -1;
+    return (int)key.id;
+}
+
+// Snapshots
+typedef struct {
+    const char *p, *end;
+} Reader;
+
+static const void *take(Reader *r, size_t n) {
+    if ((size_t)(r->end - r->p) < n) return NULL;
+    const void *at = r->p;
+    r->p += n;
+    return at;
+}
+
+static int read_string(Reader *r, char *out, size_t size) {
+    const unsigned char *len = take(r, 1);
+    const char *bytes = len ? take(r, *len) : NULL;
+    if (!bytes || *len >= size) return -1;
+    memcpy(out, bytes, *len);
+    out[*len] = '\0';
+    return 0;
+}
+
+static int parse_snapshot(const char *data, size_t size) {
+    Reader r = {data, data + size};
+    const char *magic = take(&r, 8);
+    const uint32_t *counts = take(&r, 2 * sizeof(uint32_t));
+    if (!magic || memcmp(magic, PLAYER_STATS_MAGIC, 8) != 0 || !counts || counts[0] > 255) return -1;
+    int fileGames = counts[0], gameMap[256];
+    for (int f = 0; f < fileGames; f++) {
+        char name[256];
+        if (read_string(&r, name, sizeof(name)) != 0) return -1;
+        gameMap[f] = -1;
+        for (int g = 0; g < games; g++)
+            if (strcmp(name, gameNames[g]) == 0) gameMap[f] = g;
+    }
+    for (uint32_t i = 0; i < counts[1]; i++) {
+        char name[PLAYER_NAME_SIZE];
+        if (read_string(&r, name, sizeof(name)) != 0) return -1;
+        int id = player_stats_player(name);
+        const unsigned char *played = take(&r, 1);
+        if (id < 0 || !played) return -1;
+        for (int k = 0; k < *played; k++) {
+            const unsigned char *f = take(&r, 1);
+            const PlayerGameStats *s = take(&r, sizeof(PlayerGameStats));
+            if (!f || !s || *f >= fileGames) return -1;
+            int g = gameMap[*f];
+            if (g < 0 || has_played(g, id)) continue;
+            memcpy(&stats[g][id], s, sizeof(PlayerGameStats));
+            players[id].played |= 1u << g;
+            if (rank_tree_insert(boards[g], board_key(g, id)) != 0) return -1;
+        }
+    }
+    return r.p == r.end ? numPlayers : -1;
+}
+
+int player_stats_load(const char *path) {
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return errno == ENOENT ? 0 : -1;
+    char *data = NULL;
+    long size = -1;
+    if (fseek(fp, 0, SEEK_END) == 0 && (size = ftell(fp)) >= 0 && fseek(fp, 0, SEEK_SET) == 0) {
+        data = malloc(size ? size : 1);
+        if (data && fread(data, 1, size, fp) != (size_t)size) size = -1;
+    }
+    fclose(fp);
+    int loaded = data && size >= 0 ? parse_snapshot(data, size) : -1;
+    free(data);
+    if (loaded < 0) player_stats_init(games, gameNames);
+    else dirty = 0;
+    return loaded;
+}
+
+static char *put(char *p, const void *data, size_t len) {
+    memcpy(p, data, len);
+    return p + len;
+}
+
+static char *serialize(size_t *len) {
+    size_t size = 8 + 2 * sizeof(uint32_t) + (size_t)numPlayers * (2 + PLAYER_NAME_SIZE);
+    for (int g = 0; g < games; g++) size += 1 + strlen(gameNames[g]) + (size_t)rank_tree_size(boards[g]) * (1 + sizeof(PlayerGameStats));
+    char *buf = malloc(size), *p = buf;
+    if (!buf) return NULL;
+    uint32_t counts[2] = {games, numPlayers};
+    p = put(p, PLAYER_STATS_MAGIC, 8);
+    p = put(p, counts, sizeof(counts));
+    for (int g = 0; g < games; g++) {
+        unsigned char n = strlen(gameNames[g]);
+        p = put(p, &n, 1);
+        p = put(p, gameNames[g], n);
+    }
+    for (int id = 0; id < numPlayers; id++) {
+        unsigned char n = strlen(players[id].name), played = __builtin_popcount(players[id].played);
+        p = put(p, &n, 1);
+        p = put(p, players[id].name, n);
+        p = put(p, &played, 1);
+        for (int g = 0; g < games; g++) {
+            if (!has_played(g, id)) continue;
+            unsigned char game = g;
+            p = put(p, &game, 1);
+            p = put(p, &stats[g][id], sizeof(PlayerGameStats));
+        }
+    }
+    *len = p - buf;
+    return buf;
+}
+
+// Runs on its own short-lived thread, so it does not log: the logger
+// keeps a ring for every thread that ever logged. player_stats_wait
+// reports the error from the main thread.
+static void *writer_main(void *arg) {
+    Snapshot *s = arg;
+    char tmp[sizeof(s->path) + 8];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", s->path);
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    int error = fd < 0 ? errno : 0;
+    size_t done = 0;
+    while (!error && done < s->len) {
+        ssize_t n = write(fd, s->data + done, s->len - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) error = n < 0 ? errno : EIO;
+        else done += n;
+    }
+    if (!error && fsync(fd) != 0) error = errno;
+    if (fd >= 0 && close(fd) != 0 && !error) error = errno;
+    if (!error && rename(tmp, s->path) != 0) error = errno;
+    if (error) unlink(tmp);
+    s->error = error;
+    __atomic_store_n(&s->done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+int player_stats_wait(void) {
+    if (!writing) return 0;
+    pthread_join(writerThread, NULL);
+    int error = writing->error;
+    if (error) {
+        LOG_ERROR("Stats: cannot write %s: %s", writing->path, strerror(error));
+        dirty = 1;              // the next snapshot tries again
+    }
+    free(writing->data);
+    free(writing);
+    writing = NULL;
+    return error ? -1 : 0;
+}
+
+int player_stats_snapshot(const char *path) {
+    if (writing) {
+        if (!__atomic_load_n(&writing->done, __ATOMIC_ACQUIRE)) return 0;
+        player_stats_wait();
+    }
+    if (!dirty) return 0;
+    Snapshot *s = calloc(1, sizeof(Snapshot));
+    if (!s || strlen(path) >= sizeof(s->path) || !(s->data = serialize(&s->len))) {
+        free(s);
+        return -1;
+    }
+    strcpy(s->path, path);
+    if (pthread_create(&writerThread, NULL, writer_main, s) != 0) {
+        free(s->data);
+        free(s);
+        return -1;
+    }
+    writing = s;
+    dirty = 0;
+    return 1;
+}
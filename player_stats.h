@@ -0,0 +1,69 @@
+#ifndef PLAYER_STATS_H
+#define PLAYER_STATS_H
+
+#include <stdint.h>
+
+// Results of every named player in every game, kept for as long as the
+// server runs and snapshotted to disk. For each game an order-statistic
+// tree (rank_tree.h) orders the players who have played it by rating, so
+// the top of a leaderboard and any player's place on it are O(log n).
+// Ratings are Elo, starting at PLAYER_RATING_START.
+//
+// Snapshot file (host byte order, little endian in practice): the magic,
+// the number of games and of players, each game's name (a length byte and
+// the bytes), then per player a length byte and the name, a byte counting
+// the games played and, for each, a game byte and a PlayerGameStats.
+// Games are matched by name on loading, so games may be added or reordered.
+#define PLAYER_STATS_MAGIC "GSSTATS1"
+#define PLAYER_NAME_SIZE 24             // with the terminating NUL
+#define PLAYER_STATS_MAX_GAMES 16
+#define PLAYER_RATING_START 1200
+
+typedef struct {
+    uint32_t wins, losses, draws;
+    int32_t rating;
+    uint32_t turns;
+    uint32_t reserved;
+    uint64_t turnNs;            // time taken over those turns
+} PlayerGameStats;
+
+// Sets up empty tables for count games. Returns 0, or -1 if out of memory.
+int player_stats_init(int count, const char *const *gameNames);
+void player_stats_free(void);
+
+// 1 to PLAYER_NAME_SIZE - 1 letters, digits, '_' or '-'.
+int player_stats_valid_name(const char *name);
+// The player's id, registering the name if it is new; -1 if it is not a
+// valid name or memory runs out.
+int player_stats_player(const char *name);
+// The player's id, or -1 if the name is unknown.
+int player_stats_find(const char *name);
+const char *player_stats_name(int player);
+int player_stats_count(void);
+
+// A finished game between players[0] and players[1]: winner 0 or 1, or -1
+// for a draw. A player of -1 (no name) is not recorded and counts as an
+// opponent rated PLAYER_RATING_START. turns and turnNs are each side's
+// turns in the game and the time they took.
+void player_stats_record(int game, const int players[2], int winner, const uint32_t turns[2], const uint64_t turnNs[2]);
+// NULL if the player has not played the game.
+const PlayerGameStats *player_stats_get(int game, int player);
+// 0-based place on the game's leaderboard, -1 if not on it; *total gets
+// the number of players on it.
+int player_stats_rank(int game, int player, int *total);
+// The player at a 0-based place, or -1 past the end.
+int player_stats_at(int game, int rank);
+
+// Reads a snapshot into empty tables. Returns the number of players, 0 if
+// there is no file, or -1 if it is unreadable.
+int player_stats_load(const char *path);
+// Serializes everything recorded since the last snapshot and writes it to
+// path from a background thread, through a temporary file renamed over
+// the old one. Returns 1 if started, 0 if nothing changed or the previous
+// snapshot is still being written, -1 on failure.
+int player_stats_snapshot(const char *path);
+// Waits for a snapshot being written. Returns 0, or -1 if writing it
+// failed, which is logged and leaves the changes for the next snapshot.
+int player_stats_wait(void);
+
+#endif
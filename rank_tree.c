@@ -0,0 +1,176 @@
+#include "rank_tree.h"
+
+#include <stdlib.h>
+
+#define NIL -1
+
+typedef struct {
+    RankKey key;
+    uint32_t priority;
+    int left, right;
+    int size;
+} RankNode;
+
+// Nodes live in one growable array and link by index, so the tree never
+// allocates per insert once it has grown to its working size.
+struct RankTree {
+    RankNode *nodes;
+    int capacity;
+    int used;
+    int freeList;
+    int root;
+    uint32_t seed;
+};
+
+static int compare(RankKey a, RankKey b) {
+    if (a.score != b.score) return a.score > b.score ? -1 : 1;
+    if (a.id != b.id) return a.id < b.id ? -1 : 1;
+    return 0;
+}
+
+static int size_of(const RankTree *t, int n) {
+    return n == NIL ? 0 : t->nodes[n].size;
+}
+
+static void update(RankTree *t, int n) {
+    t->nodes[n].size = 1 + size_of(t, t->nodes[n].left) + size_of(t, t->nodes[n].right);
+}
+
+RankTree *rank_tree_create(int initialCapacity) {
+    RankTree *t = calloc(1, sizeof(RankTree));
+    if (!t) return NULL;
+    t->capacity = initialCapacity > 16 ? initialCapacity : 16;
+    t->nodes = malloc(t->capacity * sizeof(RankNode));
+    if (!t->nodes) {
+        free(t);
+        return NULL;
+    }
+    t->root = NIL;
+    t->freeList = NIL;
+    t->seed = 0x2545F491u;
+    return t;
+}
+
+void rank_tree_free(RankTree *tree) {
+    if (!tree) return;
+    free(tree->nodes);
+    free(tree);
+}
+
+int rank_tree_size(const RankTree *tree) {
+    return size_of(tree, tree->root);
+}
+
+static int alloc_node(RankTree *t, RankKey key) {
+    int n;
+    if (t->freeList != NIL) {
+        n = t->freeList;
+        t->freeList = t->nodes[n].left;
+    } else {
+        if (t->used == t->capacity) {
+            RankNode *grown = realloc(t->nodes, 2 * t->capacity * sizeof(RankNode));
+            if (!grown) return NIL;
+            t->nodes = grown;
+            t->capacity *= 2;
+        }
+        n = t->used++;
+    }
+    t->seed ^= t->seed << 13;
+    t->seed ^= t->seed >> 17;
+    t->seed ^= t->seed << 5;
+    t->nodes[n] = (RankNode){key, t->seed, NIL, NIL, 1};
+    return n;
+}
+
+// Splits n into keys ordered before key (*l) and the rest (*r).
+static void split(RankTree *t, int n, RankKey key, int *l, int *r) {
+    if (n == NIL) {
+        *l = *r = NIL;
+    } else if (compare(t->nodes[n].key, key) < 0) {
+        split(t, t->nodes[n].right, key, &t->nodes[n].right, r);
+        *l = n;
+        update(t, n);
+    } else {
+        split(t, t->nodes[n].left, key, l, &t->nodes[n].left);
+        *r = n;
+        update(t, n);
+    }
+}
+
+static int merge(RankTree *t, int l, int r) {
+    if (l == NIL) return r;
+    if (r == NIL) return l;
+    if (t->nodes[l].priority > t->nodes[r].priority) {
+        t->nodes[l].right = merge(t, t->nodes[l].right, r);
+        update(t, l);
+        return l;
+    }
+    t->nodes[r].left = merge(t, l, t->nodes[r].left);
+    update(t, r);
+    return r;
+}
+
+int rank_tree_insert(RankTree *tree, RankKey key) {
+    if (rank_tree_rank(tree, key) >= 0) return -1;
+    int n = alloc_node(tree, key);
+    if (n == NIL) return -1;
+    int l, r;
+    split(tree, tree->root, key, &l, &r);
+    tree->root = merge(tree, merge(tree, l, n), r);
+    return 0;
+}
+
+static int remove_from(RankTree *t, int n, RankKey key, int *removed) {
+    if (n == NIL) return NIL;
+    int c = compare(key, t->nodes[n].key);
+    if (c == 0) {
+        int joined = merge(t, t->nodes[n].left, t->nodes[n].right);
+        t->nodes[n].left = t->freeList;
+        t->freeList = n;
+        *removed = 1;
+        return joined;
+    }
+    if (c < 0) t->nodes[n].left = remove_from(t, t->nodes[n].left, key, removed);
+    else t->nodes[n].right = remove_from(t, t->nodes[n].right, key, removed);
+    update(t, n);
+    return n;
+}
+
+int rank_tree_remove(RankTree *tree, RankKey key) {
+    int removed = 0;
+    tree->root = remove_from(tree, tree->root, key, &removed);
+    return removed ? 0 : -1;
+}
+
+int rank_tree_rank(const RankTree *tree, RankKey key) {
+    int n = tree->root, rank = 0;
+    while (n != NIL) {
+        int c = compare(key, tree->nodes[n].key);
+        if (c == 0) return rank + size_of(tree, tree->nodes[n].left);
+        if (c < 0) {
+            n = tree->nodes[n].left;
+        } else {
+            rank += size_of(tree, tree->nodes[n].left) + 1;
+            n = tree->nodes[n].right;
+        }
+    }
+    return -1;
+}
+
+int rank_tree_select(const RankTree *tree, int rank, RankKey *out) {
+    int n = tree->root;
+    if (rank < 0 || rank >= size_of(tree, n)) return -1;
+    while (n != NIL) {
+        int leftSize = size_of(tree, tree->nodes[n].left);
+        if (rank < leftSize) {
+            n = tree->nodes[n].left;
+        } else if (rank == leftSize) {
+            *out = tree->nodes[n].key;
+            return 0;
+        } else {
+            rank -= leftSize + 1;
+            n = tree->nodes[n].right;
+        }
+    }
+    return -1;
+}
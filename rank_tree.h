@@ -0,0 +1,29 @@
+#ifndef RANK_TREE_H
+#define RANK_TREE_H
+
+#include <stdint.h>
+
+// Order-statistic tree: a treap whose nodes also count their subtree, so
+// insert, remove, "rank of key" and "key at rank" are all O(log n).
+// Keys sort by score descending, then id ascending, so rank 0 is the leader.
+typedef struct {
+    int64_t score;
+    uint32_t id;
+} RankKey;
+
+typedef struct RankTree RankTree;
+
+RankTree *rank_tree_create(int initialCapacity);
+void rank_tree_free(RankTree *tree);
+
+int rank_tree_size(const RankTree *tree);
+// Returns 0, or -1 if the key is already present or memory runs out.
+int rank_tree_insert(RankTree *tree, RankKey key);
+// Returns 0, or -1 if the key is not present.
+int rank_tree_remove(RankTree *tree, RankKey key);
+// 0-based position of key, or -1 if it is not present.
+int rank_tree_rank(const RankTree *tree, RankKey key);
+// Key at a 0-based position. Returns 0, or -1 if rank is out of range.
+int rank_tree_select(const RankTree *tree, int rank, RankKey *out);
+
+#endif
@@ -0,0 +1,241 @@
+#include "replay_archive.h"
+#include "logger.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define REPLAY_MAX_FILES 16             // mapped at once; older files stay on disk
+#define REPLAY_INDEX_CAPACITY 16384     // games per file
+
+typedef struct {
+    char *map;                  // NULL when the slot is free
+    size_t size;
+    uint32_t seq;
+    int live;                   // games still being recorded here
+} ReplayFile;
+
+static ReplayFile files[REPLAY_MAX_FILES];
+static int current = -1;        // slot new games go to
+static uint32_t nextSeq = 1;
+static char replayDir[256];
+static size_t rotateLimit;
+static int fileIndex;
+
+static ReplayFileHeader *file_header(ReplayFile *f) {
+    return (ReplayFileHeader *)f->map;
+}
+
+static ReplayIndexEntry *file_index(ReplayFile *f) {
+    return (ReplayIndexEntry *)(f->map + sizeof(ReplayFileHeader));
+}
+
+static ReplayRecord *file_record(ReplayFile *f, uint32_t offset) {
+    return (ReplayRecord *)(f->map + offset);
+}
+
+// Maps a new file into a free slot, or the slot of the oldest file that
+// has no game still being recorded.
+static int open_next_file(void) {
+    int slot = -1;
+    for (int i = 0; i < REPLAY_MAX_FILES; i++) {
+        if (!files[i].map) {
+            slot = i;
+            break;
+        }
+        if (files[i].live == 0 && (slot < 0 || files[i].seq < files[slot].seq)) slot = i;
+    }
+    if (slot < 0) {
+        LOG_WARN("Replays: all %d files have live games, not recording new ones", REPLAY_MAX_FILES);
+        return -1;
+    }
+    if (files[slot].map) munmap(files[slot].map, files[slot].size);
+    files[slot].map = NULL;
+
+    char path[512];
+    char stamp[32];
+    time_t now = time(NULL);
+    struct tm tm;
+    localtime_r(&now, &tm);
+    strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &tm);
+    // The pid keeps the files of cluster nodes sharing the directory apart.
+    snprintf(path, sizeof(path), "%s/replay-%s-%d-%04d.gsr", replayDir, stamp, (int)getpid(), fileIndex++);
+    size_t size = rotateLimit * 2;
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || ftruncate(fd, size) != 0) {
+        LOG_ERROR("Replays: cannot create %s: %s", path, strerror(errno));
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    // The file is sparse: disk is only used as records are written.
+    char *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        LOG_ERROR("Replays: cannot map %s: %s", path, strerror(errno));
+        return -1;
+    }
+    files[slot] = (ReplayFile){map, size, nextSeq++, 0};
+    ReplayFileHeader *h = file_header(&files[slot]);
+    memcpy(h->magic, REPLAY_MAGIC, sizeof(h->magic));
+    h->indexCapacity = REPLAY_INDEX_CAPACITY;
+    h->games = 0;
+    h->used = sizeof(ReplayFileHeader) + REPLAY_INDEX_CAPACITY * sizeof(ReplayIndexEntry);
+    h->size = size;
+    h->created = now;
+    current = slot;
+    return 0;
+}
+
+int replay_start(const char *dir, size_t rotateBytes) {
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        LOG_ERROR("Replays: cannot create %s: %s", dir, strerror(errno));
+        return -1;
+    }
+    snprintf(replayDir, sizeof(replayDir), "%s", dir);
+    // Offsets are 32 bits.
+    rotateLimit = rotateBytes < UINT32_MAX / 2 ? rotateBytes : UINT32_MAX / 2;
+    return open_next_file();
+}
+
+void replay_stop(void) {
+    for (int i = 0; i < REPLAY_MAX_FILES; i++) {
+        if (files[i].map) munmap(files[i].map, files[i].size);
+        files[i].map = NULL;
+    }
+    current = -1;
+}
+
+void replay_begin(ReplayGame *game, int gameId, int gameType, int64_t started) {
+    memset(game, 0, sizeof(*game));
+    if (current < 0) return;
+    ReplayFileHeader *h = file_header(&files[current]);
+    if ((h->games == h->indexCapacity || h->used >= rotateLimit) && open_next_file() != 0) return;
+    ReplayFile *f = &files[current];
+    h = file_header(f);
+    uint32_t entry = h->games++;
+    file_index(f)[entry] = (ReplayIndexEntry){gameId, gameType, REPLAY_LIVE, 0, 0, 0, 0, 0, -1, started, 0};
+    f->live++;
+    game->file = current + 1;
+    game->seq = f->seq;
+    game->entry = entry;
+}
+
+// Appends a record to the game's chain. Returns its offset, or 0 if the
+// file is full, which truncates the game.
+static uint32_t append(ReplayGame *game, ReplayRecordKind kind, int player, const char *data, size_t len) {
+    ReplayFile *f = &files[game->file - 1];
+    ReplayFileHeader *h = file_header(f);
+    ReplayIndexEntry *e = &file_index(f)[game->entry];
+    if (e->flags & REPLAY_TRUNCATED) return 0;
+    size_t size = (sizeof(ReplayRecord) + len + 7) & ~(size_t)7;
+    if (h->used + size > h->size) {
+        e->flags |= REPLAY_TRUNCATED;
+        return 0;
+    }
+    uint32_t offset = h->used;
+    ReplayRecord *r = file_record(f, offset);
+    *r = (ReplayRecord){0, 0, kind == REPLAY_OUTPUT ? e->moves + 1 : e->moves, kind, player < 0 ? 0 : player, len, 0};
+    memcpy(r + 1, data, len);
+    if (e->last) file_record(f, e->last)->next = offset;
+    else e->first = offset;
+    e->last = offset;
+    h->used += size;
+    return offset;
+}
+
+void replay_output(ReplayGame *game, const char *data, size_t len) {
+    if (!game->file || len == 0) return;
+    if (append(game, REPLAY_OUTPUT, 0, data, len)) game->output = 1;
+}
+
+int replay_move(ReplayGame *game, int player, const char *input) {
+    if (!game->file || !game->output) return 0;
+    ReplayFile *f = &files[game->file - 1];
+    file_index(f)[game->entry].moves++;
+    append(game, REPLAY_MOVE, player, input, strlen(input));
+    game->output = 0;
+    return 1;
+}
+
+void replay_keyframe(ReplayGame *game, const char *state, size_t len) {
+    if (!game->file) return;
+    ReplayFile *f = &files[game->file - 1];
+    ReplayIndexEntry *e = &file_index(f)[game->entry];
+    uint32_t offset = append(game, REPLAY_KEYFRAME, 0, state, len);
+    if (!offset) return;
+    if (e->lastKeyframe) file_record(f, e->lastKeyframe)->nextKeyframe = offset;
+    else e->firstKeyframe = offset;
+    e->lastKeyframe = offset;
+}
+
+void replay_end(ReplayGame *game, int winner, int64_t finished) {
+    if (!game->file) return;
+    ReplayFile *f = &files[game->file - 1];
+    ReplayIndexEntry *e = &file_index(f)[game->entry];
+    e->flags &= ~REPLAY_LIVE;
+    e->winner = winner;
+    e->finished = finished;
+    f->live--;
+    memset(game, 0, sizeof(*game));
+}
+
+int replay_moves(const ReplayGame *game) {
+    if (!game->file) return 0;
+    return file_index(&files[game->file - 1])[game->entry].moves;
+}
+
+// Game ids only grow, so each file's index is sorted.
+static ReplayIndexEntry *find_game(int gameId, int *slot) {
+    for (int i = 0; i < REPLAY_MAX_FILES; i++) {
+        if (!files[i].map) continue;
+        ReplayIndexEntry *index = file_index(&files[i]);
+        int lo = 0, hi = (int)file_header(&files[i])->games - 1;
+        while (lo <= hi) {
+            int mid = (lo + hi) / 2;
+            if (index[mid].gameId == gameId) {
+                *slot = i;
+                return &index[mid];
+            }
+            if (index[mid].gameId < gameId) lo = mid + 1;
+            else hi = mid - 1;
+        }
+    }
+    return NULL;
+}
+
+int replay_open(int gameId, int fromMove, int toMove, ReplayCursor *cursor, ReplayInfo *info) {
+    int slot;
+    ReplayIndexEntry *e = find_game(gameId, &slot);
+    if (!e) return -1;
+    ReplayFile *f = &files[slot];
+    *info = (ReplayInfo){e->gameType, e->moves, (e->flags & REPLAY_LIVE) != 0, e->winner};
+    // The last keyframe at or before fromMove; playback goes on from there.
+    uint32_t start = 0;
+    for (uint32_t k = e->firstKeyframe; k && file_record(f, k)->move <= (uint32_t)fromMove; k = file_record(f, k)->nextKeyframe)
+        start = k;
+    *cursor = (ReplayCursor){slot + 1, f->seq, start ? start : e->first, start, toMove < 0 ? UINT32_MAX : (uint32_t)toMove};
+    return 0;
+}
+
+size_t replay_next(ReplayCursor *cursor, const char **data) {
+    while (cursor->file) {
+        ReplayFile *f = &files[cursor->file - 1];
+        if (!f->map || f->seq != cursor->seq || cursor->offset == 0) break;
+        uint32_t offset = cursor->offset;
+        ReplayRecord *r = file_record(f, offset);
+        if (r->kind == REPLAY_OUTPUT && r->move > cursor->toMove) break;
+        cursor->offset = r->next;
+        if (r->kind == REPLAY_OUTPUT || (r->kind == REPLAY_KEYFRAME && offset == cursor->start)) {
+            *data = (const char *)(r + 1);
+            return r->len;
+        }
+    }
+    cursor->file = 0;
+    return 0;
+}
@@ -0,0 +1,99 @@
+#ifndef REPLAY_ARCHIVE_H
+#define REPLAY_ARCHIVE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Replays of every game, live or finished, in memory-mapped files. A game
+// is stored as what its spectators saw, split into moves, plus a
+// full-state keyframe every few moves, so playback can start at any move
+// without going through the ones before its keyframe. Playback reads
+// straight from the mapping and allocates nothing.
+//
+// File layout (little endian): a ReplayFileHeader, indexCapacity
+// ReplayIndexEntry slots sorted by game id, then 8-byte aligned
+// ReplayRecords. Each game's records are chained through next, and its
+// keyframes also through nextKeyframe. Offsets are from the file start.
+#define REPLAY_MAGIC "GSREPLY1"
+
+typedef struct {
+    char magic[8];
+    uint32_t indexCapacity;
+    uint32_t games;             // index slots in use
+    uint32_t used;              // records end here
+    uint32_t size;
+    int64_t created;
+} ReplayFileHeader;
+
+#define REPLAY_LIVE 1           // still being played
+#define REPLAY_TRUNCATED 2      // the file filled up before the game ended
+
+typedef struct {
+    int32_t gameId;
+    uint16_t gameType;
+    uint16_t flags;
+    uint32_t moves;
+    uint32_t first, last;       // records, 0 = none
+    uint32_t firstKeyframe, lastKeyframe;
+    int32_t winner;             // -1 = draw or undecided
+    int64_t started, finished;
+} ReplayIndexEntry;
+
+typedef enum { REPLAY_OUTPUT, REPLAY_MOVE, REPLAY_KEYFRAME } ReplayRecordKind;
+
+typedef struct {
+    uint32_t next;
+    uint32_t nextKeyframe;
+    uint32_t move;              // output: the move it belongs to (0 = the game's start);
+                                // move and keyframe: the move just completed
+    uint16_t kind;
+    uint16_t player;            // moves: who made it
+    uint32_t len;               // bytes of data that follow
+    uint32_t reserved;
+} ReplayRecord;
+
+// A game being recorded; all zero when it is not.
+typedef struct {
+    int file;                   // slot + 1
+    uint32_t seq;
+    uint32_t entry;
+    int output;                 // output recorded since the last move
+} ReplayGame;
+
+typedef struct {
+    int file;                   // slot + 1, 0 when playback is over
+    uint32_t seq;               // playback ends if that file has been unmapped since
+    uint32_t offset;            // next record
+    uint32_t start;             // the keyframe playback started from, if any
+    uint32_t toMove;
+} ReplayCursor;
+
+typedef struct {
+    int gameType;
+    int moves;
+    int live;
+    int winner;
+} ReplayInfo;
+
+// Creates dir and the first file. New games go to a new file once the
+// current one holds rotateBytes; games already in it may grow to twice
+// that. Returns 0 on success, -1 on failure.
+int replay_start(const char *dir, size_t rotateBytes);
+void replay_stop(void);
+
+// Records go to the game's file; a game that does not fit is truncated.
+void replay_begin(ReplayGame *game, int gameId, int gameType, int64_t started);
+void replay_output(ReplayGame *game, const char *data, size_t len);
+// Ends the current move if it produced output. Returns 1 if it did.
+int replay_move(ReplayGame *game, int player, const char *input);
+void replay_keyframe(ReplayGame *game, const char *state, size_t len);
+void replay_end(ReplayGame *game, int winner, int64_t finished);
+int replay_moves(const ReplayGame *game);
+
+// Positions cursor to show the game as it was after fromMove and go on
+// to toMove. Returns -1 if the game is not in a mapped file.
+int replay_open(int gameId, int fromMove, int toMove, ReplayCursor *cursor, ReplayInfo *info);
+// The next piece of output, pointing into the mapping; 0 at the end.
+size_t replay_next(ReplayCursor *cursor, const char **data);
+
+#endif
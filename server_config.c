@@ -0,0 +1,161 @@
+#include "server_config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <ctype.h>
+#include <errno.h>
+
+ServerConfig serverConfig = {
+    .tttRows = 3,
+    .tttCols = 3,
+    .tttWinLength = 3,
+    .tttBotDepth = 8,
+    .slBoardSize = 100,
+    .slSnakes = "16:6 47:26 49:11 56:53 62:19 64:60 87:24 93:73 95:75 98:78",
+    .slLadders = "1:38 4:14 9:31 21:42 28:84 36:44 51:67 71:91 80:100",
+    .rngSeed = 0,
+    .tournamentFormat = "swiss",
+    .tournamentPlayers = 8,
+    .tournamentRounds = 0,
+    .botPolicy = "greedy",
+    .botFillMs = 15000,
+    .botWorkers = 2,
+    .botBudgetMs = 50,
+    .botSoakSessions = 0,
+    .adminPort = 9081,
+    .adminSocket = "",
+    .logLevel = "info",
+    .traceSample = 0,
+    .traceSessions = "",
+    .tracePath = "trace.bin",
+    .ioBackend = "poll",
+    .clusterSocket = "",
+    .clusterReportMs = 250,
+    .statsPath = "player_stats.bin",
+    .statsSnapshotMs = 60000,
+    .lobbyIntervalMs = 500,
+    .listenBacklog = 4096,
+    .tcpFlush = "cork",
+    .tcpDeferAcceptS = 0,
+    .tcpKeepaliveS = 60,
+    .tcpUserTimeoutMs = 30000,
+};
+
+typedef enum { CONFIG_INT, CONFIG_STRING } ConfigType;
+
+typedef struct {
+    const char *key;
+    ConfigType type;
+    size_t offset;
+    size_t size;            // buffer size for strings
+    int min, max;           // range for ints
+} ConfigOption;
+
+#define INT_OPTION(key, field, lo, hi) { key, CONFIG_INT, offsetof(ServerConfig, field), 0, lo, hi }
+#define STRING_OPTION(key, field) { key, CONFIG_STRING, offsetof(ServerConfig, field), sizeof(((ServerConfig *)0)->field), 0, 0 }
+
+static const ConfigOption options[] = {
+    INT_OPTION("ttt_rows", tttRows, 1, 10),
+    INT_OPTION("ttt_cols", tttCols, 1, 10),
+    INT_OPTION("ttt_win_length", tttWinLength, 1, 10),
+    INT_OPTION("ttt_bot_depth", tttBotDepth, 1, 64),
+    INT_OPTION("sl_board_size", slBoardSize, 6, 400),
+    STRING_OPTION("sl_snakes", slSnakes),
+    STRING_OPTION("sl_ladders", slLadders),
+    INT_OPTION("rng_seed", rngSeed, 0, 2147483647),
+    STRING_OPTION("tournament_format", tournamentFormat),
+    INT_OPTION("tournament_players", tournamentPlayers, 2, 65536),
+    INT_OPTION("tournament_rounds", tournamentRounds, 0, 32),
+    STRING_OPTION("bot_policy", botPolicy),
+    INT_OPTION("bot_fill_ms", botFillMs, 0, 3600000),
+    INT_OPTION("bot_workers", botWorkers, 1, 64),
+    INT_OPTION("bot_budget_ms", botBudgetMs, 1, 10000),
+    INT_OPTION("bot_soak_sessions", botSoakSessions, 0, 1000000),
+    INT_OPTION("admin_port", adminPort, 0, 65535),
+    STRING_OPTION("admin_socket", adminSocket),
+    STRING_OPTION("log_level", logLevel),
+    INT_OPTION("trace_sample", traceSample, 0, 1000000),
+    STRING_OPTION("trace_sessions", traceSessions),
+    STRING_OPTION("trace_path", tracePath),
+    STRING_OPTION("io_backend", ioBackend),
+    STRING_OPTION("cluster_socket", clusterSocket),
+    INT_OPTION("cluster_report_ms", clusterReportMs, 10, 60000),
+    STRING_OPTION("stats_path", statsPath),
+    INT_OPTION("stats_snapshot_ms", statsSnapshotMs, 1000, 86400000),
+    INT_OPTION("lobby_interval_ms", lobbyIntervalMs, 50, 60000),
+    INT_OPTION("listen_backlog", listenBacklog, 1, 65535),
+    STRING_OPTION("tcp_flush", tcpFlush),
+    INT_OPTION("tcp_defer_accept_s", tcpDeferAcceptS, 0, 600),
+    INT_OPTION("tcp_keepalive_s", tcpKeepaliveS, 0, 86400),
+    INT_OPTION("tcp_user_timeout_ms", tcpUserTimeoutMs, 0, 3600000),
+};
+
+static char *trim(char *s) {
+    while (isspace((unsigned char)*s)) s++;
+    char *end = s + strlen(s);
+    while (end > s && isspace((unsigned char)end[-1])) *--end = '\0';
+    return s;
+}
+
+static int apply_option(const char *key, const char *value, const char *path, int line) {
+    for (size_t i = 0; i < sizeof(options) / sizeof(options[0]); i++) {
+        const ConfigOption *opt = &options[i];
+        if (strcmp(opt->key, key) != 0) continue;
+        char *field = (char *)&serverConfig + opt->offset;
+        if (opt->type == CONFIG_INT) {
+            char *end;
+            long v = strtol(value, &end, 10);
+            if (*value == '\0' || *end != '\0' || v < opt->min || v > opt->max) {
+                fprintf(stderr, "%s:%d: %s must be an integer between %d and %d\n", path, line, key, opt->min, opt->max);
+                return -1;
+            }
+            *(int *)field = (int)v;
+        } else {
+            snprintf(field, opt->size, "%s", value);
+        }
+        return 0;
+    }
+    fprintf(stderr, "%s:%d: unknown option '%s'\n", path, line, key);
+    return -1;
+}
+
+int server_config_load(const char *path) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        if (errno == ENOENT) return 1;
+        fprintf(stderr, "Cannot open %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    char buf[1024];
+    int lineNo = 0, errors = 0;
+    while (fgets(buf, sizeof(buf), fp)) {
+        lineNo++;
+        buf[strcspn(buf, "#")] = '\0';
+        char *line = trim(buf);
+        if (*line == '\0') continue;
+        char *eq = strchr(line, '=');
+        if (!eq) {
+            fprintf(stderr, "%s:%d: expected key = value\n", path, lineNo);
+            errors++;
+            continue;
+        }
+        *eq = '\0';
+        if (apply_option(trim(line), trim(eq + 1), path, lineNo) != 0) errors++;
+    }
+    fclose(fp);
+    return errors ? -1 : 0;
+}
+
+int server_config_set(const char *arg) {
+    char buf[1024];
+    snprintf(buf, sizeof(buf), "%s", arg);
+    char *eq = strchr(buf, '=');
+    if (!eq) {
+        fprintf(stderr, "%s: expected key=value\n", arg);
+        return -1;
+    }
+    *eq = '\0';
+    return apply_option(trim(buf), trim(eq + 1), "command line", 0);
+}
@@ -0,0 +1,75 @@
+#ifndef SERVER_CONFIG_H
+#define SERVER_CONFIG_H
+
+#define SERVER_CONFIG_PATH "gamesys.conf"
+
+typedef struct {
+    // Tic Tac Toe: rows x cols board, k in a row wins
+    int tttRows;
+    int tttCols;
+    int tttWinLength;
+    int tttBotDepth;
+    // Snake and Ladder layout as "start:end" lists
+    int slBoardSize;
+    char slSnakes[512];
+    char slLadders[512];
+    // Non-zero makes every session's dice and word choice reproducible
+    int rngSeed;
+    // Tournaments: "swiss" or "bracket", players per tournament, Swiss
+    // rounds (0 = enough rounds to separate the players)
+    char tournamentFormat[16];
+    int tournamentPlayers;
+    int tournamentRounds;
+    // Bots: "random", "greedy" or "engine"; a waiting player gets a bot
+    // after botFillMs (0 = never); botSoakSessions bot games are kept running
+    char botPolicy[16];
+    int botFillMs;
+    int botWorkers;
+    int botBudgetMs;
+    int botSoakSessions;
+    // Metrics in Prometheus format on 127.0.0.1:adminPort (0 = off) and/or
+    // a Unix socket at adminSocket ("" = off)
+    int adminPort;
+    char adminSocket[108];
+    // "debug", "info", "warn" or "error"; debug needs a LOG_ENABLE_DEBUG build
+    char logLevel[16];
+    // Tracing: 1 in traceSample sessions (0 = none) plus the session ids
+    // listed in traceSessions, written to tracePath
+    int traceSample;
+    char traceSessions[256];
+    char tracePath[256];
+    // Event loop: "poll", "epoll" or "io_uring", falling back to the one
+    // before when unavailable
+    char ioBackend[16];
+    // Cluster mode: the coordinator's Unix socket ("" = a standalone server
+    // taking its own connections); nodes report their load every
+    // clusterReportMs
+    char clusterSocket[108];
+    int clusterReportMs;
+    // Player stats and leaderboards are reloaded from statsPath ("" = kept
+    // in memory only) and written back every statsSnapshotMs when changed
+    char statsPath[256];
+    int statsSnapshotMs;
+    // Lobby feed updates go out at most once per lobbyIntervalMs
+    int lobbyIntervalMs;
+    // Sockets: listen backlog; "nagle", "nodelay" or "cork" for how replies
+    // are flushed; TCP_DEFER_ACCEPT seconds (0 = off); keepalive probes
+    // after tcpKeepaliveS idle (0 = off) and TCP_USER_TIMEOUT (0 = the
+    // kernel's) to drop dead peers
+    int listenBacklog;
+    char tcpFlush[16];
+    int tcpDeferAcceptS;
+    int tcpKeepaliveS;
+    int tcpUserTimeoutMs;
+} ServerConfig;
+
+extern ServerConfig serverConfig;
+
+// Reads "key = value" lines ('#' starts a comment) over the defaults.
+// Returns 0 when the file was read, 1 when it does not exist (defaults
+// kept) and -1 when it contains errors.
+int server_config_load(const char *path);
+// Applies one "key=value" given on the command line. Returns 0 or -1.
+int server_config_set(const char *arg);
+
+#endif
@@ -0,0 +1,118 @@
+// Expected game length for a Snake and Ladder layout, computed exactly from
+// the Markov chain and checked by Monte Carlo with the server's dice.
+// Usage: ./sl_analyze [config] [games]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "server_config.h"
+#include "snake_ladder.h"
+#include "game_rng.h"
+
+#define MAX_TURNS 10000         // truncation point for the turn distribution
+#define MC_HISTOGRAM 4096
+
+// P(one player has reached the last square within t of their own turns).
+static void finish_distribution(const SlLayout *layout, double *cdf, int maxTurns) {
+    double dist[SL_MAX_SQUARES + 1] = {0}, next[SL_MAX_SQUARES + 1];
+    dist[0] = 1.0;
+    for (int t = 0; t < maxTurns; t++) {
+        memset(next, 0, sizeof(next));
+        for (int s = 0; s < layout->size; s++) {
+            if (dist[s] == 0) continue;
+            for (int r = 1; r <= SL_DIE_SIDES; r++) next[sl_resolve(layout, s, r)] += dist[s] / SL_DIE_SIDES;
+        }
+        next[layout->size] += dist[layout->size];
+        memcpy(dist, next, sizeof(dist));
+        cdf[t] = dist[layout->size];
+    }
+}
+
+// Expected turns for one player from every square: E[s] = 1 + mean E[next].
+// Snakes make the chain cyclic, so solve by Gauss-Seidel iteration.
+static double expected_solo_turns(const SlLayout *layout) {
+    double e[SL_MAX_SQUARES + 1] = {0};
+    for (int iter = 0; iter < 100000; iter++) {
+        double delta = 0;
+        for (int s = layout->size - 1; s >= 0; s--) {
+            double v = 1.0;
+            for (int r = 1; r <= SL_DIE_SIDES; r++) v += e[sl_resolve(layout, s, r)] / SL_DIE_SIDES;
+            // A roll that overshoots keeps the player on s, which shows up
+            // on both sides of the equation; solve for e[s] directly.
+            int stay = 0;
+            for (int r = 1; r <= SL_DIE_SIDES; r++) stay += sl_resolve(layout, s, r) == s;
+            if (stay) v = (v - e[s] * stay / SL_DIE_SIDES) / (1.0 - (double)stay / SL_DIE_SIDES);
+            delta = fmax(delta, fabs(v - e[s]));
+            e[s] = v;
+        }
+        if (delta < 1e-12) break;
+    }
+    return e[0];
+}
+
+static int percentile(const long *hist, long total, double q) {
+    long target = (long)ceil(q * total), seen = 0;
+    for (int i = 0; i < MC_HISTOGRAM; i++) {
+        seen += hist[i];
+        if (seen >= target) return i;
+    }
+    return MC_HISTOGRAM - 1;
+}
+
+int main(int argc, char **argv) {
+    const char *configPath = argc > 1 ? argv[1] : SERVER_CONFIG_PATH;
+    long games = argc > 2 ? atol(argv[2]) : 1000000;
+    if (server_config_load(configPath) < 0) return 1;
+
+    SlLayout layout;
+    char err[128];
+    if (sl_layout_parse(&layout, serverConfig.slBoardSize, serverConfig.slSnakes, serverConfig.slLadders, err, sizeof(err)) != 0) {
+        printf("Invalid layout: %s\n", err);
+        return 1;
+    }
+    printf("layout size=%d snakes=%d ladders=%d\n", layout.size, layout.numSnakes, layout.numLadders);
+
+    static double cdf[MAX_TURNS];
+    finish_distribution(&layout, cdf, MAX_TURNS);
+    // Two players alternate, player 1 first. The game ends on the first
+    // finish: at roll 2t-1 if player 1 finishes on turn t, else at roll 2t
+    // if player 2 finishes on turn t while player 1 has not.
+    double expectedRolls = 0, p1Wins = 0, prev = 0;
+    for (int t = 1; t <= MAX_TURNS; t++) {
+        double f = cdf[t - 1];
+        double p1Here = (f - prev) * (1 - prev);
+        double p2Here = (f - prev) * (1 - f);
+        expectedRolls += p1Here * (2 * t - 1) + p2Here * (2 * t);
+        p1Wins += p1Here;
+        prev = f;
+    }
+    printf("markov solo_turns=%.4f game_rolls=%.4f p1_win=%.4f unfinished=%.2e\n",
+           expected_solo_turns(&layout), expectedRolls, p1Wins, 1 - prev);
+
+    GameRng rng;
+    uint64_t seed = serverConfig.rngSeed ? (uint64_t)serverConfig.rngSeed : game_rng_fresh_seed();
+    game_rng_seed(&rng, seed);
+    static long hist[MC_HISTOGRAM];
+    double sum = 0;
+    long p1 = 0;
+    clock_t start = clock();
+    for (long g = 0; g < games; g++) {
+        int pos[2] = {0, 0}, turn = 0, rolls = 0;
+        for (;;) {
+            rolls++;
+            pos[turn] = sl_resolve(&layout, pos[turn], game_rng_range(&rng, SL_DIE_SIDES) + 1);
+            if (pos[turn] >= layout.size) break;
+            turn ^= 1;
+        }
+        p1 += turn == 0;
+        sum += rolls;
+        hist[rolls < MC_HISTOGRAM ? rolls : MC_HISTOGRAM - 1]++;
+    }
+    double secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+    if (games > 0)
+        printf("montecarlo seed=%016llx games=%ld game_rolls=%.4f p50=%d p90=%d p99=%d p1_win=%.4f games_per_sec=%.0f\n",
+               (unsigned long long)seed, games, sum / games, percentile(hist, games, 0.5), percentile(hist, games, 0.9),
+               percentile(hist, games, 0.99), (double)p1 / games, secs > 0 ? games / secs : 0);
+    return 0;
+}
@@ -0,0 +1,77 @@
+#include "snake_ladder.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int parse_pairs(const char *spec, SnakeLadder *out, int *count, const char *what, char *err, size_t errLen) {
+    const char *p = spec;
+    *count = 0;
+    while (*p) {
+        while (*p == ' ' || *p == ',' || *p == '\t') p++;
+        if (!*p) break;
+        char *end;
+        long start = strtol(p, &end, 10);
+        if (end == p || *end != ':') {
+            snprintf(err, errLen, "%s: expected start:end near '%.10s'", what, p);
+            return -1;
+        }
+        p = end + 1;
+        long dest = strtol(p, &end, 10);
+        if (end == p) {
+            snprintf(err, errLen, "%s: expected start:end near '%.10s'", what, p);
+            return -1;
+        }
+        p = end;
+        if (*count >= SL_MAX_SQUARES) {
+            snprintf(err, errLen, "%s: too many entries", what);
+            return -1;
+        }
+        out[*count].start = (int)start;
+        out[*count].end = (int)dest;
+        (*count)++;
+    }
+    return 0;
+}
+
+int sl_layout_parse(SlLayout *layout, int size, const char *snakes, const char *ladders, char *err, size_t errLen) {
+    memset(layout, 0, sizeof(*layout));
+    if (size < SL_DIE_SIDES || size > SL_MAX_SQUARES) {
+        snprintf(err, errLen, "board size must be between %d and %d", SL_DIE_SIDES, SL_MAX_SQUARES);
+        return -1;
+    }
+    layout->size = size;
+    for (int i = 0; i <= size; i++) layout->jump[i] = i;
+    if (parse_pairs(snakes, layout->snakes, &layout->numSnakes, "snakes", err, errLen) != 0 ||
+        parse_pairs(ladders, layout->ladders, &layout->numLadders, "ladders", err, errLen) != 0)
+        return -1;
+
+    for (int i = 0; i < layout->numSnakes + layout->numLadders; i++) {
+        int isSnake = i < layout->numSnakes;
+        SnakeLadder *sl = isSnake ? &layout->snakes[i] : &layout->ladders[i - layout->numSnakes];
+        const char *what = isSnake ? "snake" : "ladder";
+        if (sl->start < 1 || sl->start >= size || sl->end < 0 || sl->end > size) {
+            snprintf(err, errLen, "%s %d:%d is off the board", what, sl->start, sl->end);
+            return -1;
+        }
+        if (isSnake ? sl->end >= sl->start : sl->end <= sl->start) {
+            snprintf(err, errLen, "%s %d:%d goes the wrong way", what, sl->start, sl->end);
+            return -1;
+        }
+        if (layout->jump[sl->start] != sl->start) {
+            snprintf(err, errLen, "square %d has more than one snake or ladder", sl->start);
+            return -1;
+        }
+        layout->jump[sl->start] = sl->end;
+    }
+    // jump[] takes one hop, so a snake or ladder may not lead onto another.
+    for (int i = 0; i < layout->numSnakes + layout->numLadders; i++) {
+        int isSnake = i < layout->numSnakes;
+        SnakeLadder *sl = isSnake ? &layout->snakes[i] : &layout->ladders[i - layout->numSnakes];
+        if (layout->jump[sl->end] != sl->end) {
+            snprintf(err, errLen, "%s %d:%d ends where another snake or ladder starts", isSnake ? "snake" : "ladder", sl->start, sl->end);
+            return -1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,36 @@
+#ifndef SNAKE_LADDER_H
+#define SNAKE_LADDER_H
+
+#include <stddef.h>
+
+#define SL_MAX_SQUARES 400
+#define SL_DIE_SIDES 6
+
+typedef struct {
+    int start;
+    int end;
+} SnakeLadder;
+
+// A board resolved into a square -> destination table, so a roll needs a
+// single lookup. jump[s] == s for ordinary squares.
+typedef struct {
+    int size;                       // the winning square
+    int jump[SL_MAX_SQUARES + 1];
+    int numSnakes, numLadders;
+    SnakeLadder snakes[SL_MAX_SQUARES];
+    SnakeLadder ladders[SL_MAX_SQUARES];
+} SlLayout;
+
+// Builds a layout from "start:end" lists separated by spaces or commas,
+// e.g. "16:6 47:26". Returns 0, or -1 with a reason in err. A square has
+// at most one snake or ladder, and none may end where another starts.
+int sl_layout_parse(SlLayout *layout, int size, const char *snakes, const char *ladders, char *err, size_t errLen);
+
+// Square reached by rolling roll from pos: overshooting the last square
+// leaves the player where they are.
+static inline int sl_resolve(const SlLayout *layout, int pos, int roll) {
+    int next = pos + roll;
+    return next > layout->size ? pos : layout->jump[next];
+}
+
+#endif
@@ -0,0 +1,40 @@
+#include "sock_opts.h"
+
+#include <strings.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+int sock_parse_flush(const char *name) {
+    const char *names[] = SOCK_FLUSH_NAMES;
+    for (int i = SOCK_FLUSH_NAGLE; i <= SOCK_FLUSH_CORK; i++)
+        if (strcasecmp(name, names[i]) == 0) return i;
+    return -1;
+}
+
+static int set_int(int fd, int level, int option, int value) {
+    return setsockopt(fd, level, option, &value, sizeof(value));
+}
+
+int sock_listen(int fd, const SockOptions *options) {
+    if (options->deferAcceptS > 0) set_int(fd, IPPROTO_TCP, TCP_DEFER_ACCEPT, options->deferAcceptS);
+    return listen(fd, options->backlog);
+}
+
+int sock_tune(int fd, const SockOptions *options) {
+    int status = 0;
+    if (options->flush != SOCK_FLUSH_NAGLE && set_int(fd, IPPROTO_TCP, TCP_NODELAY, 1) != 0) status = -1;
+    if (options->keepaliveS > 0) {
+        if (set_int(fd, SOL_SOCKET, SO_KEEPALIVE, 1) != 0 ||
+            set_int(fd, IPPROTO_TCP, TCP_KEEPIDLE, options->keepaliveS) != 0 ||
+            set_int(fd, IPPROTO_TCP, TCP_KEEPINTVL, SOCK_KEEPALIVE_INTERVAL_S) != 0 ||
+            set_int(fd, IPPROTO_TCP, TCP_KEEPCNT, SOCK_KEEPALIVE_PROBES) != 0)
+            status = -1;
+    }
+    if (options->userTimeoutMs > 0 && set_int(fd, IPPROTO_TCP, TCP_USER_TIMEOUT, options->userTimeoutMs) != 0) status = -1;
+    return status;
+}
+
+int sock_cork(int fd, int on) {
+    return set_int(fd, IPPROTO_TCP, TCP_CORK, on);
+}
@@ -0,0 +1,42 @@
+#ifndef SOCK_OPTS_H
+#define SOCK_OPTS_H
+
+// TCP tuning for the game port. Game traffic is many small writes: a chess
+// turn is the move, the board and whose turn it is, sent one after another.
+// Under Nagle's algorithm each write after the first waits for the peer to
+// ACK, and a peer that is only reading delays its ACK by up to 40 ms, so a
+// turn can stall that long on an idle network. The flush policy decides how
+// the writes become segments:
+//   nagle    the kernel's default, kept to compare against
+//   nodelay  TCP_NODELAY: every write is sent at once
+//   cork     TCP_NODELAY, and a socket written more than once in a loop
+//            tick is corked from its second write until the tick ends, so
+//            the rest of a turn leaves in full segments. A tick with one
+//            write costs no extra system calls.
+#define SOCK_FLUSH_NAMES {"nagle", "nodelay", "cork"}
+#define SOCK_KEEPALIVE_INTERVAL_S 10    // between probes once they start
+#define SOCK_KEEPALIVE_PROBES 3         // unanswered before the peer is given up
+
+typedef enum { SOCK_FLUSH_NAGLE, SOCK_FLUSH_NODELAY, SOCK_FLUSH_CORK } SockFlush;
+
+typedef struct {
+    SockFlush flush;
+    int backlog;                // for listen, capped by net.core.somaxconn
+    int deferAcceptS;           // TCP_DEFER_ACCEPT, 0 = off
+    int keepaliveS;             // idle time before keepalive probes, 0 = off
+    int userTimeoutMs;          // TCP_USER_TIMEOUT, 0 = the kernel's
+} SockOptions;
+
+// The policy with that name, or -1.
+int sock_parse_flush(const char *name);
+
+// Sets TCP_DEFER_ACCEPT on a bound socket and listens. Returns 0, or -1
+// with errno set if listen failed; a failed TCP_DEFER_ACCEPT is not fatal.
+int sock_listen(int fd, const SockOptions *options);
+// Applies the flush policy and dead-peer detection to a connection.
+// Returns 0, or -1 if an option was refused (as any is by a non-TCP fd).
+int sock_tune(int fd, const SockOptions *options);
+// Sets or clears TCP_CORK; clearing it sends whatever it held back.
+int sock_cork(int fd, int on);
+
+#endif
@@ -0,0 +1,336 @@
+#include "tournament.h"
+#include "rank_tree.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WIN_POINTS 2
+#define DRAW_POINTS 1
+#define STANDINGS_LEADERS 3
+
+typedef struct {
+    int points;
+    int wins, draws, losses;
+    int hadBye;
+    int withdrawn;
+    int eliminated;
+    int numOpponents;
+    int opponents[TOURNAMENT_MAX_ROUNDS];
+} Participant;
+
+typedef struct {
+    int a, b;
+    int done;
+} Match;
+
+struct Tournament {
+    TournamentFormat format;
+    int n;
+    int rounds;                 // Swiss: fixed. Bracket: grows until one remains.
+    int round;                  // 1-based, 0 before the start
+    int over;
+    Participant *players;
+    Match *matches;             // current round only
+    int matchCount;
+    int pending;
+    RankTree *standings;        // key: points, then participant id
+    int *alive;                 // bracket order of players still in
+    int aliveCount;
+    int *scratch;
+    char *paired;
+    TournamentCallbacks cb;
+    void *ctx;
+};
+
+static RankKey key_of(const Tournament *t, int p) {
+    return (RankKey){t->players[p].points, (uint32_t)p};
+}
+
+static void add_points(Tournament *t, int p, int points) {
+    if (points == 0) return;
+    rank_tree_remove(t->standings, key_of(t, p));
+    t->players[p].points += points;
+    rank_tree_insert(t->standings, key_of(t, p));
+}
+
+static void tell(Tournament *t, int p, const char *msg) {
+    if (!t->players[p].withdrawn) t->cb.message(t->ctx, p, msg);
+}
+
+Tournament *tournament_create(TournamentFormat format, int participants, int rounds,
+                              const TournamentCallbacks *callbacks, void *ctx) {
+    if (participants < 2) return NULL;
+    Tournament *t = calloc(1, sizeof(Tournament));
+    if (!t) return NULL;
+    t->format = format;
+    t->n = participants;
+    if (rounds <= 0) {
+        rounds = 0;
+        while ((1 << rounds) < participants) rounds++;
+    }
+    t->rounds = rounds < TOURNAMENT_MAX_ROUNDS ? rounds : TOURNAMENT_MAX_ROUNDS;
+    t->players = calloc(participants, sizeof(Participant));
+    t->matches = calloc(participants / 2 + 1, sizeof(Match));
+    t->alive = malloc(participants * sizeof(int));
+    t->scratch = malloc(participants * sizeof(int));
+    t->paired = malloc(participants);
+    t->standings = rank_tree_create(participants);
+    if (!t->players || !t->matches || !t->alive || !t->scratch || !t->paired || !t->standings) {
+        tournament_free(t);
+        return NULL;
+    }
+    for (int p = 0; p < participants; p++) {
+        rank_tree_insert(t->standings, key_of(t, p));
+        t->alive[p] = p;
+    }
+    t->aliveCount = participants;
+    t->cb = *callbacks;
+    t->ctx = ctx;
+    return t;
+}
+
+void tournament_free(Tournament *t) {
+    if (!t) return;
+    free(t->players);
+    free(t->matches);
+    free(t->alive);
+    free(t->scratch);
+    free(t->paired);
+    rank_tree_free(t->standings);
+    free(t);
+}
+
+int tournament_is_over(const Tournament *t) {
+    return t->over;
+}
+
+int tournament_participants(const Tournament *t) {
+    return t->n;
+}
+
+TournamentFormat tournament_format(const Tournament *t) {
+    return t->format;
+}
+
+static int have_played(const Tournament *t, int a, int b) {
+    for (int i = 0; i < t->players[a].numOpponents; i++)
+        if (t->players[a].opponents[i] == b) return 1;
+    return 0;
+}
+
+static void give_bye(Tournament *t, int p) {
+    char msg[96];
+    t->players[p].hadBye = 1;
+    t->players[p].wins++;
+    add_points(t, p, WIN_POINTS);
+    snprintf(msg, sizeof(msg), "TOURNAMENT:Round %d: bye, you advance with a win\n", t->round);
+    tell(t, p, msg);
+}
+
+static void add_match(Tournament *t, int a, int b) {
+    Match *m = &t->matches[t->matchCount++];
+    m->a = a;
+    m->b = b;
+    m->done = 0;
+    t->pending++;
+}
+
+// Swiss: walk the standings from the top and pair each player with the
+// next one they have not met yet. The lowest-ranked player without a bye
+// sits out when the count is odd.
+static void pair_swiss(Tournament *t) {
+    int count = 0, total = rank_tree_size(t->standings);
+    for (int r = 0; r < total; r++) {
+        RankKey key;
+        rank_tree_select(t->standings, r, &key);
+        if (!t->players[key.id].withdrawn) t->scratch[count++] = key.id;
+    }
+    memset(t->paired, 0, t->n);
+    if (count % 2 == 1) {
+        int bye = t->scratch[count - 1];
+        for (int i = count - 1; i >= 0; i--) {
+            if (!t->players[t->scratch[i]].hadBye) {
+                bye = t->scratch[i];
+                break;
+            }
+        }
+        t->paired[bye] = 1;
+        give_bye(t, bye);
+    }
+    for (int i = 0; i < count; i++) {
+        int a = t->scratch[i];
+        if (t->paired[a]) continue;
+        int partner = -1;
+        for (int j = i + 1; j < count; j++) {
+            int b = t->scratch[j];
+            if (t->paired[b]) continue;
+            if (partner < 0) partner = b;       // rematch only if nobody else is left
+            if (!have_played(t, a, b)) {
+                partner = b;
+                break;
+            }
+        }
+        if (partner < 0) break;
+        t->paired[a] = t->paired[partner] = 1;
+        add_match(t, a, partner);
+    }
+}
+
+// Bracket: neighbours in the bracket order meet; the last player gets a
+// bye when the count is odd.
+static void pair_bracket(Tournament *t) {
+    int i = 0;
+    for (; i + 1 < t->aliveCount; i += 2) add_match(t, t->alive[i], t->alive[i + 1]);
+    if (i < t->aliveCount) give_bye(t, t->alive[i]);
+}
+
+static void finish(Tournament *t);
+
+static void record_result(Tournament *t, Match *m, int result) {
+    Participant *a = &t->players[m->a], *b = &t->players[m->b];
+    m->done = 1;
+    t->pending--;
+    if (a->numOpponents < TOURNAMENT_MAX_ROUNDS) a->opponents[a->numOpponents++] = m->b;
+    if (b->numOpponents < TOURNAMENT_MAX_ROUNDS) b->opponents[b->numOpponents++] = m->a;
+    if (result == 0) {
+        a->wins++;
+        b->losses++;
+        add_points(t, m->a, WIN_POINTS);
+        if (t->format == TOURNAMENT_BRACKET) b->eliminated = 1;
+    } else if (result == 1) {
+        b->wins++;
+        a->losses++;
+        add_points(t, m->b, WIN_POINTS);
+        if (t->format == TOURNAMENT_BRACKET) a->eliminated = 1;
+    } else {
+        a->draws++;
+        b->draws++;
+        add_points(t, m->a, DRAW_POINTS);
+        add_points(t, m->b, DRAW_POINTS);
+    }
+}
+
+// Bracket: both players withdrew, so neither can advance. A draw would
+// keep both in and pair them again every round.
+static void record_double_walkover(Tournament *t, Match *m) {
+    m->done = 1;
+    t->pending--;
+    t->players[m->a].losses++;
+    t->players[m->b].losses++;
+    t->players[m->a].eliminated = t->players[m->b].eliminated = 1;
+}
+
+static void send_standings(Tournament *t) {
+    char leaders[128] = "", msg[256];
+    int len = 0;
+    for (int r = 0; r < STANDINGS_LEADERS && r < t->n; r++) {
+        RankKey key;
+        rank_tree_select(t->standings, r, &key);
+        len += snprintf(leaders + len, sizeof(leaders) - len, "%sPlayer %u %lld", r ? ", " : "",
+                        key.id + 1, (long long)key.score);
+    }
+    for (int p = 0; p < t->n; p++) {
+        int rank = rank_tree_rank(t->standings, key_of(t, p));
+        snprintf(msg, sizeof(msg), "STANDINGS:Round %d: you are #%d of %d with %d points | leaders: %s\n",
+                 t->round, rank + 1, t->n, t->players[p].points, leaders);
+        tell(t, p, msg);
+    }
+}
+
+// Starts the round's matches; walkovers against withdrawn players are
+// settled immediately. Returns once at least one real match is running or
+// the tournament is over.
+static void start_round(Tournament *t) {
+    int settledAlive = -1;      // bracket: players left after the last round settled here
+    for (;;) {
+        if (t->format == TOURNAMENT_BRACKET) {
+            int kept = 0;
+            for (int i = 0; i < t->aliveCount; i++)
+                if (!t->players[t->alive[i]].eliminated) t->alive[kept++] = t->alive[i];
+            t->aliveCount = kept;
+            // Every settled match eliminates someone; a round that did not
+            // would only repeat itself.
+            if (kept <= 1 || kept == settledAlive) {
+                finish(t);
+                return;
+            }
+        } else if (t->round >= t->rounds) {
+            finish(t);
+            return;
+        }
+
+        t->round++;
+        t->matchCount = 0;
+        t->pending = 0;
+        if (t->format == TOURNAMENT_BRACKET) pair_bracket(t);
+        else pair_swiss(t);
+
+        char msg[128];
+        for (int i = 0; i < t->matchCount; i++) {
+            Match *m = &t->matches[i];
+            int aGone = t->players[m->a].withdrawn, bGone = t->players[m->b].withdrawn;
+            if (aGone && bGone && t->format == TOURNAMENT_BRACKET) {
+                record_double_walkover(t, m);
+                continue;
+            }
+            if (aGone || bGone) {
+                record_result(t, m, aGone && bGone ? -1 : aGone ? 1 : 0);
+                continue;
+            }
+            snprintf(msg, sizeof(msg), "TOURNAMENT:Round %d: you play Player %d\n", t->round, m->b + 1);
+            tell(t, m->a, msg);
+            snprintf(msg, sizeof(msg), "TOURNAMENT:Round %d: you play Player %d\n", t->round, m->a + 1);
+            tell(t, m->b, msg);
+        }
+        if (t->pending > 0) {
+            // Started last: a callback may report back before this returns.
+            int matches = t->matchCount, round = t->round;
+            for (int i = 0; i < matches && t->round == round; i++)
+                if (!t->matches[i].done) t->cb.start_match(t->ctx, (round << 20) | i, t->matches[i].a, t->matches[i].b);
+            return;
+        }
+        send_standings(t);
+        settledAlive = t->aliveCount;
+    }
+}
+
+void tournament_start(Tournament *t) {
+    if (t->round == 0 && !t->over) start_round(t);
+}
+
+void tournament_report(Tournament *t, int matchId, int result) {
+    int round = matchId >> 20, index = matchId & 0xFFFFF;
+    if (t->over || round != t->round || index >= t->matchCount || t->matches[index].done) return;
+    Match *m = &t->matches[index];
+    if (result < 0 && t->format == TOURNAMENT_BRACKET) {
+        // Knockout games need a winner: replay a drawn match.
+        t->cb.start_match(t->ctx, matchId, m->a, m->b);
+        return;
+    }
+    record_result(t, m, result);
+    if (t->pending > 0) return;
+    send_standings(t);
+    start_round(t);
+}
+
+void tournament_withdraw(Tournament *t, int participant) {
+    if (participant < 0 || participant >= t->n) return;
+    t->players[participant].withdrawn = 1;
+}
+
+static void finish(Tournament *t) {
+    RankKey winner;
+    char msg[160];
+    t->over = 1;
+    rank_tree_select(t->standings, 0, &winner);
+    if (t->format == TOURNAMENT_BRACKET && t->aliveCount == 1) winner.id = t->alive[0];
+    for (int p = 0; p < t->n; p++) {
+        int rank = p == (int)winner.id ? 0 : rank_tree_rank(t->standings, key_of(t, p));
+        if (t->format == TOURNAMENT_BRACKET && p != (int)winner.id && rank == 0) rank = 1;
+        snprintf(msg, sizeof(msg), "TOURNAMENT_OVER:Winner Player %u. You finished #%d of %d (%d-%d-%d)\n",
+                 winner.id + 1, rank + 1, t->n, t->players[p].wins, t->players[p].draws, t->players[p].losses);
+        tell(t, p, msg);
+    }
+    t->cb.finished(t->ctx);
+}
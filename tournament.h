@@ -0,0 +1,40 @@
+#ifndef TOURNAMENT_H
+#define TOURNAMENT_H
+
+typedef enum { TOURNAMENT_SWISS, TOURNAMENT_BRACKET } TournamentFormat;
+
+#define TOURNAMENT_MAX_ROUNDS 32
+
+// The tournament only schedules and scores. Starting the actual games and
+// talking to players is left to the server through these callbacks.
+// Participants are numbered 0 .. n-1.
+typedef struct {
+    void (*start_match)(void *ctx, int matchId, int a, int b);
+    void (*message)(void *ctx, int participant, const char *msg);
+    void (*finished)(void *ctx);
+} TournamentCallbacks;
+
+typedef struct Tournament Tournament;
+
+// rounds is only used by Swiss; 0 picks ceil(log2(participants)).
+Tournament *tournament_create(TournamentFormat format, int participants, int rounds,
+                              const TournamentCallbacks *callbacks, void *ctx);
+void tournament_free(Tournament *t);
+
+// Pairs and starts the first round.
+void tournament_start(Tournament *t);
+
+// Result of a match started through start_match: 0 if a won, 1 if b won,
+// -1 for a draw. Once every match of the round is in, the next round is
+// paired and started, or the tournament finishes.
+void tournament_report(Tournament *t, int matchId, int result);
+
+// A participant left. Their unfinished matches must still be reported by
+// the caller; future rounds give their opponents a walkover.
+void tournament_withdraw(Tournament *t, int participant);
+
+int tournament_is_over(const Tournament *t);
+int tournament_participants(const Tournament *t);
+TournamentFormat tournament_format(const Tournament *t);
+
+#endif
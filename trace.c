@@ -0,0 +1,132 @@
+#include "trace.h"
+#include "logger.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TRACE_RING_RECORDS 8192         // per thread, a power of two
+#define TRACE_MAX_LISTED 64
+#define TRACE_IDLE_NS 5000000
+
+// Single producer (the owning thread), single consumer (the writer thread).
+typedef struct TraceRing {
+    uint32_t head;
+    uint32_t tail;
+    uint64_t dropped;                   // written by the producer
+    uint64_t reported;                  // consumer only
+    uint16_t thread;
+    struct TraceRing *next;
+    TraceRecord records[TRACE_RING_RECORDS];
+} TraceRing;
+
+__thread int traceSession = -1;
+__thread int traceClient = -1;
+static __thread TraceRing *threadRing;
+static TraceRing *rings;
+static uint16_t nextThread;
+static FILE *traceFile;
+static pthread_t writerThread;
+static int running, stopping;
+static int sampleEvery;
+static int listed[TRACE_MAX_LISTED], numListed;
+
+static TraceRing *trace_ring(void) {
+    if (threadRing) return threadRing;
+    TraceRing *ring = calloc(1, sizeof(TraceRing));
+    if (!ring) return NULL;
+    ring->thread = __atomic_fetch_add(&nextThread, 1, __ATOMIC_RELAXED);
+    ring->next = __atomic_load_n(&rings, __ATOMIC_ACQUIRE);
+    while (!__atomic_compare_exchange_n(&rings, &ring->next, ring, 1, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE))
+        ;
+    return threadRing = ring;
+}
+
+void trace_record(TraceKind kind, uint64_t startNs, uint64_t endNs) {
+    TraceRing *ring = running ? trace_ring() : NULL;
+    if (!ring) return;
+    uint32_t head = ring->head;
+    if (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) == TRACE_RING_RECORDS) {
+        __atomic_store_n(&ring->dropped, ring->dropped + 1, __ATOMIC_RELAXED);
+        return;
+    }
+    ring->records[head & (TRACE_RING_RECORDS - 1)] = (TraceRecord){
+        startNs, endNs - startNs, traceSession, traceClient, (uint16_t)kind, ring->thread, 0};
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+static int drain(void) {
+    int written = 0;
+    for (TraceRing *ring = __atomic_load_n(&rings, __ATOMIC_ACQUIRE); ring; ring = ring->next) {
+        uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE), tail = ring->tail;
+        // At most two contiguous runs, split where the ring wraps.
+        while (tail != head) {
+            uint32_t at = tail & (TRACE_RING_RECORDS - 1);
+            uint32_t run = head - tail < TRACE_RING_RECORDS - at ? head - tail : TRACE_RING_RECORDS - at;
+            fwrite(&ring->records[at], sizeof(TraceRecord), run, traceFile);
+            tail += run;
+            written += run;
+            __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+        }
+        uint64_t dropped = __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED);
+        if (dropped != ring->reported) {
+            LOG_WARN("Trace: %llu spans dropped, ring full", (unsigned long long)(dropped - ring->reported));
+            ring->reported = dropped;
+        }
+    }
+    if (written) fflush(traceFile);
+    return written;
+}
+
+static void *writer_main(void *arg) {
+    struct timespec idle = {0, TRACE_IDLE_NS};
+    while (!__atomic_load_n(&stopping, __ATOMIC_ACQUIRE))
+        if (!drain()) nanosleep(&idle, NULL);
+    drain();
+    return NULL;
+}
+
+int trace_wants_session(int sessionId) {
+    if (!running) return 0;
+    if (sampleEvery > 0 && sessionId % sampleEvery == 0) return 1;
+    for (int i = 0; i < numListed; i++)
+        if (listed[i] == sessionId) return 1;
+    return 0;
+}
+
+int trace_start(const char *path, int every, const char *sessions) {
+    numListed = 0;
+    for (const char *p = sessions; p && *p && numListed < TRACE_MAX_LISTED;) {
+        char *end;
+        long id = strtol(p, &end, 10);
+        if (end == p) {
+            p++;
+            continue;
+        }
+        listed[numListed++] = (int)id;
+        p = end;
+    }
+    sampleEvery = every;
+    if (sampleEvery <= 0 && numListed == 0) return 0;
+    traceFile = fopen(path, "wb");
+    if (!traceFile) return -1;
+    TraceFileHeader header = {TRACE_MAGIC, trace_now()};
+    fwrite(&header, sizeof(header), 1, traceFile);
+    running = 1;
+    if (pthread_create(&writerThread, NULL, writer_main, NULL) != 0) {
+        running = 0;
+        fclose(traceFile);
+        return -1;
+    }
+    atexit(trace_stop);
+    return 1;
+}
+
+void trace_stop(void) {
+    if (!running) return;
+    __atomic_store_n(&stopping, 1, __ATOMIC_RELEASE);
+    pthread_join(writerThread, NULL);
+    running = 0;
+    fclose(traceFile);
+}
@@ -0,0 +1,77 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <time.h>
+
+// Per-session tracing. While a traced session's work runs, spans are
+// recorded with monotonic timestamps into the thread's own ring buffer and
+// a background thread appends them to a binary dump; trace_convert turns
+// the dump into Chrome trace / Perfetto JSON. For untraced sessions a span
+// costs one thread-local compare.
+typedef enum {
+    TRACE_READ,         // read() from the socket
+    TRACE_PARSE,        // splitting the input into lines
+    TRACE_TURN,         // one input line through the game
+    TRACE_VALIDATE,     // checking the move
+    TRACE_UPDATE,       // applying it to the game state
+    TRACE_SERIALIZE,    // rendering boards and messages
+    TRACE_SEND,         // send() of a reply as it is queued
+    TRACE_FLUSH,        // writing queued output once the socket is writable
+    TRACE_KIND_COUNT
+} TraceKind;
+
+#define TRACE_KIND_NAMES {"read", "parse", "turn", "validate", "update", "serialize", "send", "flush"}
+
+#define TRACE_MAGIC "GSTRACE1"
+
+// The dump is this header followed by TraceRecords, in the order each
+// thread recorded them.
+typedef struct {
+    char magic[8];
+    uint64_t startNs;
+} TraceFileHeader;
+
+typedef struct {
+    uint64_t startNs;
+    uint64_t durationNs;
+    int32_t session;
+    int32_t client;
+    uint16_t kind;
+    uint16_t thread;
+    uint32_t reserved;
+} TraceRecord;
+
+extern __thread int traceSession;   // -1 when the current work is not traced
+extern __thread int traceClient;
+
+void trace_record(TraceKind kind, uint64_t startNs, uint64_t endNs);
+
+static inline uint64_t trace_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// Attributes the spans that follow to a session (-1 for none) and client.
+static inline void trace_enter(int session, int client) {
+    traceSession = session;
+    traceClient = client;
+}
+
+static inline uint64_t trace_begin(void) {
+    return traceSession >= 0 ? trace_now() : 0;
+}
+
+static inline void trace_end(TraceKind kind, uint64_t start) {
+    if (start) trace_record(kind, start, trace_now());
+}
+
+// Starts writing to path. sampleEvery traces session ids divisible by it
+// (0 = none, 1 = all); sessions lists ids that are always traced. Returns 1
+// when tracing, 0 when no session is selected and -1 when it cannot start.
+int trace_start(const char *path, int sampleEvery, const char *sessions);
+void trace_stop(void);
+int trace_wants_session(int sessionId);
+
+#endif
@@ -0,0 +1,51 @@
+// Converts a server trace dump (see trace.h) to Chrome trace JSON, which
+// chrome://tracing and ui.perfetto.dev open directly. Each traced session
+// is shown as its own track.
+// Usage: ./trace_convert trace.bin > trace.json
+#include <stdio.h>
+#include <string.h>
+#include "trace.h"
+
+#define MAX_TRACKS 65536
+
+static const char *kindNames[] = TRACE_KIND_NAMES;
+static unsigned char named[MAX_TRACKS / 8];
+
+int main(int argc, char *argv[]) {
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s trace.bin > trace.json\n", argv[0]);
+        return 1;
+    }
+    FILE *in = fopen(argv[1], "rb");
+    if (!in) {
+        perror(argv[1]);
+        return 1;
+    }
+    TraceFileHeader header;
+    if (fread(&header, sizeof(header), 1, in) != 1 || memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0) {
+        fprintf(stderr, "%s: not a trace dump\n", argv[1]);
+        return 1;
+    }
+
+    TraceRecord r;
+    long events = 0;
+    printf("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    while (fread(&r, sizeof(r), 1, in) == 1) {
+        if (r.kind >= TRACE_KIND_COUNT || r.session < 0) continue;
+        if (r.session < MAX_TRACKS && !(named[r.session / 8] & (1 << r.session % 8))) {
+            named[r.session / 8] |= 1 << r.session % 8;
+            printf("%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"session %d\"}}",
+                   events++ ? ",\n" : "", r.session, r.session);
+        }
+        // Timestamps are microseconds since the dump started.
+        long long start = (long long)(r.startNs - header.startNs);
+        printf("%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%lld.%03lld,\"dur\":%llu.%03llu,"
+               "\"args\":{\"client\":%d,\"thread\":%u}}",
+               events++ ? ",\n" : "", kindNames[r.kind], r.session, start / 1000, start % 1000,
+               (unsigned long long)r.durationNs / 1000, (unsigned long long)r.durationNs % 1000, r.client, r.thread);
+    }
+    printf("\n]}\n");
+    fclose(in);
+    fprintf(stderr, "%ld events\n", events);
+    return 0;
+}
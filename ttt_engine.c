@@ -0,0 +1,283 @@
+#include "ttt_engine.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define TTT_WIN_SCORE 10000
+#define TTT_NODE_LIMIT 400000
+#define TTT_UNSOLVED 127
+
+enum { TT_EXACT, TT_LOWER, TT_UPPER };
+
+typedef struct {
+    TttMask me, opp;
+    int16_t score;
+    int8_t depth;
+    int8_t flag;
+    int8_t move;
+} TtEntry;
+
+struct TttBot {
+    const TttGeometry *geo;
+    TtEntry *tt;
+    uint64_t ttMask;
+    int order[TTT_MAX_CELLS];   // cells from the centre outwards
+    long nodes;
+    int aborted;
+};
+
+static const int directions[4][2] = {{0, 1}, {1, 0}, {1, 1}, {1, -1}};
+
+static uint32_t pow3_cell(int cell) {
+    uint32_t p = 1;
+    while (cell-- > 0) p *= 3;
+    return p;
+}
+
+static uint32_t table_index(TttMask x, TttMask o) {
+    uint32_t idx = 0, p = 1;
+    for (int c = 0; x | o; c++, x >>= 1, o >>= 1, p *= 3) {
+        if (x & 1) idx += p;
+        else if (o & 1) idx += 2 * p;
+    }
+    return idx;
+}
+
+// Fills the perfect-play table for every position reachable from the
+// current one. Scores are from the side to move: positive wins, and a
+// larger magnitude means the result comes sooner.
+static int solve_table(TttGeometry *geo, TttMask x, TttMask o, uint32_t idx) {
+    if (geo->tableScore[idx] != TTT_UNSOLVED) return geo->tableScore[idx];
+    int xToMove = __builtin_popcountll(x) == __builtin_popcountll(o);
+    TttMask me = xToMove ? x : o;
+    TttMask empty = geo->full & ~(x | o);
+    int best = -TTT_UNSOLVED, bestMove = -1;
+    while (empty) {
+        int c = __builtin_ctzll(empty);
+        TttMask bit = (TttMask)1 << c;
+        empty &= empty - 1;
+        int score;
+        int left = __builtin_popcountll(geo->full & ~(x | o | bit));
+        if (ttt_is_win(geo, me | bit, c)) {
+            score = left + 1;
+        } else if (!left) {
+            score = 0;
+        } else {
+            uint32_t child = idx + (xToMove ? 1 : 2) * pow3_cell(c);
+            score = xToMove ? -solve_table(geo, x | bit, o, child) : -solve_table(geo, x, o | bit, child);
+        }
+        if (score > best) {
+            best = score;
+            bestMove = c;
+        }
+    }
+    if (bestMove < 0) best = 0;
+    geo->tableScore[idx] = best;
+    geo->tableMove[idx] = bestMove;
+    return best;
+}
+
+int ttt_geometry_init(TttGeometry *geo, int rows, int cols, int k) {
+    memset(geo, 0, sizeof(*geo));
+    if (rows < 1 || cols < 1 || k < 1 || rows * cols > TTT_MAX_CELLS) return -1;
+    geo->rows = rows;
+    geo->cols = cols;
+    geo->k = k;
+    geo->cells = rows * cols;
+    geo->full = geo->cells == 64 ? ~(TttMask)0 : (((TttMask)1 << geo->cells) - 1);
+
+    int maxLines = geo->cells * 4;
+    geo->lines = malloc(maxLines * sizeof(TttMask));
+    if (!geo->lines) return -1;
+    for (int r = 0; r < rows; r++) {
+        for (int c = 0; c < cols; c++) {
+            for (int d = 0; d < (k == 1 ? 1 : 4); d++) {
+                int er = r + directions[d][0] * (k - 1);
+                int ec = c + directions[d][1] * (k - 1);
+                if (er < 0 || er >= rows || ec < 0 || ec >= cols) continue;
+                TttMask line = 0;
+                for (int i = 0; i < k; i++)
+                    line |= (TttMask)1 << ((r + directions[d][0] * i) * cols + c + directions[d][1] * i);
+                geo->lines[geo->lineCount++] = line;
+            }
+        }
+    }
+    if (geo->lineCount == 0) {
+        ttt_geometry_free(geo);
+        return -1;
+    }
+
+    int total = 0;
+    for (int c = 0; c < geo->cells; c++) {
+        geo->cellLineStart[c] = total;
+        for (int l = 0; l < geo->lineCount; l++) total += (geo->lines[l] >> c) & 1;
+    }
+    geo->cellLineStart[geo->cells] = total;
+    geo->cellLines = malloc(total * sizeof(int));
+    if (!geo->cellLines) {
+        ttt_geometry_free(geo);
+        return -1;
+    }
+    for (int c = 0, n = 0; c < geo->cells; c++)
+        for (int l = 0; l < geo->lineCount; l++)
+            if ((geo->lines[l] >> c) & 1) geo->cellLines[n++] = l;
+
+    if (geo->cells <= TTT_TABLE_MAX_CELLS) {
+        uint32_t states = pow3_cell(geo->cells);
+        geo->tableScore = malloc(states);
+        geo->tableMove = malloc(states);
+        if (!geo->tableScore || !geo->tableMove) {
+            ttt_geometry_free(geo);
+            return -1;
+        }
+        memset(geo->tableScore, TTT_UNSOLVED, states);
+        memset(geo->tableMove, -1, states);
+        solve_table(geo, 0, 0, 0);
+    }
+    return 0;
+}
+
+void ttt_geometry_free(TttGeometry *geo) {
+    free(geo->lines);
+    free(geo->cellLines);
+    free(geo->tableScore);
+    free(geo->tableMove);
+    geo->lines = NULL;
+    geo->cellLines = NULL;
+    geo->tableScore = NULL;
+    geo->tableMove = NULL;
+    geo->lineCount = 0;
+}
+
+int ttt_has_win(const TttGeometry *geo, TttMask mine) {
+    for (int l = 0; l < geo->lineCount; l++)
+        if ((mine & geo->lines[l]) == geo->lines[l]) return 1;
+    return 0;
+}
+
+TttBot *ttt_bot_create(const TttGeometry *geo, int ttBits) {
+    TttBot *bot = calloc(1, sizeof(TttBot));
+    if (!bot) return NULL;
+    bot->geo = geo;
+    if (geo->tableScore == NULL) {
+        bot->tt = calloc((size_t)1 << ttBits, sizeof(TtEntry));
+        if (!bot->tt) {
+            free(bot);
+            return NULL;
+        }
+        bot->ttMask = ((uint64_t)1 << ttBits) - 1;
+    }
+    // Centre cells take part in the most lines, so try them first.
+    int weight[TTT_MAX_CELLS];
+    for (int c = 0; c < geo->cells; c++) {
+        bot->order[c] = c;
+        weight[c] = geo->cellLineStart[c + 1] - geo->cellLineStart[c];
+    }
+    for (int i = 1; i < geo->cells; i++) {
+        int c = bot->order[i], j = i;
+        while (j > 0 && weight[bot->order[j - 1]] < weight[c]) {
+            bot->order[j] = bot->order[j - 1];
+            j--;
+        }
+        bot->order[j] = c;
+    }
+    return bot;
+}
+
+void ttt_bot_free(TttBot *bot) {
+    if (!bot) return;
+    free(bot->tt);
+    free(bot);
+}
+
+static uint64_t position_hash(TttMask me, TttMask opp) {
+    uint64_t h = me * 0x9E3779B97F4A7C15ull ^ (opp + 0x632BE59BD9B4E019ull) * 0xC2B2AE3D27D4EB4Full;
+    return h ^ (h >> 31);
+}
+
+// Open lines weighted by how many stones they already hold.
+static int evaluate(const TttGeometry *geo, TttMask me, TttMask opp) {
+    int score = 0;
+    for (int l = 0; l < geo->lineCount; l++) {
+        TttMask line = geo->lines[l];
+        int mine = __builtin_popcountll(line & me);
+        int theirs = __builtin_popcountll(line & opp);
+        if (!theirs && mine) score += 1 << (2 * mine);
+        else if (!mine && theirs) score -= 1 << (2 * theirs);
+    }
+    return score > TTT_WIN_SCORE / 2 ? TTT_WIN_SCORE / 2 : score < -TTT_WIN_SCORE / 2 ? -TTT_WIN_SCORE / 2 : score;
+}
+
+static int negamax(TttBot *bot, TttMask me, TttMask opp, int depth, int alpha, int beta, int ply, int *bestOut) {
+    const TttGeometry *geo = bot->geo;
+    if (++bot->nodes > TTT_NODE_LIMIT) {
+        bot->aborted = 1;
+        return 0;
+    }
+    if (depth == 0) return evaluate(geo, me, opp);
+
+    TtEntry *entry = &bot->tt[position_hash(me, opp) & bot->ttMask];
+    int ttMove = -1;
+    if (entry->me == me && entry->opp == opp && (me | opp)) {
+        ttMove = entry->move;
+        if (entry->depth >= depth && !bestOut) {
+            if (entry->flag == TT_EXACT) return entry->score;
+            if (entry->flag == TT_LOWER && entry->score >= beta) return entry->score;
+            if (entry->flag == TT_UPPER && entry->score <= alpha) return entry->score;
+        }
+    }
+
+    int alphaOrig = alpha, best = -TTT_WIN_SCORE - 1, bestMove = -1;
+    TttMask empty = geo->full & ~(me | opp);
+    for (int i = -1; i < geo->cells; i++) {
+        int c = i < 0 ? ttMove : bot->order[i];
+        if (c < 0 || (i >= 0 && c == ttMove)) continue;
+        TttMask bit = (TttMask)1 << c;
+        if (!(empty & bit)) continue;
+        int score;
+        if (ttt_is_win(geo, me | bit, c)) score = TTT_WIN_SCORE - ply;
+        else if ((me | opp | bit) == geo->full) score = 0;
+        else score = -negamax(bot, opp, me | bit, depth - 1, -beta, -alpha, ply + 1, NULL);
+        if (bot->aborted) return 0;
+        if (score > best) {
+            best = score;
+            bestMove = c;
+        }
+        if (score > alpha) alpha = score;
+        if (alpha >= beta) break;
+    }
+
+    entry->me = me;
+    entry->opp = opp;
+    entry->score = best;
+    entry->depth = depth;
+    entry->move = bestMove;
+    entry->flag = best <= alphaOrig ? TT_UPPER : best >= beta ? TT_LOWER : TT_EXACT;
+    if (bestOut) *bestOut = bestMove;
+    return best;
+}
+
+int ttt_best_move(TttBot *bot, TttMask toMove, TttMask other, int maxDepth) {
+    const TttGeometry *geo = bot->geo;
+    if (ttt_is_full(geo, toMove, other)) return -1;
+    if (geo->tableMove) {
+        int xToMove = __builtin_popcountll(toMove) == __builtin_popcountll(other);
+        uint32_t idx = xToMove ? table_index(toMove, other) : table_index(other, toMove);
+        if (geo->tableScore[idx] != TTT_UNSOLVED && geo->tableMove[idx] >= 0) return geo->tableMove[idx];
+    }
+    int best = -1;
+    for (int c = 0; c < geo->cells && best < 0; c++)
+        if (!(((toMove | other) >> bot->order[c]) & 1)) best = bot->order[c];
+    if (!bot->tt) return best;
+
+    bot->nodes = 0;
+    bot->aborted = 0;
+    for (int depth = 1; depth <= maxDepth; depth++) {
+        int move = -1;
+        int score = negamax(bot, toMove, other, depth, -TTT_WIN_SCORE - 1, TTT_WIN_SCORE + 1, 0, &move);
+        if (bot->aborted) break;
+        if (move >= 0) best = move;
+        if (score >= TTT_WIN_SCORE - maxDepth || score <= -TTT_WIN_SCORE + maxDepth) break;
+    }
+    return best;
+}
@@ -0,0 +1,56 @@
+#ifndef TTT_ENGINE_H
+#define TTT_ENGINE_H
+
+#include <stdint.h>
+
+#define TTT_MAX_CELLS 64
+#define TTT_TABLE_MAX_CELLS 12      // boards up to this size get a full perfect-play table
+
+typedef uint64_t TttMask;           // bit r * cols + c is cell (r, c)
+
+// Precomputed geometry of an m x n board with k in a row. Immutable after
+// ttt_geometry_init, so it can be shared between sessions and threads.
+typedef struct {
+    int rows, cols, k;
+    int cells;
+    TttMask full;
+    int lineCount;
+    TttMask *lines;
+    int cellLineStart[TTT_MAX_CELLS + 1];   // lines through cell c are
+    int *cellLines;                         // cellLines[cellLineStart[c] .. cellLineStart[c + 1])
+    // Perfect play for small boards, indexed by the base-3 encoding of the
+    // position: score from the side to move's view, and its best cell.
+    int8_t *tableScore;
+    int8_t *tableMove;
+} TttGeometry;
+
+// Search state for boards too large for the table. Not shared between threads.
+typedef struct TttBot TttBot;
+
+int ttt_geometry_init(TttGeometry *geo, int rows, int cols, int k);
+void ttt_geometry_free(TttGeometry *geo);
+
+// True if mine completes a line through lastCell.
+static inline int ttt_is_win(const TttGeometry *geo, TttMask mine, int lastCell) {
+    for (int i = geo->cellLineStart[lastCell]; i < geo->cellLineStart[lastCell + 1]; i++) {
+        TttMask line = geo->lines[geo->cellLines[i]];
+        if ((mine & line) == line) return 1;
+    }
+    return 0;
+}
+
+static inline int ttt_is_full(const TttGeometry *geo, TttMask x, TttMask o) {
+    return (x | o) == geo->full;
+}
+
+int ttt_has_win(const TttGeometry *geo, TttMask mine);
+
+TttBot *ttt_bot_create(const TttGeometry *geo, int ttBits);
+void ttt_bot_free(TttBot *bot);
+
+// Best cell for the player owning toMove, or -1 if the board is full.
+// Uses the perfect-play table when the geometry has one, otherwise an
+// iterative-deepening negamax limited to maxDepth plies.
+int ttt_best_move(TttBot *bot, TttMask toMove, TttMask other, int maxDepth);
+
+#endif
@@ -0,0 +1,97 @@
+// Microbenchmark for the Wordle feedback kernels and the hint solver.
+// Usage: ./wordle_bench [answers_file] [allowed_file]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "wordle_dict.h"
+#include "wordle_solver.h"
+
+#define MIN_BENCH_SECONDS 0.5
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int verify_kernel(const WordleSolver *solver, uint8_t *out) {
+    for (int g = 0; g < solver->guesses.count; g++) {
+        wordle_patterns(solver->guesses.words[g], &solver->answers, out);
+        for (int a = 0; a < solver->answers.count; a++) {
+            if (out[a] != wordle_pattern(solver->guesses.words[g], solver->answers.words[a])) {
+                printf("MISMATCH guess=%.5s answer=%.5s\n", solver->guesses.words[g], solver->answers.words[a]);
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+static void bench_kernel(const WordleSolver *solver, WordleKernel kernel, uint8_t *out) {
+    WordleKernel used = wordle_kernel_select(kernel);
+    if (used != kernel) return;
+    int ok = verify_kernel(solver, out);
+    double start = now_seconds(), elapsed;
+    long pairs = 0;
+    unsigned sink = 0;
+    do {
+        for (int g = 0; g < solver->guesses.count; g++) {
+            wordle_patterns(solver->guesses.words[g], &solver->answers, out);
+            sink += out[g % solver->answers.count];
+        }
+        pairs += (long)solver->guesses.count * solver->answers.count;
+        elapsed = now_seconds() - start;
+    } while (elapsed < MIN_BENCH_SECONDS);
+    printf("kernel=%s verified=%d pairs=%ld seconds=%.3f pairs_per_sec=%.0f sink=%u\n",
+           wordle_kernel_name(used), ok, pairs, elapsed, pairs / elapsed, sink & 1);
+}
+
+static void bench_hint(const WordleSolver *solver, const char *label) {
+    char guesses[1][6] = {"CRANE"};
+    uint8_t patterns[1];
+    char best[6];
+    patterns[0] = wordle_pattern("CRANE", solver->answers.words[solver->answers.count / 2]);
+
+    double start = now_seconds();
+    int left = wordle_solver_hint(solver, guesses, patterns, 0, best);
+    double opening = now_seconds() - start;
+    printf("hint=%s history=0 candidates=%d best=%s ms=%.3f\n", label, left, best, opening * 1e3);
+
+    start = now_seconds();
+    left = wordle_solver_hint(solver, guesses, patterns, 1, best);
+    double second = now_seconds() - start;
+    printf("hint=%s history=1 candidates=%d best=%s ms=%.3f\n", label, left, best, second * 1e3);
+}
+
+int main(int argc, char **argv) {
+    const char *answersPath = argc > 1 ? argv[1] : "data/wordle_answers.txt";
+    const char *allowedPath = argc > 2 ? argv[2] : "data/wordle_allowed.txt";
+    if (wordle_dict_load(answersPath, allowedPath) <= 0) {
+        printf("Cannot load dictionary\n");
+        return 1;
+    }
+
+    WordleSolver solver;
+    if (wordle_solver_init(&solver, 0) != 0) return 1;
+    printf("answers=%d guesses=%d\n", solver.answers.count, solver.guesses.count);
+    uint8_t *out = malloc(solver.answers.stride);
+
+    bench_kernel(&solver, WORDLE_KERNEL_SCALAR, out);
+    bench_kernel(&solver, WORDLE_KERNEL_SSE2, out);
+    bench_kernel(&solver, WORDLE_KERNEL_AVX2, out);
+    wordle_kernel_select(WORDLE_KERNEL_AUTO);
+    bench_hint(&solver, "kernel");
+    wordle_solver_free(&solver);
+
+    double start = now_seconds();
+    wordle_solver_init(&solver, 1);
+    printf("table_build_ms=%.3f table_bytes=%ld\n", (now_seconds() - start) * 1e3,
+           (long)solver.guesses.count * solver.answers.stride);
+    bench_hint(&solver, "table");
+
+    wordle_solver_free(&solver);
+    free(out);
+    wordle_dict_unload();
+    return 0;
+}
@@ -0,0 +1,116 @@
+#include "wordle_dict.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define WORDLE_SET_BYTES ((size_t)1 << 22)  // one bit for every 25-bit packed word
+
+typedef struct {
+    const char *data;
+    size_t size;
+    int count;
+} WordFile;
+
+static WordFile answers, allowed;
+// Anonymous mapping: pages stay untouched (and unallocated) until a word
+// hashes into them, so the 4 MB bitmap costs almost nothing to set up.
+static uint8_t *validSet;
+
+static int map_word_file(const char *path, WordFile *file) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "[WORDLE] Cannot open %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0 || st.st_size % WORDLE_LINE_LEN != 0) {
+        fprintf(stderr, "[WORDLE] %s is not a list of %d-letter lines\n", path, WORDLE_WORD_LEN);
+        close(fd);
+        return -1;
+    }
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        fprintf(stderr, "[WORDLE] Cannot map %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    madvise(data, st.st_size, MADV_WILLNEED);
+    file->data = data;
+    file->size = st.st_size;
+    file->count = st.st_size / WORDLE_LINE_LEN;
+    return 0;
+}
+
+static void unmap_word_file(WordFile *file) {
+    if (file->data) munmap((void *)file->data, file->size);
+    file->data = NULL;
+    file->size = 0;
+    file->count = 0;
+}
+
+static int add_words(const WordFile *file, const char *path) {
+    for (int i = 0; i < file->count; i++) {
+        const char *word = file->data + (size_t)i * WORDLE_LINE_LEN;
+        uint32_t packed = wordle_pack(word);
+        if (packed == WORDLE_BAD_PACK || word[WORDLE_WORD_LEN] != '\n') {
+            fprintf(stderr, "[WORDLE] %s line %d is not an uppercase %d-letter word\n", path, i + 1, WORDLE_WORD_LEN);
+            return -1;
+        }
+        validSet[packed >> 3] |= 1u << (packed & 7);
+    }
+    return 0;
+}
+
+int wordle_dict_load(const char *answersPath, const char *allowedPath) {
+    wordle_dict_unload();
+    if (map_word_file(answersPath, &answers) != 0) return -1;
+    if (allowedPath && map_word_file(allowedPath, &allowed) != 0) {
+        fprintf(stderr, "[WORDLE] Only answers will be accepted as guesses\n");
+    }
+    validSet = mmap(NULL, WORDLE_SET_BYTES, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (validSet == MAP_FAILED) {
+        validSet = NULL;
+        wordle_dict_unload();
+        return -1;
+    }
+    if (add_words(&answers, answersPath) != 0 || (allowed.data && add_words(&allowed, allowedPath) != 0)) {
+        wordle_dict_unload();
+        return -1;
+    }
+    return answers.count;
+}
+
+void wordle_dict_unload(void) {
+    unmap_word_file(&answers);
+    unmap_word_file(&allowed);
+    if (validSet) munmap(validSet, WORDLE_SET_BYTES);
+    validSet = NULL;
+}
+
+int wordle_dict_answer_count(void) {
+    return answers.count;
+}
+
+int wordle_dict_allowed_count(void) {
+    return allowed.count;
+}
+
+const char *wordle_dict_answer(int index) {
+    return answers.data + (size_t)index * WORDLE_LINE_LEN;
+}
+
+const char *wordle_dict_allowed(int index) {
+    return allowed.data + (size_t)index * WORDLE_LINE_LEN;
+}
+
+int wordle_dict_is_valid(const char *guess) {
+    if (!validSet) return 1;
+    uint32_t packed = wordle_pack(guess);
+    if (packed == WORDLE_BAD_PACK) return 0;
+    return (validSet[packed >> 3] >> (packed & 7)) & 1;
+}
@@ -0,0 +1,39 @@
+#ifndef WORDLE_DICT_H
+#define WORDLE_DICT_H
+
+#include <stdint.h>
+
+#define WORDLE_WORD_LEN 5
+#define WORDLE_LINE_LEN 6           // five letters plus '\n'
+#define WORDLE_BAD_PACK 0xFFFFFFFFu
+
+// Packs an uppercase five-letter word into 25 bits, 5 bits per letter.
+// Returns WORDLE_BAD_PACK if any character is not A-Z.
+static inline uint32_t wordle_pack(const char *word) {
+    uint32_t packed = 0;
+    for (int i = 0; i < WORDLE_WORD_LEN; i++) {
+        unsigned c = (unsigned char)word[i] - 'A';
+        if (c >= 26) return WORDLE_BAD_PACK;
+        packed |= c << (5 * i);
+    }
+    return packed;
+}
+
+// Maps the answer and allowed-guess files. Both are sorted lists of
+// uppercase words, one per line, so each file is an array of fixed
+// WORDLE_LINE_LEN records. allowedPath may be NULL. Returns the number of
+// answers, or -1 if the answer file is missing or malformed.
+int wordle_dict_load(const char *answersPath, const char *allowedPath);
+void wordle_dict_unload(void);
+
+int wordle_dict_answer_count(void);
+int wordle_dict_allowed_count(void);
+
+// Pointers into the mapped files. The words are not NUL-terminated.
+const char *wordle_dict_answer(int index);
+const char *wordle_dict_allowed(int index);
+
+// O(1) membership test against answers plus allowed guesses.
+int wordle_dict_is_valid(const char *guess);
+
+#endif
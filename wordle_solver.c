@@ -0,0 +1,291 @@
+#include "wordle_solver.h"
+#include "wordle_dict.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define WORDLE_HAVE_X86 1
+#endif
+
+#define WORDLE_BLOCK 32         // AVX2 lanes; stride is a multiple of this
+#define WORDLE_PAD_LETTER 31    // never equal to a real letter
+
+static const uint8_t pow3[5] = {1, 3, 9, 27, 81};
+
+int wordle_wordset_init(WordleWordSet *set, int capacity) {
+    set->count = 0;
+    set->stride = (capacity + WORDLE_BLOCK - 1) / WORDLE_BLOCK * WORDLE_BLOCK;
+    if (set->stride == 0) set->stride = WORDLE_BLOCK;
+    set->letters = malloc((size_t)set->stride * 5);
+    set->words = malloc((size_t)set->stride * sizeof(char *));
+    if (!set->letters || !set->words) {
+        wordle_wordset_free(set);
+        return -1;
+    }
+    memset(set->letters, WORDLE_PAD_LETTER, (size_t)set->stride * 5);
+    return 0;
+}
+
+void wordle_wordset_add(WordleWordSet *set, const char *word) {
+    for (int pos = 0; pos < 5; pos++) set->letters[pos * set->stride + set->count] = word[pos] - 'A';
+    set->words[set->count++] = word;
+}
+
+void wordle_wordset_free(WordleWordSet *set) {
+    free(set->letters);
+    free(set->words);
+    set->letters = NULL;
+    set->words = NULL;
+    set->count = 0;
+}
+
+uint8_t wordle_pattern(const char *guess, const char *answer) {
+    int remaining[26] = {0};
+    uint8_t pattern = 0;
+    int green[5];
+    for (int i = 0; i < 5; i++) {
+        green[i] = guess[i] == answer[i];
+        if (green[i]) pattern += 2 * pow3[i];
+        else remaining[answer[i] - 'A']++;
+    }
+    for (int i = 0; i < 5; i++) {
+        if (!green[i] && remaining[guess[i] - 'A'] > 0) {
+            remaining[guess[i] - 'A']--;
+            pattern += pow3[i];
+        }
+    }
+    return pattern;
+}
+
+// The vector kernels work on many answers at once, one byte lane each.
+// Position i is yellow when it is not green and fewer earlier non-green
+// positions of the guess share its letter than there are non-green answer
+// positions holding that letter. That is the same left-to-right rule as
+// the scalar version, but expressed only with compares, ANDs and adds.
+static void patterns_scalar(const uint8_t *g, const WordleWordSet *set, uint8_t *out) {
+    for (int w = 0; w < set->count; w++) {
+        uint8_t a[5];
+        int green[5];
+        uint8_t pattern = 0;
+        for (int j = 0; j < 5; j++) a[j] = set->letters[j * set->stride + w];
+        for (int i = 0; i < 5; i++) green[i] = a[i] == g[i];
+        for (int i = 0; i < 5; i++) {
+            if (green[i]) {
+                pattern += 2 * pow3[i];
+                continue;
+            }
+            int avail = 0, prior = 0;
+            for (int j = 0; j < 5; j++) avail += !green[j] && a[j] == g[i];
+            for (int k = 0; k < i; k++) prior += !green[k] && g[k] == g[i];
+            if (prior < avail) pattern += pow3[i];
+        }
+        out[w] = pattern;
+    }
+}
+
+#ifdef WORDLE_HAVE_X86
+__attribute__((target("sse2")))
+static void patterns_sse2(const uint8_t *g, const WordleWordSet *set, uint8_t *out) {
+    const __m128i ones = _mm_set1_epi8(-1);
+    for (int base = 0; base < set->count; base += 16) {
+        __m128i a[5], green[5], notGreen[5];
+        for (int j = 0; j < 5; j++) {
+            a[j] = _mm_loadu_si128((const __m128i *)(set->letters + j * set->stride + base));
+            green[j] = _mm_cmpeq_epi8(a[j], _mm_set1_epi8(g[j]));
+            notGreen[j] = _mm_xor_si128(green[j], ones);
+        }
+        __m128i pattern = _mm_and_si128(green[0], _mm_set1_epi8(2 * pow3[0]));
+        for (int i = 1; i < 5; i++) pattern = _mm_add_epi8(pattern, _mm_and_si128(green[i], _mm_set1_epi8(2 * pow3[i])));
+        for (int i = 0; i < 5; i++) {
+            __m128i letter = _mm_set1_epi8(g[i]);
+            __m128i avail = _mm_setzero_si128();
+            __m128i prior = _mm_setzero_si128();
+            // Masks are -1 per lane, so subtracting them counts.
+            for (int j = 0; j < 5; j++) avail = _mm_sub_epi8(avail, _mm_and_si128(notGreen[j], _mm_cmpeq_epi8(a[j], letter)));
+            for (int k = 0; k < i; k++) if (g[k] == g[i]) prior = _mm_sub_epi8(prior, notGreen[k]);
+            __m128i yellow = _mm_and_si128(notGreen[i], _mm_cmpgt_epi8(avail, prior));
+            pattern = _mm_add_epi8(pattern, _mm_and_si128(yellow, _mm_set1_epi8(pow3[i])));
+        }
+        _mm_storeu_si128((__m128i *)(out + base), pattern);
+    }
+}
+
+__attribute__((target("avx2")))
+static void patterns_avx2(const uint8_t *g, const WordleWordSet *set, uint8_t *out) {
+    const __m256i ones = _mm256_set1_epi8(-1);
+    for (int base = 0; base < set->count; base += 32) {
+        __m256i a[5], green[5], notGreen[5];
+        for (int j = 0; j < 5; j++) {
+            a[j] = _mm256_loadu_si256((const __m256i *)(set->letters + j * set->stride + base));
+            green[j] = _mm256_cmpeq_epi8(a[j], _mm256_set1_epi8(g[j]));
+            notGreen[j] = _mm256_xor_si256(green[j], ones);
+        }
+        __m256i pattern = _mm256_and_si256(green[0], _mm256_set1_epi8(2 * pow3[0]));
+        for (int i = 1; i < 5; i++) pattern = _mm256_add_epi8(pattern, _mm256_and_si256(green[i], _mm256_set1_epi8(2 * pow3[i])));
+        for (int i = 0; i < 5; i++) {
+            __m256i letter = _mm256_set1_epi8(g[i]);
+            __m256i avail = _mm256_setzero_si256();
+            __m256i prior = _mm256_setzero_si256();
+            for (int j = 0; j < 5; j++) avail = _mm256_sub_epi8(avail, _mm256_and_si256(notGreen[j], _mm256_cmpeq_epi8(a[j], letter)));
+            for (int k = 0; k < i; k++) if (g[k] == g[i]) prior = _mm256_sub_epi8(prior, notGreen[k]);
+            __m256i yellow = _mm256_and_si256(notGreen[i], _mm256_cmpgt_epi8(avail, prior));
+            pattern = _mm256_add_epi8(pattern, _mm256_and_si256(yellow, _mm256_set1_epi8(pow3[i])));
+        }
+        _mm256_storeu_si256((__m256i *)(out + base), pattern);
+    }
+}
+#endif
+
+typedef void (*PatternKernel)(const uint8_t *g, const WordleWordSet *set, uint8_t *out);
+
+static PatternKernel activeKernel;
+static WordleKernel activeKernelId;
+
+WordleKernel wordle_kernel_select(WordleKernel kernel) {
+    activeKernel = patterns_scalar;
+    activeKernelId = WORDLE_KERNEL_SCALAR;
+#ifdef WORDLE_HAVE_X86
+    __builtin_cpu_init();
+    int avx2 = __builtin_cpu_supports("avx2");
+    if ((kernel == WORDLE_KERNEL_AUTO || kernel == WORDLE_KERNEL_AVX2) && avx2) {
+        activeKernel = patterns_avx2;
+        activeKernelId = WORDLE_KERNEL_AVX2;
+    } else if (kernel != WORDLE_KERNEL_SCALAR) {
+        activeKernel = patterns_sse2;
+        activeKernelId = WORDLE_KERNEL_SSE2;
+    }
+#else
+    (void)kernel;
+#endif
+    return activeKernelId;
+}
+
+const char *wordle_kernel_name(WordleKernel kernel) {
+    switch (kernel) {
+        case WORDLE_KERNEL_SCALAR: return "scalar";
+        case WORDLE_KERNEL_SSE2: return "sse2";
+        case WORDLE_KERNEL_AVX2: return "avx2";
+        default: return "auto";
+    }
+}
+
+void wordle_patterns(const char *guess, const WordleWordSet *set, uint8_t *out) {
+    uint8_t g[5];
+    if (!activeKernel) wordle_kernel_select(WORDLE_KERNEL_AUTO);
+    for (int i = 0; i < 5; i++) g[i] = guess[i] - 'A';
+    activeKernel(g, set, out);
+}
+
+int wordle_solver_init(WordleSolver *solver, int precompute) {
+    int answers = wordle_dict_answer_count();
+    int allowed = wordle_dict_allowed_count();
+    memset(solver, 0, sizeof(*solver));
+    if (answers <= 0) return -1;
+    if (wordle_wordset_init(&solver->answers, answers) != 0 ||
+        wordle_wordset_init(&solver->guesses, answers + allowed) != 0) {
+        wordle_solver_free(solver);
+        return -1;
+    }
+    for (int i = 0; i < answers; i++) {
+        wordle_wordset_add(&solver->answers, wordle_dict_answer(i));
+        wordle_wordset_add(&solver->guesses, wordle_dict_answer(i));
+    }
+    for (int i = 0; i < allowed; i++) wordle_wordset_add(&solver->guesses, wordle_dict_allowed(i));
+
+    solver->nlogn = malloc((answers + 1) * sizeof(float));
+    if (!solver->nlogn) {
+        wordle_solver_free(solver);
+        return -1;
+    }
+    solver->nlogn[0] = 0;
+    for (int n = 1; n <= answers; n++) solver->nlogn[n] = n * log2f(n);
+
+    if (precompute) {
+        // Rows are padded to the answer stride so the kernel can write whole blocks.
+        solver->table = malloc((size_t)solver->guesses.count * solver->answers.stride);
+        if (solver->table) {
+            for (int g = 0; g < solver->guesses.count; g++)
+                wordle_patterns(solver->guesses.words[g], &solver->answers,
+                                solver->table + (size_t)g * solver->answers.stride);
+        }
+    }
+    return 0;
+}
+
+void wordle_solver_free(WordleSolver *solver) {
+    wordle_wordset_free(&solver->answers);
+    wordle_wordset_free(&solver->guesses);
+    free(solver->table);
+    free(solver->nlogn);
+    solver->table = NULL;
+    solver->nlogn = NULL;
+}
+
+int wordle_solver_hint(const WordleSolver *solver, const char (*guesses)[6], const uint8_t *patterns,
+                       int history, char *best) {
+    const WordleWordSet *answers = &solver->answers;
+    int *candidates = malloc(answers->count * sizeof(int));
+    uint8_t *scratch = malloc(answers->stride > solver->guesses.stride ? answers->stride : solver->guesses.stride);
+    WordleWordSet subset = {0};
+    int count = 0;
+    if (!candidates || !scratch) goto done;
+
+    for (int i = 0; i < answers->count; i++) candidates[i] = i;
+    count = answers->count;
+    for (int h = 0; h < history && count > 0; h++) {
+        wordle_patterns(guesses[h], answers, scratch);
+        int kept = 0;
+        for (int c = 0; c < count; c++)
+            if (scratch[candidates[c]] == patterns[h]) candidates[kept++] = candidates[c];
+        count = kept;
+    }
+    if (count == 0) goto done;
+    if (count <= 2) {
+        memcpy(best, answers->words[candidates[0]], 5);
+        best[5] = '\0';
+        goto done;
+    }
+
+    if (!solver->table) {
+        if (wordle_wordset_init(&subset, count) != 0) {
+            count = 0;
+            goto done;
+        }
+        for (int c = 0; c < count; c++) wordle_wordset_add(&subset, answers->words[candidates[c]]);
+    }
+
+    // Expected information is log2(N) - sum(n log2 n) / N over the pattern
+    // buckets, so minimising sum(n log2 n) maximises it. Guesses that could
+    // themselves be the answer win ties.
+    float bestScore = INFINITY;
+    int bestGuess = 0, bestIsCandidate = 0;
+    for (int g = 0; g < solver->guesses.count; g++) {
+        uint16_t buckets[WORDLE_PATTERNS] = {0};
+        if (solver->table) {
+            const uint8_t *row = solver->table + (size_t)g * answers->stride;
+            for (int c = 0; c < count; c++) buckets[row[candidates[c]]]++;
+        } else {
+            wordle_patterns(solver->guesses.words[g], &subset, scratch);
+            for (int c = 0; c < count; c++) buckets[scratch[c]]++;
+        }
+        float score = 0;
+        for (int p = 0; p < WORDLE_PATTERNS; p++) score += solver->nlogn[buckets[p]];
+        int isCandidate = buckets[WORDLE_ALL_GREEN] > 0;
+        if (score < bestScore - 1e-4f || (score < bestScore + 1e-4f && isCandidate && !bestIsCandidate)) {
+            bestScore = score;
+            bestGuess = g;
+            bestIsCandidate = isCandidate;
+        }
+    }
+    memcpy(best, solver->guesses.words[bestGuess], 5);
+    best[5] = '\0';
+
+done:
+    wordle_wordset_free(&subset);
+    free(candidates);
+    free(scratch);
+    return count;
+}
@@ -0,0 +1,57 @@
+#ifndef WORDLE_SOLVER_H
+#define WORDLE_SOLVER_H
+
+#include <stdint.h>
+
+// A feedback pattern is a base-3 number with one digit per position,
+// position 0 least significant: 0 = gray, 1 = yellow, 2 = green.
+#define WORDLE_PATTERNS 243
+#define WORDLE_ALL_GREEN 242
+
+typedef enum { WORDLE_KERNEL_AUTO, WORDLE_KERNEL_SCALAR, WORDLE_KERNEL_SSE2, WORDLE_KERNEL_AVX2 } WordleKernel;
+
+// Words in structure-of-arrays form: letters[pos * stride + i] is letter
+// pos of word i as 0-25. stride is count rounded up to a full AVX2 block
+// and the padding lanes hold a value that never matches a letter.
+typedef struct {
+    int count;
+    int stride;
+    uint8_t *letters;
+    const char **words;     // original spelling, not NUL-terminated
+} WordleWordSet;
+
+typedef struct {
+    WordleWordSet answers;
+    WordleWordSet guesses;  // answers followed by the extra allowed guesses
+    uint8_t *table;         // optional guesses.count x answers.count patterns
+    float *nlogn;           // n * log2(n) for n up to answers.count
+} WordleSolver;
+
+int wordle_wordset_init(WordleWordSet *set, int capacity);
+void wordle_wordset_add(WordleWordSet *set, const char *word);
+void wordle_wordset_free(WordleWordSet *set);
+
+// Scalar reference for one (guess, answer) pair, both uppercase.
+uint8_t wordle_pattern(const char *guess, const char *answer);
+
+// Picks the kernel used by wordle_patterns. AUTO chooses the widest one the
+// CPU supports; an unsupported request falls back. Returns the kernel used.
+WordleKernel wordle_kernel_select(WordleKernel kernel);
+const char *wordle_kernel_name(WordleKernel kernel);
+
+// Feedback of one guess against every word in set; out must hold set->stride bytes.
+void wordle_patterns(const char *guess, const WordleWordSet *set, uint8_t *out);
+
+// Builds the solver from the loaded wordle_dict. With precompute set, every
+// (guess, answer) pattern is computed once up front and hints become table
+// lookups. Returns 0 on success.
+int wordle_solver_init(WordleSolver *solver, int precompute);
+void wordle_solver_free(WordleSolver *solver);
+
+// Suggests the guess with the highest expected information given the
+// guesses made so far and their patterns. Writes five letters plus NUL to
+// best and returns the number of answers still possible (0 if none).
+int wordle_solver_hint(const WordleSolver *solver, const char (*guesses)[6], const uint8_t *patterns,
+                       int history, char *best);
+
+#endif
@@ -0,0 +1,121 @@
+#include "worker_pool.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+struct WorkerPool {
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+    WorkerJob *head, *tail;         // waiting to run
+    WorkerJob *doneHead, *doneTail; // finished, not yet collected
+    int stopping;
+    int wakePipe[2];
+    int threads;
+    pthread_t *ids;
+    void *(*thread_init)(void *ctx);
+    void (*thread_free)(void *state);
+    void *ctx;
+};
+
+static void *worker_main(void *arg) {
+    WorkerPool *pool = arg;
+    void *state = pool->thread_init ? pool->thread_init(pool->ctx) : NULL;
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (!pool->head && !pool->stopping) pthread_cond_wait(&pool->ready, &pool->lock);
+        if (!pool->head) break;
+        WorkerJob *job = pool->head;
+        pool->head = job->next;
+        if (!pool->head) pool->tail = NULL;
+        pthread_mutex_unlock(&pool->lock);
+
+        job->run(job, state);
+
+        pthread_mutex_lock(&pool->lock);
+        job->next = NULL;
+        int wasEmpty = pool->doneHead == NULL;
+        if (pool->doneTail) pool->doneTail->next = job;
+        else pool->doneHead = job;
+        pool->doneTail = job;
+        // One byte per batch: the pipe stays readable until the batch is collected.
+        if (wasEmpty) {
+            char b = 1;
+            (void)!write(pool->wakePipe[1], &b, 1);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+    if (pool->thread_free) pool->thread_free(state);
+    return NULL;
+}
+
+WorkerPool *worker_pool_create(int threads, void *(*thread_init)(void *ctx), void (*thread_free)(void *state), void *ctx) {
+    WorkerPool *pool = calloc(1, sizeof(WorkerPool));
+    if (!pool) return NULL;
+    pool->ids = calloc(threads, sizeof(pthread_t));
+    if (!pool->ids || pipe(pool->wakePipe) != 0) {
+        free(pool->ids);
+        free(pool);
+        return NULL;
+    }
+    fcntl(pool->wakePipe[0], F_SETFL, O_NONBLOCK);
+    fcntl(pool->wakePipe[0], F_SETFD, FD_CLOEXEC);
+    fcntl(pool->wakePipe[1], F_SETFD, FD_CLOEXEC);
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->ready, NULL);
+    pool->thread_init = thread_init;
+    pool->thread_free = thread_free;
+    pool->ctx = ctx;
+    for (int i = 0; i < threads; i++) {
+        if (pthread_create(&pool->ids[pool->threads], NULL, worker_main, pool) == 0) pool->threads++;
+    }
+    if (pool->threads == 0) {
+        worker_pool_destroy(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+void worker_pool_destroy(WorkerPool *pool) {
+    if (!pool) return;
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = 1;
+    pthread_cond_broadcast(&pool->ready);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 0; i < pool->threads; i++) pthread_join(pool->ids[i], NULL);
+    close(pool->wakePipe[0]);
+    close(pool->wakePipe[1]);
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->ready);
+    free(pool->ids);
+    free(pool);
+}
+
+void worker_pool_submit(WorkerPool *pool, WorkerJob *job) {
+    job->next = NULL;
+    pthread_mutex_lock(&pool->lock);
+    if (pool->tail) pool->tail->next = job;
+    else pool->head = job;
+    pool->tail = job;
+    pthread_cond_signal(&pool->ready);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+int worker_pool_wake_fd(const WorkerPool *pool) {
+    return pool->wakePipe[0];
+}
+
+int worker_pool_threads(const WorkerPool *pool) {
+    return pool->threads;
+}
+
+WorkerJob *worker_pool_completed(WorkerPool *pool) {
+    char drain[64];
+    pthread_mutex_lock(&pool->lock);
+    WorkerJob *done = pool->doneHead;
+    pool->doneHead = pool->doneTail = NULL;
+    while (read(pool->wakePipe[0], drain, sizeof(drain)) > 0) {}
+    pthread_mutex_unlock(&pool->lock);
+    return done;
+}
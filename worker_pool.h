@@ -0,0 +1,26 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+// A fixed set of threads for work the event loop must not wait on. Jobs
+// are handed back to the submitting thread when done: wake_fd becomes
+// readable and worker_pool_completed returns them.
+typedef struct WorkerJob WorkerJob;
+struct WorkerJob {
+    // Runs on a worker; state is what thread_init returned for that worker.
+    void (*run)(WorkerJob *job, void *state);
+    WorkerJob *next;
+};
+
+typedef struct WorkerPool WorkerPool;
+
+// thread_init/thread_free may be NULL. Returns NULL if no thread starts.
+WorkerPool *worker_pool_create(int threads, void *(*thread_init)(void *ctx), void (*thread_free)(void *state), void *ctx);
+void worker_pool_destroy(WorkerPool *pool);
+
+void worker_pool_submit(WorkerPool *pool, WorkerJob *job);
+int worker_pool_wake_fd(const WorkerPool *pool);
+// Finished jobs, oldest first, linked through next. Also clears wake_fd.
+WorkerJob *worker_pool_completed(WorkerPool *pool);
+int worker_pool_threads(const WorkerPool *pool);
+
+#endif